@@ -21,6 +21,9 @@
 const uint32_t WIDTH = 800;
 const uint32_t HEIGHT = 600;
 
+// vertical field of view of the camera's projection in degrees, lod and texture streaming derive screen sizes from it
+const float CAMERA_FOV = 45.0f;
+
 // strings for the vulkan instance
 const std::string APP_NAME    = "Deferred Rendering";
 const std::string ENGINE_NAME = "No Engine";
@@ -31,9 +34,37 @@ const std::streamsize MAX_SIZE = 1048;
 // paths to the model
 const std::string MODEL_PATH = "C:\\Users\\Tommy\\Documents\\COMP4\\5822HighPerformanceGraphics\\A3\\Assets\\SuzanneGltf\\Suzanne.gltf";
 
+// upload the model's vertices in the packed (20 byte) format rather than the float (48 byte) layout. Needs
+// offscreen_packed.vert.spv and shadowmap_packed.vert.spv, built by compile.bat in the shaders directory
+const bool PACKED_VERTICES = false;
+
+// bytes of uniform data each frame in flight can push, per frame uniforms and per draw data
+const uint64_t UNIFORM_RING_FRAME_SIZE = 256 * 1024;
+
+// bytes of CPU side scratch memory each frame in flight can use, descriptor writes and GUI statistics
+const size_t FRAME_ARENA_SIZE = 1024 * 1024;
+
+// device memory the material textures' streamed levels may take, the smallest levels of each texture are always resident
+const uint64_t TEXTURE_STREAMING_BUDGET = 256ull * 1024 * 1024;
+
+// bytes of mip chains rebuilt by the texture streamer in a frame, a single chain larger than this still goes through
+const uint64_t TEXTURE_STREAMING_UPLOAD_SIZE = 16 * 1024 * 1024;
+
+// workers decoding the levels of streamed textures, few enough to leave the cores to the frame
+const uint32_t TEXTURE_STREAMING_THREADS = 2;
+
+// where the pipeline cache is kept between runs
+const std::string PIPELINE_CACHE_PATH = "pipeline_cache.bin";
+
+// where the options window writes the device memory report
+const std::string MEMORY_REPORT_PATH = "memory_report.json";
+
 // path to the skybox
 const std::string SKYBOX_PATH = "C:\\Users\\Tommy\\Documents\\Graphics\\CubeMaps\\sky\\";
 
+// block compressed cube map in the skybox directory, used instead of the png faces when present
+const std::string SKYBOX_KTX2 = "Skybox.ktx2";
+
 // forward rendering shader paths
 const std::string FWD_VERT_SHADER = "C:\\Users\\Tommy\\Documents\\COMP4\\5822HighPerformanceGraphics\\A3\\DeferredRendering\\src\\shaders\\forward.vert.spv";
 const std::string FWD_FRAG_SHADER = "C:\\Users\\Tommy\\Documents\\COMP4\\5822HighPerformanceGraphics\\A3\\DeferredRendering\\src\\shaders\\forward.frag.spv";
@@ -41,6 +72,7 @@ const std::string FWD_FRAG_SHADER = "C:\\Users\\Tommy\\Documents\\COMP4\\5822Hig
 // deferred rendering shader paths (offscreen, composition, skybox)
 const std::string OFF_VERT_SHADER = "C:\\Users\\Tommy\\Documents\\COMP4\\5822HighPerformanceGraphics\\A3\\DeferredRendering\\src\\shaders\\offscreen.vert.spv";
 const std::string OFF_FRAG_SHADER = "C:\\Users\\Tommy\\Documents\\COMP4\\5822HighPerformanceGraphics\\A3\\DeferredRendering\\src\\shaders\\offscreen.frag.spv";
+const std::string OFF_PACKED_VERT_SHADER = "C:\\Users\\Tommy\\Documents\\COMP4\\5822HighPerformanceGraphics\\A3\\DeferredRendering\\src\\shaders\\offscreen_packed.vert.spv";
 
 const std::string COMP_VERT_SHADER = "C:\\Users\\Tommy\\Documents\\COMP4\\5822HighPerformanceGraphics\\A3\\DeferredRendering\\src\\shaders\\composition.vert.spv";
 const std::string COMP_FRAG_SHADER = "C:\\Users\\Tommy\\Documents\\COMP4\\5822HighPerformanceGraphics\\A3\\DeferredRendering\\src\\shaders\\composition.frag.spv";
@@ -50,6 +82,7 @@ const std::string SKY_FRAG_SHADER = "C:\\Users\\Tommy\\Documents\\COMP4\\5822Hig
 
 const std::string SHADOWMAP_VERT_SHADER = "C:\\Users\\Tommy\\Documents\\COMP4\\5822HighPerformanceGraphics\\A3\\DeferredRendering\\src\\shaders\\shadowmap.vert.spv";
 const std::string SHADOWMAP_FRAG_SHADER = "C:\\Users\\Tommy\\Documents\\COMP4\\5822HighPerformanceGraphics\\A3\\DeferredRendering\\src\\shaders\\shadowmap.frag.spv";
+const std::string SHADOWMAP_PACKED_VERT_SHADER = "C:\\Users\\Tommy\\Documents\\COMP4\\5822HighPerformanceGraphics\\A3\\DeferredRendering\\src\\shaders\\shadowmap_packed.vert.spv";
 
 namespace Axes {
 	// world axes
@@ -27,6 +27,13 @@
 #include <hpg/Buffers.h>
 #include <hpg/Skybox.h>
 #include <hpg/ShadowMap.h>
+#include <hpg/UniformRing.h>
+#include <hpg/UploadManager.h>
+#include <hpg/DeletionQueue.h>
+#include <hpg/RenderTargetPool.h>
+#include <hpg/TextureStreamer.h>
+
+#include <utils/FrameArena.h>
 
 // glfw window library
 #define GLFW_INCLUDE_VULKAN
@@ -51,6 +58,7 @@ public:
 private:
     //-Initialise all our data for rendering---------------------------------------------------------------------//
     void initVulkan();
+    // rebuilds the swap chain and the resources that depend on its extent without waiting on the device
     void recreateVulkanData();
 
     //-Initialise Imgui data-------------------------------------------------------------------------------------//
@@ -64,9 +72,14 @@ private:
     void createDescriptorSetLayout();
     void createDescriptorPool();
     void createDescriptorSets();
+    void createCompositionDescriptorSets(); // the sets sampling the gBuffer attachments, rebuilt with them
+    VkDescriptorSet createMaterialDescriptorSet(UI32 materialIdx); // sampling the material's textures, rebuilt as they stream
 
     //-Update uniform buffer-------------------------------------------------------------------------------------//
-    void updateUniformBuffers(uint32_t currentImage);
+    void updateUniformBuffers(UI32 frameIdx);
+    // every set of the layout has the two dynamic uniform buffers, vertex (binding 0) and fragment (binding 4)
+    void bindDescriptorSet(VkCommandBuffer cmdBuffer, VkPipelineLayout layout, VkDescriptorSet set, 
+        UI32 vertexUniformOffset, UI32 fragmentUniformOffset = 0);
 
     //-Command buffer initialisation functions-------------------------------------------------------------------//
     void createCommandPool(VkCommandPool* commandPool, VkCommandPoolCreateFlags flags);
@@ -78,6 +91,22 @@ private:
     void buildOffscreenCommandBuffer(UI32 cmdBufferIndex);
     void buildShadowMapCommandBuffer(VkCommandBuffer cmdBuffer);
 
+    //-Level of detail and culling-------------------------------------------------------------------------------//
+    struct CullingView {
+        glm::vec4 planes[6]; // frustum planes in model space
+        glm::vec3 position;  // viewer position in model space
+        bool enabled;
+    };
+
+    UI32 selectLod(const Model::SubMesh& subMesh, const glm::vec3& viewPosition, F32 pixelsPerUnit);
+    CullingView getCullingView(const glm::mat4& modelViewProjection, const glm::vec3& viewPosition);
+    UI32 drawSubMesh(VkCommandBuffer cmdBuffer, const Model::SubMesh& subMesh, UI32 lodIdx, const CullingView& view); // returns the triangles drawn
+
+    //-Texture streaming-----------------------------------------------------------------------------------------//
+    // requests the texel density of the visible sub meshes' materials, updates the streamer and the descriptor sets
+    // of the materials whose textures changed
+    void streamTextures();
+
     //-Window/Input Callbacks------------------------------------------------------------------------------------//
     static void framebufferResizeCallback(GLFWwindow* window, int width, int height);
 
@@ -101,6 +130,7 @@ private:
     GLFWwindow* window;
 
     VulkanSetup vkSetup; // instance, device (logical, physical), ...
+    RenderTargetPool renderTargetPool; // attachment images, aliased and transient where possible
     SwapChain swapChain; // sc images, pipelines, ...
     FrameBuffer frameBuffer;
     GBuffer gBuffer;
@@ -109,9 +139,11 @@ private:
 
     Skybox skybox;
 
-    VulkanBuffer vertexBuffer;
-    VulkanBuffer indexBuffer;
-    std::vector<Texture> textures;
+    VulkanBuffer geometryBuffer; // vertices of every sub mesh, followed by their indices
+    VkDeviceSize indexBufferOffset = 0;
+    std::vector<Texture> textures; // two per material, albedo then metallic roughness
+    TextureStreamer textureStreamer; // the textures' mip levels resident on the device
+    F32 textureBudgetMb = 0.0f; // the streamer's budget, changed from the options window
 
     Light lights[1];
 
@@ -128,10 +160,27 @@ private:
     VkDescriptorSetLayout descriptorSetLayout;
     // descriptor set handles
     std::vector<VkDescriptorSet> compositionDescriptorSets; 
-    VkDescriptorSet offScreenDescriptorSet;
+    std::vector<VkDescriptorSet> offScreenDescriptorSets; // one per material, the last for sub meshes without one
     VkDescriptorSet skyboxDescriptorSet;
     VkDescriptorSet shadowMapDescriptorSet;
 
+    UploadManager uploadManager; // batches buffer and texture uploads into few submissions
+
+    DeletionQueue deletionQueue; // objects retired while frames in flight may still use them
+
+    UniformRing uniformRing; // uniforms of every pass, partitioned per frame in flight
+    struct UniformOffsets {
+        UI32 offScreen;
+        UI32 composition;
+        UI32 shadowMap;
+        UI32 skybox;
+    } uniformOffsets{}; // dynamic offsets of this frame's uniforms in the ring
+
+    FrameArena frameArena; // CPU side data of a frame, partitioned per frame in flight
+
+    UI64 numFrameHeapAllocations = 0; // by the last frame, none once in a steady state
+    UI64 numHeapAllocatingFrames = 0; // stops growing once the main loop reaches a steady state
+
     VkCommandPool renderCommandPool;
     std::vector<VkCommandBuffer> offScreenCommandBuffers;
     std::vector<VkCommandBuffer> renderCommandBuffers;
@@ -150,6 +199,13 @@ private:
     glm::vec3 translate = glm::vec3(0.0f);
     glm::vec3 rotate = glm::vec3(0.0f);;
     float scale = 1.0f;
+    glm::mat4 modelMatrix = glm::mat4(1.0f);
+    glm::mat4 viewProjection = glm::mat4(1.0f);
+
+    F32 lodThreshold = 1.0f; // largest screen space error of a level of detail, in pixels
+    UI32 numOffscreenTriangles = 0;
+    UI32 numShadowTriangles = 0;
+    bool meshletCulling = true;
     
     bool shouldExit         = false;
     bool framebufferResized = false;
@@ -0,0 +1,45 @@
+///////////////////////////////////////////////////////
+// AccessorView struct declaration
+///////////////////////////////////////////////////////
+
+//
+// A typed, non-owning view of a glTF accessor. It points straight into the buffer data 
+// (loaded or memory mapped) and knows the element stride and component type, so attributes can be read from
+// tightly packed, interleaved or strided buffer views without copying the buffer first.
+//
+
+#ifndef ACCESSOR_VIEW_H
+#define ACCESSOR_VIEW_H
+
+#include <hpg/Buffers.h> // raw buffer data
+
+#include <tiny_gltf.h>
+
+#include <vector>
+
+#include <stdint.h>
+
+
+struct AccessorView {
+    //-Create a view from a model accessor-----------------------------------------------------------------------//
+    // buffers holds the data of each gltf buffer, which need not be owned by the tinygltf model
+    static AccessorView fromAccessor(const tinygltf::Model& model, const std::vector<Buffer>& buffers, int accessorIdx);
+
+    //-Bulk conversion-------------------------------------------------------------------------------------------//
+    // write numOut floats per element to dst, advancing dst by dstStride bytes per element. Components the
+    // accessor lacks are set to fill, or wFill for the fourth, and integer components are normalised when the
+    // accessor says so. An accessor without a buffer view reads as zeros
+    void readFloats(float* dst, size_t dstStride, uint32_t numOut, float fill = 0.0f, float wFill = 0.0f) const;
+    // widen 8, 16 or 32 bit indices to 32 bit indices, adding baseVertex to each
+    void readIndices(uint32_t* dst, uint32_t baseVertex = 0) const;
+
+    //-Members---------------------------------------------------------------------------------------------------//
+    const unsigned char* data = nullptr; // first element, nullptr when the accessor has no buffer view
+    size_t count              = 0; // number of elements
+    size_t stride             = 0; // bytes between consecutive elements
+    int componentType         = TINYGLTF_COMPONENT_TYPE_FLOAT;
+    uint32_t numComponents    = 0; // 1 for scalars, 2-4 for vectors
+    bool normalized           = false;
+};
+
+#endif // !ACCESSOR_VIEW_H
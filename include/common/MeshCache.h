@@ -0,0 +1,105 @@
+///////////////////////////////////////////////////////
+// MeshCache class declaration
+///////////////////////////////////////////////////////
+
+//
+// A compact on disk cache of a model's processed geometry. The cache holds the interleaved 
+// vertices, indices, submesh and meshlet tables and material image references, and is keyed by a hash 
+// of the source file and every file it depends on. A valid cache is memory mapped, so its 
+// geometry can be copied straight into a staging buffer without parsing the source again.
+//
+
+#ifndef MESH_CACHE_H
+#define MESH_CACHE_H
+
+#include <hpg/Buffers.h> // raw buffer data
+
+#include <utils/MappedFile.h>
+
+#include <common/types.h>
+
+#include <string>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+
+class MeshCache {
+public:
+    //-Cache file header-----------------------------------------------------------------------------------------//
+    struct Header {
+        char magic[4];
+        UI32 version;
+        UI64 sourceHash;
+        UI32 vertexStride; // size of the vertex, submesh and meshlet structs, a mismatch invalidates the cache
+        UI32 subMeshStride;
+        UI64 numVertices;
+        UI64 numIndices;
+        UI64 numSubMeshes;
+        UI64 numMeshlets;
+        UI64 vertexOffset; // byte offsets of each section from the start of the file
+        UI64 indexOffset;
+        UI64 subMeshOffset;
+        UI64 meshletOffset;
+        UI64 referencesOffset;
+        F32  centre[3];
+        UI32 numDependencies;
+        UI32 numMaterials;
+        UI32 meshletStride;
+    };
+
+    //-A file the source depends on (e.g. a .bin buffer), relative to the source directory-----------------------//
+    struct Dependency {
+        std::string path;
+        UI64 hash;
+    };
+
+    //-Image uris of a material's texture slots, empty for the slots it has no texture in--------------------------//
+    struct Material {
+        std::string albedo;            // the gltf baseColorTexture
+        std::string metallicRoughness; // and metallicRoughnessTexture
+    };
+
+    //-Data written to the cache---------------------------------------------------------------------------------//
+    struct Contents {
+        Buffer vertices;
+        UI32   vertexStride = 0;
+        Buffer indices; // 32 bit indices
+        Buffer subMeshes;
+        UI32   subMeshStride = 0;
+        Buffer meshlets;
+        UI32   meshletStride = 0;
+        glm::vec3 centre = glm::vec3(0.0f);
+        std::vector<Dependency> dependencies;
+        std::vector<Material> materials;
+    };
+
+public:
+    //-Hashing---------------------------------------------------------------------------------------------------//
+    static UI64 hashData(const unsigned char* data, size_t size);
+    static UI64 hashFile(const std::string& path);
+
+    //-Cache file location---------------------------------------------------------------------------------------//
+    static std::string getCachePath(const std::string& sourcePath);
+
+    //-Reading and writing---------------------------------------------------------------------------------------//
+    // map the cache of a source file, returns false when there is no cache or it is out of date
+    bool load(const std::string& sourcePath, UI64 sourceHash, UI32 vertexStride, UI32 subMeshStride, UI32 meshletStride);
+    void unload();
+    static void write(const std::string& sourcePath, UI64 sourceHash, const Contents& contents);
+
+    inline bool isLoaded() const { return header != nullptr; }
+
+public:
+    //-Members, pointing into the mapped cache-------------------------------------------------------------------//
+    MappedFile file;
+    const Header* header      = nullptr;
+    unsigned char* vertices   = nullptr;
+    unsigned char* indices    = nullptr;
+    unsigned char* subMeshes  = nullptr;
+    unsigned char* meshlets   = nullptr;
+
+    std::vector<Material> materials;
+};
+
+#endif // !MESH_CACHE_H
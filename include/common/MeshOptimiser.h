@@ -0,0 +1,49 @@
+///////////////////////////////////////////////////////
+// MeshOptimiser class declaration
+///////////////////////////////////////////////////////
+
+//
+// Reorders index and vertex data of a triangle mesh to reduce the work done by the GPU.
+// Triangles are reordered for the post transform vertex cache (Tipsify, Sander et al. 2007), 
+// clusters of triangles are then sorted so that outward facing ones are drawn first to 
+// reduce overdraw, and vertices are finally reordered by first use for fetch locality.
+// Cache efficiency is measured by simulating a FIFO cache.
+//
+
+#ifndef MESH_OPTIMISER_H
+#define MESH_OPTIMISER_H
+
+#include <common/Model.h> // vertex layout
+
+#include <common/types.h>
+
+#include <vector>
+
+
+class MeshOptimiser {
+public:
+    //-Post transform cache statistics---------------------------------------------------------------------------//
+    struct VertexCacheStats {
+        F32 acmr; // average cache miss ratio, transformed vertices per triangle (0.5 is ideal for large grids)
+        F32 atvr; // average transform to vertex ratio, transformed vertices per referenced vertex (1 is ideal)
+    };
+
+    // approximate size of the post transform cache, in vertices
+    static const UI32 CACHE_SIZE = 16;
+
+public:
+    //-Index reordering------------------------------------------------------------------------------------------//
+    // clusters receives the first triangle of each run that starts with a cold cache
+    static void optimiseVertexCache(UI32* indices, size_t indexCount, size_t vertexCount, std::vector<size_t>* clusters = nullptr);
+    static void optimiseOverdraw(UI32* indices, size_t indexCount, const Model::Vertex* vertices, const std::vector<size_t>& clusters, 
+        F32 threshold = 1.05f);
+
+    //-Vertex reordering-----------------------------------------------------------------------------------------//
+    // unreferenced vertices are moved to the end, the vertex count is unchanged
+    static void optimiseVertexFetch(Model::Vertex* vertices, size_t vertexCount, UI32* indices, size_t indexCount);
+
+    //-Analysis--------------------------------------------------------------------------------------------------//
+    static VertexCacheStats analyseVertexCache(const UI32* indices, size_t indexCount, size_t vertexCount, UI32 cacheSize = CACHE_SIZE);
+};
+
+#endif // !MESH_OPTIMISER_H
@@ -0,0 +1,31 @@
+///////////////////////////////////////////////////////
+// MeshSimplifier class declaration
+///////////////////////////////////////////////////////
+
+//
+// Quadric error mesh simplification (Garland and Heckbert 1997) by half edge collapse. A 
+// collapse moves one vertex onto a neighbour, so simplified index buffers reference the 
+// same vertices as the original and every level of detail can share one vertex buffer.
+// Vertices on open borders and on attribute seams (several vertices sharing a position) 
+// are never moved, which keeps the simplified mesh free of cracks.
+//
+
+#ifndef MESH_SIMPLIFIER_H
+#define MESH_SIMPLIFIER_H
+
+#include <common/Model.h> // vertex layout
+
+#include <common/types.h>
+
+#include <vector>
+
+
+class MeshSimplifier {
+public:
+    // simplifies until the index count reaches targetIndexCount or the next collapse would exceed targetError,
+    // returns the simplified indices and sets error to the largest distance from the original surface
+    static std::vector<UI32> simplify(const UI32* indices, size_t indexCount, const Model::Vertex* vertices, size_t vertexCount, 
+        size_t targetIndexCount, F32 targetError, F32* error);
+};
+
+#endif // !MESH_SIMPLIFIER_H
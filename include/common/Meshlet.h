@@ -0,0 +1,50 @@
+///////////////////////////////////////////////////////
+// Meshlet struct declaration
+///////////////////////////////////////////////////////
+
+//
+// A small cluster of triangles (at most 64 vertices and 124 triangles) that is contiguous in 
+// the index buffer. Each meshlet has a bounding sphere and a cone bounding its triangle 
+// normals, so clusters outside the view frustum or facing away from the viewer can be 
+// rejected on the CPU before any draws are recorded.
+//
+
+#ifndef MESHLET_H
+#define MESHLET_H
+
+#include <common/types.h>
+
+#include <vector>
+
+#include <glm/glm.hpp>
+
+
+struct Meshlet {
+    //-Limits----------------------------------------------------------------------------------------------------//
+    static const UI32 MAX_VERTICES  = 64;
+    static const UI32 MAX_TRIANGLES = 124;
+
+    //-Build meshlets from consecutive triangles of an index range-----------------------------------------------//
+    // positions points at the first vertex of the range, firstIndex is the position of indices in the packed buffer
+    static std::vector<Meshlet> build(const UI32* indices, size_t indexCount, UI32 firstIndex, const unsigned char* positions, 
+        size_t positionStride, size_t vertexCount);
+
+    //-Culling---------------------------------------------------------------------------------------------------//
+    // planes of the frustum of a clip space transform, in the space the transform is applied to (normals point inwards)
+    static void getFrustumPlanes(const glm::mat4& clip, glm::vec4 planes[6]);
+    static bool isSphereInFrustum(const glm::vec3& centre, F32 radius, const glm::vec4 planes[6]);
+
+    // false when the meshlet is outside the frustum or every triangle faces away from viewPosition
+    bool isVisible(const glm::vec3& viewPosition, const glm::vec4 planes[6]) const;
+
+    //-Members---------------------------------------------------------------------------------------------------//
+    UI32 firstIndex;
+    UI32 indexCount;
+    glm::vec3 centre; // bounding sphere
+    F32 radius;
+    glm::vec3 coneApex; // behind every triangle of the meshlet
+    glm::vec3 coneAxis; // average triangle normal
+    F32 coneCutoff; // sine of the cone's half angle, 1 when the cone is too wide to ever cull
+};
+
+#endif // !MESHLET_H
@@ -3,7 +3,13 @@
 ///////////////////////////////////////////////////////
 
 //
-// A model class for handling operations on data loaded from a file. 
+// A model class for handling operations on data loaded from a file. Every mesh and primitive
+// in the file is packed into a single vertex and index buffer, the submesh table records 
+// where each one lives in those buffers and which material it uses. The processed geometry
+// is written to a mesh cache after the first load, later loads map the cache instead. Each
+// sub mesh also has a chain of simplified index ranges over its vertices, for levels of detail,
+// and its full resolution triangles are split into meshlets for culling. The vertices can be
+// uploaded as they are or compressed to the packed vertex format.
 //
 
 #ifndef MODEL_H
@@ -12,9 +18,19 @@
 #include <hpg/Buffers.h> // buffers containing data
 
 #include <common/Texture.h> 
+#include <common/MeshCache.h> // pre-baked geometry
+#include <common/Meshlet.h> // triangle clusters
+#include <common/PackedVertex.h> // compressed vertices
+#include <common/types.h>
+
+#include <utils/MappedFile.h> // memory mapped gltf buffers
+#include <utils/Ktx2File.h> // block compressed textures
+#include <utils/ImageDecoder.h> // parallel image decoding
+#include <utils/ThreadPool.h>
 
 #include <string> // string for model path
 #include <vector> // vector container
+#include <functional> // texture callback
 
 #include <vulkan/vulkan_core.h>
 
@@ -33,11 +49,42 @@ public:
         glm::vec2 tex;
     };
 
+    //-Level of detail POD, a range of the packed index buffer--------------------------------------------------//
+    struct Lod {
+        UI32 firstIndex;
+        UI32 indexCount;
+        F32  error; // largest distance from the full resolution surface, in model space
+    };
+
+    static const UI32 MAX_LODS = 4;
+
+    //-Sub mesh POD----------------------------------------------------------------------------------------------//
+    struct SubMesh {
+        UI32 firstIndex;   // first index in the packed index buffer
+        I32  vertexOffset; // added to each index, first vertex in the packed vertex buffer
+        UI32 indexCount;
+        I32  material;     // material index, -1 when the sub mesh has no material
+        glm::vec3 centre;  // bounding sphere in model space
+        F32  radius;
+        F32  uvDensity;    // uv units per model space unit, from the areas of the full resolution triangles
+        UI32 numLods;      // lods[0] is the full resolution range above
+        Lod  lods[MAX_LODS];
+        UI32 firstMeshlet; // meshlets of lods[0], none for geometry added after loading
+        UI32 numMeshlets;
+    };
+
 public:
     //-Supported file formats------------------------------------------------------------------------------------//
     enum class FileExtension : unsigned char {
         OBJ  = 0x0,
-        GLTF = 0x1
+        GLTF = 0x1,
+        GLB  = 0x2
+    };
+
+    //-Vertex layout of the uploaded vertex buffer---------------------------------------------------------------//
+    enum class VertexFormat : unsigned char {
+        FLOAT  = 0x0, // Vertex, 48 bytes
+        PACKED = 0x1  // PackedVertex, 20 bytes
     };
 
 public:
@@ -45,39 +92,106 @@ public:
     void loadModel(const std::string& path);
     void loadObjModel(const std::string& path);
     void loadGltfModel(const std::string& path);
+    void mapGltfBuffers(const std::string& baseDir);
+    bool loadCachedModel(const std::string& path, UI64 sourceHash);
+    void optimiseSubMeshes();
+    void generateLods();
+    void generateMeshlets();
+    void writeMeshCache(const std::string& path, UI64 sourceHash);
+
+    //-Add geometry that is not part of the model file-----------------------------------------------------------//
+    void addSubMesh(const std::vector<Vertex>& subMeshVertices, const std::vector<UI32>& subMeshIndices, I32 material = -1);
+
+    //-Vertex format, set before the pipelines are created and the vertices uploaded----------------------------//
+    inline void setVertexFormat(VertexFormat format) { vertexFormat = format; }
+    inline VertexFormat getVertexFormat() const { return vertexFormat; }
+    inline size_t getVertexStride() const { return vertexFormat == VertexFormat::PACKED ? sizeof(PackedVertex) : sizeof(Vertex); }
+    // dequantisation of packed vertices, identity and no-op for the float format
+    inline glm::mat4 getPositionTransform() const { 
+        return vertexFormat == VertexFormat::PACKED ? quantisation.getPositionTransform() : glm::mat4(1.0f); }
+    inline glm::vec4 getUvTransform() const { 
+        return vertexFormat == VertexFormat::PACKED ? quantisation.getUvTransform() : glm::vec4(0.0f, 0.0f, 1.0f, 1.0f); }
+
+    //-Compare the packed vertex format against the float layout, size, encode time and error--------------------//
+    static void benchmarkVertexFormats(const std::string& path);
 
     //-File utils------------------------------------------------------------------------------------------------//
     FileExtension getExtension(const std::string& path);
 
     //-Get model data--------------------------------------------------------------------------------------------//
     static VkFormat getFormatFromType(uint32_t type);
-    VkIndexType getIndexType(uint32_t primitiveNum);
-    std::vector<VkDeviceSize> getBufferOffsets(uint32_t primitiveNum);
-    uint32_t getNumVertices(uint32_t primitiveNum);
-    uint32_t getNumIndices(uint32_t primitiveNum);
     VkFormat getImageFormat(uint32_t imgIdx);
     uint32_t getImageBitDepth(uint32_t imgIdx);
+    inline uint32_t getNumVertices() const { return static_cast<uint32_t>(numCachedVertices + vertices.size()); }
+    inline uint32_t getNumIndices() const { return static_cast<uint32_t>(numCachedIndices + indices.size()); }
+    inline uint32_t getNumMaterials() const { 
+        return static_cast<uint32_t>(meshCache.isLoaded() ? meshCache.materials.size() : model.materials.size()); }
+    inline const std::vector<SubMesh>& getSubMeshes() const { return subMeshes; }
+    inline const std::vector<Meshlet>& getMeshlets() const { return meshlets; }
+
+    //-Level of detail selection---------------------------------------------------------------------------------//
+    // coarsest lod whose error, seen from distance, covers at most threshold pixels (pixelsPerUnit at distance 1)
+    static UI32 selectLod(const SubMesh& subMesh, F32 distance, F32 pixelsPerUnit, F32 threshold);
 
     //-Binding and attribute descriptions------------------------------------------------------------------------//
-    VkVertexInputBindingDescription getBindingDescriptions(uint32_t primitiveNum);
-    std::array<VkVertexInputAttributeDescription, 4> getAttributeDescriptions(uint32_t primitiveNum);
+    VkVertexInputBindingDescription getBindingDescriptions(uint32_t binding);
+    std::array<VkVertexInputAttributeDescription, 4> getAttributeDescriptions(uint32_t binding);
 
     //-Get buffers-----------------------------------------------------------------------------------------------//
-    std::vector<Vertex>* getVertexBuffer(uint32_t primitiveNum);
-    std::vector<uint32_t>* getIndexBuffer(uint32_t primitiveNum);
+    // the packed data may be split between the mapped cache and geometry added afterwards, uploads gather the regions,
+    // packed vertices are encoded from both into a single region
+    std::vector<Buffer> getVertexData();
+    std::vector<Buffer> getIndexData();
+
+    //-Material textures-----------------------------------------------------------------------------------------//
+    // decodes the images of every material on the pool, onDecoded runs on the calling thread as each one completes,
+    // with the texture it is for: 2 * material for albedo and 2 * material + 1 for metallic roughness. Textures a
+    // material has no image for are not reported, the caller fills them with a default. A .ktx2 file next to an 
+    // image, with the same name, is loaded in its place with its pre-built mip levels. The image is only valid during
+    // the call, the source keeps the mapped ktx2 or the encoded bytes for callers that read the image again. The gltf's
+    // encoded images are moved into their sources, so this runs once per load
+    void decodeMaterialTextures(ThreadPool* pool, 
+        const std::function<void(UI32 textureIdx, const Image& image, const ImageSource& source)>& onDecoded);
 
-    //-Get material textures-------------------------------------------------------------------------------------//
-    const std::vector<Image>* getMaterialTextureData(uint32_t primitiveNum);
+private:
+    //-Texture utils---------------------------------------------------------------------------------------------//
+    // gltf image of a material's texture slot, 0 for albedo and 1 for metallic roughness, -1 when it has none
+    int getMaterialImage(UI32 materialIdx, UI32 slot) const;
+    // maps the block compressed stand in for the image at uri into file, false if there is none
+    bool loadKtx2Texture(const std::string& uri, Ktx2File* file);
+
+    //-Sub mesh utils--------------------------------------------------------------------------------------------//
+    std::vector<size_t> getSubMeshVertexCounts() const;
+    static void computeBounds(SubMesh& subMesh, const Vertex* subMeshVertices, size_t vertexCount);
+    static void computeUvDensity(SubMesh& subMesh, const Vertex* subMeshVertices, const UI32* subMeshIndices);
+    void packVertices();
+
+    //-Gltf scene traversal--------------------------------------------------------------------------------------//
+    void loadGltfNode(int nodeIdx, const glm::mat4& parentTransform);
+    void loadGltfPrimitive(const tinygltf::Primitive& primitive, const glm::mat4& transform);
 
 private:
     //-Members---------------------------------------------------------------------------------------------------//
     tinygltf::Model model;
 
+    std::vector<MappedFile> mappedFiles; // glb file or external .bin buffers
+    std::vector<Buffer> bufferData; // data of each gltf buffer, mapped where possible
+
+    MeshCache meshCache; // when loaded, holds the vertices and indices that precede those in the vectors below
+    size_t numCachedVertices = 0;
+    size_t numCachedIndices  = 0;
+    std::string baseDir;
+
     glm::vec3 centre;
 
     std::vector<Vertex> vertices;
     std::vector<uint32_t> indices;
-    std::vector<Image> textures;
+    std::vector<SubMesh> subMeshes;
+    std::vector<Meshlet> meshlets;
+
+    VertexFormat vertexFormat = VertexFormat::FLOAT;
+    PackedVertex::Quantisation quantisation{};
+    std::vector<PackedVertex> packedVertices; // every vertex, cached and added, when the format is packed
 
     FileExtension ext;
 
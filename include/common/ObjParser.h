@@ -0,0 +1,54 @@
+///////////////////////////////////////////////////////
+// ObjParser class declaration
+///////////////////////////////////////////////////////
+
+//
+// A multithreaded parser for wavefront obj files. The mapped file is split into line aligned
+// chunks which are parsed concurrently, then merged in file order so the output does not 
+// depend on the number of threads. Only geometry is read (positions, normals, texcoords, faces
+// and object/group boundaries), polygons are triangulated as fans.
+//
+
+#ifndef OBJ_PARSER_H
+#define OBJ_PARSER_H
+
+#include <utils/ThreadPool.h>
+
+#include <common/types.h>
+
+#include <string>
+#include <vector>
+
+
+class ObjParser {
+public:
+    //-Face corner, 0 based indices into the attribute arrays, -1 when the attribute was not given--------------//
+    struct Index {
+        I32 vertex;
+        I32 normal;
+        I32 texcoord;
+    };
+
+    //-Range of face corners started by an o or g statement------------------------------------------------------//
+    struct Shape {
+        size_t firstIndex;
+        size_t indexCount;
+    };
+
+public:
+    //-Parse-----------------------------------------------------------------------------------------------------//
+    void parse(const std::string& path, ThreadPool& pool);
+
+    //-Time the parse with an increasing number of threads, tinyobjloader is timed as the baseline----------------//
+    static void benchmark(const std::string& path);
+
+public:
+    //-Members---------------------------------------------------------------------------------------------------//
+    std::vector<F32> positions; // xyz
+    std::vector<F32> normals;   // xyz
+    std::vector<F32> texcoords; // uv
+    std::vector<Index> indices; // three corners per triangle
+    std::vector<Shape> shapes;
+};
+
+#endif // !OBJ_PARSER_H
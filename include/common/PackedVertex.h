@@ -0,0 +1,51 @@
+///////////////////////////////////////////////////////
+// PackedVertex struct declaration
+///////////////////////////////////////////////////////
+
+//
+// A compressed 20 byte vertex, against 48 bytes for the float layout. Positions are unorm16
+// within the bounds of the model, normals and tangents are octahedral encoded in two snorm16
+// each and uvs are unorm16 within the uv bounds of the model. The tangent's handedness is
+// stored in the otherwise unused w of the position. The quantisation bounds are undone in the
+// vertex shader, the position bounds are folded into the model matrix.
+//
+
+#ifndef PACKED_VERTEX_H
+#define PACKED_VERTEX_H
+
+#include <common/types.h>
+
+#include <glm/glm.hpp>
+
+
+struct PackedVertex {
+    //-Bounds the positions and uvs are quantised to------------------------------------------------------------//
+    struct Quantisation {
+        glm::vec3 positionMin;
+        glm::vec3 positionExtent;
+        glm::vec2 uvMin;
+        glm::vec2 uvExtent;
+
+        glm::mat4 getPositionTransform() const; // unorm position to model space
+        glm::vec4 getUvTransform() const; // offset in xy, scale in zw
+    };
+
+    //-Encoding and decoding-------------------------------------------------------------------------------------//
+    static PackedVertex pack(const glm::vec3& pos, const glm::vec3& nor, const glm::vec4& tan, const glm::vec2& tex,
+        const Quantisation& quantisation);
+    // decodes as the packed vertex shaders do, used to measure the quantisation error
+    void unpack(const Quantisation& quantisation, glm::vec3& pos, glm::vec3& nor, glm::vec4& tan, glm::vec2& tex) const;
+
+    static void octEncode(const glm::vec3& v, I16 encoded[2]);
+    static glm::vec3 octDecode(const I16 encoded[2]);
+
+    //-Members---------------------------------------------------------------------------------------------------//
+    UI16 pos[4]; // xyz in the position bounds, w is 0 for a left handed tangent frame
+    I16  nor[2];
+    I16  tan[2];
+    UI16 tex[2];
+};
+
+static_assert(sizeof(PackedVertex) == 20, "packed vertex must stay tightly packed");
+
+#endif // !PACKED_VERTEX_H
@@ -15,7 +15,7 @@ public:
 	SpotLight(glm::vec3 dir = { 0.0f, 0.0f, 0.0f }, F32 n = 0.0f, F32 f = 0.0f) : direction(dir), nearZ(n), farZ(f) {}
 
 	glm::mat4 getMVP(glm::mat4 model = glm::mat4(1.0f)) {
-		glm::mat4 proj = glm::perspective(glm::radians(45.0f), 1.0f, nearZ, farZ);
+		glm::mat4 proj = glm::perspective(glm::radians(FOV), 1.0f, nearZ, farZ);
 		glm::mat4 view = glm::lookAt(direction, { 0.0f, 0.0f, 0.0f }, { 0.0f, 1.0f, 0.0f });
 		proj[1][1] *= -1.0f;
 		proj[0][0] *= -1.0f;
@@ -26,6 +26,9 @@ public:
 		return glm::lookAt(direction, { 0.0f, 0.0f, 0.0f }, { 0.0f, -1.0f, 0.0f });
 	}
 
+	// field of view of the shadow map's projection, in degrees
+	static constexpr F32 FOV = 45.0f;
+
 	glm::vec3 direction;
 
 	F32 nearZ;
@@ -12,6 +12,8 @@
 #include <hpg/Buffers.h>
 #include <hpg/Image.h>
 #include <hpg/VulkanSetup.h>
+#include <hpg/UploadManager.h>
+#include <hpg/DeletionQueue.h>
 
 #include <string> // string class
 
@@ -20,10 +22,20 @@
 class Texture {
 public:
     //-Initialisation and cleanup----------------------------------------//    
-    void createTexture(VulkanSetup* pVkSetup, const VkCommandPool& commandPool, const Image& imageData);
+    // the pixels are queued for upload, the texture can be sampled by later submissions on the graphics queue. Block
+    // compressed images keep their format when the device supports it
+    UploadManager::Token createTexture(VulkanSetup* pVkSetup, UploadManager* uploadManager, const Image& imageData);
     void cleanupTexture();
 
+    //-Replacing the image---------------------------------------------//    
+    // a new image and view hold the image data's levels and the sampler is kept, the old ones are destroyed once the
+    // frames in flight are done with them. Descriptors must be pointed at the new view
+    UploadManager::Token recreateImage(UploadManager* uploadManager, const Image& imageData, DeletionQueue* deletionQueue);
+
 private:
+    //-Texture image and view creation---------------------------------//    
+    UploadManager::Token createTextureImage(UploadManager* uploadManager, const Image& imageData);
+
     //-Texture sampler creation------------------------------------------//    
     void createTextureSampler();
 
@@ -15,6 +15,9 @@
 #define BUFFERS_H
 
 #include <hpg/VulkanSetup.h>
+#include <hpg/MemoryAllocator.h>
+
+#include <vector>
 
 #include <vulkan/vulkan_core.h> // vulkan core structs &c
 
@@ -51,6 +54,7 @@ public:
         VkDeviceSize          size       = 0;
         VkBufferUsageFlags    usage      = 0;
         VkMemoryPropertyFlags properties = 0;
+        MemoryAllocator::Category category = MemoryAllocator::Category::OTHER; // for memory reporting
         VulkanBuffer*         pVulkanBuffer    = nullptr; // ptr to the buffer object we want to create
     };
 
@@ -73,17 +77,14 @@ public:
     static void copyBufferToImage(const VulkanSetup* vkSetup, const VkCommandPool& renderCommandPool, 
         VkBuffer buffer, VkImage image, const std::vector<VkBufferImageCopy>& regions);
 
-    //-Buffer creation on GPU---------------------------------------------//
-    static void createDeviceLocalBuffer(const VulkanSetup* vkSetup, const VkCommandPool& commandPool, const Buffer& buffer, VulkanBuffer* vkBuffer, VkBufferUsageFlagBits usage);
-
     //-Utility uniform buffer creation------------------------------------//
     template<typename T>
     static void createUniformBuffer(const VulkanSetup* vkSetup, size_t imagesSize, VulkanBuffer* buffer, VkMemoryPropertyFlags properties);
 
 public:
     // the vulkan buffer handle and its memory
-    VkBuffer       buffer = nullptr;
-    VkDeviceMemory memory = nullptr;
+    VkBuffer                    buffer = nullptr;
+    MemoryAllocator::Allocation allocation{}; // mapped when host visible
 };
 
 //
@@ -0,0 +1,53 @@
+///////////////////////////////////////////////////////
+// DeletionQueue class declaration
+///////////////////////////////////////////////////////
+
+//
+// Defers the destruction of Vulkan objects that frames in flight may still use. Deleters are
+// tagged with the serial of the frame being recorded when they are pushed, and run once that
+// frame is known to have completed. The application waits on a frame's in flight fence before
+// recording into its slot again, at which point every frame up to MAX_FRAMES_IN_FLIGHT serials
+// back has completed, so nothing ever waits on the device to release a resource.
+//
+
+#ifndef DELETION_QUEUE_H
+#define DELETION_QUEUE_H
+
+#include <common/types.h>
+
+#include <deque>
+#include <functional>
+
+
+class DeletionQueue {
+public:
+    //-Deferring destruction-------------------------------------------------------------------------------------//
+    // the deleter runs once the current frame has completed
+    void push(std::function<void()>&& deleter);
+
+    //-Frame serials---------------------------------------------------------------------------------------------//
+    // called once the current frame has been submitted
+    inline void nextFrame() { frame++; }
+    inline UI64 getFrame() const { return frame; }
+
+    //-Running deleters------------------------------------------------------------------------------------------//
+    // runs the deleters of every frame up to and including completedFrame
+    void collect(UI64 completedFrame);
+    // runs every deleter, the device must be idle
+    void flush();
+
+    inline size_t getNumPending() const { return entries.size(); }
+
+private:
+    //-Members---------------------------------------------------------------------------------------------------//
+    struct Entry {
+        UI64                  frame;
+        std::function<void()> deleter;
+    };
+
+    std::deque<Entry> entries; // in push order, so frame serials never decrease
+
+    UI64 frame = 0; // serial of the frame being recorded
+};
+
+#endif // !DELETION_QUEUE_H
@@ -7,14 +7,17 @@
 
 #include <hpg/VulkanSetup.h> // for referencing the device
 #include <hpg/Image.h>
+#include <hpg/RenderTargetPool.h>
 
 #include <vulkan/vulkan_core.h>
 
 class DepthResource {
 public:
     //-Initialisation and cleanup-----------------------------------------//    
-    void createDepthResource(VulkanSetup* vkSetup, const VkExtent2D& extent, VkCommandPool commandPool);
+    void createDepthResource(VulkanSetup* vkSetup, RenderTargetPool* renderTargetPool, const VkExtent2D& extent);
     void cleanupDepthResource();
+    // destroys the resource once the current frame has completed
+    void releaseDepthResource(DeletionQueue* deletionQueue);
 
     //-Depth resource creation helpers------------------------------------//
     static VkFormat findDepthFormat(const VulkanSetup* vkSetup);
@@ -23,6 +26,7 @@ public:
 public:
     //-Members------------------------------------------------------------//
     VulkanSetup* vkSetup;
+    RenderTargetPool* renderTargetPool;
 	
     VulkanImage depthImage;
     VkImageView depthImageView;
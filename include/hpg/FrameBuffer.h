@@ -12,14 +12,17 @@
 #include <hpg/VulkanSetup.h> // for referencing the device
 #include <hpg/DepthResource.h> // for referencing the depth resource
 #include <hpg/SwapChain.h> // for referencing the swap chain
+#include <hpg/DeletionQueue.h>
 
 #include <vulkan/vulkan_core.h>
 
 class FrameBuffer {
 public:
     //-Initialisation and cleanup-----------------------------------------//    
-    void initFrameBuffer(VulkanSetup* pVkSetup, const SwapChain* swapChain, const VkCommandPool& commandPool);
+    void initFrameBuffer(VulkanSetup* pVkSetup, const SwapChain* swapChain, RenderTargetPool* renderTargetPool);
     void cleanupFrameBuffers();
+    // retires the framebuffers and depth resource and creates them for the swap chain's new images and extent
+    void recreateFrameBuffers(const SwapChain* swapChain, DeletionQueue* deletionQueue);
 
 private:
     //-Framebuffer creation-----------------------------------------------//    
@@ -29,6 +32,7 @@ private:
 public:
     //-Members------------------------------------------------------------//    
     VulkanSetup* vkSetup;
+    RenderTargetPool* renderTargetPool;
 
     std::vector<VkFramebuffer> framebuffers;
     std::vector<VkFramebuffer> imGuiFramebuffers;
@@ -14,6 +14,8 @@
 #include <hpg/Buffers.h>
 #include <hpg/Image.h>
 #include <hpg/SwapChain.h>
+#include <hpg/DeletionQueue.h>
+#include <hpg/RenderTargetPool.h>
 
 #include <vulkan/vulkan_core.h>
 
@@ -36,6 +38,7 @@ public:
 		glm::mat4 view;
 		glm::mat4 projection;
 		glm::mat4 normal;
+		glm::vec4 uvTransform; // offset and scale of packed uvs
 	};
 
 	struct CompositionUBO {
@@ -55,11 +58,19 @@ public:
 public:
 	//-Initialisation and cleanup--------------------------------------------------------------------------------//
 	void createGBuffer(VulkanSetup* pVkSetup, SwapChain* swapChain, VkDescriptorSetLayout* descriptorSetLayout, 
-		Model* model, const VkCommandPool& cmdPool);
+		Model* model, RenderTargetPool* renderTargetPool);
 	void cleanupGBuffer();
+	// retires the attachments and frame buffer and creates them for the swap chain's extent. The render pass, sampler
+	// and pipelines do not depend on the extent and are kept
+	void recreateGBuffer(SwapChain* swapChain, DeletionQueue* deletionQueue);
+	// retires the pipelines and builds them again, only needed when the swap chain's render pass changed format
+	void recreatePipelines(SwapChain* swapChain, VkDescriptorSetLayout* descriptorSetLayout, Model* model, 
+		DeletionQueue* deletionQueue);
 
 	//-Attachment creation---------------------------------------------------------------------------------------//
-	void createAttachment(const std::string& name, VkFormat format, VkImageUsageFlagBits usage, const VkCommandPool& cmdPool);
+	void createAttachments();
+	// transient attachments are only used by the offscreen pass, the others are sampled by the composition pass
+	void createAttachment(const std::string& name, VkFormat format, VkImageUsageFlagBits usage, bool transient);
 	
 	//-Render pass creation--------------------------------------------------------------------------------------//
 	void createRenderPass();
@@ -73,13 +84,10 @@ public:
 	//-Deferred rendering pipeline-------------------------------------------------------------------------------//
 	void createPipelines(VkDescriptorSetLayout* descriptorSetLayout, SwapChain* swapChain, Model* model);
 
-	//-Uniform buffer update-------------------------------------------------------------------------------------//
-	void updateOffScreenUniformBuffer(const OffScreenUbo& ubo);
-	void updateCompositionUniformBuffer(uint32_t imageIndex, const CompositionUBO& ubo);
-
 public:
 	//-Members---------------------------------------------------------------------------------------------------//
 	VulkanSetup* vkSetup;
+	RenderTargetPool* renderTargetPool;
 
 	VkExtent2D extent;
 
@@ -89,9 +97,6 @@ public:
 
 	VkSampler colourSampler;
 
-	VulkanBuffer offScreenUniform;
-	VulkanBuffer compositionUniforms;
-
 	std::map<std::string, Attachment> attachments;
 
 	VkPipelineLayout layout;
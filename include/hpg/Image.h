@@ -12,14 +12,28 @@
 
 #include <hpg/Buffers.h>
 
+#include <memory> // shared sources
+#include <vector>
+
 #include <vulkan/vulkan_core.h>
 
-// POD struct for an image from file (.png, .jpeg, &c)
+class Ktx2File;
+
+// struct for an image from file (.png, .jpeg, .ktx2, &c), the data is not owned
 struct Image {
     uint32_t width;
     uint32_t height;
     VkFormat format;
     Buffer imageData;
+    uint32_t arrayLayers = 1; // the layers of a level are back to back, six faces for a cube map
+    std::vector<VkDeviceSize> levelOffsets; // of each pre-built level in the data, empty when only level 0 is present
+};
+
+// where an image can be read again once it has been uploaded, empty when it only exists in memory
+struct ImageSource {
+    std::shared_ptr<const Ktx2File> ktx2; // a mapped container, its levels are read in place
+    Buffer encoded{}; // or the bytes of a png, jpeg, &c. that decode to four channels
+    std::shared_ptr<const void> owner; // keeps the encoded bytes alive, a mapped file or a vector
 };
 
 class VulkanImage {
@@ -32,8 +46,10 @@ public:
         VkImageTiling         tiling = VK_IMAGE_TILING_OPTIMAL;
         VkImageUsageFlags     usage = VK_NULL_HANDLE;
         uint32_t              arrayLayers = 1; // default to 1 for convenience
+        uint32_t              mipLevels = 1; // getMipLevels for a full chain
         VkMemoryPropertyFlags properties = VK_NULL_HANDLE;
         VkImageCreateFlags    flags = 0;
+        MemoryAllocator::Category category = MemoryAllocator::Category::OTHER; // for memory reporting
         VulkanImage*          pVulkanImage = nullptr;
     };
 
@@ -44,12 +60,14 @@ public:
         VkImageLayout oldLayout         = VK_IMAGE_LAYOUT_UNDEFINED;
         VkImageLayout newLayout         = VK_IMAGE_LAYOUT_UNDEFINED;
         uint32_t      arrayLayers       = 1;
+        uint32_t      mipLevels         = 1;
     };
 
     //-Querying a format's support----------------------------------------//
     struct ImageFormatSupportDetails {
         VkFormat format;
         VkImageFormatProperties properties;
+        bool supported; // the properties are only valid when the format is supported
     };
 
 public:
@@ -64,19 +82,36 @@ public:
     static void transitionImageLayout(const VulkanSetup* vkSetup, const LayoutTransitionInfo& transitionInfo);
 
     //-Image Loading from file--------------------------------------------//
+    // the pixels are stb_image's, free them with stbi_image_free once the upload manager has staged them
     static Image loadImageFromFile(const std::string& path);
 
     //-Helpers for image formats------------------------------------------//
     static VkFormat getImageFormat(int numChannels);
+    // bytes per texel, or per 4x4 block for block compressed formats
+    static UI32 getFormatTexelSize(VkFormat format);
+    static bool formatIsBlockCompressed(VkFormat format);
     static ImageFormatSupportDetails queryFormatSupport(VkPhysicalDevice device, VkFormat format, VkImageType type, 
         VkImageTiling tiling, VkImageUsageFlags usage, VkImageCreateFlags flags);
     static VkBool32 formatIsFilterable(VkPhysicalDevice physicalDevice, VkFormat format, VkImageTiling tiling);
+    // whether optimally tiled images of the format can be both the source and destination of a blit
+    static VkBool32 formatIsBlittable(VkPhysicalDevice physicalDevice, VkFormat format);
+    // formats whose channels are all 8 bits, which the CPU downsampler handles
+    static bool formatHasByteChannels(VkFormat format);
+
+    //-Mip chains---------------------------------------------------------//
+    // levels of a full chain down to 1x1
+    static UI32 getMipLevels(UI32 width, UI32 height);
+    // bytes of a single layer of a width x height level
+    static VkDeviceSize getLevelSize(VkFormat format, UI32 width, UI32 height);
+    // copies of every layer of each level in the image's data, buffer offsets relative to the data
+    static std::vector<VkBufferImageCopy> getUploadRegions(const Image& image);
 
 public:
     VkExtent2D     extent      = { 0, 0 };
     VkFormat       format      = VK_FORMAT_UNDEFINED;
+    uint32_t       mipLevels   = 1;
     VkImage        image       = nullptr;
-    VkDeviceMemory imageMemory = nullptr;
+    MemoryAllocator::Allocation allocation{};
 };
 
 #endif // !VULKAN_IMAGE_H
\ No newline at end of file
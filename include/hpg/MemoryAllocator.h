@@ -0,0 +1,166 @@
+///////////////////////////////////////////////////////
+// MemoryAllocator class declaration
+///////////////////////////////////////////////////////
+
+//
+// Sub-allocates buffers and images from large blocks of device memory rather than calling
+// vkAllocateMemory for every resource, which is slow and limited by maxMemoryAllocationCount.
+// Blocks are reserved per memory type and each keeps a sorted free list, allocations are
+// placed best fit and freed ranges are merged with their neighbours. Linear resources
+// (buffers) and optimal tiling images never share a block, so bufferImageGranularity is
+// respected without padding. Host visible blocks stay mapped for their whole lifetime.
+// Allocations are tagged with what they hold so usage can be reported per category, and heap
+// budgets come from VK_EXT_memory_budget when the device supports it.
+//
+
+#ifndef MEMORY_ALLOCATOR_H
+#define MEMORY_ALLOCATOR_H
+
+#include <common/types.h>
+
+#include <memory> // block ownership
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <vulkan/vulkan_core.h>
+
+
+class MemoryAllocator {
+private:
+    struct Block;
+
+public:
+    //-What the memory is used for, for accounting only------------------------------------------------------//
+    enum class Category : unsigned char {
+        TEXTURE    = 0x0,
+        GEOMETRY   = 0x1, // vertex and index buffers
+        ATTACHMENT = 0x2, // g-buffer and depth attachments
+        SHADOW_MAP = 0x3,
+        UNIFORM    = 0x4,
+        STAGING    = 0x5,
+        OTHER      = 0x6,
+        COUNT      = 0x7
+    };
+
+    //-Sub allocation, bind the resource to memory at offset----------------------------------------------------//
+    struct Allocation {
+        VkDeviceMemory   memory    = VK_NULL_HANDLE;
+        VkDeviceSize     offset    = 0;
+        VkDeviceSize     size      = 0;
+        void*            mapped    = nullptr; // start of the allocation when the memory is host visible
+        MemoryAllocator* allocator = nullptr; // owner, null when nothing is allocated
+        Block*           block     = nullptr;
+        Category         category  = Category::OTHER;
+    };
+
+    //-Kind of resource, decides which blocks it can share----------------------------------------------------//
+    enum class ResourceType : unsigned char {
+        LINEAR  = 0x0, // buffers and linear tiling images
+        OPTIMAL = 0x1  // optimal tiling images
+    };
+
+    //-Usage of one memory type--------------------------------------------------------------------------------//
+    struct Stats {
+        UI32         memoryType;
+        UI32         numBlocks;
+        UI32         numAllocations;
+        UI32         numFreeRanges;
+        VkDeviceSize blockBytes;       // reserved with vkAllocateMemory
+        VkDeviceSize usedBytes;        // handed out to resources, alignment padding stays free
+        VkDeviceSize largestFreeRange;
+        F32          fragmentation;    // 1 - largest free range / free bytes within each block, 0 when contiguous
+    };
+
+    //-Usage of one category-----------------------------------------------------------------------------------//
+    struct CategoryStats {
+        UI32         numAllocations;
+        VkDeviceSize bytes;
+        VkDeviceSize peakBytes;
+    };
+
+    //-Budget of one memory heap-------------------------------------------------------------------------------//
+    struct HeapBudget {
+        VkDeviceSize size;
+        VkDeviceSize budget;         // how much the process can use before allocations may fail or be paged out
+        VkDeviceSize usage;          // used by the whole process, including memory the allocator does not own
+        VkDeviceSize allocatorBytes; // reserved in the allocator's blocks
+        bool         deviceLocal;
+    };
+
+public:
+    //-Initialisation and cleanup------------------------------------------------------------------------------//
+    void init(VkPhysicalDevice physicalDevice, VkDevice device, VkDeviceSize blockSize = DEFAULT_BLOCK_SIZE);
+    // the device must have been created with VK_EXT_memory_budget, and the instance with physical device properties 2
+    void enableMemoryBudget(VkInstance instance);
+    void cleanup();
+
+    //-Allocation----------------------------------------------------------------------------------------------//
+    Allocation allocate(const VkMemoryRequirements& requirements, VkMemoryPropertyFlags properties, ResourceType type,
+        Category category = Category::OTHER);
+    void free(Allocation& allocation);
+
+    //-Statistics----------------------------------------------------------------------------------------------//
+    std::vector<Stats> getStats();
+    std::vector<CategoryStats> getCategoryStats();
+    // without the budget extension the budget is estimated as 80% of the heap and the usage is the allocator's
+    std::vector<HeapBudget> getHeapBudgets();
+    // allocation free forms filling caller storage, of at least VK_MAX_MEMORY_TYPES stats, Category::COUNT category
+    // stats and VK_MAX_MEMORY_HEAPS budgets, return the number of entries written
+    UI32 getStats(Stats* stats);
+    UI32 getCategoryStats(CategoryStats* stats);
+    UI32 getHeapBudgets(HeapBudget* budgets);
+    void printStats();
+    // writes the heap budgets, category totals and memory type statistics as json
+    void dumpJson(const std::string& path);
+
+    static const char* getCategoryName(Category category);
+    inline bool hasMemoryBudget() const { return vkGetPhysicalDeviceMemoryProperties2KHR != nullptr; }
+
+    inline UI32 getNumDeviceAllocations() const { return numDeviceAllocations; }
+
+public:
+    static const VkDeviceSize DEFAULT_BLOCK_SIZE = 64 * 1024 * 1024;
+
+private:
+    //-Block of device memory and its free list----------------------------------------------------------------//
+    struct Range {
+        VkDeviceSize offset;
+        VkDeviceSize size;
+    };
+
+    struct Block {
+        VkDeviceMemory     memory;
+        VkDeviceSize       size;
+        UI32               memoryType;
+        ResourceType       resourceType;
+        bool               dedicated; // holds a single resource larger than the block size
+        unsigned char*     mapped;
+        UI32               numAllocations;
+        std::vector<Range> freeRanges; // sorted by offset, never adjacent
+    };
+
+    UI32 findMemoryType(UI32 typeFilter, VkMemoryPropertyFlags properties) const;
+    Block* createBlock(UI32 memoryType, VkDeviceSize size, ResourceType resourceType, bool dedicated);
+    void destroyBlock(Block* block);
+    // the allocation's category must be set, it is accounted for when the allocation succeeds
+    bool allocateFromBlock(Block* block, VkDeviceSize size, VkDeviceSize alignment, Allocation& allocation);
+
+private:
+    //-Members-------------------------------------------------------------------------------------------------//
+    VkPhysicalDevice physicalDevice = VK_NULL_HANDLE;
+    VkDevice device = VK_NULL_HANDLE;
+    VkPhysicalDeviceMemoryProperties memoryProperties{};
+    PFN_vkGetPhysicalDeviceMemoryProperties2KHR vkGetPhysicalDeviceMemoryProperties2KHR = nullptr; // set with the budget extension
+    VkDeviceSize blockSize = DEFAULT_BLOCK_SIZE;
+    VkDeviceSize nonCoherentAtomSize = 1;
+
+    std::vector<std::unique_ptr<Block>> blocks;
+    UI32 numDeviceAllocations = 0;
+
+    CategoryStats categoryStats[static_cast<size_t>(Category::COUNT)]{};
+
+    std::mutex mutex; // resources may be created from worker threads
+};
+
+#endif // !MEMORY_ALLOCATOR_H
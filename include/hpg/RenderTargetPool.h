@@ -0,0 +1,109 @@
+///////////////////////////////////////////////////////
+// RenderTargetPool class declaration
+///////////////////////////////////////////////////////
+
+//
+// Creates the images render passes draw into and decides where their memory comes from. Each
+// target declares the first and last pass of the frame that use it, targets whose passes do not
+// overlap are bound to the same memory, which is fine as every render pass clears its attachments
+// from an undefined layout. Transient targets, which are never sampled nor stored, get the
+// TRANSIENT_ATTACHMENT usage and lazily allocated memory on devices that have it, so tile based
+// GPUs never back them with real memory at all. Targets are destroyed through the pool, and a
+// released target keeps its memory slot busy until the frames using it have completed.
+//
+
+#ifndef RENDER_TARGET_POOL_H
+#define RENDER_TARGET_POOL_H
+
+#include <hpg/VulkanSetup.h>
+#include <hpg/Image.h>
+#include <hpg/DeletionQueue.h>
+
+#include <common/types.h>
+
+#include <map>
+#include <memory>
+#include <vector>
+
+#include <vulkan/vulkan_core.h>
+
+
+class RenderTargetPool {
+public:
+    //-Passes of a frame, in submission order--------------------------------------------------------------------//
+    enum class Pass : unsigned char {
+        OFFSCREEN   = 0x0, // gBuffer
+        SHADOW_MAP  = 0x1,
+        COMPOSITION = 0x2,
+        GUI         = 0x3
+    };
+
+    //-Target creation info--------------------------------------------------------------------------------------//
+    struct TargetInfo {
+        UI32               width        = 0;
+        UI32               height       = 0;
+        VkFormat           format       = VK_FORMAT_UNDEFINED;
+        VkImageUsageFlags  usage        = 0;
+        VkImageAspectFlags aspect       = 0;
+        Pass               firstPass    = Pass::OFFSCREEN; // first and last pass of a frame using the target
+        Pass               lastPass     = Pass::OFFSCREEN;
+        bool               transient    = false; // only used as an attachment, contents do not outlive its passes
+        VulkanImage*       pVulkanImage = nullptr;
+        VkImageView*       pImageView   = nullptr;
+    };
+
+    //-Memory use------------------------------------------------------------------------------------------------//
+    struct Stats {
+        UI32         numTargets;
+        UI32         numSlots;
+        VkDeviceSize requestedBytes; // what a separate allocation for every target would take
+        VkDeviceSize allocatedBytes; // backing the slots
+        VkDeviceSize lazyBytes;      // of the allocated bytes, lazily allocated and only committed when needed
+        VkDeviceSize savedBytes;     // requested bytes that are aliased or lazily allocated
+    };
+
+public:
+    //-Initialisation and cleanup--------------------------------------------------------------------------------//
+    void createRenderTargetPool(const VulkanSetup* pVkSetup);
+    // every target must have been destroyed
+    void cleanupRenderTargetPool();
+
+    //-Targets---------------------------------------------------------------------------------------------------//
+    void createTarget(const TargetInfo& info);
+    void destroyTarget(VkImage image, VkImageView imageView);
+    // destroys the target once the current frame has completed, its slot is not reused by overlapping passes before
+    void releaseTarget(VkImage image, VkImageView imageView, DeletionQueue* deletionQueue);
+
+    Stats getStats() const;
+    inline bool hasLazyMemory() const { return lazyMemoryTypeBits != 0; }
+
+private:
+    //-Memory shared by targets with disjoint passes-------------------------------------------------------------//
+    struct Slot {
+        MemoryAllocator::Allocation allocation;
+        UI32                        memoryTypeBits;
+        VkMemoryPropertyFlags       properties;
+        std::vector<VkImage>        users;
+    };
+
+    struct Target {
+        Slot*        slot;
+        VkDeviceSize size;
+        Pass         firstPass;
+        Pass         lastPass;
+    };
+
+    // a slot the requirements fit in whose users' passes do not overlap with [firstPass, lastPass], or null
+    Slot* findSlot(const VkMemoryRequirements& requirements, VkMemoryPropertyFlags properties, Pass firstPass, Pass lastPass);
+
+private:
+    //-Members---------------------------------------------------------------------------------------------------//
+    const VulkanSetup* vkSetup;
+
+    UI32 lazyMemoryTypeBits = 0; // memory types that are lazily allocated
+
+    std::vector<std::unique_ptr<Slot>> slots;
+    std::map<VkImage, Target>          targets;
+};
+
+#endif // !RENDER_TARGET_POOL_H
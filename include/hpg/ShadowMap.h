@@ -29,8 +29,6 @@ public:
 
 	void createShadowMapPipeline(VkDescriptorSetLayout* descriptorSetLayout, Model* model);
 
-	void updateShadowMapUniformBuffer(const UBO& ubo);
-
 public:
 	VulkanSetup* vkSetup;
 
@@ -50,8 +48,6 @@ public:
 
 	VkPipelineLayout layout;
 	VkPipeline shadowMapPipeline;
-
-	VulkanBuffer shadowMapUniformBuffer;
 };
 
 #endif // !SHADOW_MAP_H
\ No newline at end of file
@@ -15,6 +15,10 @@
 
 #include <common/Model.h>
 
+#include <hpg/UploadManager.h>
+
+#include <utils/ThreadPool.h>
+
 class Skybox {
 public: 
 	//-Unfiorm buffer object---------------------------------------------//    
@@ -76,23 +80,15 @@ public:
 
 public:
 	//-Initialisation and cleanup----------------------------------------//    
-	void createSkybox(VulkanSetup* pVkSetup, const VkCommandPool& commandPool);
+	void createSkybox(VulkanSetup* pVkSetup, UploadManager* uploadManager, ThreadPool* pool);
 	void cleanupSkybox();
 
-	//-Skybox uniform object update -------------------------------------//    
-	void updateSkyboxUniformBuffer(const UBO& ubo) {
-		void* data;
-		vkMapMemory(vkSetup->device, uniformBuffer.memory, 0, sizeof(ubo), 0, &data);
-		memcpy(data, &ubo, sizeof(ubo));
-		vkUnmapMemory(vkSetup->device, uniformBuffer.memory);
-	}
-
 private:
 	//-Skybox sampler creation-------------------------------------------//    
 	void createSkyboxSampler();
 
 	//-Skybox image creation---------------------------------------------//    
-	void createSkyboxImage(const VkCommandPool& commandPool);
+	void createSkyboxImage(UploadManager* uploadManager, ThreadPool* pool);
 
 	//-Skybox image view creation----------------------------------------//    
 	void createSkyboxImageView();
@@ -107,7 +103,6 @@ public:
 	VkSampler skyboxSampler;
 
 	VulkanBuffer vertexBuffer;
-	VulkanBuffer uniformBuffer;
 };
 
 #endif // !SKYBOX_H
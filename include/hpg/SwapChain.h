@@ -15,6 +15,7 @@
 
 #include <hpg/VulkanSetup.h> // for referencing the device
 #include <hpg/DepthResource.h> // for referencing the depth resource
+#include <hpg/DeletionQueue.h>
 
 #include <vector> // vector container
 
@@ -25,10 +26,14 @@ public:
     //-Initialisation and cleanup--------------------------------------------------------------------------------//    
     void initSwapChain(VulkanSetup* pVkSetup, Model* model, VkDescriptorSetLayout* descriptorSetLayout);
     void cleanupSwapChain();
+    // creates a swap chain for the current surface extent from the old one, which is retired along with the extent 
+    // dependent objects. Render passes and the pipeline are only rebuilt if the surface format changed
+    void recreateSwapChain(Model* model, VkDescriptorSetLayout* descriptorSetLayout, DeletionQueue* deletionQueue);
 
 private:
     //-Swap chain creation helpers-------------------------------------------------------------------------------//    
-    void createSwapChain();
+    void createSwapChain(VkSwapchainKHR oldSwapChain = VK_NULL_HANDLE);
+    void createImageViews();
     VulkanSetup::SwapChainSupportDetails querySwapChainSupport();
     VkSurfaceFormatKHR chooseSwapSurfaceFormat(const std::vector<VkSurfaceFormatKHR>& availableFormats);
     VkPresentModeKHR chooseSwapPresentMode(const std::vector<VkPresentModeKHR>& availablePresentModes);
@@ -0,0 +1,177 @@
+///////////////////////////////////////////////////////
+// TextureStreamer class declaration
+///////////////////////////////////////////////////////
+
+//
+// Keeps only the mip levels the view needs of each texture on the device. A texture starts out
+// with the levels no larger than MIN_RESIDENT_SIZE, so materials can be drawn as soon as they are
+// added, and the streamer keeps the texture's source: the mapped ktx2 container or the encoded
+// image. Each frame the renderer requests the pixels a uv unit covers on screen for the textures
+// it draws, which gives the coarsest level that still maps a texel to at most a pixel. Textures
+// grow towards the requested levels and keep the levels they have while everything fits in the
+// budget. Over budget, the largest level of a texture is evicted, unrequested levels going first
+// and then the ones covering the fewest pixels per texel. Vulkan 1.0 has no sparse residency, so
+// a texture changes its levels by recreating its image with the new chain, uploaded through the
+// upload manager. Levels mapped in a format the device samples are read in place, encoded images
+// and block compressed ones the device cannot sample are decoded again on the streamer's workers
+// and uploaded by a later update. The old image is destroyed once frames in flight are done with
+// it, and the renderer points its descriptors at the new view. The rebuilds started by an update
+// are capped, along with those still decoding, so streaming never stalls a frame on a large
+// chain, and evictions are applied before textures grow.
+//
+
+#ifndef TEXTURE_STREAMER_H
+#define TEXTURE_STREAMER_H
+
+#include <hpg/VulkanSetup.h>
+#include <hpg/Image.h>
+#include <hpg/UploadManager.h>
+#include <hpg/DeletionQueue.h>
+
+#include <utils/ThreadPool.h>
+
+#include <common/Texture.h>
+#include <common/types.h>
+
+#include <future>
+#include <memory>
+#include <vector>
+
+#include <vulkan/vulkan_core.h>
+
+
+class TextureStreamer {
+public:
+    //-Memory use------------------------------------------------------------------------------------------------//
+    struct Stats {
+        UI32         numTextures;
+        UI32         numStreaming;    // textures whose resident levels differ from the ones requested
+        UI32         numDecoding;     // rebuilds whose levels are being decoded on the workers
+        VkDeviceSize residentBytes;   // levels on the device
+        VkDeviceSize requestedBytes;  // what the requested levels would take, regardless of the budget
+        VkDeviceSize fullBytes;       // every level of every texture
+        VkDeviceSize budget;
+        VkDeviceSize sourceBytes;     // encoded images and mapped containers the textures are rebuilt from
+        VkDeviceSize hostBytes;       // levels copied to the host, of textures without a source and decoding rebuilds
+        UI32         numStreamedIn;   // image rebuilds since creation that added levels
+        UI32         numEvicted;      // and that removed them
+        VkDeviceSize uploadedBytes;   // by the rebuilds
+    };
+
+public:
+    //-Initialisation and cleanup--------------------------------------------------------------------------------//
+    void createTextureStreamer(VulkanSetup* pVkSetup, UploadManager* pUploadManager, DeletionQueue* pDeletionQueue,
+        VkDeviceSize budget, VkDeviceSize uploadBytesPerUpdate, UI32 numThreads);
+    // waits for the rebuilds being decoded and releases the sources, the textures are cleaned up by their owner
+    void cleanupTextureStreamer();
+
+    //-Textures--------------------------------------------------------------------------------------------------//
+    // creates the texture with the smallest levels of the image, the source is kept to read the others from. An
+    // image without a source has every level copied to the host, its chain built there when it has a single level
+    void addTexture(UI32 textureIdx, Texture* texture, const Image& image, const ImageSource& source = ImageSource{});
+
+    //-Streaming-------------------------------------------------------------------------------------------------//
+    // pixelsPerUv is the screen size of a uv unit where the texture is drawn, the largest request of a frame counts
+    void request(UI32 textureIdx, F32 pixelsPerUv);
+    // uploads the rebuilds decoded since the last update, moves the textures towards the levels requested and
+    // flushes the uploads
+    void update();
+    // textures whose image was recreated by the last update, in increasing order
+    inline const std::vector<UI32>& getChangedTextures() const { return changedTextures; }
+
+    inline void setBudget(VkDeviceSize bytes) { budget = bytes; }
+    inline VkDeviceSize getBudget() const { return budget; }
+    Stats getStats() const;
+
+public:
+    // largest dimension of the levels always resident
+    static const UI32 MIN_RESIDENT_SIZE = 64;
+
+private:
+    //-Levels decoded on a worker--------------------------------------------------------------------------------//
+    struct Rebuild {
+        UI32                       numLevels = 0;
+        VkDeviceSize               bytes     = 0; // of the levels, read on this thread while the worker runs
+        std::vector<unsigned char> storage;
+        Image                      levels{}; // points into the storage once done
+        std::future<void>          done;
+    };
+
+    //-Streamed texture------------------------------------------------------------------------------------------//
+    struct StreamedTexture {
+        Texture*                   texture = nullptr;
+        ImageSource                source;
+        bool                       decodeBlocks = false; // the source's format cannot be sampled by the device
+        std::vector<unsigned char> hostData;   // every level of textures without a source
+        Image                      hostLevels{}; // the layout of the host data
+        UI32                       width   = 0;
+        UI32                       height  = 0;
+        VkFormat                   format  = VK_FORMAT_UNDEFINED; // of the uploaded levels
+        std::vector<VkDeviceSize>  chainBytes; // bytes of the smallest n levels, for n up to the number of levels
+        UI32                       numLevels       = 1;
+        UI32                       minLevels       = 1; // never evicted
+        UI32                       residentLevels  = 1; // the smallest levels, on the device
+        UI32                       requestedLevels = 0; // since the last update
+        UI32                       targetLevels    = 1;
+        F32                        pixelsPerUv     = 0.0f;
+        std::shared_ptr<Rebuild>   rebuild; // being decoded, shared with the worker
+    };
+
+    //-Eviction candidate, the largest target level of a texture------------------------------------------------//
+    struct Candidate {
+        bool requested; // unrequested levels are evicted first, the largest of them first
+        F32  priority;  // pixels a texel of the level covers when requested, its bytes otherwise
+        UI32 textureIdx;
+        // ordered for a max heap, the top is the next level to evict
+        bool operator<(const Candidate& other) const {
+            if (requested != other.requested) {
+                return requested;
+            }
+            return requested ? priority > other.priority : priority < other.priority;
+        }
+    };
+
+    // the largest dimension of the texture's level
+    static UI32 getLevelDimension(const StreamedTexture& streamed, UI32 level);
+    Candidate getCandidate(UI32 textureIdx) const;
+
+    //-Reading levels--------------------------------------------------------------------------------------------//
+    // the levels from first down of an image with pre-built levels, pointing into its data
+    static Image selectLevels(const Image& image, UI32 first);
+    // levels from first down of numLevels, written into storage: filtered from a single level of 8 bit channels or
+    // expanded from block compressed levels
+    static Image downsampleLevels(const Image& image, UI32 first, UI32 numLevels, std::vector<unsigned char>* storage);
+    static Image decodeLevels(const Image& levels, std::vector<unsigned char>* storage);
+    // decodes the source on the calling thread, the levels point into storage
+    static Image readSourceLevels(const ImageSource& source, bool decodeBlocks, UI32 first, UI32 numLevels,
+        std::vector<unsigned char>* storage);
+
+    // recreates the image straight away when its levels can be read in place, otherwise decodes them on a worker
+    void rebuildTexture(UI32 textureIdx, UI32 numLevels);
+    void setResidentLevels(UI32 textureIdx, UI32 numLevels, const Image& levels);
+
+private:
+    //-Members---------------------------------------------------------------------------------------------------//
+    VulkanSetup*   vkSetup       = nullptr;
+    UploadManager* uploadManager = nullptr;
+    DeletionQueue* deletionQueue = nullptr;
+
+    std::unique_ptr<ThreadPool> pool; // decodes rebuilds, kept small so it does not compete with the frame
+
+    VkDeviceSize budget               = 0;
+    VkDeviceSize uploadBytesPerUpdate = 0;
+
+    std::vector<StreamedTexture> textures; // by texture index, textures that were not added have no texture
+    std::vector<UI32>            changedTextures;
+
+    // scratch of the updates, kept to reuse their memory
+    std::vector<Candidate> candidates;
+    std::vector<UI32>      streamIns;
+
+    VkDeviceSize sourceBytes   = 0; // each source counted once, however many textures share it
+    UI32         numStreamedIn = 0;
+    UI32         numEvicted    = 0;
+    VkDeviceSize uploadedBytes = 0;
+};
+
+#endif // !TEXTURE_STREAMER_H
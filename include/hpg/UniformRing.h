@@ -0,0 +1,72 @@
+///////////////////////////////////////////////////////
+// UniformRing class declaration
+///////////////////////////////////////////////////////
+
+//
+// A single persistently mapped uniform buffer split into one partition per frame in flight.
+// Each frame the partition of that frame is reset, uniform blocks are then copied into it
+// back to back at the device's minUniformBufferOffsetAlignment, and are bound through dynamic
+// uniform buffer descriptors with the offset returned by the push. Writing uniforms is a plain
+// memcpy, and per draw data only costs another push.
+//
+
+#ifndef UNIFORM_RING_H
+#define UNIFORM_RING_H
+
+#include <hpg/VulkanSetup.h>
+#include <hpg/Buffers.h>
+
+#include <common/types.h>
+
+#include <cstring> // memcpy
+
+#include <vulkan/vulkan_core.h>
+
+
+class UniformRing {
+public:
+    //-Initialisation and cleanup--------------------------------------------------------------------------------//
+    void createUniformRing(const VulkanSetup* pVkSetup, VkDeviceSize frameSize, UI32 numFrames);
+    void cleanupUniformRing();
+
+    //-Per frame use---------------------------------------------------------------------------------------------//
+    // the frame's previous submission must have completed, its partition is overwritten
+    void beginFrame(UI32 frameIdx);
+
+    // reserves size bytes in the current frame's partition, returns the dynamic offset
+    UI32 allocate(VkDeviceSize size, void** data);
+
+    template<typename T>
+    UI32 push(const T& uniforms);
+
+    //-Descriptors-----------------------------------------------------------------------------------------------//
+    // a dynamic uniform buffer descriptor of the ring, the offset is given when the set is bound
+    VkDescriptorBufferInfo getDescriptorInfo(VkDeviceSize range) const;
+
+    inline VkDeviceSize getFrameUsage() const { return head - frameBegin; }
+
+public:
+    //-Members---------------------------------------------------------------------------------------------------//
+    const VulkanSetup* vkSetup;
+
+    VulkanBuffer buffer; // host visible and coherent, mapped for its whole lifetime
+
+    VkDeviceSize frameSize  = 0;
+    VkDeviceSize alignment  = 1;
+    VkDeviceSize frameBegin = 0;
+    VkDeviceSize head       = 0;
+};
+
+//
+// Template definitions
+//
+
+template<typename T>
+UI32 UniformRing::push(const T& uniforms) {
+    void* data;
+    UI32 offset = allocate(sizeof(T), &data);
+    memcpy(data, &uniforms, sizeof(T));
+    return offset;
+}
+
+#endif // !UNIFORM_RING_H
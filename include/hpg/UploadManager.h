@@ -0,0 +1,156 @@
+///////////////////////////////////////////////////////
+// UploadManager class declaration
+///////////////////////////////////////////////////////
+
+//
+// Batches host to device uploads of buffers and images into a single submission. Source data
+// is copied into a persistently mapped staging arena as soon as an upload is queued, so callers
+// may free it straight away, and the copies are recorded into the batch's command buffer. A
+// batch is submitted with a fence when flushed or when the arena runs out of space, and every
+// upload returns the token of its batch rather than waiting on the queue. Tokens increase with
+// submission order, a token is complete once its batch's fence is signalled. The arena is a ring,
+// staging space is reclaimed as batches complete. Copies run on the transfer queue, when that is
+// a family of its own the batch releases ownership of its resources there and a small submission
+// on the graphics queue, waiting on the copies with a semaphore, acquires them. Otherwise the batch
+// goes to the graphics queue with barriers making the data visible to later submissions. Either
+// way the renderer does not need to wait on a token before drawing with the resources, only before
+// destroying them. Images can have their mip chain generated from level 0, with linear blits on the
+// graphics queue when the format supports them and on the host while staging otherwise. Images
+// can also be written into the arena by the caller, which lets decoders skip their own copy.
+//
+
+#ifndef UPLOAD_MANAGER_H
+#define UPLOAD_MANAGER_H
+
+#include <hpg/VulkanSetup.h>
+#include <hpg/Buffers.h>
+#include <hpg/Image.h>
+
+#include <common/types.h>
+
+#include <deque>
+#include <functional> // staging writes
+#include <vector>
+
+#include <vulkan/vulkan_core.h>
+
+
+class UploadManager {
+public:
+    typedef UI64 Token;
+
+    //-Image upload info-----------------------------------------------------------------------------------------//
+    struct ImageUploadInfo {
+        VulkanImage*                   pVulkanImage = nullptr;
+        const void*                    data         = nullptr;
+        VkDeviceSize                   size         = 0;
+        std::vector<VkBufferImageCopy> regions; // buffer offsets relative to data
+        UI32                           mipLevels    = 1;
+        UI32                           arrayLayers  = 1;
+        VkImageLayout                  finalLayout  = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+        // the regions only cover level 0, one tightly packed layer each, and every other level is built from it. 
+        // Blitting needs the image to be created with TRANSFER_SRC usage
+        bool                           generateMips = false;
+        // when set, writes the size bytes straight into staging memory in place of copying them from data, so that 
+        // decoded pixels need no host copy of their own. It runs before uploadImage returns and must not queue uploads
+        std::function<void(unsigned char* staging)> writeData;
+    };
+
+public:
+    //-Initialisation and cleanup--------------------------------------------------------------------------------//
+    void createUploadManager(const VulkanSetup* pVkSetup, VkDeviceSize stagingSize = DEFAULT_STAGING_SIZE);
+    // waits for every pending batch
+    void cleanupUploadManager();
+
+    //-Device local resources filled through the manager--------------------------------------------------------//
+    // buffers are packed back to back, callers are responsible for any alignment between them
+    Token createDeviceLocalBuffer(const std::vector<Buffer>& buffers, VulkanBuffer* vkBuffer, VkBufferUsageFlags usage,
+        MemoryAllocator::Category category = MemoryAllocator::Category::GEOMETRY);
+
+    //-Queueing uploads------------------------------------------------------------------------------------------//
+    // buffers are packed back to back from dstOffset
+    Token uploadBuffer(VkBuffer dst, VkDeviceSize dstOffset, const std::vector<Buffer>& buffers);
+    // transitions the whole image from undefined, copies the regions and transitions it to the final layout
+    Token uploadImage(const ImageUploadInfo& info);
+
+    //-Submission and completion---------------------------------------------------------------------------------//
+    // submits the recording batch if it has any uploads, returns the last token submitted
+    Token flush();
+    // retires completed batches without blocking
+    void update();
+    bool isComplete(Token token);
+    // flushes the token's batch if it is still recording and blocks until it completes
+    void wait(Token token);
+
+    inline Token getRecordingToken() const { return recordingToken; }
+    inline UI32 getNumSubmissions() const { return numSubmissions; }
+    inline UI32 getNumUploads() const { return numUploads; }
+    inline UI32 getNumBlittedMipChains() const { return numBlittedMipChains; }
+    inline UI32 getNumDownsampledMipChains() const { return numDownsampledMipChains; }
+
+public:
+    static const VkDeviceSize DEFAULT_STAGING_SIZE = 64 * 1024 * 1024;
+
+private:
+    //-Mip chain blitted from level 0, every level is in TRANSFER_DST_OPTIMAL beforehand--------------------------//
+    struct MipGeneration {
+        VkImage       image       = VK_NULL_HANDLE;
+        UI32          width       = 0;
+        UI32          height      = 0;
+        UI32          mipLevels   = 1;
+        UI32          arrayLayers = 1;
+        VkImageLayout finalLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+    };
+
+    //-Batch of uploads sharing a command buffer and a fence-----------------------------------------------------//
+    struct Batch {
+        VkCommandBuffer           commandBuffer = VK_NULL_HANDLE; // transfer queue
+        VkCommandBuffer           acquireCommandBuffer = VK_NULL_HANDLE; // graphics queue, with an ownership transfer
+        VkSemaphore               copiesDone    = VK_NULL_HANDLE; // signalled by the copies, waited on by the acquire
+        VkFence                   fence         = VK_NULL_HANDLE; // signalled by the batch's last submission
+        Token                     token         = 0;
+        VkDeviceSize              stagingBytes  = 0; // arena bytes reserved, including alignment and wrap padding
+        std::vector<VulkanBuffer> dedicatedStaging; // uploads that do not fit in the arena at all
+        UI32                      numUploads    = 0;
+        bool                      hasBufferCopies = false;
+        std::vector<VkBufferMemoryBarrier> bufferAcquires; // recorded on the graphics queue when flushed
+        std::vector<VkImageMemoryBarrier>  imageAcquires;
+        std::vector<VkImageMemoryBarrier>  mipAcquires; // images blitted after they are acquired
+        std::vector<MipGeneration>         mipGenerations;
+    };
+
+    void beginBatch();
+    // blits every level from the one above and transitions it to the final layout, needs a graphics queue
+    static void recordMipGeneration(VkCommandBuffer commandBuffer, const MipGeneration& generation);
+    void retireBatch(Batch& batch);
+    // reserves arena space for size bytes, flushing and waiting on older batches until it fits
+    unsigned char* reserveStaging(VkDeviceSize size, VkDeviceSize alignment, VkBuffer* stagingBuffer, VkDeviceSize* stagingOffset);
+    bool tryReserve(VkDeviceSize size, VkDeviceSize alignment, VkDeviceSize* offset);
+
+private:
+    //-Members---------------------------------------------------------------------------------------------------//
+    const VulkanSetup* vkSetup;
+
+    VkCommandPool commandPool = VK_NULL_HANDLE; // transfer family
+    VkCommandPool acquirePool = VK_NULL_HANDLE; // graphics family, only with an ownership transfer
+    bool ownershipTransfer = false; // copies and rendering use different queue families
+
+    VulkanBuffer staging; // host visible and coherent, mapped for its whole lifetime
+    VkDeviceSize capacity = 0;
+    VkDeviceSize head     = 0; // next free byte
+    VkDeviceSize used     = 0; // bytes between the oldest pending batch's first byte and the head
+
+    Batch              recording;
+    std::deque<Batch>  pending; // submitted, in token order
+    std::vector<Batch> freeBatches; // completed, command buffers and fences are reused
+
+    Token recordingToken = 1;
+    Token completedToken = 0; // every token up to this one has completed
+
+    UI32 numSubmissions = 0;
+    UI32 numUploads     = 0;
+    UI32 numBlittedMipChains     = 0;
+    UI32 numDownsampledMipChains = 0;
+};
+
+#endif // !UPLOAD_MANAGER_H
@@ -20,6 +20,8 @@
 // constants and structs
 #include <utils/Utils.h>
 
+#include <hpg/MemoryAllocator.h> // device memory sub-allocation
+
 // vulkan definitions
 #include <vulkan/vk_platform.h>
 #include <vulkan/vulkan_core.h>
@@ -67,8 +69,14 @@ private:
     bool isDeviceSuitable(VkPhysicalDevice device);
     SwapChainSupportDetails querySwapChainSupport(VkPhysicalDevice device);
     bool checkDeviceExtensionSupport(VkPhysicalDevice device);
+    bool isDeviceExtensionSupported(VkPhysicalDevice device, const char* extensionName);
     void createLogicalDevice();
 
+    //-Pipeline cache--------------------------------------------------------------------------------------------//
+    // seeded from the cache file when it was written by the same device and driver, empty otherwise
+    void createPipelineCache();
+    void writePipelineCache();
+
 public:
     //-Members---------------------------------------------------------------------------------------------------//
     GLFWwindow* window;
@@ -83,8 +91,20 @@ public:
     VkDevice         device;
     VkQueue          graphicsQueue;
     VkQueue          presentQueue;
+    VkQueue          transferQueue; // the graphics queue when the device has no dedicated transfer family
+    uint32_t         graphicsFamily;
+    uint32_t         transferFamily;
     VkPhysicalDeviceProperties deviceProperties;
 
+    // shared by every pipeline created, persisted across runs in PIPELINE_CACHE_PATH
+    VkPipelineCache pipelineCache = VK_NULL_HANDLE;
+
+    // resources are created through const VulkanSetup pointers, allocating from the allocator does not change the setup
+    mutable MemoryAllocator allocator;
+
+    bool physicalDeviceProperties2 = false; // VK_KHR_get_physical_device_properties2 enabled on the instance
+    bool memoryBudget = false; // VK_EXT_memory_budget enabled on the device
+
     bool setupComplete = false;
 };
 
@@ -0,0 +1,30 @@
+///////////////////////////////////////////////////////
+// Heap allocation counter
+///////////////////////////////////////////////////////
+
+//
+// Counts heap allocations so the frame loop can be checked to be free of them. The global operator
+// new is replaced by one that bumps a counter before calling malloc, which catches the standard
+// containers and anything else allocated with new, and ImGui is handed the counted malloc through
+// its allocator functions. Libraries calling malloc themselves (GLFW, the Vulkan loader and driver)
+// are not seen.
+//
+
+#ifndef ALLOCATION_COUNTER_H
+#define ALLOCATION_COUNTER_H
+
+#include <common/types.h>
+
+#include <cstddef> // size_t
+
+
+namespace utils {
+    // heap allocations since start up, from any thread
+    UI64 getNumHeapAllocations();
+
+    // malloc and free for allocation callbacks that bypass operator new
+    void* countedMalloc(size_t size);
+    void countedFree(void* ptr);
+}
+
+#endif // !ALLOCATION_COUNTER_H
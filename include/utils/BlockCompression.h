@@ -0,0 +1,41 @@
+///////////////////////////////////////////////////////
+// Block compression
+///////////////////////////////////////////////////////
+
+//
+// Encoding and decoding of the BC1, BC3, BC4, BC5 and BC7 block compressed formats on the host.
+// Textures are compressed offline and uploaded as they are, the decoder is the fallback for
+// devices that cannot sample a file's format and expands the blocks to the 8 bit format they
+// stand for: BC4 to R8, BC5 to R8G8 and the others to R8G8B8A8, keeping the sRGB encoding. The
+// decoder handles every BC7 mode, the encoder favours speed and simplicity over quality, it fits
+// each block's endpoints to its principal axis and only writes BC7 blocks in mode 6, one subset
+// with four bit indices. BC1 blocks are always written opaque.
+//
+
+#ifndef BLOCK_COMPRESSION_H
+#define BLOCK_COMPRESSION_H
+
+#include <hpg/Image.h>
+
+#include <common/types.h>
+
+#include <vector>
+
+#include <vulkan/vulkan_core.h>
+
+
+namespace utils {
+    // the 8 bit format a block compressed format decodes to, undefined for formats the codec does not handle
+    VkFormat getDecodedFormat(VkFormat format);
+
+    // writes the texels of a width x height level of blocks, tightly packed in the decoded format
+    void decodeBlocks(VkFormat format, const unsigned char* blocks, UI32 width, UI32 height, unsigned char* dst);
+
+    // compresses a tightly packed R8G8B8A8 level, edge blocks repeat the last row and column
+    void encodeBlocks(VkFormat format, const unsigned char* rgba, UI32 width, UI32 height, unsigned char* blocks);
+
+    // decodes every level and layer of a block compressed image, the returned image points into storage
+    Image decodeImage(const Image& image, std::vector<unsigned char>* storage);
+}
+
+#endif // !BLOCK_COMPRESSION_H
@@ -0,0 +1,31 @@
+///////////////////////////////////////////////////////
+// CPU image downsampling
+///////////////////////////////////////////////////////
+
+//
+// Builds mip levels on the host for formats the device cannot blit with linear filtering. Each
+// level is a 2x2 box filter of the one above it, averaged per byte so it applies to any format 
+// made of 8 bit channels. sRGB data is averaged as stored rather than in linear space, which 
+// slightly darkens high contrast detail in the smaller levels. Four byte texels, the common case,
+// go through SSE2, other texel sizes and the odd edge texels are filtered one at a time.
+//
+
+#ifndef DOWNSAMPLE_H
+#define DOWNSAMPLE_H
+
+#include <common/types.h>
+
+#include <cstddef> // size_t
+
+
+namespace utils {
+    // dimensions of the level below, never less than one texel
+    inline UI32 getMipDimension(UI32 dimension, UI32 level) { 
+        return (dimension >> level) > 0 ? (dimension >> level) : 1; 
+    }
+
+    // writes the getMipDimension(width, 1) x getMipDimension(height, 1) level below a tightly packed image
+    void downsampleImage(const unsigned char* src, UI32 width, UI32 height, UI32 texelSize, unsigned char* dst);
+}
+
+#endif // !DOWNSAMPLE_H
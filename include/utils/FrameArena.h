@@ -0,0 +1,83 @@
+///////////////////////////////////////////////////////
+// FrameArena class declaration
+///////////////////////////////////////////////////////
+
+//
+// A linear allocator for CPU side data that only lives for a frame, such as descriptor writes and
+// statistics gathered for the GUI. A single block is allocated up front and split into one partition
+// per frame in flight, allocating bumps the head of the current partition and nothing is freed on
+// its own, the whole partition is reset when its frame begins again. FrameAllocator lets standard
+// containers draw from the arena, FrameVector being the common case, so a frame needs no heap
+// allocations at all once the arena is created.
+//
+
+#ifndef FRAME_ARENA_H
+#define FRAME_ARENA_H
+
+#include <common/types.h>
+
+#include <cstddef> // size_t, max_align_t
+#include <memory>
+#include <vector>
+
+
+class FrameArena {
+public:
+    //-Initialisation and cleanup--------------------------------------------------------------------------------//
+    void createFrameArena(size_t frameSize, UI32 numFrames);
+    void cleanupFrameArena();
+
+    //-Per frame use---------------------------------------------------------------------------------------------//
+    // data allocated the last time the frame began is overwritten
+    void beginFrame(UI32 frameIdx);
+
+    // reserves size bytes in the current frame's partition, throws when the partition is full
+    void* allocate(size_t size, size_t alignment = alignof(std::max_align_t));
+
+    inline size_t getFrameUsage() const { return head - frameBegin; }
+    inline size_t getPeakUsage() const { return peakUsage; }
+
+public:
+    //-Members---------------------------------------------------------------------------------------------------//
+    size_t frameSize = 0;
+
+private:
+    std::unique_ptr<unsigned char[]> memory;
+
+    UI32   numFrames  = 0;
+    size_t frameBegin = 0;
+    size_t head       = 0;
+    size_t peakUsage  = 0; // most bytes a frame has used
+};
+
+//
+// STL allocator adapter, deallocation is a no-op as memory is reclaimed when the frame is reset
+//
+
+template<typename T>
+class FrameAllocator {
+public:
+    typedef T value_type;
+
+    FrameAllocator(FrameArena* pArena) noexcept : arena(pArena) {}
+
+    template<typename U>
+    FrameAllocator(const FrameAllocator<U>& other) noexcept : arena(other.arena) {}
+
+    inline T* allocate(size_t n) { return static_cast<T*>(arena->allocate(n * sizeof(T), alignof(T))); }
+    inline void deallocate(T*, size_t) noexcept {}
+
+    FrameArena* arena;
+};
+
+template<typename T, typename U>
+inline bool operator==(const FrameAllocator<T>& a, const FrameAllocator<U>& b) { return a.arena == b.arena; }
+
+template<typename T, typename U>
+inline bool operator!=(const FrameAllocator<T>& a, const FrameAllocator<U>& b) { return a.arena != b.arena; }
+
+// growing leaves the old storage behind until the frame is reset, reserve or size it up front
+template<typename T>
+using FrameVector = std::vector<T, FrameAllocator<T>>;
+
+#endif // !FRAME_ARENA_H
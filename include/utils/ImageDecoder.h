@@ -0,0 +1,86 @@
+///////////////////////////////////////////////////////
+// ImageDecoder class declaration
+///////////////////////////////////////////////////////
+
+//
+// Decodes png, jpeg and the other stb_image formats on a thread pool. Decodes are submitted
+// up front and collected with next in the order they complete, so the caller can upload each
+// image while the workers are still busy with the others, and loading time scales with the
+// number of cores rather than the number of images. stb_image's global vertical flip is not
+// safe to change while other threads decode, images are flipped by the worker instead.
+//
+
+#ifndef IMAGE_DECODER_H
+#define IMAGE_DECODER_H
+
+#include <hpg/Image.h>
+
+#include <utils/ThreadPool.h>
+
+#include <common/types.h>
+
+#include <condition_variable>
+#include <cstdlib> // free
+#include <deque>
+#include <exception> // exception_ptr
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+
+class ImageDecoder {
+public:
+    //-Decoded image---------------------------------------------------------------------------------------------//
+    struct Result {
+        UI32  id = 0; // returned when the decode was submitted
+        Image image{}; // in an 8 bit sRGB format, points into the pixels
+        std::unique_ptr<unsigned char, void(*)(void*)> pixels{ nullptr, std::free };
+    };
+
+public:
+    explicit ImageDecoder(ThreadPool* pPool);
+    // waits for the decodes still running, results that were not collected are dropped
+    ~ImageDecoder();
+
+    ImageDecoder(const ImageDecoder&) = delete;
+    ImageDecoder& operator=(const ImageDecoder&) = delete;
+
+    //-Submitting decodes----------------------------------------------------------------------------------------//
+    // numChannels forces the number of channels, 0 keeps the file's. Flipped images start with their bottom row
+    UI32 decodeFile(const std::string& path, int numChannels, bool flipVertically = false);
+    // the encoded data must stay valid until the decode completes
+    UI32 decodeMemory(const unsigned char* data, size_t size, int numChannels, bool flipVertically = false);
+
+    //-Collecting results----------------------------------------------------------------------------------------//
+    // blocks until a decode that has not been collected yet completes, false once every decode has been collected.
+    // Rethrows the error of a failed decode
+    bool next(Result* result);
+
+private:
+    // decode returns stb_image allocated pixels, or null on failure
+    typedef std::function<unsigned char*(int* width, int* height, int* channels)> DecodeFunction;
+    UI32 submit(DecodeFunction&& decode, int numChannels, bool flipVertically, const std::string& name);
+
+private:
+    //-Members---------------------------------------------------------------------------------------------------//
+    struct Completed {
+        Result             result;
+        std::exception_ptr error;
+    };
+
+    ThreadPool* pool;
+
+    std::mutex              mutex;
+    std::condition_variable condition;
+    std::deque<Completed>   completed; // not collected yet, in completion order
+
+    UI32 numSubmitted = 0;
+    UI32 numCollected = 0;
+
+    std::vector<std::future<void>> futures; // waited on before the decoder goes away
+};
+
+#endif // !IMAGE_DECODER_H
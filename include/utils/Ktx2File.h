@@ -0,0 +1,50 @@
+///////////////////////////////////////////////////////
+// Ktx2File class declaration
+///////////////////////////////////////////////////////
+
+//
+// Reads and writes block compressed textures in KTX2 containers. A loaded file is memory mapped
+// and its levels are handed to the upload path where they lie, so a texture with a full mip
+// chain costs no more than a copy to staging memory. Only what the renderer needs is handled:
+// 2D textures and cube maps in the BC1, BC3, BC4, BC5 and BC7 formats with pre-built levels and
+// no supercompression. Cube map faces are stored in the order the skybox samples them. convert
+// is the offline side, it builds the mip chain of an image, or of six cube map faces, on the host
+// and compresses every level.
+//
+
+#ifndef KTX2_FILE_H
+#define KTX2_FILE_H
+
+#include <hpg/Image.h>
+
+#include <utils/MappedFile.h>
+
+#include <string>
+#include <vector>
+
+#include <vulkan/vulkan_core.h>
+
+
+class Ktx2File {
+public:
+    //-Loading---------------------------------------------------------------------------------------------------//
+    // maps the file and validates its header and level index, throws for files the loader cannot handle
+    void load(const std::string& path);
+
+    // the image's data points into the mapping, it is only valid while the file is loaded
+    inline const Image& getImage() const { return image; }
+
+    //-Writing---------------------------------------------------------------------------------------------------//
+    // the image must be block compressed, its levels are written smallest first as the format asks
+    static void write(const std::string& path, const Image& image);
+
+    // compresses one image, or six cube map faces, and its full mip chain
+    static void convert(const std::vector<std::string>& inputs, const std::string& output, VkFormat format);
+
+private:
+    //-Members---------------------------------------------------------------------------------------------------//
+    MappedFile file;
+    Image      image{};
+};
+
+#endif // !KTX2_FILE_H
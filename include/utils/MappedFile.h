@@ -0,0 +1,44 @@
+///////////////////////////////////////////////////////
+// MappedFile class declaration
+///////////////////////////////////////////////////////
+
+//
+// A read only, memory mapped view of a file. Pages are only read from disk when touched, 
+// so large binary assets can be parsed and uploaded without first being copied into a 
+// heap allocated buffer. The mapping is copy on write, writes never reach the file.
+//
+
+#ifndef MAPPED_FILE_H
+#define MAPPED_FILE_H
+
+#include <string>
+
+
+class MappedFile {
+public:
+    MappedFile() = default;
+    ~MappedFile();
+
+    // mappings own an os handle, they can be moved but not copied
+    MappedFile(MappedFile&& other) noexcept;
+    MappedFile& operator=(MappedFile&& other) noexcept;
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    //-Map and unmap---------------------------------------------------------------------------------------------//
+    void map(const std::string& path);
+    void unmap();
+
+    inline bool isMapped() const { return data != nullptr; }
+
+public:
+    //-Members---------------------------------------------------------------------------------------------------//
+    unsigned char* data = nullptr;
+    size_t size         = 0;
+
+private:
+    void* fileHandle    = nullptr; // platform handles, only the windows mapping object needs to be kept
+    void* mappingHandle = nullptr;
+};
+
+#endif // !MAPPED_FILE_H
@@ -0,0 +1,72 @@
+///////////////////////////////////////////////////////
+// ThreadPool class declaration
+///////////////////////////////////////////////////////
+
+//
+// A fixed size pool of worker threads consuming a shared task queue. Tasks are submitted
+// as callables and their completion (or exception) is observed through a future.
+//
+
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <common/types.h>
+
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
+
+class ThreadPool {
+public:
+    explicit ThreadPool(UI32 numThreads = std::thread::hardware_concurrency());
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    //-Submit work-----------------------------------------------------------------------------------------------//
+    template<typename F>
+    std::future<void> submit(F&& task);
+
+    // runs body(i) for i in [0, count) on the workers and blocks until all are done, rethrows the first exception
+    void parallelFor(size_t count, const std::function<void(size_t)>& body);
+
+    inline UI32 getNumThreads() const { return static_cast<UI32>(workers.size()); }
+
+private:
+    void workerLoop();
+
+private:
+    //-Members---------------------------------------------------------------------------------------------------//
+    std::vector<std::thread> workers;
+    std::queue<std::function<void()>> tasks;
+
+    std::mutex mutex;
+    std::condition_variable condition;
+    bool stopping = false;
+};
+
+//
+// Template function definitions
+//
+
+template<typename F>
+std::future<void> ThreadPool::submit(F&& task) {
+    // std::function must be copyable, so the packaged task is shared
+    auto packaged = std::make_shared<std::packaged_task<void()>>(std::forward<F>(task));
+    std::future<void> future = packaged->get_future();
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        tasks.emplace([packaged]() { (*packaged)(); });
+    }
+    condition.notify_one();
+    return future;
+}
+
+#endif // !THREAD_POOL_H
@@ -68,12 +68,18 @@ namespace utils {
     struct QueueFamilyIndices {
         std::optional<uint32_t> graphicsFamily; // queue supporting drawing commands
         std::optional<uint32_t> presentFamily; // queue for presenting image to vk surface 
+        std::optional<uint32_t> transferFamily; // queue without graphics support for copies, if the device has one
 
         inline bool isComplete() {
             // if device supports drawing cmds AND image can be presented to surface
             return graphicsFamily.has_value() && presentFamily.has_value();
         }
 
+        // copies fall back to the graphics queue when there is no dedicated transfer family
+        inline uint32_t getTransferFamily() const {
+            return transferFamily.has_value() ? transferFamily.value() : graphicsFamily.value();
+        }
+
         static QueueFamilyIndices findQueueFamilies(VkPhysicalDevice device, VkSurfaceKHR surface);
     };
 
@@ -12,6 +12,7 @@
 #include <utils/Utils.h>
 #include <utils/Print.h>
 #include <utils/Assert.h>
+#include <utils/AllocationCounter.h>
 
 // transformations
 #define GLM_FORCE_RADIANS
@@ -23,6 +24,7 @@
 #include <glm/gtx/string_cast.hpp>
 
 #include <algorithm> // min, max
+#include <cmath> // tan
 #include <fstream> // file (shader) loading
 #include <cstdint> // UINT32_MAX
 #include <set> // set for queues
@@ -46,6 +48,7 @@ void Application::initVulkan() {
     // scene data
     camera = Camera({ 0.0f, 0.0f, 0.0f }, 2.0f, 10.0f);
     model.loadModel(MODEL_PATH);
+    model.setVertexFormat(PACKED_VERTICES ? Model::VertexFormat::PACKED : Model::VertexFormat::FLOAT);
 
     lights[0] = { {5.0f, -5.0f, 0.0f, 0.0f}, {0.5f, 0.5f, 0.5f}, 40.0f }; // pos, colour, radius
 
@@ -54,51 +57,67 @@ void Application::initVulkan() {
     createCommandPool(&renderCommandPool, VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT);
     createCommandPool(&imGuiCommandPool, VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT);
 
+    uploadManager.createUploadManager(&vkSetup);
+
     createDescriptorSetLayout();
 
+    renderTargetPool.createRenderTargetPool(&vkSetup);
+
     swapChain.initSwapChain(&vkSetup, &model, &descriptorSetLayout);
-    frameBuffer.initFrameBuffer(&vkSetup, &swapChain, renderCommandPool);
-    gBuffer.createGBuffer(&vkSetup, &swapChain, &descriptorSetLayout, &model, renderCommandPool);
+    frameBuffer.initFrameBuffer(&vkSetup, &swapChain, &renderTargetPool);
+    gBuffer.createGBuffer(&vkSetup, &swapChain, &descriptorSetLayout, &model, &renderTargetPool);
     shadowMap.createShadowMap(&vkSetup, &descriptorSetLayout, &model,  renderCommandPool);
     
-    // textures
-    const std::vector<Image>* textureImages = model.getMaterialTextureData(0);
-    textures.resize(textureImages->size());
-
-    for (size_t i = 0; i < textureImages->size(); i++) {
-        textures[i].createTexture(&vkSetup, renderCommandPool, textureImages->data()[i] );
+    // textures, two per material (albedo and metallic roughness) followed by a default for sub meshes without a material
+    UI32 numMaterials = model.getNumMaterials();
+    textures.resize(2 * (static_cast<size_t>(numMaterials) + 1));
+
+    unsigned char white[] = { 255, 255, 255, 255 };
+    Image defaultImage{ 1, 1, VK_FORMAT_R8G8B8A8_SRGB, { white, sizeof(white) } };
+
+    // images are decoded on every hardware thread, each texture is queued for upload as soon as its image is ready.
+    // Only the smallest levels are uploaded, the rest are streamed in as the view needs them
+    textureBudgetMb = TEXTURE_STREAMING_BUDGET / (1024.0f * 1024.0f);
+    textureStreamer.createTextureStreamer(&vkSetup, &uploadManager, &deletionQueue, TEXTURE_STREAMING_BUDGET, 
+        TEXTURE_STREAMING_UPLOAD_SIZE, TEXTURE_STREAMING_THREADS);
+    ThreadPool loadPool;
+    std::vector<bool> created(textures.size(), false);
+    model.decodeMaterialTextures(&loadPool, [&](UI32 textureIdx, const Image& image, const ImageSource& source) {
+        textureStreamer.addTexture(textureIdx, &textures[textureIdx], image, source);
+        created[textureIdx] = true;
+    });
+
+    // materials without images and the sub meshes without a material sample white
+    for (UI32 i = 0; i < static_cast<UI32>(textures.size()); i++) {
+        if (!created[i]) {
+            textureStreamer.addTexture(i, &textures[i], defaultImage);
+        }
     }
 
-    skybox.createSkybox(&vkSetup, renderCommandPool);
+    skybox.createSkybox(&vkSetup, &uploadManager, &loadPool);
 
+    // the floor is packed into the model's buffers as an extra sub mesh
     floor = Plane(20.0f, 20.0f);
+    model.addSubMesh(floor.getVertices(), floor.getIndices());
 
-    // vertex buffer 
-    std::vector<Model::Vertex>* modelVertexBuffer = model.getVertexBuffer(0);
-    // generate the vertices for a 2D plane
-    //std::vector<Model::Vertex> planeVertexBuffer = floor.getVertices();
+    cube = Cube(2.0f, 2.0f, 2.0f);
 
-    for (auto& v : floor.getVertices()) {
-        modelVertexBuffer->push_back(v);
-    }
+    // a single buffer holds the vertices of every sub mesh followed by their indices, cached data is copied from 
+    // the mapped cache file straight into the staging buffer
+    std::vector<Buffer> geometryData = model.getVertexData();
+    std::vector<Buffer> indexData = model.getIndexData();
+    geometryData.insert(geometryData.end(), indexData.begin(), indexData.end());
+    indexBufferOffset = static_cast<VkDeviceSize>(model.getNumVertices()) * model.getVertexStride(); // a multiple of 4, as index offsets must be
 
-    cube = Cube(2.0f, 2.0f, 2.0f);
-    
-    VulkanBuffer::createDeviceLocalBuffer(&vkSetup, renderCommandPool, 
-        Buffer{ (unsigned char*)modelVertexBuffer->data(), modelVertexBuffer->size() * sizeof(Model::Vertex) }, // vertex data as buffer
-        &vertexBuffer, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT);
+    uploadManager.createDeviceLocalBuffer(geometryData, &geometryBuffer, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT);
 
-    // index buffer
-    std::vector<uint32_t>* iBuffer = model.getIndexBuffer(0);
-    // generate indices for a quad
-    UI32 offset = static_cast<UI32>(iBuffer->size());
-    for (auto& i : floor.getIndices()) {
-        iBuffer->push_back(i + offset);
-    }
+    // submit whatever is left, the first frame is submitted after it on the same queue so nothing waits on the host
+    uploadManager.flush();
+    PRINT("uploads: %u in %u submissions, mip chains: %u blitted, %u downsampled on the host\n", uploadManager.getNumUploads(), 
+        uploadManager.getNumSubmissions(), uploadManager.getNumBlittedMipChains(), uploadManager.getNumDownsampledMipChains());
 
-    VulkanBuffer::createDeviceLocalBuffer(&vkSetup, renderCommandPool, 
-        Buffer{ (unsigned char*)iBuffer->data(), iBuffer->size() * sizeof(uint32_t) }, // index data as buffer
-        &indexBuffer, VK_BUFFER_USAGE_INDEX_BUFFER_BIT);
+    uniformRing.createUniformRing(&vkSetup, UNIFORM_RING_FRAME_SIZE, MAX_FRAMES_IN_FLIGHT);
+    frameArena.createFrameArena(FRAME_ARENA_SIZE, MAX_FRAMES_IN_FLIGHT);
 
     createDescriptorPool();
     createDescriptorSets();
@@ -117,55 +136,67 @@ void Application::initVulkan() {
 
     createSyncObjects();
 
-    // record commands
-    for (UI32 i = 0; i < swapChain.images.size(); i++) { 
-        buildOffscreenCommandBuffer(i); // offscreen gbuffer commands
-        buildShadowMapCommandBuffer(offScreenCommandBuffers[i]); // final image composition
-        buildCompositionCommandBuffer(i); // final image composition
-    }
+    // commands are recorded every frame, the scene's depend on the camera and every pass binds its uniforms at
+    // this frame's offsets in the uniform ring
+
+    vkSetup.allocator.printStats();
+
+    TextureStreamer::Stats textureStats = textureStreamer.getStats();
+    PRINT("textures: %u, %.1f MB resident of %.1f MB with every level, %.1f MB of sources and %.1f MB of levels on the host\n", 
+        textureStats.numTextures, textureStats.residentBytes / (1024.0f * 1024.0f), textureStats.fullBytes / (1024.0f * 1024.0f),
+        textureStats.sourceBytes / (1024.0f * 1024.0f), textureStats.hostBytes / (1024.0f * 1024.0f));
+
+    RenderTargetPool::Stats targetStats = renderTargetPool.getStats();
+    PRINT("render targets: %u in %u slots, %.1f of %.1f MB saved by aliasing and lazy allocation\n", targetStats.numTargets, 
+        targetStats.numSlots, targetStats.savedBytes / (1024.0f * 1024.0f), targetStats.requestedBytes / (1024.0f * 1024.0f));
 }
 
 void Application::recreateVulkanData() {
-    static int width = 0, height = 0;
+    int width = 0, height = 0;
     glfwGetFramebufferSize(window, &width, &height);
 
-    while (width == 0 || height == 0) {
-        glfwGetFramebufferSize(window, &width, &height);
-        glfwWaitEvents();
+    // a minimised window has no extent to create a swap chain for, try again once it is restored
+    if (width == 0 || height == 0) {
+        framebufferResized = true;
+        return;
     }
 
-    vkDeviceWaitIdle(vkSetup.device); // wait if in use by device
-
-    // destroy old swap chain dependencies
-    vkFreeCommandBuffers(vkSetup.device, imGuiCommandPool, static_cast<uint32_t>(imGuiCommandBuffers.size()), imGuiCommandBuffers.data());
-
-    vkFreeCommandBuffers(vkSetup.device, renderCommandPool, static_cast<uint32_t>(renderCommandBuffers.size()), renderCommandBuffers.data());
-    vkFreeCommandBuffers(vkSetup.device, renderCommandPool, static_cast<uint32_t>(offScreenCommandBuffers.size()), offScreenCommandBuffers.data());
-    //vkFreeCommandBuffers(vkSetup.device, renderCommandPool, static_cast<uint32_t>(shadowMapCommandBuffers.size()), shadowMapCommandBuffers.data());
-
-    shadowMap.cleanupShadowMap();
-    gBuffer.cleanupGBuffer();
-    frameBuffer.cleanupFrameBuffers();
-    swapChain.cleanupSwapChain();
-
-    // create new swap chain etc...
-    swapChain.initSwapChain(&vkSetup, &model, &descriptorSetLayout);
-    frameBuffer.initFrameBuffer(&vkSetup, &swapChain, renderCommandPool);
-    gBuffer.createGBuffer(&vkSetup, &swapChain, &descriptorSetLayout, &model, renderCommandPool);
-    shadowMap.createShadowMap(&vkSetup, &descriptorSetLayout, &model, renderCommandPool);
-
-    createDescriptorSets();
-
-    createCommandBuffers(static_cast<uint32_t>(renderCommandBuffers.size()), renderCommandBuffers.data(), renderCommandPool);
-    createCommandBuffers(static_cast<uint32_t>(offScreenCommandBuffers.size()), offScreenCommandBuffers.data(), renderCommandPool);
-    createCommandBuffers(static_cast<uint32_t>(shadowMapCommandBuffers.size()), shadowMapCommandBuffers.data(), renderCommandPool);
-
-    createCommandBuffers(static_cast<uint32_t>(imGuiCommandBuffers.size()), imGuiCommandBuffers.data(), imGuiCommandPool);
+    // nothing waits on the device here, whatever frames in flight may still use is handed to the deletion queue and
+    // destroyed once their fences have signalled. Only the resources depending on the extent are rebuilt, the shadow
+    // map, render passes, samplers and pipelines are kept, the viewport and scissor being set when recording
+    VkFormat oldImageFormat = swapChain.imageFormat;
+    swapChain.recreateSwapChain(&model, &descriptorSetLayout, &deletionQueue);
+    frameBuffer.recreateFrameBuffers(&swapChain, &deletionQueue);
+    gBuffer.recreateGBuffer(&swapChain, &deletionQueue);
+
+    // the composition pipeline is only compatible with swap chain render passes of the same format
+    if (swapChain.imageFormat != oldImageFormat) {
+        gBuffer.recreatePipelines(&swapChain, &descriptorSetLayout, &model, &deletionQueue);
+    }
 
-    for (UI32 i = 0; i < swapChain.images.size(); i++) {
-        buildOffscreenCommandBuffer(i);
-        buildCompositionCommandBuffer(i);
-        buildShadowMapCommandBuffer(offScreenCommandBuffers[i]);
+    // fresh composition sets sample the new attachments, the old ones may be bound by frames in flight
+    VkDevice device = vkSetup.device;
+    VkDescriptorPool pool = descriptorPool;
+    std::vector<VkDescriptorSet> oldCompositionDescriptorSets = compositionDescriptorSets;
+    createCompositionDescriptorSets();
+    deletionQueue.push([=]() {
+        vkFreeDescriptorSets(device, pool, static_cast<uint32_t>(oldCompositionDescriptorSets.size()), 
+            oldCompositionDescriptorSets.data());
+    });
+
+    // per image command buffers are recorded every frame so they are kept, only extra images need new ones. Fences in 
+    // imagesInFlight are kept too, an image index is not recorded into again before its last use has completed
+    size_t numImages = swapChain.images.size();
+    if (numImages > renderCommandBuffers.size()) {
+        uint32_t first = static_cast<uint32_t>(renderCommandBuffers.size());
+        uint32_t count = static_cast<uint32_t>(numImages) - first;
+
+        renderCommandBuffers.resize(numImages);
+        imGuiCommandBuffers.resize(numImages);
+        createCommandBuffers(count, renderCommandBuffers.data() + first, renderCommandPool);
+        createCommandBuffers(count, imGuiCommandBuffers.data() + first, imGuiCommandPool);
+
+        imagesInFlight.resize(numImages, VK_NULL_HANDLE);
     }
 
     // update ImGui aswell
@@ -174,6 +205,9 @@ void Application::recreateVulkanData() {
 
 void Application::initImGui() {
     IMGUI_CHECKVERSION();
+    // count imgui's allocations along with the application's
+    ImGui::SetAllocatorFunctions([](size_t size, void*) { return utils::countedMalloc(size); }, 
+        [](void* ptr, void*) { utils::countedFree(ptr); });
     ImGui::CreateContext();
     ImGuiIO& io = ImGui::GetIO(); (void)io;
 
@@ -188,7 +222,7 @@ void Application::initImGui() {
     init_info.Device         = vkSetup.device;
     init_info.QueueFamily    = utils::QueueFamilyIndices::findQueueFamilies(vkSetup.physicalDevice, vkSetup.surface).graphicsFamily.value();
     init_info.Queue          = vkSetup.graphicsQueue;
-    init_info.PipelineCache  = VK_NULL_HANDLE;
+    init_info.PipelineCache  = vkSetup.pipelineCache;
     init_info.DescriptorPool = descriptorPool;
     init_info.Allocator      = nullptr;
     init_info.MinImageCount  = swapChain.supportDetails.capabilities.minImageCount + 1;
@@ -251,16 +285,16 @@ void Application::createDescriptorPool() {
 void Application::createDescriptorSetLayout() {
 
     std::vector<VkDescriptorSetLayoutBinding> setLayoutBindings = {
-        // binding 0: vertex shader uniform buffer 
-        utils::initDescriptorSetLayoutBinding(0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_SHADER_STAGE_VERTEX_BIT),
+        // binding 0: vertex shader uniform buffer, dynamic offset into the uniform ring
+        utils::initDescriptorSetLayoutBinding(0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, VK_SHADER_STAGE_VERTEX_BIT),
         // binding 1: model albedo texture / position texture
         utils::initDescriptorSetLayoutBinding(1, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT),
         // binding 2: model metallic roughness / normal texture
         utils::initDescriptorSetLayoutBinding(2, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT),
         // binding 3: albedo texture
         utils::initDescriptorSetLayoutBinding(3, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT),
-        // binding 4: fragment shader uniform buffer 
-        utils::initDescriptorSetLayoutBinding(4, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_SHADER_STAGE_FRAGMENT_BIT),
+        // binding 4: fragment shader uniform buffer, dynamic offset into the uniform ring
+        utils::initDescriptorSetLayoutBinding(4, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, VK_SHADER_STAGE_FRAGMENT_BIT),
         // binding 5: fragment shader shadow map sampler
         utils::initDescriptorSetLayoutBinding(5, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT)
     };
@@ -276,41 +310,21 @@ void Application::createDescriptorSetLayout() {
 }
 
 void Application::createDescriptorSets() {
-    std::vector<VkWriteDescriptorSet> writeDescriptorSets;
+    FrameVector<VkWriteDescriptorSet> writeDescriptorSets(&frameArena);
+    writeDescriptorSets.reserve(4);
 
-    std::vector<VkDescriptorSetLayout> layouts(swapChain.images.size(), descriptorSetLayout);
+    FrameVector<VkDescriptorSetLayout> layouts(swapChain.images.size(), descriptorSetLayout, &frameArena);
 
     VkDescriptorSetAllocateInfo allocInfo = utils::initDescriptorSetAllocInfo(descriptorPool, 1, layouts.data());
 
-    // offscreen descriptor set
-    if (vkAllocateDescriptorSets(vkSetup.device, &allocInfo, &offScreenDescriptorSet) != VK_SUCCESS) {
-        throw std::runtime_error("failed to allocate descriptor sets!");
-    }
-
-    // offscreen uniform
-    VkDescriptorBufferInfo offScreenUboInf{};
-    offScreenUboInf.buffer = gBuffer.offScreenUniform.buffer;
-    offScreenUboInf.offset = 0;
-    offScreenUboInf.range  = sizeof(GBuffer::OffScreenUbo);
-    
-    // offscreen textures in scene
-    std::vector<VkDescriptorImageInfo> offScreenTexDescriptors(textures.size());
-    for (size_t i = 0; i < textures.size(); i++) {
-        offScreenTexDescriptors[i].imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-        offScreenTexDescriptors[i].imageView   = textures[i].textureImageView;
-        offScreenTexDescriptors[i].sampler     = textures[i].textureSampler;
+    // offscreen descriptor sets, one per material and one for sub meshes without a material
+    offScreenDescriptorSets.resize(static_cast<size_t>(model.getNumMaterials()) + 1);
+    for (UI32 i = 0; i < static_cast<UI32>(offScreenDescriptorSets.size()); i++) {
+        offScreenDescriptorSets[i] = createMaterialDescriptorSet(i);
     }
 
-    writeDescriptorSets = {
-        // binding 0: vertex shader uniform buffer 
-        utils::initWriteDescriptorSet(offScreenDescriptorSet, 0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, &offScreenUboInf),
-        // binding 1: model albedo texture 
-        utils::initWriteDescriptorSet(offScreenDescriptorSet, 1, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, &offScreenTexDescriptors[0]),
-        // binding 2: model metallic roughness texture
-        utils::initWriteDescriptorSet(offScreenDescriptorSet, 2, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, &offScreenTexDescriptors[1])
-    };
-
-    vkUpdateDescriptorSets(vkSetup.device, static_cast<uint32_t>(writeDescriptorSets.size()), writeDescriptorSets.data(), 0, nullptr);
+    // uniforms, every set points both dynamic bindings at the ring so the offsets given when binding are always valid
+    VkDescriptorBufferInfo compositionUboInf = uniformRing.getDescriptorInfo(sizeof(GBuffer::CompositionUBO));
 
     // skybox descriptor set
     if (vkAllocateDescriptorSets(vkSetup.device, &allocInfo, &skyboxDescriptorSet) != VK_SUCCESS) {
@@ -318,10 +332,7 @@ void Application::createDescriptorSets() {
     }
 
     // skybox uniform
-    VkDescriptorBufferInfo skyboxUboInf{};
-    skyboxUboInf.buffer = skybox.uniformBuffer.buffer;
-    skyboxUboInf.offset = 0;
-    skyboxUboInf.range = sizeof(Skybox::UBO);
+    VkDescriptorBufferInfo skyboxUboInf = uniformRing.getDescriptorInfo(sizeof(Skybox::UBO));
 
     // skybox texture
     VkDescriptorImageInfo skyboxTexDescriptor{};
@@ -331,9 +342,11 @@ void Application::createDescriptorSets() {
 
     writeDescriptorSets = {
         // binding 0: vertex shader uniform buffer 
-        utils::initWriteDescriptorSet(skyboxDescriptorSet, 0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, &skyboxUboInf),
+        utils::initWriteDescriptorSet(skyboxDescriptorSet, 0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, &skyboxUboInf),
         // binding 1: skybox texture 
-        utils::initWriteDescriptorSet(skyboxDescriptorSet, 1, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, &skyboxTexDescriptor)
+        utils::initWriteDescriptorSet(skyboxDescriptorSet, 1, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, &skyboxTexDescriptor),
+        // binding 4: unused fragment uniform buffer
+        utils::initWriteDescriptorSet(skyboxDescriptorSet, 4, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, &compositionUboInf)
     };
 
     vkUpdateDescriptorSets(vkSetup.device, static_cast<uint32_t>(writeDescriptorSets.size()), writeDescriptorSets.data(), 0, nullptr);
@@ -344,20 +357,66 @@ void Application::createDescriptorSets() {
     }
 
     // shadowMap uniform
-    VkDescriptorBufferInfo shadowMapUboInf{};
-    shadowMapUboInf.buffer = shadowMap.shadowMapUniformBuffer.buffer;
-    shadowMapUboInf.offset = 0;
-    shadowMapUboInf.range = sizeof(ShadowMap::UBO);
+    VkDescriptorBufferInfo shadowMapUboInf = uniformRing.getDescriptorInfo(sizeof(ShadowMap::UBO));
 
     writeDescriptorSets = {
         // binding 0: vertex shader uniform buffer 
-        utils::initWriteDescriptorSet(shadowMapDescriptorSet, 0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, &shadowMapUboInf),
+        utils::initWriteDescriptorSet(shadowMapDescriptorSet, 0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, &shadowMapUboInf),
+        // binding 4: unused fragment uniform buffer
+        utils::initWriteDescriptorSet(shadowMapDescriptorSet, 4, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, &compositionUboInf)
     };
 
     vkUpdateDescriptorSets(vkSetup.device, static_cast<uint32_t>(writeDescriptorSets.size()), writeDescriptorSets.data(), 0, nullptr);
 
-    // composition descriptor sets
-    allocInfo.descriptorSetCount = static_cast<uint32_t>(layouts.size());
+    createCompositionDescriptorSets();
+}
+
+VkDescriptorSet Application::createMaterialDescriptorSet(UI32 materialIdx) {
+    VkDescriptorSet set;
+    VkDescriptorSetAllocateInfo allocInfo = utils::initDescriptorSetAllocInfo(descriptorPool, 1, &descriptorSetLayout);
+    if (vkAllocateDescriptorSets(vkSetup.device, &allocInfo, &set) != VK_SUCCESS) {
+        throw std::runtime_error("failed to allocate descriptor sets!");
+    }
+
+    // uniforms, both dynamic bindings point at the ring so the offsets given when binding are always valid
+    VkDescriptorBufferInfo offScreenUboInf = uniformRing.getDescriptorInfo(sizeof(GBuffer::OffScreenUbo));
+    VkDescriptorBufferInfo compositionUboInf = uniformRing.getDescriptorInfo(sizeof(GBuffer::CompositionUBO));
+
+    // the material's textures, as they are now, streaming replaces their views
+    VkDescriptorImageInfo texDescriptors[2]{};
+    for (UI32 i = 0; i < 2; i++) {
+        texDescriptors[i].imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+        texDescriptors[i].imageView   = textures[2 * materialIdx + i].textureImageView;
+        texDescriptors[i].sampler     = textures[2 * materialIdx + i].textureSampler;
+    }
+
+    VkWriteDescriptorSet writeDescriptorSets[] = {
+        // binding 0: vertex shader uniform buffer 
+        utils::initWriteDescriptorSet(set, 0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, &offScreenUboInf),
+        // binding 1: model albedo texture 
+        utils::initWriteDescriptorSet(set, 1, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, &texDescriptors[0]),
+        // binding 2: model metallic roughness texture
+        utils::initWriteDescriptorSet(set, 2, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, &texDescriptors[1]),
+        // binding 4: unused fragment uniform buffer
+        utils::initWriteDescriptorSet(set, 4, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, &compositionUboInf)
+    };
+
+    vkUpdateDescriptorSets(vkSetup.device, static_cast<uint32_t>(SizeofArray(writeDescriptorSets)), writeDescriptorSets, 0, nullptr);
+    return set;
+}
+
+void Application::createCompositionDescriptorSets() {
+    FrameVector<VkWriteDescriptorSet> writeDescriptorSets(&frameArena);
+    writeDescriptorSets.reserve(6);
+
+    FrameVector<VkDescriptorSetLayout> layouts(swapChain.images.size(), descriptorSetLayout, &frameArena);
+
+    VkDescriptorSetAllocateInfo allocInfo = utils::initDescriptorSetAllocInfo(descriptorPool, 
+        static_cast<uint32_t>(layouts.size()), layouts.data());
+
+    VkDescriptorBufferInfo offScreenUboInf = uniformRing.getDescriptorInfo(sizeof(GBuffer::OffScreenUbo));
+    VkDescriptorBufferInfo compositionUboInf = uniformRing.getDescriptorInfo(sizeof(GBuffer::CompositionUBO));
+
     compositionDescriptorSets.resize(layouts.size());
 
     if (vkAllocateDescriptorSets(vkSetup.device, &allocInfo, compositionDescriptorSets.data()) != VK_SUCCESS) {
@@ -386,14 +445,10 @@ void Application::createDescriptorSets() {
     texDescriptorShadowMap.sampler = shadowMap.depthSampler;
 
     for (size_t i = 0; i < compositionDescriptorSets.size(); i++) {
-        // forward rendering uniform buffer
-        VkDescriptorBufferInfo compositionUboInf{};
-        compositionUboInf.buffer = gBuffer.compositionUniforms.buffer;
-        compositionUboInf.offset = sizeof(GBuffer::CompositionUBO) * i;
-        compositionUboInf.range  = sizeof(GBuffer::CompositionUBO);
-
         // offscreen descriptor writes
         writeDescriptorSets = {
+            // binding 0: unused vertex uniform buffer
+            utils::initWriteDescriptorSet(compositionDescriptorSets[i], 0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, &offScreenUboInf),
             // binding 1: position texture target 
             utils::initWriteDescriptorSet(compositionDescriptorSets[i], 1, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, &texDescriptorPosition),
             // binding 2: normal texture target
@@ -401,7 +456,7 @@ void Application::createDescriptorSets() {
             // binding 3: albedo texture target
             utils::initWriteDescriptorSet(compositionDescriptorSets[i], 3, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, &texDescriptorAlbedo),
             // binding 4: fragment shader uniform
-            utils::initWriteDescriptorSet(compositionDescriptorSets[i], 4, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, &compositionUboInf),
+            utils::initWriteDescriptorSet(compositionDescriptorSets[i], 4, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, &compositionUboInf),
             // binding 5: shadow map
             utils::initWriteDescriptorSet(compositionDescriptorSets[i], 5, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, &texDescriptorShadowMap),
         };
@@ -461,9 +516,17 @@ void Application::buildCompositionCommandBuffer(UI32 cmdBufferIndex) {
     }
     
     vkCmdBeginRenderPass(renderCommandBuffers[cmdBufferIndex], &renderPassBeginInfo, VK_SUBPASS_CONTENTS_INLINE);
+
+    VkViewport viewport{ 0.0f, 0.0f, (F32)swapChain.extent.width, (F32)swapChain.extent.height, 0.0f, 1.0f };
+    VkRect2D scissor{ { 0, 0 }, swapChain.extent };
+
+    vkCmdSetViewport(renderCommandBuffers[cmdBufferIndex], 0, 1, &viewport);
+
+    vkCmdSetScissor(renderCommandBuffers[cmdBufferIndex], 0, 1, &scissor);
+
     vkCmdBindPipeline(renderCommandBuffers[cmdBufferIndex], VK_PIPELINE_BIND_POINT_GRAPHICS, gBuffer.deferredPipeline);
-    vkCmdBindDescriptorSets(renderCommandBuffers[cmdBufferIndex], VK_PIPELINE_BIND_POINT_GRAPHICS, 
-        swapChain.pipelineLayout, 0, 1, &compositionDescriptorSets[cmdBufferIndex], 0, nullptr);
+    bindDescriptorSet(renderCommandBuffers[cmdBufferIndex], swapChain.pipelineLayout, compositionDescriptorSets[cmdBufferIndex], 
+        0, uniformOffsets.composition);
     // draw a single triangle
     vkCmdDraw(renderCommandBuffers[cmdBufferIndex], 3, 1, 0, 0);
     vkCmdEndRenderPass(renderCommandBuffers[cmdBufferIndex]);
@@ -528,19 +591,38 @@ void Application::buildOffscreenCommandBuffer(UI32 cmdBufferIndex) {
 
     vkCmdBeginRenderPass(offScreenCommandBuffers[cmdBufferIndex], &renderPassBeginInfo, VK_SUBPASS_CONTENTS_INLINE);
 
+    // shared by the scene and skybox pipelines
+    VkViewport viewport{ 0.0f, 0.0f, (F32)gBuffer.extent.width, (F32)gBuffer.extent.height, 0.0f, 1.0f };
+    VkRect2D scissor{ { 0, 0 }, gBuffer.extent };
+
+    vkCmdSetViewport(offScreenCommandBuffers[cmdBufferIndex], 0, 1, &viewport);
+
+    vkCmdSetScissor(offScreenCommandBuffers[cmdBufferIndex], 0, 1, &scissor);
+
     // scene pipeline
     vkCmdBindPipeline(offScreenCommandBuffers[cmdBufferIndex], VK_PIPELINE_BIND_POINT_GRAPHICS, gBuffer.offScreenPipeline);
-    vkCmdBindDescriptorSets(offScreenCommandBuffers[cmdBufferIndex], VK_PIPELINE_BIND_POINT_GRAPHICS, gBuffer.layout, 0, 1,
-        &offScreenDescriptorSet, 0, nullptr);
     VkDeviceSize offset = 0; // offset into vertex buffer
-    vkCmdBindVertexBuffers(offScreenCommandBuffers[cmdBufferIndex], 0, 1, &vertexBuffer.buffer, &offset);
-    vkCmdBindIndexBuffer(offScreenCommandBuffers[cmdBufferIndex], indexBuffer.buffer, 0, VK_INDEX_TYPE_UINT32);
-    vkCmdDrawIndexed(offScreenCommandBuffers[cmdBufferIndex], model.getNumIndices(0) + 6, 1, 0, 0, 0);
+    vkCmdBindVertexBuffers(offScreenCommandBuffers[cmdBufferIndex], 0, 1, &geometryBuffer.buffer, &offset);
+    vkCmdBindIndexBuffer(offScreenCommandBuffers[cmdBufferIndex], geometryBuffer.buffer, indexBufferOffset, VK_INDEX_TYPE_UINT32);
+
+    // draw every sub mesh from the packed buffers, only the material descriptor set changes between draws
+    F32 pixelsPerUnit = static_cast<F32>(swapChain.extent.height) / (2.0f * tanf(0.5f * glm::radians(CAMERA_FOV)));
+    CullingView view = getCullingView(viewProjection * modelMatrix, camera.position);
+    VkDescriptorSet boundSet = VK_NULL_HANDLE;
+    numOffscreenTriangles = 0;
+    for (const auto& subMesh : model.getSubMeshes()) {
+        VkDescriptorSet materialSet = offScreenDescriptorSets[subMesh.material >= 0 ? subMesh.material : model.getNumMaterials()];
+        if (materialSet != boundSet) {
+            bindDescriptorSet(offScreenCommandBuffers[cmdBufferIndex], gBuffer.layout, materialSet, uniformOffsets.offScreen);
+            boundSet = materialSet;
+        }
+        numOffscreenTriangles += drawSubMesh(offScreenCommandBuffers[cmdBufferIndex], subMesh, 
+            selectLod(subMesh, camera.position, pixelsPerUnit), view);
+    }
 
     // skybox pipeline
     vkCmdBindPipeline(offScreenCommandBuffers[cmdBufferIndex], VK_PIPELINE_BIND_POINT_GRAPHICS, gBuffer.skyboxPipeline);
-    vkCmdBindDescriptorSets(offScreenCommandBuffers[cmdBufferIndex], VK_PIPELINE_BIND_POINT_GRAPHICS, gBuffer.layout, 0, 1,
-        &skyboxDescriptorSet, 0, nullptr);
+    bindDescriptorSet(offScreenCommandBuffers[cmdBufferIndex], gBuffer.layout, skyboxDescriptorSet, uniformOffsets.skybox);
     vkCmdBindVertexBuffers(offScreenCommandBuffers[cmdBufferIndex], 0, 1, &skybox.vertexBuffer.buffer, &offset);
     vkCmdDraw(offScreenCommandBuffers[cmdBufferIndex], 36, 1, 0, 0);
 
@@ -585,14 +667,19 @@ void Application::buildShadowMapCommandBuffer(VkCommandBuffer cmdBuffer) {
 
     // scene pipeline
     vkCmdBindPipeline(cmdBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, shadowMap.shadowMapPipeline);
-    vkCmdBindDescriptorSets(cmdBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, shadowMap.layout, 0, 1,
-        &shadowMapDescriptorSet, 0, nullptr);
+    bindDescriptorSet(cmdBuffer, shadowMap.layout, shadowMapDescriptorSet, uniformOffsets.shadowMap);
 
     VkDeviceSize offset = 0; // offset into vertex buffer
-    vkCmdBindVertexBuffers(cmdBuffer, 0, 1, &vertexBuffer.buffer, &offset);
-    vkCmdBindIndexBuffer(cmdBuffer, indexBuffer.buffer, 0, VK_INDEX_TYPE_UINT32);
+    vkCmdBindVertexBuffers(cmdBuffer, 0, 1, &geometryBuffer.buffer, &offset);
+    vkCmdBindIndexBuffer(cmdBuffer, geometryBuffer.buffer, indexBufferOffset, VK_INDEX_TYPE_UINT32);
     
-    vkCmdDrawIndexed(cmdBuffer, model.getNumIndices(0) + 6, 1, 0, 0, 0);
+    // the shadow map is seen from the light, at its own resolution
+    F32 pixelsPerUnit = static_cast<F32>(shadowMap.extent) / (2.0f * tanf(0.5f * glm::radians(SpotLight::FOV)));
+    CullingView view = getCullingView(spotLight.getMVP(modelMatrix), spotLight.direction);
+    numShadowTriangles = 0;
+    for (const auto& subMesh : model.getSubMeshes()) {
+        numShadowTriangles += drawSubMesh(cmdBuffer, subMesh, selectLod(subMesh, spotLight.direction, pixelsPerUnit), view);
+    }
 
     vkCmdEndRenderPass(cmdBuffer);
 
@@ -601,6 +688,101 @@ void Application::buildShadowMapCommandBuffer(VkCommandBuffer cmdBuffer) {
     }
 }
 
+UI32 Application::selectLod(const Model::SubMesh& subMesh, const glm::vec3& viewPosition, F32 pixelsPerUnit) {
+    // distance from the viewer to the closest point of the sub mesh's bounding sphere, in world space
+    glm::vec3 centre = glm::vec3(modelMatrix * glm::vec4(subMesh.centre, 1.0f));
+    F32 distance = glm::length(centre - viewPosition) - subMesh.radius * scale;
+    return Model::selectLod(subMesh, distance, pixelsPerUnit * scale, lodThreshold);
+}
+
+Application::CullingView Application::getCullingView(const glm::mat4& modelViewProjection, const glm::vec3& viewPosition) {
+    // culling is done in model space, where the sub mesh and meshlet bounds are
+    CullingView view{};
+    Meshlet::getFrustumPlanes(modelViewProjection, view.planes);
+    view.position = glm::vec3(glm::inverse(modelMatrix) * glm::vec4(viewPosition, 1.0f));
+    view.enabled = scale > 0.0f; // the model matrix cannot be inverted
+    return view;
+}
+
+UI32 Application::drawSubMesh(VkCommandBuffer cmdBuffer, const Model::SubMesh& subMesh, UI32 lodIdx, const CullingView& view) {
+    if (view.enabled && !Meshlet::isSphereInFrustum(subMesh.centre, subMesh.radius, view.planes)) {
+        return 0;
+    }
+
+    const Model::Lod& lod = subMesh.lods[lodIdx];
+
+    // meshlets only cover the full resolution triangles
+    if (!view.enabled || !meshletCulling || lodIdx != 0 || subMesh.numMeshlets == 0) {
+        vkCmdDrawIndexed(cmdBuffer, lod.indexCount, 1, lod.firstIndex, subMesh.vertexOffset, 0);
+        return lod.indexCount / 3;
+    }
+
+    // meshlets are contiguous in the index buffer, so runs of visible meshlets are merged into a single draw
+    const std::vector<Meshlet>& meshlets = model.getMeshlets();
+    UI32 firstIndex = 0;
+    UI32 indexCount = 0;
+    UI32 numTriangles = 0;
+    for (UI32 i = subMesh.firstMeshlet; i < subMesh.firstMeshlet + subMesh.numMeshlets; i++) {
+        const Meshlet& meshlet = meshlets[i];
+        if (!meshlet.isVisible(view.position, view.planes)) {
+            continue;
+        }
+        if (indexCount > 0 && firstIndex + indexCount == meshlet.firstIndex) {
+            indexCount += meshlet.indexCount;
+            continue;
+        }
+        if (indexCount > 0) {
+            vkCmdDrawIndexed(cmdBuffer, indexCount, 1, firstIndex, subMesh.vertexOffset, 0);
+            numTriangles += indexCount / 3;
+        }
+        firstIndex = meshlet.firstIndex;
+        indexCount = meshlet.indexCount;
+    }
+    if (indexCount > 0) {
+        vkCmdDrawIndexed(cmdBuffer, indexCount, 1, firstIndex, subMesh.vertexOffset, 0);
+        numTriangles += indexCount / 3;
+    }
+    return numTriangles;
+}
+
+void Application::streamTextures() {
+    // a uv unit covers pixelsPerUnit / (distance * uvDensity) pixels, seen from the closest point of the bounding sphere
+    F32 pixelsPerUnit = static_cast<F32>(swapChain.extent.height) / (2.0f * tanf(0.5f * glm::radians(CAMERA_FOV)));
+    CullingView view = getCullingView(viewProjection * modelMatrix, camera.position);
+    for (const auto& subMesh : model.getSubMeshes()) {
+        if (subMesh.material < 0 || subMesh.uvDensity <= 0.0f || 
+            (view.enabled && !Meshlet::isSphereInFrustum(subMesh.centre, subMesh.radius, view.planes))) {
+            continue;
+        }
+        glm::vec3 centre = glm::vec3(modelMatrix * glm::vec4(subMesh.centre, 1.0f));
+        F32 distance = std::max(glm::length(centre - camera.position) - subMesh.radius * scale, 0.1f); // the near plane
+        F32 pixelsPerUv = pixelsPerUnit * scale / (distance * subMesh.uvDensity);
+        textureStreamer.request(2 * subMesh.material, pixelsPerUv);
+        textureStreamer.request(2 * subMesh.material + 1, pixelsPerUv);
+    }
+
+    textureStreamer.setBudget(static_cast<VkDeviceSize>(textureBudgetMb * 1024.0f * 1024.0f));
+    textureStreamer.update();
+
+    // materials whose textures changed get fresh sets, the old ones may be bound by frames in flight
+    UI32 lastMaterial = UINT32_MAX;
+    for (UI32 textureIdx : textureStreamer.getChangedTextures()) {
+        UI32 materialIdx = textureIdx / 2;
+        if (materialIdx == lastMaterial) {
+            continue;
+        }
+        lastMaterial = materialIdx;
+
+        VkDevice device = vkSetup.device;
+        VkDescriptorPool pool = descriptorPool;
+        VkDescriptorSet oldSet = offScreenDescriptorSets[materialIdx];
+        offScreenDescriptorSets[materialIdx] = createMaterialDescriptorSet(materialIdx);
+        deletionQueue.push([=]() {
+            vkFreeDescriptorSets(device, pool, 1, &oldSet);
+        });
+    }
+}
+
 // Handling window resize events
 
 void Application::framebufferResizeCallback(GLFWwindow* window, int width, int height) {
@@ -650,6 +832,16 @@ void Application::mainLoop() {
     // loop keeps window open
     while (!glfwWindowShouldClose(window)) {
         glfwPollEvents();
+
+        // nothing can be presented while minimised, block until an event arrives rather than spinning on frames
+        int width = 0, height = 0;
+        glfwGetFramebufferSize(window, &width, &height);
+        if (width == 0 || height == 0) {
+            glfwWaitEvents();
+            prevTime = std::chrono::high_resolution_clock::now();
+            continue;
+        }
+
         // get the time before the drawing frame
         currTime = std::chrono::high_resolution_clock::now();
         deltaTime = std::chrono::duration<float, std::chrono::seconds::period>(currTime - prevTime).count();
@@ -657,12 +849,24 @@ void Application::mainLoop() {
         if (processKeyInput() == 0)
             break;
 
+        UI64 numHeapAllocations = utils::getNumHeapAllocations();
+
+        // the frame's CPU side scratch memory from MAX_FRAMES_IN_FLIGHT frames back is no longer needed, the GUI and
+        // the frame's drawing both allocate from its partition
+        frameArena.beginFrame(static_cast<UI32>(currentFrame));
+
         // sets the current GUI
         setGUI();
 
         // draw the frame
         drawFrame();
 
+        // frame data comes from the frame arena, anything reaching the heap is counted here
+        numFrameHeapAllocations = utils::getNumHeapAllocations() - numHeapAllocations;
+        if (numFrameHeapAllocations > 0) {
+            numHeapAllocatingFrames++;
+        }
+
         prevTime = currTime;
     }
     vkDeviceWaitIdle(vkSetup.device);
@@ -686,6 +890,15 @@ void Application::drawFrame() {
     // previous frame finished will fence
     vkWaitForFences(vkSetup.device, 1, &inFlightFences[currentFrame], VK_TRUE, UINT64_MAX);
 
+    // reclaim the staging memory of finished uploads
+    uploadManager.update();
+
+    // the fence was last signalled by the frame MAX_FRAMES_IN_FLIGHT serials back, it and every frame before it 
+    // have completed so the objects they retired can be destroyed
+    if (deletionQueue.getFrame() >= MAX_FRAMES_IN_FLIGHT) {
+        deletionQueue.collect(deletionQueue.getFrame() - MAX_FRAMES_IN_FLIGHT);
+    }
+
     VkResult result = vkAcquireNextImageKHR(vkSetup.device, swapChain.swapChain, UINT64_MAX, 
         imageAvailableSemaphores[currentFrame], VK_NULL_HANDLE, &imageIndex); 
 
@@ -703,7 +916,18 @@ void Application::drawFrame() {
 
     imagesInFlight[imageIndex] = inFlightFences[currentFrame]; // set image as in use by current frame
 
-    updateUniformBuffers(imageIndex);
+    // the in flight fence waited on above guarantees this frame's partition of the uniform ring is no longer read
+    updateUniformBuffers(static_cast<UI32>(currentFrame));
+
+    // texture levels follow the view set above, their uploads are submitted before this frame's commands
+    streamTextures();
+
+    // levels of detail are chosen from the current camera, so the scene commands are recorded every frame. The 
+    // in flight fence waited on above guarantees the command buffer of this frame is no longer executing, as does
+    // the image's fence for its composition command buffer
+    buildOffscreenCommandBuffer(static_cast<UI32>(currentFrame));
+    buildShadowMapCommandBuffer(offScreenCommandBuffers[currentFrame]);
+    buildCompositionCommandBuffer(imageIndex);
 
     buildGuiCommandBuffer(imageIndex);
 
@@ -772,6 +996,7 @@ void Application::drawFrame() {
 
     // increment current frame 
     currentFrame = (currentFrame + 1) % MAX_FRAMES_IN_FLIGHT;
+    deletionQueue.nextFrame();
 }
 
 void Application::setGUI() {
@@ -787,6 +1012,51 @@ void Application::setGUI() {
     ImGui::SliderFloat3("translate", &translate[0], -2.0f, 2.0f);
     ImGui::SliderFloat3("rotate", &rotate[0], -180.0f, 180.0f);
     ImGui::SliderFloat("Scale:", &scale, 0.0f, 1.0f);
+    ImGui::BulletText("Level of detail:");
+    ImGui::SliderFloat("max error (px)", &lodThreshold, 0.0f, 16.0f);
+    ImGui::Checkbox("meshlet culling", &meshletCulling);
+    ImGui::Text("triangles: %u offscreen, %u shadow", numOffscreenTriangles, numShadowTriangles);
+    ImGui::BulletText("Texture streaming:");
+    ImGui::SliderFloat("budget (MB)", &textureBudgetMb, 16.0f, 4096.0f);
+    TextureStreamer::Stats textureStats = textureStreamer.getStats();
+    ImGui::Text("resident %.1f MB, requested %.1f MB, every level %.1f MB", textureStats.residentBytes / (1024.0f * 1024.0f),
+        textureStats.requestedBytes / (1024.0f * 1024.0f), textureStats.fullBytes / (1024.0f * 1024.0f));
+    ImGui::Text("%u of %u textures streaming, %u decoding, %u streamed in, %u evicted, %.1f MB uploaded", textureStats.numStreaming, 
+        textureStats.numTextures, textureStats.numDecoding, textureStats.numStreamedIn, textureStats.numEvicted, 
+        textureStats.uploadedBytes / (1024.0f * 1024.0f));
+    ImGui::Text("host: %.1f MB of sources, %.1f MB of levels", textureStats.sourceBytes / (1024.0f * 1024.0f), 
+        textureStats.hostBytes / (1024.0f * 1024.0f));
+    ImGui::BulletText("Device memory (%u allocations):", vkSetup.allocator.getNumDeviceAllocations());
+    FrameVector<MemoryAllocator::Stats> typeStats(VK_MAX_MEMORY_TYPES, &frameArena);
+    typeStats.resize(vkSetup.allocator.getStats(typeStats.data()));
+    for (const auto& stats : typeStats) {
+        ImGui::Text("type %u: %u blocks, %.1f / %.1f MB, fragmentation %.2f", stats.memoryType, stats.numBlocks,
+            stats.usedBytes / (1024.0f * 1024.0f), stats.blockBytes / (1024.0f * 1024.0f), stats.fragmentation);
+    }
+    FrameVector<MemoryAllocator::CategoryStats> categories(static_cast<size_t>(MemoryAllocator::Category::COUNT), &frameArena);
+    vkSetup.allocator.getCategoryStats(categories.data());
+    for (size_t i = 0; i < categories.size(); i++) {
+        ImGui::Text("%s: %.1f MB (peak %.1f MB)", MemoryAllocator::getCategoryName(static_cast<MemoryAllocator::Category>(i)),
+            categories[i].bytes / (1024.0f * 1024.0f), categories[i].peakBytes / (1024.0f * 1024.0f));
+    }
+    FrameVector<MemoryAllocator::HeapBudget> budgets(VK_MAX_MEMORY_HEAPS, &frameArena);
+    budgets.resize(vkSetup.allocator.getHeapBudgets(budgets.data()));
+    for (size_t i = 0; i < budgets.size(); i++) {
+        ImGui::Text("heap %zu%s: %.1f / %.1f MB %s", i, budgets[i].deviceLocal ? " (local)" : "", budgets[i].usage / (1024.0f * 1024.0f),
+            budgets[i].budget / (1024.0f * 1024.0f), vkSetup.allocator.hasMemoryBudget() ? "budget" : "estimated budget");
+    }
+    if (ImGui::Button("dump memory report")) {
+        vkSetup.allocator.dumpJson(MEMORY_REPORT_PATH);
+        PRINT("memory report written to %s\n", MEMORY_REPORT_PATH.c_str());
+    }
+    ImGui::Text("uniform ring: %.1f / %.1f KB per frame", uniformRing.getFrameUsage() / 1024.0f, uniformRing.frameSize / 1024.0f);
+    RenderTargetPool::Stats targetStats = renderTargetPool.getStats();
+    ImGui::Text("render targets: %u in %u slots, %.1f MB saved (%.1f MB lazy)%s", targetStats.numTargets, targetStats.numSlots,
+        targetStats.savedBytes / (1024.0f * 1024.0f), targetStats.lazyBytes / (1024.0f * 1024.0f), 
+        renderTargetPool.hasLazyMemory() ? "" : ", no lazy memory");
+    ImGui::Text("frame arena: %.1f / %.1f KB per frame (peak %.1f KB)", frameArena.getFrameUsage() / 1024.0f, 
+        frameArena.frameSize / 1024.0f, frameArena.getPeakUsage() / 1024.0f);
+    ImGui::Text("heap allocations: %llu last frame, %llu frames allocated", numFrameHeapAllocations, numHeapAllocatingFrames);
     ImGui::BulletText("Attachments:");
     ImGui::SameLine();
     ImGui::Combo("", &attachmentNum, attachments, SizeofArray(attachments));
@@ -795,10 +1065,11 @@ void Application::setGUI() {
 
 // Uniforms
 
-void Application::updateUniformBuffers(uint32_t currentImage) {
+void Application::updateUniformBuffers(UI32 frameIdx) {
+    uniformRing.beginFrame(frameIdx);
 
     // offscreen ubo
-    glm::mat4 proj = glm::perspective(glm::radians(45.0f), swapChain.extent.width / (float)swapChain.extent.height, 0.1f, 40.0f);
+    glm::mat4 proj = glm::perspective(glm::radians(CAMERA_FOV), swapChain.extent.width / (float)swapChain.extent.height, 0.1f, 40.0f);
     proj[1][1] *= -1.0f; // y coordinates inverted, Vulkan origin top left vs OpenGL bottom left
 
     glm::mat4 model = glm::translate(glm::mat4(1.0f), translate);
@@ -808,24 +1079,31 @@ void Application::updateUniformBuffers(uint32_t currentImage) {
     rotateZ[1][1] *= -1.0f;
     model *= rotateZ * glm::toMat4(glm::quat(glm::radians(rotate)));
 
+    // packed positions are dequantised by the model matrix, normals are not quantised so the normal matrix is unchanged
+    glm::mat4 dequantisedModel = model * this->model.getPositionTransform();
+
     GBuffer::OffScreenUbo offscreenUbo{};
-    offscreenUbo.model = model;
+    offscreenUbo.model = dequantisedModel;
     offscreenUbo.view = camera.getViewMatrix();
     offscreenUbo.projection = proj;
     offscreenUbo.normal = glm::transpose(glm::inverse(glm::mat3(model)));
+    offscreenUbo.uvTransform = this->model.getUvTransform();
 
-    gBuffer.updateOffScreenUniformBuffer(offscreenUbo);
+    modelMatrix = model; // kept for level of detail selection and culling
+    viewProjection = offscreenUbo.projection * offscreenUbo.view;
+
+    uniformOffsets.offScreen = uniformRing.push(offscreenUbo);
 
     // shadow map ubo
-    ShadowMap::UBO shadowMapUbo = { spotLight.getMVP(model) };
-    shadowMap.updateShadowMapUniformBuffer(shadowMapUbo); 
+    ShadowMap::UBO shadowMapUbo = { spotLight.getMVP(dequantisedModel) };
+    uniformOffsets.shadowMap = uniformRing.push(shadowMapUbo);
 
     // skybox ubo
     Skybox::UBO skyboxUbo{};
     skyboxUbo.view = glm::mat4(glm::mat3(camera.getViewMatrix()));
     skyboxUbo.projection = proj;
 
-    skybox.updateSkyboxUniformBuffer(skyboxUbo);
+    uniformOffsets.skybox = uniformRing.push(skyboxUbo);
 
     // composition ubo
     GBuffer::CompositionUBO compositionUbo = {};
@@ -838,7 +1116,14 @@ void Application::updateUniformBuffers(uint32_t currentImage) {
     compositionUbo.lights[2] = lights[2];
     compositionUbo.lights[3] = lights[3];
     */
-    gBuffer.updateCompositionUniformBuffer(currentImage, compositionUbo);
+    uniformOffsets.composition = uniformRing.push(compositionUbo);
+}
+
+void Application::bindDescriptorSet(VkCommandBuffer cmdBuffer, VkPipelineLayout layout, VkDescriptorSet set, 
+    UI32 vertexUniformOffset, UI32 fragmentUniformOffset) {
+    // dynamic offsets are consumed in binding order
+    UI32 dynamicOffsets[2] = { vertexUniformOffset, fragmentUniformOffset };
+    vkCmdBindDescriptorSets(cmdBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, layout, 0, 1, &set, 2, dynamicOffsets);
 }
 
 int Application::processKeyInput() {
@@ -924,9 +1209,16 @@ void Application::cleanup() {
     ImGui_ImplGlfw_Shutdown();
     ImGui::DestroyContext();
 
+    // resources may only be destroyed once their uploads have completed
+    uploadManager.cleanupUploadManager();
+
+    // the device is idle, destroy whatever is still waiting on frames
+    deletionQueue.flush();
+
     for (auto& texture : textures) {
         texture.cleanupTexture();
     }
+    textureStreamer.cleanupTextureStreamer();
 
     skybox.cleanupSkybox();
 
@@ -937,17 +1229,22 @@ void Application::cleanup() {
 
     // call the function we created for destroying the swap chain and frame buffers
     // in the reverse order of their creation
+    shadowMap.cleanupShadowMap();
     gBuffer.cleanupGBuffer();
     frameBuffer.cleanupFrameBuffers();
     swapChain.cleanupSwapChain();
 
+    renderTargetPool.cleanupRenderTargetPool();
+
     // cleanup the descriptor pools and descriptor set layouts
     vkDestroyDescriptorPool(vkSetup.device, descriptorPool, nullptr);
     vkDestroyDescriptorSetLayout(vkSetup.device, descriptorSetLayout, nullptr);
 
-    // destroy the index and vertex buffers
-    indexBuffer.cleanupBufferData(vkSetup.device);
-    vertexBuffer.cleanupBufferData(vkSetup.device);
+    // destroy the geometry buffer
+    geometryBuffer.cleanupBufferData(vkSetup.device);
+
+    uniformRing.cleanupUniformRing();
+    frameArena.cleanupFrameArena();
 
     // loop over each frame and destroy its semaphores and fences
     for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
@@ -0,0 +1,186 @@
+//
+// Definition of the AccessorView struct
+//
+
+#include <common/AccessorView.h>
+
+#include <utils/Assert.h>
+
+#include <algorithm> // min
+#include <cstring> // memcpy
+#include <limits> // integer ranges for normalisation
+#include <type_traits>
+#include <stdexcept>
+
+// copy N floats per element, the fixed size lets the compiler turn each copy into a single vector move
+template<uint32_t N>
+static void copyFloats(const unsigned char* src, size_t srcStride, unsigned char* dst, size_t dstStride, size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        memcpy(dst, src, N * sizeof(float));
+        src += srcStride;
+        dst += dstStride;
+    }
+}
+
+// convert a single component to float, following the glTF rules for normalised integers
+template<typename T>
+static inline float toFloat(const unsigned char* src, bool normalized) {
+    T value;
+    memcpy(&value, src, sizeof(T)); // buffer data is not guaranteed to be aligned
+    if (!normalized)
+        return static_cast<float>(value);
+    if (std::is_signed<T>::value)
+        return std::max(static_cast<float>(value) / static_cast<float>(std::numeric_limits<T>::max()), -1.0f);
+    return static_cast<float>(value) / static_cast<float>(std::numeric_limits<T>::max());
+}
+
+// value of a component the accessor lacks
+static inline float missingComponent(uint32_t c, float fill, float wFill) {
+    return c == 3 ? wFill : fill;
+}
+
+template<typename T>
+static void convertComponents(const AccessorView& view, float* dst, size_t dstStride, uint32_t numOut, float fill, 
+    float wFill) {
+    uint32_t numCopied = std::min(numOut, view.numComponents);
+    const unsigned char* src = view.data;
+    unsigned char* out = reinterpret_cast<unsigned char*>(dst);
+    for (size_t i = 0; i < view.count; i++) {
+        float* element = reinterpret_cast<float*>(out);
+        for (uint32_t c = 0; c < numCopied; c++) {
+            element[c] = toFloat<T>(src + c * sizeof(T), view.normalized);
+        }
+        for (uint32_t c = numCopied; c < numOut; c++) {
+            element[c] = missingComponent(c, fill, wFill);
+        }
+        src += view.stride;
+        out += dstStride;
+    }
+}
+
+template<typename T>
+static void widenIndices(const AccessorView& view, uint32_t* dst, uint32_t baseVertex) {
+    const unsigned char* src = view.data;
+    for (size_t i = 0; i < view.count; i++) {
+        T index;
+        memcpy(&index, src, sizeof(T));
+        dst[i] = static_cast<uint32_t>(index) + baseVertex;
+        src += view.stride;
+    }
+}
+
+AccessorView AccessorView::fromAccessor(const tinygltf::Model& model, const std::vector<Buffer>& buffers, int accessorIdx) {
+    m_assert(accessorIdx >= 0 && accessorIdx < static_cast<int>(model.accessors.size()), "Invalid accessor index...");
+    const tinygltf::Accessor& accessor = model.accessors[accessorIdx];
+
+    if (accessor.sparse.isSparse) {
+        throw std::runtime_error("Sparse accessors are not supported!");
+    }
+
+    AccessorView view{};
+    view.count         = accessor.count;
+    view.componentType = accessor.componentType;
+    view.numComponents = static_cast<uint32_t>(tinygltf::GetNumComponentsInType(accessor.type));
+    view.normalized    = accessor.normalized;
+
+    // an accessor without a buffer view is all zeros
+    if (accessor.bufferView < 0) {
+        return view;
+    }
+
+    const tinygltf::BufferView& bufferView = model.bufferViews[accessor.bufferView];
+    const Buffer& buffer = buffers[bufferView.buffer];
+
+    int byteStride = accessor.ByteStride(bufferView); // falls back to the element size when the view is tightly packed
+    if (byteStride <= 0) {
+        throw std::runtime_error("Invalid accessor stride!");
+    }
+    view.stride = static_cast<size_t>(byteStride);
+
+    // make sure the last element lies inside the buffer before handing out a raw pointer
+    size_t elementSize = static_cast<size_t>(tinygltf::GetComponentSizeInBytes(accessor.componentType)) * view.numComponents;
+    size_t start = bufferView.byteOffset + accessor.byteOffset;
+    if (view.count > 0 && start + (view.count - 1) * view.stride + elementSize > buffer.size) {
+        throw std::runtime_error("Accessor reads past the end of its buffer!");
+    }
+
+    view.data = buffer.data + start;
+    return view;
+}
+
+void AccessorView::readFloats(float* dst, size_t dstStride, uint32_t numOut, float fill, float wFill) const {
+    unsigned char* out = reinterpret_cast<unsigned char*>(dst);
+
+    // no data, the accessor's components are zeros and the ones it lacks are filled
+    if (!data) {
+        for (size_t i = 0; i < count; i++, out += dstStride) {
+            float* element = reinterpret_cast<float*>(out);
+            for (uint32_t c = 0; c < numOut; c++) {
+                element[c] = c < numComponents ? 0.0f : missingComponent(c, fill, wFill);
+            }
+        }
+        return;
+    }
+
+    // fast path, float components that map one to one onto the destination
+    if (componentType == TINYGLTF_COMPONENT_TYPE_FLOAT && numComponents == numOut) {
+        switch (numOut) {
+        case 1:
+            copyFloats<1>(data, stride, out, dstStride, count);
+            return;
+        case 2:
+            copyFloats<2>(data, stride, out, dstStride, count);
+            return;
+        case 3:
+            copyFloats<3>(data, stride, out, dstStride, count);
+            return;
+        case 4:
+            copyFloats<4>(data, stride, out, dstStride, count);
+            return;
+        }
+    }
+
+    switch (componentType) {
+    case TINYGLTF_COMPONENT_TYPE_FLOAT:
+        convertComponents<float>(*this, dst, dstStride, numOut, fill, wFill);
+        return;
+    case TINYGLTF_COMPONENT_TYPE_BYTE:
+        convertComponents<int8_t>(*this, dst, dstStride, numOut, fill, wFill);
+        return;
+    case TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE:
+        convertComponents<uint8_t>(*this, dst, dstStride, numOut, fill, wFill);
+        return;
+    case TINYGLTF_COMPONENT_TYPE_SHORT:
+        convertComponents<int16_t>(*this, dst, dstStride, numOut, fill, wFill);
+        return;
+    case TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT:
+        convertComponents<uint16_t>(*this, dst, dstStride, numOut, fill, wFill);
+        return;
+    case TINYGLTF_COMPONENT_TYPE_UNSIGNED_INT:
+        convertComponents<uint32_t>(*this, dst, dstStride, numOut, fill, wFill);
+        return;
+    }
+    throw std::runtime_error("Unsupported accessor component type!");
+}
+
+void AccessorView::readIndices(uint32_t* dst, uint32_t baseVertex) const {
+    m_assert(numComponents == 1, "Index accessors must be scalar...");
+
+    if (!data) {
+        std::fill_n(dst, count, baseVertex);
+        return;
+    }
+
+    switch (componentType) {
+    case TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE:
+        widenIndices<uint8_t>(*this, dst, baseVertex);
+        return;
+    case TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT:
+        widenIndices<uint16_t>(*this, dst, baseVertex);
+        return;
+    case TINYGLTF_COMPONENT_TYPE_UNSIGNED_INT:
+        widenIndices<uint32_t>(*this, dst, baseVertex);
+        return;
+    }
+    throw std::runtime_error("Invalid index type...");
+}
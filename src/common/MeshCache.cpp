@@ -0,0 +1,248 @@
+//
+// Definition of the MeshCache class
+//
+
+#include <common/MeshCache.h>
+
+#include <utils/Print.h>
+
+#include <cstdio> // remove, rename
+#include <cstring> // memcpy, memcmp
+#include <fstream>
+#include <stdexcept>
+
+// bump whenever the layout of the cache or of the cached structs changes
+static const char CACHE_MAGIC[4] = { 'H', 'P', 'G', 'M' };
+static const UI32 CACHE_VERSION  = 6;
+
+static inline UI64 rotl64(UI64 x, int r) {
+    return (x << r) | (x >> (64 - r));
+}
+
+static inline UI64 fmix64(UI64 k) {
+    k ^= k >> 33;
+    k *= 0xff51afd7ed558ccdULL;
+    k ^= k >> 33;
+    k *= 0xc4ceb9fe1a85ec53ULL;
+    k ^= k >> 33;
+    return k;
+}
+
+// sections are aligned so that the vertex and index data can be read in place
+static inline UI64 alignOffset(UI64 offset, UI64 alignment) {
+    return (offset + alignment - 1) & ~(alignment - 1);
+}
+
+UI64 MeshCache::hashData(const unsigned char* data, size_t size) {
+    // a murmur style hash consuming 8 bytes at a time, hashing a source file should cost far less than parsing it
+    const UI64 c1 = 0x87c37b91114253d5ULL;
+    const UI64 c2 = 0x4cf5ad432745937fULL;
+    UI64 h = 0x9e3779b97f4a7c15ULL ^ size;
+
+    size_t numBlocks = size / 8;
+    for (size_t i = 0; i < numBlocks; i++) {
+        UI64 k;
+        memcpy(&k, data + i * 8, sizeof(UI64));
+        k *= c1;
+        k = rotl64(k, 31);
+        k *= c2;
+        h ^= k;
+        h = rotl64(h, 27) * 5 + 0x52dce729;
+    }
+
+    // remaining bytes
+    UI64 k = 0;
+    for (size_t i = numBlocks * 8; i < size; i++) {
+        k = (k << 8) | data[i];
+    }
+    h ^= fmix64(k);
+
+    return fmix64(h);
+}
+
+UI64 MeshCache::hashFile(const std::string& path) {
+    MappedFile source;
+    source.map(path);
+    return hashData(source.data, source.size);
+}
+
+std::string MeshCache::getCachePath(const std::string& sourcePath) {
+    return sourcePath + ".meshcache";
+}
+
+// reads a length prefixed string from the references section, returns false when it would overrun the file
+static bool readString(const unsigned char*& ptr, const unsigned char* end, std::string& str) {
+    UI32 length;
+    if (end - ptr < static_cast<ptrdiff_t>(sizeof(UI32))) {
+        return false;
+    }
+    memcpy(&length, ptr, sizeof(UI32));
+    ptr += sizeof(UI32);
+    if (end - ptr < static_cast<ptrdiff_t>(length)) {
+        return false;
+    }
+    str.assign(reinterpret_cast<const char*>(ptr), length);
+    ptr += length;
+    return true;
+}
+
+bool MeshCache::load(const std::string& sourcePath, UI64 sourceHash, UI32 vertexStride, UI32 subMeshStride, UI32 meshletStride) {
+    unload();
+
+    std::string cachePath = getCachePath(sourcePath);
+    if (!std::ifstream(cachePath).good()) {
+        return false;
+    }
+
+    file.map(cachePath);
+
+    // validate the header before trusting any of the offsets
+    if (file.size < sizeof(Header)) {
+        unload();
+        return false;
+    }
+
+    const Header* cacheHeader = reinterpret_cast<const Header*>(file.data);
+    if (memcmp(cacheHeader->magic, CACHE_MAGIC, sizeof(CACHE_MAGIC)) != 0 || cacheHeader->version != CACHE_VERSION ||
+        cacheHeader->sourceHash != sourceHash || cacheHeader->vertexStride != vertexStride || 
+        cacheHeader->subMeshStride != subMeshStride || cacheHeader->meshletStride != meshletStride) {
+        unload();
+        return false;
+    }
+
+    if (cacheHeader->vertexOffset + cacheHeader->numVertices * vertexStride > file.size ||
+        cacheHeader->indexOffset + cacheHeader->numIndices * sizeof(UI32) > file.size ||
+        cacheHeader->subMeshOffset + cacheHeader->numSubMeshes * subMeshStride > file.size ||
+        cacheHeader->meshletOffset + cacheHeader->numMeshlets * meshletStride > file.size ||
+        cacheHeader->referencesOffset > file.size) {
+        unload();
+        return false;
+    }
+
+    // the files the source depends on must not have changed either
+    std::string baseDir = sourcePath.substr(0, sourcePath.find_last_of("/\\") + 1);
+    const unsigned char* ptr = file.data + cacheHeader->referencesOffset;
+    const unsigned char* end = file.data + file.size;
+
+    for (UI32 i = 0; i < cacheHeader->numDependencies; i++) {
+        std::string path;
+        UI64 hash;
+        if (!readString(ptr, end, path) || end - ptr < static_cast<ptrdiff_t>(sizeof(UI64))) {
+            unload();
+            return false;
+        }
+        memcpy(&hash, ptr, sizeof(UI64));
+        ptr += sizeof(UI64);
+
+        if (!std::ifstream(baseDir + path).good() || hashFile(baseDir + path) != hash) {
+            unload();
+            return false;
+        }
+    }
+
+    materials.resize(cacheHeader->numMaterials);
+    for (auto& material : materials) {
+        if (!readString(ptr, end, material.albedo) || !readString(ptr, end, material.metallicRoughness)) {
+            unload();
+            return false;
+        }
+    }
+
+    header    = cacheHeader;
+    vertices  = file.data + header->vertexOffset;
+    indices   = file.data + header->indexOffset;
+    subMeshes = file.data + header->subMeshOffset;
+    meshlets  = file.data + header->meshletOffset;
+
+    return true;
+}
+
+void MeshCache::unload() {
+    file.unmap();
+    header    = nullptr;
+    vertices  = nullptr;
+    indices   = nullptr;
+    subMeshes = nullptr;
+    meshlets  = nullptr;
+    materials.clear();
+}
+
+static void writeString(std::ofstream& out, const std::string& str) {
+    UI32 length = static_cast<UI32>(str.size());
+    out.write(reinterpret_cast<const char*>(&length), sizeof(UI32));
+    out.write(str.data(), length);
+}
+
+static void writePadding(std::ofstream& out, UI64 from, UI64 to) {
+    static const char zeros[16] = {};
+    out.write(zeros, static_cast<std::streamsize>(to - from));
+}
+
+void MeshCache::write(const std::string& sourcePath, UI64 sourceHash, const Contents& contents) {
+    Header cacheHeader{};
+    memcpy(cacheHeader.magic, CACHE_MAGIC, sizeof(CACHE_MAGIC));
+    cacheHeader.version         = CACHE_VERSION;
+    cacheHeader.sourceHash      = sourceHash;
+    cacheHeader.vertexStride    = contents.vertexStride;
+    cacheHeader.subMeshStride   = contents.subMeshStride;
+    cacheHeader.meshletStride   = contents.meshletStride;
+    cacheHeader.numVertices     = contents.vertices.size / contents.vertexStride;
+    cacheHeader.numIndices      = contents.indices.size / sizeof(UI32);
+    cacheHeader.numSubMeshes    = contents.subMeshes.size / contents.subMeshStride;
+    cacheHeader.numMeshlets     = contents.meshletStride ? contents.meshlets.size / contents.meshletStride : 0;
+    cacheHeader.numDependencies = static_cast<UI32>(contents.dependencies.size());
+    cacheHeader.numMaterials    = static_cast<UI32>(contents.materials.size());
+    memcpy(cacheHeader.centre, &contents.centre[0], sizeof(cacheHeader.centre));
+
+    // header, vertices, indices, sub meshes, meshlets, then the dependency and material references
+    cacheHeader.vertexOffset     = alignOffset(sizeof(Header), 16);
+    cacheHeader.indexOffset      = alignOffset(cacheHeader.vertexOffset + contents.vertices.size, 16);
+    cacheHeader.subMeshOffset    = alignOffset(cacheHeader.indexOffset + contents.indices.size, 16);
+    cacheHeader.meshletOffset    = alignOffset(cacheHeader.subMeshOffset + contents.subMeshes.size, 16);
+    cacheHeader.referencesOffset = alignOffset(cacheHeader.meshletOffset + contents.meshlets.size, 16);
+
+    // write to a temporary file first so that an interrupted write never leaves a cache that looks valid
+    std::string cachePath = getCachePath(sourcePath);
+    std::string tmpPath = cachePath + ".tmp";
+
+    std::ofstream out(tmpPath, std::ios::binary | std::ios::trunc);
+    if (!out) {
+        throw std::runtime_error("failed to open " + tmpPath + " for writing!");
+    }
+
+    out.write(reinterpret_cast<const char*>(&cacheHeader), sizeof(Header));
+    writePadding(out, sizeof(Header), cacheHeader.vertexOffset);
+    out.write(reinterpret_cast<const char*>(contents.vertices.data), contents.vertices.size);
+    writePadding(out, cacheHeader.vertexOffset + contents.vertices.size, cacheHeader.indexOffset);
+    out.write(reinterpret_cast<const char*>(contents.indices.data), contents.indices.size);
+    writePadding(out, cacheHeader.indexOffset + contents.indices.size, cacheHeader.subMeshOffset);
+    out.write(reinterpret_cast<const char*>(contents.subMeshes.data), contents.subMeshes.size);
+    writePadding(out, cacheHeader.subMeshOffset + contents.subMeshes.size, cacheHeader.meshletOffset);
+    out.write(reinterpret_cast<const char*>(contents.meshlets.data), contents.meshlets.size);
+    writePadding(out, cacheHeader.meshletOffset + contents.meshlets.size, cacheHeader.referencesOffset);
+
+    for (const auto& dependency : contents.dependencies) {
+        writeString(out, dependency.path);
+        out.write(reinterpret_cast<const char*>(&dependency.hash), sizeof(UI64));
+    }
+
+    for (const auto& material : contents.materials) {
+        writeString(out, material.albedo);
+        writeString(out, material.metallicRoughness);
+    }
+
+    UI64 cacheSize = static_cast<UI64>(out.tellp());
+    out.close();
+    if (!out) {
+        std::remove(tmpPath.c_str());
+        throw std::runtime_error("failed to write " + tmpPath + "!");
+    }
+
+    std::remove(cachePath.c_str()); // rename does not replace existing files on windows
+    if (std::rename(tmpPath.c_str(), cachePath.c_str()) != 0) {
+        std::remove(tmpPath.c_str());
+        throw std::runtime_error("failed to move " + tmpPath + " to " + cachePath + "!");
+    }
+
+    PRINT("wrote mesh cache %s (%llu bytes)\n", cachePath.c_str(), static_cast<unsigned long long>(cacheSize));
+}
@@ -0,0 +1,304 @@
+//
+// Definition of the MeshOptimiser class
+//
+
+#include <common/MeshOptimiser.h>
+
+#include <utils/Assert.h>
+
+#include <algorithm> // stable_sort, copy
+#include <numeric> // iota
+
+// FIFO cache simulation: a vertex is in the cache if fewer than cacheSize misses happened since it was loaded
+struct FifoCache {
+    std::vector<size_t> timestamps;
+    size_t time;
+    size_t cacheSize;
+
+    FifoCache(size_t vertexCount, size_t size) : timestamps(vertexCount, 0), time(size + 1), cacheSize(size) {}
+
+    inline bool access(UI32 vertex) {
+        if (time - timestamps[vertex] > cacheSize) {
+            timestamps[vertex] = time++;
+            return true; // miss
+        }
+        return false;
+    }
+
+    inline void flush() {
+        time += cacheSize + 1;
+    }
+};
+
+// next fanning vertex once the current one is exhausted, the most recent dead end or the next live vertex in input order
+static I32 skipDeadEnd(std::vector<UI32>& deadEnds, const std::vector<UI32>& liveTriangles, size_t& cursor, size_t vertexCount, 
+    bool& coldStart) {
+    while (!deadEnds.empty()) {
+        UI32 vertex = deadEnds.back();
+        deadEnds.pop_back();
+        if (liveTriangles[vertex] > 0) {
+            coldStart = false;
+            return static_cast<I32>(vertex);
+        }
+    }
+
+    // nothing in the cache is of use, the next triangles start from scratch
+    coldStart = true;
+    while (cursor < vertexCount) {
+        if (liveTriangles[cursor] > 0) {
+            return static_cast<I32>(cursor);
+        }
+        cursor++;
+    }
+    return -1;
+}
+
+void MeshOptimiser::optimiseVertexCache(UI32* indices, size_t indexCount, size_t vertexCount, std::vector<size_t>* clusters) {
+    m_assert(indexCount % 3 == 0, "Index count is not a multiple of 3...");
+    size_t numTriangles = indexCount / 3;
+    if (clusters) {
+        clusters->clear();
+    }
+    if (numTriangles == 0) {
+        return;
+    }
+
+    // vertex to triangle adjacency
+    std::vector<UI32> liveTriangles(vertexCount, 0);
+    for (size_t i = 0; i < indexCount; i++) {
+        m_assert(indices[i] < vertexCount, "Index out of range...");
+        liveTriangles[indices[i]]++;
+    }
+
+    std::vector<UI32> adjacencyOffsets(vertexCount + 1, 0);
+    for (size_t v = 0; v < vertexCount; v++) {
+        adjacencyOffsets[v + 1] = adjacencyOffsets[v] + liveTriangles[v];
+    }
+
+    std::vector<UI32> adjacency(indexCount);
+    std::vector<UI32> fill(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+    for (size_t t = 0; t < numTriangles; t++) {
+        for (size_t c = 0; c < 3; c++) {
+            adjacency[fill[indices[3 * t + c]]++] = static_cast<UI32>(t);
+        }
+    }
+
+    FifoCache cache(vertexCount, CACHE_SIZE);
+
+    std::vector<bool> emitted(numTriangles, false);
+    std::vector<UI32> deadEnds;
+    std::vector<UI32> candidates;
+    std::vector<UI32> output;
+    output.reserve(indexCount);
+
+    size_t cursor = 0;
+    bool coldStart = true;
+    I32 fanning = skipDeadEnd(deadEnds, liveTriangles, cursor, vertexCount, coldStart);
+
+    while (fanning >= 0) {
+        if (coldStart && clusters) {
+            clusters->push_back(output.size() / 3);
+        }
+
+        // emit every remaining triangle around the fanning vertex
+        candidates.clear();
+        for (UI32 a = adjacencyOffsets[fanning]; a < adjacencyOffsets[fanning + 1]; a++) {
+            UI32 t = adjacency[a];
+            if (emitted[t]) {
+                continue;
+            }
+            for (size_t c = 0; c < 3; c++) {
+                UI32 v = indices[3 * t + c];
+                output.push_back(v);
+                deadEnds.push_back(v);
+                candidates.push_back(v);
+                liveTriangles[v]--;
+                cache.access(v);
+            }
+            emitted[t] = true;
+        }
+
+        // prefer the oldest candidate that will still be in the cache once all of its triangles are emitted
+        I32 next = -1;
+        I32 bestPriority = -1;
+        for (UI32 v : candidates) {
+            if (liveTriangles[v] == 0) {
+                continue;
+            }
+            I32 priority = 0;
+            size_t age = cache.time - cache.timestamps[v];
+            if (age + 2 * liveTriangles[v] <= cache.cacheSize) {
+                priority = static_cast<I32>(age);
+            }
+            if (priority > bestPriority) {
+                bestPriority = priority;
+                next = static_cast<I32>(v);
+            }
+        }
+
+        coldStart = false;
+        if (next < 0) {
+            next = skipDeadEnd(deadEnds, liveTriangles, cursor, vertexCount, coldStart);
+        }
+        fanning = next;
+    }
+
+    m_assert(output.size() == indexCount, "Not every triangle was emitted...");
+    std::copy(output.begin(), output.end(), indices);
+}
+
+void MeshOptimiser::optimiseOverdraw(UI32* indices, size_t indexCount, const Model::Vertex* vertices, const std::vector<size_t>& clusters, 
+    F32 threshold) {
+    size_t numTriangles = indexCount / 3;
+    if (numTriangles == 0) {
+        return;
+    }
+
+    size_t vertexCount = 0;
+    for (size_t i = 0; i < indexCount; i++) {
+        vertexCount = std::max(vertexCount, static_cast<size_t>(indices[i]) + 1);
+    }
+
+    // hard boundaries (cold cache) may be split further where doing so costs little cache efficiency
+    std::vector<size_t> hard = clusters;
+    if (hard.empty() || hard.front() != 0) {
+        hard.insert(hard.begin(), 0);
+    }
+    hard.push_back(numTriangles);
+
+    FifoCache cache(vertexCount, CACHE_SIZE);
+    std::vector<size_t> soft;
+
+    for (size_t h = 0; h + 1 < hard.size(); h++) {
+        size_t start = hard[h];
+        size_t end = hard[h + 1];
+        if (start >= end) {
+            continue;
+        }
+
+        // miss ratio of the whole cluster
+        cache.flush();
+        size_t clusterMisses = 0;
+        for (size_t t = start; t < end; t++) {
+            for (size_t c = 0; c < 3; c++) {
+                clusterMisses += cache.access(indices[3 * t + c]);
+            }
+        }
+        F32 clusterThreshold = threshold * static_cast<F32>(clusterMisses) / static_cast<F32>(end - start);
+
+        // start a new cluster each time the running miss ratio reaches the target
+        soft.push_back(start);
+        cache.flush();
+        size_t runningMisses = 0;
+        size_t runningTriangles = 0;
+        for (size_t t = start; t < end; t++) {
+            for (size_t c = 0; c < 3; c++) {
+                runningMisses += cache.access(indices[3 * t + c]);
+            }
+            runningTriangles++;
+
+            if (t + 1 < end && static_cast<F32>(runningMisses) / static_cast<F32>(runningTriangles) <= clusterThreshold) {
+                soft.push_back(t + 1);
+                cache.flush();
+                runningMisses = 0;
+                runningTriangles = 0;
+            }
+        }
+    }
+    soft.push_back(numTriangles);
+
+    size_t numClusters = soft.size() - 1;
+
+    // area weighted centroid of the mesh and of each cluster, and the average normal of each cluster
+    std::vector<glm::vec3> centroids(numClusters, glm::vec3(0.0f));
+    std::vector<glm::vec3> normals(numClusters, glm::vec3(0.0f));
+    glm::vec3 meshCentroid(0.0f);
+    F32 meshArea = 0.0f;
+
+    for (size_t c = 0; c < numClusters; c++) {
+        F32 clusterArea = 0.0f;
+        for (size_t t = soft[c]; t < soft[c + 1]; t++) {
+            const glm::vec3& p0 = vertices[indices[3 * t + 0]].pos;
+            const glm::vec3& p1 = vertices[indices[3 * t + 1]].pos;
+            const glm::vec3& p2 = vertices[indices[3 * t + 2]].pos;
+
+            glm::vec3 normal = glm::cross(p1 - p0, p2 - p0); // length is twice the area
+            F32 area = glm::length(normal);
+
+            centroids[c] += (p0 + p1 + p2) * (area / 3.0f);
+            normals[c] += normal;
+            clusterArea += area;
+        }
+        meshCentroid += centroids[c];
+        meshArea += clusterArea;
+        centroids[c] = clusterArea > 0.0f ? centroids[c] / clusterArea : vertices[indices[3 * soft[c]]].pos;
+        F32 normalLength = glm::length(normals[c]);
+        normals[c] = normalLength > 0.0f ? normals[c] / normalLength : glm::vec3(0.0f);
+    }
+    meshCentroid = meshArea > 0.0f ? meshCentroid / meshArea : glm::vec3(0.0f);
+
+    // clusters facing away from the centre are likely to occlude the rest, so they are drawn first
+    std::vector<F32> sortKeys(numClusters);
+    for (size_t c = 0; c < numClusters; c++) {
+        sortKeys[c] = glm::dot(centroids[c] - meshCentroid, normals[c]);
+    }
+
+    std::vector<size_t> order(numClusters);
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(), [&sortKeys](size_t a, size_t b) { return sortKeys[a] > sortKeys[b]; });
+
+    std::vector<UI32> output;
+    output.reserve(indexCount);
+    for (size_t c : order) {
+        output.insert(output.end(), indices + 3 * soft[c], indices + 3 * soft[c + 1]);
+    }
+    std::copy(output.begin(), output.end(), indices);
+}
+
+void MeshOptimiser::optimiseVertexFetch(Model::Vertex* vertices, size_t vertexCount, UI32* indices, size_t indexCount) {
+    const UI32 unused = ~0u;
+    std::vector<UI32> remap(vertexCount, unused);
+
+    // number vertices in the order the index buffer first references them
+    UI32 next = 0;
+    for (size_t i = 0; i < indexCount; i++) {
+        UI32& mapped = remap[indices[i]];
+        if (mapped == unused) {
+            mapped = next++;
+        }
+        indices[i] = mapped;
+    }
+
+    for (size_t v = 0; v < vertexCount; v++) {
+        if (remap[v] == unused) {
+            remap[v] = next++;
+        }
+    }
+
+    std::vector<Model::Vertex> reordered(vertexCount);
+    for (size_t v = 0; v < vertexCount; v++) {
+        reordered[remap[v]] = vertices[v];
+    }
+    std::copy(reordered.begin(), reordered.end(), vertices);
+}
+
+MeshOptimiser::VertexCacheStats MeshOptimiser::analyseVertexCache(const UI32* indices, size_t indexCount, size_t vertexCount, 
+    UI32 cacheSize) {
+    FifoCache cache(vertexCount, cacheSize);
+    std::vector<bool> referenced(vertexCount, false);
+
+    size_t misses = 0;
+    size_t numReferenced = 0;
+    for (size_t i = 0; i < indexCount; i++) {
+        misses += cache.access(indices[i]);
+        if (!referenced[indices[i]]) {
+            referenced[indices[i]] = true;
+            numReferenced++;
+        }
+    }
+
+    VertexCacheStats stats{};
+    stats.acmr = indexCount ? static_cast<F32>(misses) / static_cast<F32>(indexCount / 3) : 0.0f;
+    stats.atvr = numReferenced ? static_cast<F32>(misses) / static_cast<F32>(numReferenced) : 0.0f;
+    return stats;
+}
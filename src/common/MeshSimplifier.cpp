@@ -0,0 +1,260 @@
+//
+// Definition of the MeshSimplifier class
+//
+
+#include <common/MeshSimplifier.h>
+
+#include <algorithm> // sort, max
+#include <cmath> // sqrt
+#include <cstring> // memcpy
+#include <unordered_map> // seam detection
+
+// symmetric 4x4 quadric, weighted by triangle area so that the error is a squared distance
+struct Quadric {
+    F32 a00, a11, a22, a10, a20, a21;
+    F32 b0, b1, b2;
+    F32 c;
+    F32 w;
+
+    void add(const Quadric& q) {
+        a00 += q.a00; a11 += q.a11; a22 += q.a22; a10 += q.a10; a20 += q.a20; a21 += q.a21;
+        b0 += q.b0; b1 += q.b1; b2 += q.b2;
+        c += q.c;
+        w += q.w;
+    }
+
+    F32 evaluate(const glm::vec3& p) const {
+        F32 rx = a00 * p.x + a10 * p.y + a20 * p.z + b0;
+        F32 ry = a10 * p.x + a11 * p.y + a21 * p.z + b1;
+        F32 rz = a20 * p.x + a21 * p.y + a22 * p.z + b2;
+        F32 r = rx * p.x + ry * p.y + rz * p.z + b0 * p.x + b1 * p.y + b2 * p.z + c;
+        return w > 0.0f ? std::max(r / w, 0.0f) : 0.0f;
+    }
+
+    static Quadric fromPlane(const glm::vec3& n, F32 d, F32 weight) {
+        Quadric q;
+        q.a00 = n.x * n.x * weight; q.a11 = n.y * n.y * weight; q.a22 = n.z * n.z * weight;
+        q.a10 = n.y * n.x * weight; q.a20 = n.z * n.x * weight; q.a21 = n.z * n.y * weight;
+        q.b0 = n.x * d * weight; q.b1 = n.y * d * weight; q.b2 = n.z * d * weight;
+        q.c = d * d * weight;
+        q.w = weight;
+        return q;
+    }
+};
+
+struct Collapse {
+    UI32 from;
+    UI32 to;
+    F32 error;
+};
+
+// hash exact positions to find vertices that were split for differing attributes
+struct PositionHash {
+    size_t operator()(const glm::vec3& p) const {
+        UI32 bits[3];
+        memcpy(bits, &p, sizeof(bits));
+        return (bits[0] * 73856093u) ^ (bits[1] * 19349663u) ^ (bits[2] * 83492791u);
+    }
+};
+
+struct PositionEqual {
+    bool operator()(const glm::vec3& a, const glm::vec3& b) const {
+        return a.x == b.x && a.y == b.y && a.z == b.z;
+    }
+};
+
+static UI64 edgeKey(UI32 a, UI32 b) {
+    return a < b ? (static_cast<UI64>(a) << 32) | b : (static_cast<UI64>(b) << 32) | a;
+}
+
+std::vector<UI32> MeshSimplifier::simplify(const UI32* indices, size_t indexCount, const Model::Vertex* vertices, size_t vertexCount, 
+    size_t targetIndexCount, F32 targetError, F32* error) {
+    std::vector<UI32> result(indices, indices + indexCount);
+    F32 maxError = 0.0f;
+
+    // lock vertices on attribute seams and open borders
+    std::vector<bool> locked(vertexCount, false);
+    {
+        std::unordered_map<glm::vec3, UI32, PositionHash, PositionEqual> positions;
+        positions.reserve(vertexCount);
+        std::vector<UI32> canonical(vertexCount);
+        for (size_t v = 0; v < vertexCount; v++) {
+            auto inserted = positions.insert({ vertices[v].pos, static_cast<UI32>(v) });
+            canonical[v] = inserted.first->second;
+            if (!inserted.second) {
+                locked[v] = true;
+                locked[inserted.first->second] = true;
+            }
+        }
+
+        // an edge used by a single triangle is on a border
+        std::unordered_map<UI64, UI32> edgeCounts;
+        edgeCounts.reserve(indexCount);
+        for (size_t i = 0; i < indexCount; i += 3) {
+            for (size_t e = 0; e < 3; e++) {
+                edgeCounts[edgeKey(canonical[result[i + e]], canonical[result[i + (e + 1) % 3]])]++;
+            }
+        }
+        for (size_t i = 0; i < indexCount; i += 3) {
+            for (size_t e = 0; e < 3; e++) {
+                UI32 a = result[i + e];
+                UI32 b = result[i + (e + 1) % 3];
+                if (edgeCounts[edgeKey(canonical[a], canonical[b])] == 1) {
+                    locked[a] = true;
+                    locked[b] = true;
+                }
+            }
+        }
+    }
+
+    // accumulate the planes of the triangles around each vertex
+    std::vector<Quadric> quadrics(vertexCount, Quadric{});
+    for (size_t i = 0; i < indexCount; i += 3) {
+        const glm::vec3& p0 = vertices[result[i + 0]].pos;
+        const glm::vec3& p1 = vertices[result[i + 1]].pos;
+        const glm::vec3& p2 = vertices[result[i + 2]].pos;
+
+        glm::vec3 normal = glm::cross(p1 - p0, p2 - p0);
+        F32 area = glm::length(normal);
+        if (area == 0.0f) {
+            continue;
+        }
+        normal = normal / area;
+
+        Quadric q = Quadric::fromPlane(normal, -glm::dot(normal, p0), area);
+        for (size_t c = 0; c < 3; c++) {
+            quadrics[result[i + c]].add(q);
+        }
+    }
+
+    F32 targetErrorSquared = targetError * targetError;
+
+    std::vector<UI32> adjacencyOffsets(vertexCount + 1);
+    std::vector<UI32> adjacency;
+    std::vector<Collapse> collapses;
+    std::vector<bool> touched(vertexCount);
+    std::vector<UI32> remap(vertexCount);
+
+    // each pass collapses a set of independent edges, cheapest first
+    while (result.size() > targetIndexCount) {
+        size_t numTriangles = result.size() / 3;
+
+        // vertex to triangle adjacency of the current mesh
+        std::fill(adjacencyOffsets.begin(), adjacencyOffsets.end(), 0);
+        for (UI32 index : result) {
+            adjacencyOffsets[index + 1]++;
+        }
+        for (size_t v = 0; v < vertexCount; v++) {
+            adjacencyOffsets[v + 1] += adjacencyOffsets[v];
+        }
+        adjacency.resize(result.size());
+        std::vector<UI32> fill(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+        for (size_t t = 0; t < numTriangles; t++) {
+            for (size_t c = 0; c < 3; c++) {
+                adjacency[fill[result[3 * t + c]]++] = static_cast<UI32>(t);
+            }
+        }
+
+        // both directions of every edge whose source vertex may move
+        collapses.clear();
+        for (size_t t = 0; t < numTriangles; t++) {
+            for (size_t e = 0; e < 3; e++) {
+                UI32 a = result[3 * t + e];
+                UI32 b = result[3 * t + (e + 1) % 3];
+                for (int direction = 0; direction < 2; direction++) {
+                    UI32 from = direction ? b : a;
+                    UI32 to = direction ? a : b;
+                    if (locked[from]) {
+                        continue;
+                    }
+                    Quadric q = quadrics[from];
+                    q.add(quadrics[to]);
+                    collapses.push_back({ from, to, q.evaluate(vertices[to].pos) });
+                }
+            }
+        }
+
+        std::sort(collapses.begin(), collapses.end(), [](const Collapse& a, const Collapse& b) { return a.error < b.error; });
+
+        for (size_t v = 0; v < vertexCount; v++) {
+            remap[v] = static_cast<UI32>(v);
+        }
+        std::fill(touched.begin(), touched.end(), false);
+
+        size_t trianglesToRemove = (result.size() - targetIndexCount) / 3;
+        size_t removed = 0;
+        size_t numCollapsed = 0;
+
+        for (const auto& collapse : collapses) {
+            if (removed >= trianglesToRemove || collapse.error > targetErrorSquared) {
+                break;
+            }
+            if (touched[collapse.from] || touched[collapse.to]) {
+                continue;
+            }
+
+            // moving the vertex must not flip any of the triangles that remain
+            const glm::vec3& to = vertices[collapse.to].pos;
+            bool flips = false;
+            size_t collapsedTriangles = 0;
+            for (UI32 a = adjacencyOffsets[collapse.from]; a < adjacencyOffsets[collapse.from + 1] && !flips; a++) {
+                const UI32* triangle = &result[3 * adjacency[a]];
+                if (triangle[0] == collapse.to || triangle[1] == collapse.to || triangle[2] == collapse.to) {
+                    collapsedTriangles++;
+                    continue;
+                }
+
+                // rotate so the moving vertex comes first, keeping the winding
+                size_t c = triangle[0] == collapse.from ? 0 : triangle[1] == collapse.from ? 1 : 2;
+                const glm::vec3& p0 = vertices[triangle[c]].pos;
+                const glm::vec3& p1 = vertices[triangle[(c + 1) % 3]].pos;
+                const glm::vec3& p2 = vertices[triangle[(c + 2) % 3]].pos;
+
+                glm::vec3 before = glm::cross(p1 - p0, p2 - p0);
+                glm::vec3 after = glm::cross(p1 - to, p2 - to);
+                F32 lengths = glm::length(before) * glm::length(after);
+                flips = glm::dot(before, after) <= 0.25f * lengths;
+            }
+            if (flips || collapsedTriangles == 0) {
+                continue;
+            }
+
+            // the neighbourhood of the moved vertex is fixed for the rest of the pass
+            for (UI32 a = adjacencyOffsets[collapse.from]; a < adjacencyOffsets[collapse.from + 1]; a++) {
+                const UI32* triangle = &result[3 * adjacency[a]];
+                touched[triangle[0]] = true;
+                touched[triangle[1]] = true;
+                touched[triangle[2]] = true;
+            }
+
+            remap[collapse.from] = collapse.to;
+            quadrics[collapse.to].add(quadrics[collapse.from]);
+            maxError = std::max(maxError, collapse.error);
+            removed += collapsedTriangles;
+            numCollapsed++;
+        }
+
+        if (numCollapsed == 0) {
+            break; // every remaining collapse is locked, flips a triangle or is above the error limit
+        }
+
+        // apply the collapses and drop the triangles that became degenerate
+        size_t write = 0;
+        for (size_t t = 0; t < numTriangles; t++) {
+            UI32 a = remap[result[3 * t + 0]];
+            UI32 b = remap[result[3 * t + 1]];
+            UI32 c = remap[result[3 * t + 2]];
+            if (a != b && b != c && a != c) {
+                result[write++] = a;
+                result[write++] = b;
+                result[write++] = c;
+            }
+        }
+        result.resize(write);
+    }
+
+    if (error) {
+        *error = std::sqrt(maxError);
+    }
+    return result;
+}
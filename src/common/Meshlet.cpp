@@ -0,0 +1,168 @@
+//
+// Definition of the Meshlet struct
+//
+
+#include <common/Meshlet.h>
+
+#include <algorithm> // min, max
+#include <cfloat> // FLT_MAX
+#include <cmath> // sqrt
+#include <cstring> // memcpy
+
+static inline glm::vec3 getPosition(const unsigned char* positions, size_t stride, UI32 index) {
+    glm::vec3 position;
+    memcpy(&position, positions + stride * index, sizeof(glm::vec3));
+    return position;
+}
+
+// bounding sphere and normal cone of the triangles in [first, first + count) of the local indices
+static void computeMeshletBounds(Meshlet& meshlet, const UI32* indices, const unsigned char* positions, size_t stride) {
+    glm::vec3 minimum(FLT_MAX), maximum(-FLT_MAX);
+    for (UI32 i = 0; i < meshlet.indexCount; i++) {
+        glm::vec3 p = getPosition(positions, stride, indices[i]);
+        minimum = glm::min(minimum, p);
+        maximum = glm::max(maximum, p);
+    }
+    meshlet.centre = 0.5f * (minimum + maximum);
+
+    F32 radiusSquared = 0.0f;
+    for (UI32 i = 0; i < meshlet.indexCount; i++) {
+        glm::vec3 offset = getPosition(positions, stride, indices[i]) - meshlet.centre;
+        radiusSquared = std::max(radiusSquared, glm::dot(offset, offset));
+    }
+    meshlet.radius = std::sqrt(radiusSquared);
+
+    // the cone axis is the average unit normal, its spread is the widest angle between the axis and a normal
+    std::vector<glm::vec3> normals;
+    std::vector<glm::vec3> points; // a corner of each triangle with a normal
+    normals.reserve(meshlet.indexCount / 3);
+    points.reserve(meshlet.indexCount / 3);
+    glm::vec3 axis(0.0f);
+    for (UI32 i = 0; i + 2 < meshlet.indexCount; i += 3) {
+        glm::vec3 p0 = getPosition(positions, stride, indices[i + 0]);
+        glm::vec3 p1 = getPosition(positions, stride, indices[i + 1]);
+        glm::vec3 p2 = getPosition(positions, stride, indices[i + 2]);
+        glm::vec3 normal = glm::cross(p1 - p0, p2 - p0);
+        F32 length = glm::length(normal);
+        if (length > 0.0f) {
+            normals.push_back(normal / length);
+            points.push_back(p0);
+            axis += normals.back();
+        }
+    }
+
+    F32 axisLength = glm::length(axis);
+    meshlet.coneAxis = axisLength > 0.0f ? axis / axisLength : glm::vec3(0.0f, 0.0f, 1.0f);
+    meshlet.coneApex = meshlet.centre;
+    meshlet.coneCutoff = 1.0f;
+    if (axisLength == 0.0f) {
+        return;
+    }
+
+    F32 minDot = 1.0f;
+    for (const auto& normal : normals) {
+        minDot = std::min(minDot, glm::dot(normal, meshlet.coneAxis));
+    }
+
+    // a cone wider than a hemisphere always has a triangle facing the viewer
+    if (minDot <= 0.0f) {
+        return;
+    }
+    meshlet.coneCutoff = std::sqrt(1.0f - minDot * minDot);
+
+    // move the apex back along the axis until it lies behind the plane of every triangle, then any view direction 
+    // measured from the apex is conservative for the whole cluster
+    F32 maxDistance = 0.0f;
+    for (size_t t = 0; t < normals.size(); t++) {
+        F32 distance = glm::dot(meshlet.centre - points[t], normals[t]) / glm::dot(meshlet.coneAxis, normals[t]);
+        maxDistance = std::max(maxDistance, distance);
+    }
+    meshlet.coneApex = meshlet.centre - meshlet.coneAxis * maxDistance;
+}
+
+std::vector<Meshlet> Meshlet::build(const UI32* indices, size_t indexCount, UI32 firstIndex, const unsigned char* positions, 
+    size_t positionStride, size_t vertexCount) {
+    std::vector<Meshlet> meshlets;
+
+    // triangles are taken in index buffer order, which is already optimised for locality, so each meshlet is a 
+    // contiguous range of the index buffer and visible neighbours can be drawn together
+    std::vector<UI32> lastMeshlet(vertexCount, ~0u);
+    Meshlet meshlet{};
+    UI32 numVertices = 0;
+    meshlet.firstIndex = firstIndex;
+
+    for (size_t i = 0; i + 2 < indexCount; i += 3) {
+        UI32 meshletIdx = static_cast<UI32>(meshlets.size());
+        UI32 newVertices = 0;
+        for (size_t c = 0; c < 3; c++) {
+            newVertices += lastMeshlet[indices[i + c]] != meshletIdx;
+        }
+
+        if (numVertices + newVertices > MAX_VERTICES || meshlet.indexCount / 3 + 1 > MAX_TRIANGLES) {
+            computeMeshletBounds(meshlet, indices + (meshlet.firstIndex - firstIndex), positions, positionStride);
+            meshlets.push_back(meshlet);
+
+            meshlet = Meshlet{};
+            meshlet.firstIndex = firstIndex + static_cast<UI32>(i);
+            numVertices = 0;
+            meshletIdx++;
+        }
+
+        for (size_t c = 0; c < 3; c++) {
+            if (lastMeshlet[indices[i + c]] != meshletIdx) {
+                lastMeshlet[indices[i + c]] = meshletIdx;
+                numVertices++;
+            }
+        }
+        meshlet.indexCount += 3;
+    }
+
+    if (meshlet.indexCount > 0) {
+        computeMeshletBounds(meshlet, indices + (meshlet.firstIndex - firstIndex), positions, positionStride);
+        meshlets.push_back(meshlet);
+    }
+
+    return meshlets;
+}
+
+void Meshlet::getFrustumPlanes(const glm::mat4& clip, glm::vec4 planes[6]) {
+    // Gribb and Hartmann, planes are combinations of the rows of the clip matrix (glm is column major)
+    glm::vec4 rows[4];
+    for (int r = 0; r < 4; r++) {
+        rows[r] = glm::vec4(clip[0][r], clip[1][r], clip[2][r], clip[3][r]);
+    }
+
+    planes[0] = rows[3] + rows[0]; // left
+    planes[1] = rows[3] - rows[0]; // right
+    planes[2] = rows[3] + rows[1]; // bottom
+    planes[3] = rows[3] - rows[1]; // top
+    planes[4] = rows[3] + rows[2]; // near, conservative whether depth is [-1, 1] or [0, 1]
+    planes[5] = rows[3] - rows[2]; // far
+
+    for (int p = 0; p < 6; p++) {
+        F32 length = glm::length(glm::vec3(planes[p]));
+        if (length > 0.0f) {
+            planes[p] /= length;
+        }
+    }
+}
+
+bool Meshlet::isSphereInFrustum(const glm::vec3& centre, F32 radius, const glm::vec4 planes[6]) {
+    for (int p = 0; p < 6; p++) {
+        if (glm::dot(glm::vec3(planes[p]), centre) + planes[p].w < -radius) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool Meshlet::isVisible(const glm::vec3& viewPosition, const glm::vec4 planes[6]) const {
+    if (!isSphereInFrustum(centre, radius, planes)) {
+        return false;
+    }
+
+    // back facing when the direction from the viewer is within 90 degrees minus the cone's spread of its axis
+    glm::vec3 toApex = coneApex - viewPosition;
+    F32 distance = glm::length(toApex);
+    return distance == 0.0f || glm::dot(toApex, coneAxis) < coneCutoff * distance;
+}
@@ -7,13 +7,27 @@
 #include <array>
 #include <string> // string class
 #include <iostream>
+#include <chrono> // load timings
+#include <unordered_map> // vertex welding
+#include <cstring> // memcpy
+#include <algorithm> // swap, sort
+#include <cfloat> // FLT_MAX
+#include <cmath> // sqrt, fabs
+#include <fstream> // ktx2 stand ins
+#include <functional> // texture callback
+#include <memory> // texture sources
 
 #include <common/Model.h> // model class declaration
+#include <common/AccessorView.h> // typed views of gltf buffer data
+#include <common/ObjParser.h> // multithreaded obj parsing
+#include <common/MeshOptimiser.h> // index and vertex reordering
+#include <common/MeshSimplifier.h> // levels of detail
 
 #include <utils/Utils.h>
 #include <utils/Assert.h>
+#include <utils/Print.h>
 
-// model loading
+// model loading, tinyobjloader remains as the baseline of the obj parse benchmark
 #define TINYOBJLOADER_IMPLEMENTATION
 #include <tiny_obj_loader.h>
 
@@ -23,74 +37,445 @@
 #include <tiny_gltf.h>
 
 #include <glm/gtc/type_ptr.hpp> // construct vec from ptr
+#include <glm/gtc/matrix_transform.hpp> // node transforms
+#include <glm/gtx/quaternion.hpp>
 #include <glm/gtx/string_cast.hpp>
 
+// largest simplification error of a level of detail, as a fraction of the sub mesh's bounding radius
+static const F32 LOD_ERROR_LIMIT = 0.05f;
+
+// tinygltf image loader keeping the encoded bytes, the images are decoded on a thread pool when textures are created
+static bool keepEncodedImage(tinygltf::Image* image, const int, std::string*, std::string*, int, int, 
+    const unsigned char* bytes, int size, void*) {
+    image->image.assign(bytes, bytes + size);
+    return true;
+}
+
+// hash and compare obj index triplets so that identical face corners map to a single vertex
+struct ObjIndexHash {
+    size_t operator()(const ObjParser::Index& index) const {
+        size_t seed = std::hash<int>()(index.vertex);
+        seed ^= std::hash<int>()(index.normal) + 0x9e3779b9 + (seed << 6) + (seed >> 2);
+        seed ^= std::hash<int>()(index.texcoord) + 0x9e3779b9 + (seed << 6) + (seed >> 2);
+        return seed;
+    }
+};
+
+struct ObjIndexEqual {
+    bool operator()(const ObjParser::Index& a, const ObjParser::Index& b) const {
+        return a.vertex == b.vertex && a.normal == b.normal && a.texcoord == b.texcoord;
+    }
+};
+
 void Model::loadModel(const std::string& path) {
-    FileExtension ext = getExtension(path);
+    ext = getExtension(path);
+
+    // hashing the source costs far less than parsing it, a matching cache skips the parse altogether
+    auto start = std::chrono::high_resolution_clock::now();
+    UI64 sourceHash = MeshCache::hashFile(path);
+    PRINT("%s: hashed in %.2f ms\n", path.c_str(), 
+        std::chrono::duration<float, std::chrono::milliseconds::period>(std::chrono::high_resolution_clock::now() - start).count());
+
+    if (loadCachedModel(path, sourceHash)) {
+        return;
+    }
+
     switch (ext) {
     case FileExtension::GLTF:
+    case FileExtension::GLB:
         loadGltfModel(path);
-        return;
+        break;
     case FileExtension::OBJ:
         loadObjModel(path);
+        break;
+    }
+
+    // optimised and simplified before being cached, so the cost is only paid when the cache is baked
+    optimiseSubMeshes();
+    generateLods();
+    generateMeshlets();
+
+    writeMeshCache(path, sourceHash);
+}
+
+bool Model::loadCachedModel(const std::string& path, UI64 sourceHash) {
+    auto start = std::chrono::high_resolution_clock::now();
+
+    baseDir = path.substr(0, path.find_last_of("/\\") + 1);
+    numCachedVertices = 0;
+    numCachedIndices  = 0;
+
+    if (!meshCache.load(path, sourceHash, sizeof(Vertex), sizeof(SubMesh), sizeof(Meshlet))) {
+        return false;
+    }
+
+    // the vertices and indices stay in the mapped cache until they are copied to the staging buffer
+    const MeshCache::Header* header = meshCache.header;
+    numCachedVertices = static_cast<size_t>(header->numVertices);
+    numCachedIndices  = static_cast<size_t>(header->numIndices);
+
+    vertices.clear();
+    indices.clear();
+
+    // the sub mesh table is small and grows when geometry is added, so it is copied out
+    const SubMesh* cachedSubMeshes = reinterpret_cast<const SubMesh*>(meshCache.subMeshes);
+    subMeshes.assign(cachedSubMeshes, cachedSubMeshes + header->numSubMeshes);
+
+    const Meshlet* cachedMeshlets = reinterpret_cast<const Meshlet*>(meshCache.meshlets);
+    meshlets.assign(cachedMeshlets, cachedMeshlets + header->numMeshlets);
+
+    centre = glm::make_vec3(header->centre);
+
+    PRINT("%s: loaded from mesh cache in %.2f ms\n", path.c_str(),
+        std::chrono::duration<float, std::chrono::milliseconds::period>(std::chrono::high_resolution_clock::now() - start).count());
+    PRINT("sub meshes: %zu, vertices: %zu, indices: %zu\n", subMeshes.size(), numCachedVertices, numCachedIndices);
+
+    return true;
+}
+
+std::vector<size_t> Model::getSubMeshVertexCounts() const {
+    // each sub mesh owns the vertices from its offset up to the next sub mesh's offset
+    std::vector<size_t> order(subMeshes.size());
+    for (size_t i = 0; i < order.size(); i++) {
+        order[i] = i;
+    }
+    std::sort(order.begin(), order.end(), [this](size_t a, size_t b) { return subMeshes[a].vertexOffset < subMeshes[b].vertexOffset; });
+
+    std::vector<size_t> vertexCounts(subMeshes.size());
+    for (size_t i = 0; i < order.size(); i++) {
+        size_t vertexEnd = i + 1 < order.size() ? static_cast<size_t>(subMeshes[order[i + 1]].vertexOffset) : vertices.size();
+        vertexCounts[order[i]] = vertexEnd - subMeshes[order[i]].vertexOffset;
+    }
+    return vertexCounts;
+}
+
+void Model::optimiseSubMeshes() {
+    auto start = std::chrono::high_resolution_clock::now();
+
+    std::vector<size_t> vertexCounts = getSubMeshVertexCounts();
+
+    // totals over every sub mesh, acmr and atvr are misses per triangle and per referenced vertex
+    F32 missesBefore = 0.0f, missesAfter = 0.0f, numReferenced = 0.0f;
+    size_t numTriangles = 0;
+
+    for (size_t i = 0; i < subMeshes.size(); i++) {
+        SubMesh& subMesh = subMeshes[i];
+        size_t vertexCount = vertexCounts[i];
+        if (vertexCount == 0 || subMesh.indexCount < 3) {
+            continue;
+        }
+
+        Vertex* subMeshVertices = vertices.data() + subMesh.vertexOffset;
+        UI32* subMeshIndices = indices.data() + subMesh.firstIndex;
+        F32 subMeshTriangles = static_cast<F32>(subMesh.indexCount / 3);
+
+        MeshOptimiser::VertexCacheStats stats = MeshOptimiser::analyseVertexCache(subMeshIndices, subMesh.indexCount, vertexCount);
+        missesBefore  += stats.acmr * subMeshTriangles;
+        numReferenced += stats.atvr > 0.0f ? stats.acmr * subMeshTriangles / stats.atvr : 0.0f;
+
+        std::vector<size_t> clusters;
+        MeshOptimiser::optimiseVertexCache(subMeshIndices, subMesh.indexCount, vertexCount, &clusters);
+        MeshOptimiser::optimiseOverdraw(subMeshIndices, subMesh.indexCount, subMeshVertices, clusters);
+        MeshOptimiser::optimiseVertexFetch(subMeshVertices, vertexCount, subMeshIndices, subMesh.indexCount);
+
+        stats = MeshOptimiser::analyseVertexCache(subMeshIndices, subMesh.indexCount, vertexCount);
+        missesAfter  += stats.acmr * subMeshTriangles;
+        numTriangles += subMesh.indexCount / 3;
+    }
+
+    if (numTriangles == 0) {
         return;
     }
-    throw std::runtime_error("Unsupported extension!");
+
+    PRINT("optimised %zu triangles in %.2f ms, ACMR %.3f -> %.3f, ATVR %.3f -> %.3f (%u vertex cache)\n", numTriangles,
+        std::chrono::duration<float, std::chrono::milliseconds::period>(std::chrono::high_resolution_clock::now() - start).count(),
+        missesBefore / numTriangles, missesAfter / numTriangles, missesBefore / numReferenced, missesAfter / numReferenced, 
+        MeshOptimiser::CACHE_SIZE);
+}
+
+void Model::generateLods() {
+    auto start = std::chrono::high_resolution_clock::now();
+
+    std::vector<size_t> vertexCounts = getSubMeshVertexCounts();
+
+    // simplified ranges are appended after the full resolution indices of every sub mesh
+    std::vector<UI32> lodIndices;
+    size_t lodIndexBase = indices.size();
+    size_t numLodTriangles[MAX_LODS] = {};
+
+    for (size_t i = 0; i < subMeshes.size(); i++) {
+        SubMesh& subMesh = subMeshes[i];
+        const Vertex* subMeshVertices = vertices.data() + subMesh.vertexOffset;
+
+        computeBounds(subMesh, subMeshVertices, vertexCounts[i]);
+        computeUvDensity(subMesh, subMeshVertices, indices.data() + subMesh.firstIndex);
+        subMesh.numLods = 1;
+        subMesh.lods[0] = { subMesh.firstIndex, subMesh.indexCount, 0.0f };
+        numLodTriangles[0] += subMesh.indexCount / 3;
+
+        // each level aims for half the triangles of the previous one, simplifying from the previous level
+        std::vector<UI32> previous(indices.begin() + subMesh.firstIndex, indices.begin() + subMesh.firstIndex + subMesh.indexCount);
+        F32 errorLimit = LOD_ERROR_LIMIT * subMesh.radius;
+
+        while (subMesh.numLods < MAX_LODS) {
+            F32 error;
+            std::vector<UI32> lod = MeshSimplifier::simplify(previous.data(), previous.size(), subMeshVertices, vertexCounts[i],
+                previous.size() / 6 * 3, errorLimit, &error);
+
+            // stop once a level no longer saves enough to be worth its indices
+            if (lod.empty() || lod.size() > previous.size() * 3 / 4) {
+                break;
+            }
+
+            MeshOptimiser::optimiseVertexCache(lod.data(), lod.size(), vertexCounts[i]);
+
+            Lod& level = subMesh.lods[subMesh.numLods];
+            level.firstIndex = static_cast<UI32>(lodIndexBase + lodIndices.size());
+            level.indexCount = static_cast<UI32>(lod.size());
+            level.error      = subMesh.lods[subMesh.numLods - 1].error + error; // errors of the chain add up
+            numLodTriangles[subMesh.numLods] += lod.size() / 3;
+            subMesh.numLods++;
+
+            lodIndices.insert(lodIndices.end(), lod.begin(), lod.end());
+            previous = std::move(lod);
+        }
+    }
+
+    indices.insert(indices.end(), lodIndices.begin(), lodIndices.end());
+
+    PRINT("generated levels of detail in %.2f ms, triangles per level: %zu %zu %zu %zu\n",
+        std::chrono::duration<float, std::chrono::milliseconds::period>(std::chrono::high_resolution_clock::now() - start).count(),
+        numLodTriangles[0], numLodTriangles[1], numLodTriangles[2], numLodTriangles[3]);
+}
+
+void Model::generateMeshlets() {
+    auto start = std::chrono::high_resolution_clock::now();
+
+    std::vector<size_t> vertexCounts = getSubMeshVertexCounts();
+    meshlets.clear();
+
+    for (size_t i = 0; i < subMeshes.size(); i++) {
+        SubMesh& subMesh = subMeshes[i];
+        std::vector<Meshlet> subMeshMeshlets = Meshlet::build(indices.data() + subMesh.firstIndex, subMesh.indexCount, subMesh.firstIndex,
+            reinterpret_cast<const unsigned char*>(vertices.data() + subMesh.vertexOffset) + offsetof(Vertex, pos), sizeof(Vertex), 
+            vertexCounts[i]);
+
+        subMesh.firstMeshlet = static_cast<UI32>(meshlets.size());
+        subMesh.numMeshlets  = static_cast<UI32>(subMeshMeshlets.size());
+        meshlets.insert(meshlets.end(), subMeshMeshlets.begin(), subMeshMeshlets.end());
+    }
+
+    PRINT("built %zu meshlets in %.2f ms\n", meshlets.size(),
+        std::chrono::duration<float, std::chrono::milliseconds::period>(std::chrono::high_resolution_clock::now() - start).count());
+}
+
+void Model::computeBounds(SubMesh& subMesh, const Vertex* subMeshVertices, size_t vertexCount) {
+    // sphere around the centre of the bounding box, not minimal but cheap and good enough for lod selection
+    glm::vec3 minimum(FLT_MAX), maximum(-FLT_MAX);
+    for (size_t v = 0; v < vertexCount; v++) {
+        minimum = glm::min(minimum, subMeshVertices[v].pos);
+        maximum = glm::max(maximum, subMeshVertices[v].pos);
+    }
+    subMesh.centre = vertexCount > 0 ? 0.5f * (minimum + maximum) : glm::vec3(0.0f);
+
+    F32 radiusSquared = 0.0f;
+    for (size_t v = 0; v < vertexCount; v++) {
+        glm::vec3 offset = subMeshVertices[v].pos - subMesh.centre;
+        radiusSquared = std::max(radiusSquared, glm::dot(offset, offset));
+    }
+    subMesh.radius = std::sqrt(radiusSquared);
+}
+
+void Model::computeUvDensity(SubMesh& subMesh, const Vertex* subMeshVertices, const UI32* subMeshIndices) {
+    // the square root of the ratio of areas is the average uv length of a model space unit, texture streaming turns it
+    // into texels per pixel
+    F64 surfaceArea = 0.0;
+    F64 uvArea = 0.0;
+    for (UI32 i = 0; i + 2 < subMesh.indexCount; i += 3) {
+        const Vertex& a = subMeshVertices[subMeshIndices[i]];
+        const Vertex& b = subMeshVertices[subMeshIndices[i + 1]];
+        const Vertex& c = subMeshVertices[subMeshIndices[i + 2]];
+        surfaceArea += 0.5 * glm::length(glm::cross(b.pos - a.pos, c.pos - a.pos));
+        glm::vec2 ab = b.tex - a.tex;
+        glm::vec2 ac = c.tex - a.tex;
+        uvArea += 0.5 * std::fabs(ab.x * ac.y - ab.y * ac.x);
+    }
+    subMesh.uvDensity = surfaceArea > 0.0 ? static_cast<F32>(std::sqrt(uvArea / surfaceArea)) : 0.0f;
+}
+
+UI32 Model::selectLod(const SubMesh& subMesh, F32 distance, F32 pixelsPerUnit, F32 threshold) {
+    distance = std::max(distance, 1e-3f);
+    for (UI32 lod = subMesh.numLods - 1; lod > 0; lod--) {
+        if (subMesh.lods[lod].error * pixelsPerUnit / distance <= threshold) {
+            return lod;
+        }
+    }
+    return 0;
+}
+
+void Model::writeMeshCache(const std::string& path, UI64 sourceHash) {
+    MeshCache::Contents contents;
+    contents.vertices      = { reinterpret_cast<unsigned char*>(vertices.data()), vertices.size() * sizeof(Vertex) };
+    contents.vertexStride  = sizeof(Vertex);
+    contents.indices       = { reinterpret_cast<unsigned char*>(indices.data()), indices.size() * sizeof(UI32) };
+    contents.subMeshes     = { reinterpret_cast<unsigned char*>(subMeshes.data()), subMeshes.size() * sizeof(SubMesh) };
+    contents.subMeshStride = sizeof(SubMesh);
+    contents.meshlets      = { reinterpret_cast<unsigned char*>(meshlets.data()), meshlets.size() * sizeof(Meshlet) };
+    contents.meshletStride = sizeof(Meshlet);
+    contents.centre        = centre;
+
+    if (ext != FileExtension::OBJ) {
+        // materials reference the image of each texture slot by uri
+        contents.materials.resize(model.materials.size());
+        for (UI32 i = 0; i < static_cast<UI32>(model.materials.size()); i++) {
+            for (UI32 slot = 0; slot < 2; slot++) {
+                int imageIdx = getMaterialImage(i, slot);
+                if (imageIdx < 0) {
+                    continue;
+                }
+                const tinygltf::Image& image = model.images[imageIdx];
+                if (image.uri.empty() || tinygltf::IsDataURI(image.uri)) {
+                    // embedded images cannot be referenced from the cache
+                    PRINT("%s: not writing a mesh cache, material images are embedded in the %s\n", path.c_str(), "file");
+                    return;
+                }
+                (slot == 0 ? contents.materials[i].albedo : contents.materials[i].metallicRoughness) = image.uri;
+            }
+        }
+    }
+
+    try {
+        // external buffers are part of the source, the cache is stale if any of them change
+        if (ext != FileExtension::OBJ) {
+            for (const auto& buffer : model.buffers) {
+                if (!buffer.uri.empty() && !tinygltf::IsDataURI(buffer.uri)) {
+                    contents.dependencies.push_back({ buffer.uri, MeshCache::hashFile(baseDir + buffer.uri) });
+                }
+            }
+        }
+
+        MeshCache::write(path, sourceHash, contents);
+    }
+    catch (const std::runtime_error& e) {
+        // not fatal, a dependency that cannot be hashed or a failed write only skips the cache, the next run parses 
+        // the source again
+        PRINT("%s: not writing a mesh cache, %s\n", path.c_str(), e.what());
+    }
 }
 
 void Model::loadObjModel(const std::string& path) {
-    // setup variables to get model info
-    tinyobj::attrib_t attrib; // contains all the positions, normals, textures and faces
-    std::vector<tinyobj::shape_t> shapes; // all the separate objects and their faces
-    std::vector<tinyobj::material_t> materials; // object materials
-    std::string warn, err;
-
-    // load the model, show error if not
-    if (!tinyobj::LoadObj(&attrib, &shapes, &materials, &warn, &err, path.c_str())) {
-        throw std::runtime_error(warn + err);
-    }
-
-    // combine all the shapes into a single model
-    for (const auto& shape : shapes) {
-        for (const auto& index : shape.mesh.indices) {
-            Vertex vertex{};
-
-            // set vertex data
-            vertex.pos = {
-                attrib.vertices[3 * index.vertex_index + 0],
-                attrib.vertices[3 * index.vertex_index + 1],
-                attrib.vertices[3 * index.vertex_index + 2]
-            };
-
-            vertex.nor = {
-                attrib.normals[3 * index.normal_index + 0],
-                attrib.normals[3 * index.normal_index + 1],
-                attrib.normals[3 * index.normal_index + 2]
-            };
-
-            vertex.tex = {
-                attrib.texcoords[2 * index.texcoord_index + 0],
-                1.0f - attrib.texcoords[2 * index.texcoord_index + 1]
-            };
-            // add to the centre of gravity
-            centre += vertex.pos;
-
-            vertices.push_back(vertex);
-            indices.push_back(static_cast<uint32_t>(indices.size()));
+    auto start = std::chrono::high_resolution_clock::now();
+
+    // parse the file on every hardware thread, the output is the same whatever the number of threads
+    ThreadPool pool;
+    ObjParser parser;
+    parser.parse(path, pool);
+
+    auto parsed = std::chrono::high_resolution_clock::now();
+
+    size_t numCorners = parser.indices.size();
+
+    vertices.clear();
+    indices.clear();
+    subMeshes.clear();
+    indices.reserve(numCorners);
+
+    // corners referencing the same position/normal/texcoord triplet are the same vertex, so weld them by 
+    // hashing the triplet and remapping the index buffer to the first occurrence
+    std::unordered_map<ObjParser::Index, uint32_t, ObjIndexHash, ObjIndexEqual> uniqueVertices;
+    uniqueVertices.reserve(numCorners / 4); // closed triangle meshes average ~6 corners per vertex
+
+    centre = glm::vec3(0.0f);
+
+    // each shape becomes a sub mesh with its own vertex range, indices are relative to the start of that range
+    for (const auto& shape : parser.shapes) {
+        SubMesh subMesh{};
+        subMesh.firstIndex   = static_cast<UI32>(indices.size());
+        subMesh.vertexOffset = static_cast<I32>(vertices.size());
+        subMesh.indexCount   = static_cast<UI32>(shape.indexCount);
+        subMesh.material     = -1; // obj materials are not loaded
+
+        uniqueVertices.clear();
+
+        for (size_t i = shape.firstIndex; i < shape.firstIndex + shape.indexCount; i++) {
+            const ObjParser::Index& index = parser.indices[i];
+            auto inserted = uniqueVertices.insert({ index, static_cast<uint32_t>(vertices.size()) - subMesh.vertexOffset });
+
+            if (inserted.second) {
+                Vertex vertex{};
+
+                // set vertex data
+                vertex.pos = {
+                    parser.positions[3 * index.vertex + 0],
+                    parser.positions[3 * index.vertex + 1],
+                    parser.positions[3 * index.vertex + 2]
+                };
+
+                // normals and texcoords are optional in obj files, an index of -1 means none was given
+                if (index.normal >= 0) {
+                    vertex.nor = {
+                        parser.normals[3 * index.normal + 0],
+                        parser.normals[3 * index.normal + 1],
+                        parser.normals[3 * index.normal + 2]
+                    };
+                }
+
+                if (index.texcoord >= 0) {
+                    vertex.tex = {
+                        parser.texcoords[2 * index.texcoord + 0],
+                        1.0f - parser.texcoords[2 * index.texcoord + 1]
+                    };
+                }
+                // add to the centre of gravity
+                centre += vertex.pos;
+
+                vertices.push_back(vertex);
+            }
+
+            indices.push_back(inserted.first->second);
         }
+
+        subMeshes.push_back(subMesh);
     }
     // now compute the centre by dividing by the number of vertices in the model
     centre /= (float)vertices.size();
+
+    auto welded = std::chrono::high_resolution_clock::now();
+
+    // report how much the welding saved
+    PRINT("%s: parsed in %.2f ms on %u threads, welded in %.2f ms\n", path.c_str(),
+        std::chrono::duration<float, std::chrono::milliseconds::period>(parsed - start).count(), pool.getNumThreads(),
+        std::chrono::duration<float, std::chrono::milliseconds::period>(welded - parsed).count());
+    PRINT("vertices: %zu -> %zu (%zu -> %zu bytes), indices: %zu\n", numCorners, vertices.size(),
+        numCorners * sizeof(Vertex), vertices.size() * sizeof(Vertex), indices.size());
 }
 
 void Model::loadGltfModel(const std::string& path) {
+    auto start = std::chrono::high_resolution_clock::now();
+
     tinygltf::TinyGLTF loader;
+    // images would otherwise be decoded one after the other while parsing
+    loader.SetImageLoader(keepEncodedImage, nullptr);
 
     std::string err;
     std::string warn;
 
+    baseDir = path.substr(0, path.find_last_of("/\\") + 1);
+
+    mappedFiles.clear();
+    bufferData.clear();
+
     // parse the gltf file
-    loadStatus = loader.LoadASCIIFromFile(&model, &err, &warn, path);
+    if (ext == FileExtension::GLB) {
+        // map the glb instead of reading it into memory, the binary chunk is used in place afterwards
+        mappedFiles.emplace_back();
+        mappedFiles.back().map(path);
+        loadStatus = loader.LoadBinaryFromMemory(&model, &err, &warn, mappedFiles.back().data, 
+            static_cast<unsigned int>(mappedFiles.back().size), baseDir);
+    }
+    else {
+        loadStatus = loader.LoadASCIIFromFile(&model, &err, &warn, path);
+    }
 
     if (!warn.empty()) {
         std::cout << warn;
@@ -104,10 +489,229 @@ void Model::loadGltfModel(const std::string& path) {
         throw std::runtime_error("Could not parse .gltf file");
     }
 
-    // run some assertions to limit use for now
-    m_assert(model.buffers.size() == 1, "Invalid number of buffers (only one buffer in a file supported)...");
-    m_assert(model.meshes.size() == 1, "Invalid number of meshse (only single mesh models are currently supported)...");
-    m_assert(model.meshes[0].primitives.size() == 1, "Invalid number of primitives (only single primitive meshes are currently supported)...");
+    mapGltfBuffers(baseDir);
+
+    auto parsed = std::chrono::high_resolution_clock::now();
+
+    vertices.clear();
+    indices.clear();
+    subMeshes.clear();
+
+    // pack every primitive of every mesh instance, transforms of the node hierarchy are baked into the vertices
+    if (!model.scenes.empty()) {
+        const tinygltf::Scene& scene = model.scenes[model.defaultScene >= 0 ? model.defaultScene : 0];
+        for (int nodeIdx : scene.nodes) {
+            loadGltfNode(nodeIdx, glm::mat4(1.0f));
+        }
+    }
+    else {
+        // no scene, just take the meshes as they are
+        for (const auto& mesh : model.meshes) {
+            for (const auto& primitive : mesh.primitives) {
+                loadGltfPrimitive(primitive, glm::mat4(1.0f));
+            }
+        }
+    }
+
+    m_assert(subMeshes.size() > 0, "No triangle primitives in model...");
+
+    centre = glm::vec3(0.0f);
+    for (const auto& vertex : vertices) {
+        centre += vertex.pos;
+    }
+    centre /= (float)vertices.size();
+
+    auto extracted = std::chrono::high_resolution_clock::now();
+
+    PRINT("%s: parsed in %.2f ms, extracted in %.2f ms\n", path.c_str(),
+        std::chrono::duration<float, std::chrono::milliseconds::period>(parsed - start).count(),
+        std::chrono::duration<float, std::chrono::milliseconds::period>(extracted - parsed).count());
+    PRINT("sub meshes: %zu, vertices: %zu, indices: %zu\n", subMeshes.size(), vertices.size(), indices.size());
+}
+
+void Model::loadGltfNode(int nodeIdx, const glm::mat4& parentTransform) {
+    const tinygltf::Node& node = model.nodes[nodeIdx];
+
+    // local transform is either a matrix or translation, rotation and scale
+    glm::mat4 local(1.0f);
+    if (node.matrix.size() == 16) {
+        local = glm::mat4(glm::make_mat4(node.matrix.data()));
+    }
+    else {
+        if (node.translation.size() == 3) {
+            local = glm::translate(local, glm::vec3(glm::make_vec3(node.translation.data())));
+        }
+        if (node.rotation.size() == 4) {
+            // gltf stores quaternions as xyzw, glm constructs them from wxyz
+            local *= glm::toMat4(glm::quat(static_cast<float>(node.rotation[3]), static_cast<float>(node.rotation[0]), 
+                static_cast<float>(node.rotation[1]), static_cast<float>(node.rotation[2])));
+        }
+        if (node.scale.size() == 3) {
+            local = glm::scale(local, glm::vec3(glm::make_vec3(node.scale.data())));
+        }
+    }
+
+    glm::mat4 transform = parentTransform * local;
+
+    if (node.mesh >= 0) {
+        for (const auto& primitive : model.meshes[node.mesh].primitives) {
+            loadGltfPrimitive(primitive, transform);
+        }
+    }
+
+    for (int child : node.children) {
+        loadGltfNode(child, transform);
+    }
+}
+
+void Model::loadGltfPrimitive(const tinygltf::Primitive& primitive, const glm::mat4& transform) {
+    if (primitive.mode != TINYGLTF_MODE_TRIANGLES) {
+        PRINT("skipping primitive with unsupported mode %i\n", primitive.mode);
+        return;
+    }
+
+    auto position = primitive.attributes.find("POSITION");
+    if (position == primitive.attributes.end()) {
+        PRINT("skipping primitive without a %s attribute\n", "POSITION");
+        return;
+    }
+
+    SubMesh subMesh{};
+    subMesh.firstIndex   = static_cast<UI32>(indices.size());
+    subMesh.vertexOffset = static_cast<I32>(vertices.size());
+    subMesh.material     = primitive.material;
+
+    // append the vertices of the primitive, missing attributes are left zeroed
+    size_t numVertices = model.accessors[position->second].count;
+    vertices.resize(vertices.size() + numVertices, Vertex{});
+    Vertex* primitiveVertices = vertices.data() + subMesh.vertexOffset;
+
+    // read each attribute straight from the buffer data into its slot in the interleaved vertices
+    static const std::pair<const char*, size_t> attributes[] = {
+        { "POSITION",   offsetof(Vertex, pos) },
+        { "NORMAL",     offsetof(Vertex, nor) },
+        { "TANGENT",    offsetof(Vertex, tan) },
+        { "TEXCOORD_0", offsetof(Vertex, tex) }
+    };
+    static const uint32_t attributeSizes[] = { 3, 3, 4, 2 };
+
+    for (size_t i = 0; i < SizeofArray(attributes); i++) {
+        auto attribute = primitive.attributes.find(attributes[i].first);
+        if (attribute == primitive.attributes.end()) {
+            continue;
+        }
+
+        AccessorView view = AccessorView::fromAccessor(model, bufferData, attribute->second);
+        m_assert(view.count == numVertices, "Attribute counts differ within a primitive...");
+
+        float* dst = reinterpret_cast<float*>(reinterpret_cast<unsigned char*>(primitiveVertices) + attributes[i].second);
+        view.readFloats(dst, sizeof(Vertex), attributeSizes[i], 0.0f, 1.0f); // tangents without a w default to 1
+    }
+
+    // bake the node transform
+    if (transform != glm::mat4(1.0f)) {
+        glm::mat3 normalMatrix = glm::transpose(glm::inverse(glm::mat3(transform)));
+        for (size_t i = 0; i < numVertices; i++) {
+            Vertex& vertex = primitiveVertices[i];
+            vertex.pos = glm::vec3(transform * glm::vec4(vertex.pos, 1.0f));
+            if (vertex.nor != glm::vec3(0.0f))
+                vertex.nor = glm::normalize(normalMatrix * vertex.nor);
+            glm::vec3 tangent = glm::mat3(transform) * glm::vec3(vertex.tan);
+            if (tangent != glm::vec3(0.0f))
+                vertex.tan = glm::vec4(glm::normalize(tangent), vertex.tan.w);
+        }
+    }
+
+    // append the indices, relative to the first vertex of the primitive
+    if (primitive.indices >= 0) {
+        AccessorView view = AccessorView::fromAccessor(model, bufferData, primitive.indices);
+        indices.resize(indices.size() + view.count);
+        view.readIndices(indices.data() + subMesh.firstIndex);
+    }
+    else {
+        // non indexed primitive, each vertex is used once
+        for (UI32 i = 0; i < static_cast<UI32>(numVertices); i++) {
+            indices.push_back(i);
+        }
+    }
+
+    subMesh.indexCount = static_cast<UI32>(indices.size()) - subMesh.firstIndex;
+
+    // mirroring transforms flip the winding order of the triangles
+    if (glm::determinant(glm::mat3(transform)) < 0.0f) {
+        for (UI32 i = subMesh.firstIndex; i + 2 < subMesh.firstIndex + subMesh.indexCount; i += 3) {
+            std::swap(indices[i + 1], indices[i + 2]);
+        }
+    }
+
+    subMeshes.push_back(subMesh);
+}
+
+void Model::addSubMesh(const std::vector<Vertex>& subMeshVertices, const std::vector<UI32>& subMeshIndices, I32 material) {
+    SubMesh subMesh{};
+    subMesh.firstIndex   = getNumIndices(); // cached geometry comes first in the packed buffers
+    subMesh.vertexOffset = static_cast<I32>(getNumVertices());
+    subMesh.indexCount   = static_cast<UI32>(subMeshIndices.size());
+    subMesh.material     = material;
+
+    computeBounds(subMesh, subMeshVertices.data(), subMeshVertices.size());
+    computeUvDensity(subMesh, subMeshVertices.data(), subMeshIndices.data());
+    subMesh.numLods = 1;
+    subMesh.lods[0] = { subMesh.firstIndex, subMesh.indexCount, 0.0f };
+    subMesh.firstMeshlet = 0;
+    subMesh.numMeshlets  = 0;
+
+    vertices.insert(vertices.end(), subMeshVertices.begin(), subMeshVertices.end());
+    indices.insert(indices.end(), subMeshIndices.begin(), subMeshIndices.end());
+
+    subMeshes.push_back(subMesh);
+}
+
+void Model::mapGltfBuffers(const std::string& baseDir) {
+    // tinygltf always copies buffers into its own vectors, point at mapped data instead and drop those copies
+    // so that only one copy of the geometry is held while it is converted. Only base64 data uris keep theirs
+    bufferData.resize(model.buffers.size());
+
+    for (size_t i = 0; i < model.buffers.size(); i++) {
+        tinygltf::Buffer& buffer = model.buffers[i];
+        size_t byteLength = buffer.data.size();
+        unsigned char* mapped = nullptr;
+
+        if (ext == FileExtension::GLB && i == 0 && buffer.uri.empty()) {
+            // glb layout: 12 byte header, json chunk, then the binary chunk (each chunk has a length and type). A
+            // truncated or malformed file keeps tinygltf's copy rather than reading past the mapping
+            const MappedFile& glb = mappedFiles[0];
+            const uint32_t BIN_CHUNK_TYPE = 0x004E4942; // "BIN"
+            if (glb.size >= 20) {
+                uint32_t jsonLength;
+                memcpy(&jsonLength, glb.data + 12, sizeof(uint32_t));
+                size_t chunkOffset = 20 + static_cast<size_t>(jsonLength);
+                if (chunkOffset + 8 <= glb.size) {
+                    uint32_t chunkLength, chunkType;
+                    memcpy(&chunkLength, glb.data + chunkOffset, sizeof(uint32_t));
+                    memcpy(&chunkType, glb.data + chunkOffset + 4, sizeof(uint32_t));
+                    if (chunkType == BIN_CHUNK_TYPE && chunkOffset + 8 + chunkLength <= glb.size && byteLength <= chunkLength) {
+                        mapped = glb.data + chunkOffset + 8;
+                    }
+                }
+            }
+        }
+        else if (!buffer.uri.empty() && !tinygltf::IsDataURI(buffer.uri)) {
+            mappedFiles.emplace_back();
+            mappedFiles.back().map(baseDir + buffer.uri);
+            if (mappedFiles.back().size >= byteLength) {
+                mapped = mappedFiles.back().data;
+            }
+        }
+
+        if (mapped) {
+            bufferData[i] = { mapped, byteLength };
+            std::vector<unsigned char>().swap(buffer.data); // release the tinygltf copy
+        }
+        else {
+            bufferData[i] = { buffer.data.data(), byteLength };
+        }
+    }
 }
 
 Model::FileExtension Model::getExtension(const std::string& path) {
@@ -118,6 +722,8 @@ Model::FileExtension Model::getExtension(const std::string& path) {
         return FileExtension::OBJ;
     else if (extension == "gltf")
         return FileExtension::GLTF;
+    else if (extension == "glb")
+        return FileExtension::GLB;
     throw std::runtime_error("Unsupported extension!");
 }
 
@@ -137,42 +743,6 @@ VkFormat Model::getFormatFromType(uint32_t type) {
     return VK_FORMAT_MAX_ENUM; // keep compiler happy, never called
 }
 
-VkIndexType Model::getIndexType(uint32_t primitiveNum) {
-    auto& primitive = model.meshes[0].primitives[0];
-
-    tinygltf::Accessor indexAccessor = model.accessors[primitive.indices]; // get the indices for the primitive
-
-    switch (indexAccessor.componentType) {
-    case TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT:
-        return VK_INDEX_TYPE_UINT16;
-    case TINYGLTF_COMPONENT_TYPE_UNSIGNED_INT:
-        return VK_INDEX_TYPE_UINT32;
-    default:
-        throw std::runtime_error("Invalid index type...");
-    }
-    return VK_INDEX_TYPE_MAX_ENUM; // keep compiler happy
-}
-
-std::vector<VkDeviceSize> Model::getBufferOffsets(uint32_t primitiveNum) {
-    auto& primitive = model.meshes[0].primitives[0];
-
-    // vector containing the offsets to each attribute
-    std::vector<VkDeviceSize> offsets(primitive.attributes.size(), 0);
-    return offsets;
-}
-
-uint32_t Model::getNumVertices(uint32_t primitiveNum) {
-    tinygltf::Accessor accessor = model.accessors[model.meshes[0].primitives[primitiveNum].attributes.begin()->second];
-    uint32_t numVerts = static_cast<uint32_t>(model.bufferViews[accessor.bufferView].byteLength / accessor.ByteStride(model.bufferViews[accessor.bufferView]));
-    return numVerts;
-}
-
-uint32_t Model::getNumIndices(uint32_t primitiveNum) {
-    tinygltf::Accessor idxAccessor = model.accessors[model.meshes[0].primitives[primitiveNum].indices];
-    uint32_t numIndices = static_cast<uint32_t>(model.bufferViews[idxAccessor.bufferView].byteLength / idxAccessor.ByteStride(model.bufferViews[idxAccessor.bufferView]));
-    return numIndices;
-}
-
 VkFormat Model::getImageFormat(uint32_t imgIdx) {
     // get the texture
     tinygltf::Image im = model.images[imgIdx];
@@ -236,114 +806,293 @@ uint32_t Model::getImageBitDepth(uint32_t imgIdx) {
     return model.images[imgIdx].bits;
 }
 
-VkVertexInputBindingDescription Model::getBindingDescriptions(uint32_t primitiveNum) {
+VkVertexInputBindingDescription Model::getBindingDescriptions(uint32_t binding) {
     VkVertexInputBindingDescription bindingDescription{};
-    bindingDescription.binding   = primitiveNum; // for now 1 primitive = 1 buffer
-    bindingDescription.stride    = sizeof(Vertex);
+    bindingDescription.binding   = binding; // all sub meshes share a single vertex buffer
+    bindingDescription.stride    = static_cast<uint32_t>(getVertexStride());
     bindingDescription.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
 
     return bindingDescription;
 }
 
-std::array<VkVertexInputAttributeDescription, 4> Model::getAttributeDescriptions(uint32_t primitiveNum) {
-    auto& primitive = model.meshes[0].primitives[primitiveNum];
-
-    m_assert(primitive.attributes.size() == 4, "Model must have four attributes...");
+std::array<VkVertexInputAttributeDescription, 4> Model::getAttributeDescriptions(uint32_t binding) {
+    // loaded data is always converted to the Vertex layout, so the attributes do not depend on the source file
     std::array<VkVertexInputAttributeDescription, 4> attributeDescriptions{};
 
-    for (auto& attrib : primitive.attributes) {
-        tinygltf::Accessor accessor = model.accessors[attrib.second];
+    if (vertexFormat == VertexFormat::PACKED) {
+        // unorm and snorm attributes are converted to floats by the input assembler, the shaders undo the quantisation
+        attributeDescriptions[0] = { 0, binding, VK_FORMAT_R16G16B16A16_UNORM, offsetof(PackedVertex, pos) };
+        attributeDescriptions[1] = { 1, binding, VK_FORMAT_R16G16_SNORM,       offsetof(PackedVertex, nor) };
+        attributeDescriptions[2] = { 2, binding, VK_FORMAT_R16G16_SNORM,       offsetof(PackedVertex, tan) };
+        attributeDescriptions[3] = { 3, binding, VK_FORMAT_R16G16_UNORM,       offsetof(PackedVertex, tex) };
+        return attributeDescriptions;
+    }
 
-        int size     = accessor.type != TINYGLTF_TYPE_SCALAR ? accessor.type : 1;
-        int location = -1;
-        int offset   = 0;
-        if (attrib.first.compare("POSITION") == 0) {
-            location = 0;
-            offset   = offsetof(Vertex, pos);
-        }
-        else if (attrib.first.compare("NORMAL") == 0) {
-            location = 1;
-            offset   = offsetof(Vertex, nor);
-        }
-        else if (attrib.first.compare("TANGENT") == 0) {
-            location = 2;
-            offset   = offsetof(Vertex, tan);
-        }
-        else if (attrib.first.compare("TEXCOORD_0") == 0) {
-            location = 3;
-            offset   = offsetof(Vertex, tex);
-        }
-        else
-            throw std::runtime_error("Invalid vertex attribute!");
+    attributeDescriptions[0] = { 0, binding, VK_FORMAT_R32G32B32_SFLOAT,    offsetof(Vertex, pos) };
+    attributeDescriptions[1] = { 1, binding, VK_FORMAT_R32G32B32_SFLOAT,    offsetof(Vertex, nor) };
+    attributeDescriptions[2] = { 2, binding, VK_FORMAT_R32G32B32A32_SFLOAT, offsetof(Vertex, tan) };
+    attributeDescriptions[3] = { 3, binding, VK_FORMAT_R32G32_SFLOAT,       offsetof(Vertex, tex) };
+
+    return attributeDescriptions;
+}
 
-        // use attrib num in map as index in array
-        attributeDescriptions[attrib.second - 1].binding  = primitiveNum;
-        attributeDescriptions[attrib.second - 1].location = location;
-        attributeDescriptions[attrib.second - 1].format   = getFormatFromType(size); // returns the right format for appropriate type (size of vec)
-        attributeDescriptions[attrib.second - 1].offset   = offset;
+std::vector<Buffer> Model::getVertexData() {
+    std::vector<Buffer> regions;
+    if (vertexFormat == VertexFormat::PACKED) {
+        packVertices();
+        regions.push_back({ reinterpret_cast<unsigned char*>(packedVertices.data()), packedVertices.size() * sizeof(PackedVertex) });
+        return regions;
     }
 
-    return attributeDescriptions;
+    if (numCachedVertices > 0) {
+        regions.push_back({ meshCache.vertices, numCachedVertices * sizeof(Vertex) });
+    }
+    if (!vertices.empty()) {
+        regions.push_back({ reinterpret_cast<unsigned char*>(vertices.data()), vertices.size() * sizeof(Vertex) });
+    }
+    return regions;
 }
 
-std::vector<Model::Vertex>* Model::getVertexBuffer(uint32_t primitiveNum) {
-    // create array for vertices
-    vertices.resize(getNumVertices(primitiveNum));
-    m_assert(vertices.size() > 0, "No vertex data in primitive...");
+std::vector<Buffer> Model::getIndexData() {
+    std::vector<Buffer> regions;
+    if (numCachedIndices > 0) {
+        regions.push_back({ meshCache.indices, numCachedIndices * sizeof(uint32_t) });
+    }
+    if (!indices.empty()) {
+        regions.push_back({ reinterpret_cast<unsigned char*>(indices.data()), indices.size() * sizeof(uint32_t) });
+    }
+    return regions;
+}
 
-    // map from attribute index to buffer offset (assumes order: pos, norm, tan, tex)
-    std::map<int, size_t> attributeOffsets;
-    for (auto& attribute : model.meshes[0].primitives[primitiveNum].attributes) {
-        
-        attributeOffsets.insert({ attribute.second - 1, model.bufferViews[attribute.second].byteOffset });
+void Model::packVertices() {
+    const Vertex* cached = reinterpret_cast<const Vertex*>(meshCache.vertices);
+    size_t numVertices = getNumVertices();
+    auto getVertex = [&](size_t i) -> const Vertex& { return i < numCachedVertices ? cached[i] : vertices[i - numCachedVertices]; };
+
+    // a single quantisation for the whole model, every sub mesh is drawn with the same uniforms
+    glm::vec3 positionMin(FLT_MAX), positionMax(-FLT_MAX);
+    glm::vec2 uvMin(FLT_MAX), uvMax(-FLT_MAX);
+    for (size_t i = 0; i < numVertices; i++) {
+        const Vertex& v = getVertex(i);
+        positionMin = glm::min(positionMin, v.pos);
+        positionMax = glm::max(positionMax, v.pos);
+        uvMin = glm::min(uvMin, v.tex);
+        uvMax = glm::max(uvMax, v.tex);
     }
 
-    tinygltf::Buffer buffer = model.buffers[0];
+    if (numVertices == 0) {
+        quantisation = { glm::vec3(0.0f), glm::vec3(1.0f), glm::vec2(0.0f), glm::vec2(1.0f) };
+    }
+    else {
+        quantisation = { positionMin, positionMax - positionMin, uvMin, uvMax - uvMin };
+    }
 
-    // loop over each vertex and extract its attributes from the model buffer
-    for (size_t i = 0; i < vertices.size(); i++) {
-        vertices[i] = Vertex {
-            glm::make_vec3(((float*)(buffer.data.data() + attributeOffsets[0] + (i * sizeof(glm::vec3))))), // pos
-            glm::make_vec3(((float*)(buffer.data.data() + attributeOffsets[1] + (i * sizeof(glm::vec3))))), // norm
-            glm::make_vec4(((float*)(buffer.data.data() + attributeOffsets[2] + (i * sizeof(glm::vec3))))), // tan
-            glm::make_vec2(((float*)(buffer.data.data() + attributeOffsets[3] + (i * sizeof(glm::vec2)))))  // tex
-        };
+    packedVertices.resize(numVertices);
+    for (size_t i = 0; i < numVertices; i++) {
+        const Vertex& v = getVertex(i);
+        packedVertices[i] = PackedVertex::pack(v.pos, v.nor, v.tan, v.tex, quantisation);
     }
+}
+
+void Model::benchmarkVertexFormats(const std::string& path) {
+    using milliseconds = std::chrono::duration<float, std::chrono::milliseconds::period>;
 
-    return &vertices;
+    Model model;
+    model.loadModel(path);
+
+    // float reference, gathered from the cache and the vectors
+    std::vector<Vertex> reference;
+    reference.reserve(model.getNumVertices());
+    for (const Buffer& region : model.getVertexData()) {
+        const Vertex* begin = reinterpret_cast<const Vertex*>(region.data);
+        reference.insert(reference.end(), begin, begin + region.size / sizeof(Vertex));
+    }
+
+    PRINT("vertex format benchmark: %s (%zu vertices)\n", path.c_str(), reference.size());
+
+    model.setVertexFormat(VertexFormat::PACKED);
+    const UI32 numRuns = 10;
+    auto start = std::chrono::high_resolution_clock::now();
+    for (UI32 run = 0; run < numRuns; run++) {
+        model.packVertices();
+    }
+    float encodeMs = milliseconds(std::chrono::high_resolution_clock::now() - start).count() / numRuns;
+
+    float floatMB = static_cast<float>(reference.size() * sizeof(Vertex)) / (1024.0f * 1024.0f);
+    float packedMB = static_cast<float>(model.packedVertices.size() * sizeof(PackedVertex)) / (1024.0f * 1024.0f);
+    PRINT("float:  %2zu bytes per vertex, %8.2f MB\n", sizeof(Vertex), floatMB);
+    PRINT("packed: %2zu bytes per vertex, %8.2f MB (%.1f%% of float), encoded in %.2f ms\n", sizeof(PackedVertex), packedMB,
+        100.0f * packedMB / std::max(floatMB, FLT_MIN), encodeMs);
+
+    // decode as the shaders do and compare with the float layout
+    F32 maxPositionError = 0.0f, sumPositionError = 0.0f;
+    F32 maxNormalError = 0.0f, sumNormalError = 0.0f;
+    F32 maxTangentError = 0.0f, sumTangentError = 0.0f;
+    F32 maxUvError = 0.0f;
+    size_t numNormals = 0, numTangents = 0, numFlippedTangents = 0;
+
+    // atan2 rather than acos, which cannot resolve angles this small in single precision
+    auto angleDegrees = [](const glm::vec3& a, const glm::vec3& b) {
+        return glm::degrees(std::atan2(glm::length(glm::cross(a, b)), glm::dot(a, b)));
+    };
+
+    for (size_t i = 0; i < reference.size(); i++) {
+        const Vertex& v = reference[i];
+        glm::vec3 pos, nor;
+        glm::vec4 tan;
+        glm::vec2 tex;
+        model.packedVertices[i].unpack(model.quantisation, pos, nor, tan, tex);
+
+        F32 positionError = glm::length(pos - v.pos);
+        maxPositionError = std::max(maxPositionError, positionError);
+        sumPositionError += positionError;
+
+        if (glm::dot(v.nor, v.nor) > 0.0f) {
+            F32 normalError = angleDegrees(v.nor, nor);
+            maxNormalError = std::max(maxNormalError, normalError);
+            sumNormalError += normalError;
+            numNormals++;
+        }
+
+        glm::vec3 tangent = glm::vec3(v.tan);
+        if (glm::dot(tangent, tangent) > 0.0f) {
+            F32 tangentError = angleDegrees(tangent, glm::vec3(tan));
+            maxTangentError = std::max(maxTangentError, tangentError);
+            sumTangentError += tangentError;
+            numTangents++;
+            numFlippedTangents += (v.tan.w < 0.0f) != (tan.w < 0.0f) ? 1 : 0;
+        }
+
+        maxUvError = std::max(maxUvError, std::max(std::abs(tex.x - v.tex.x), std::abs(tex.y - v.tex.y)));
+    }
+
+    F32 extent = std::max(model.quantisation.positionExtent.x, std::max(model.quantisation.positionExtent.y, 
+        model.quantisation.positionExtent.z));
+    size_t numVertices = std::max(reference.size(), static_cast<size_t>(1));
+    PRINT("position error: max %.3g, mean %.3g (max %.4f%% of the model extent %.3g)\n", maxPositionError, 
+        sumPositionError / numVertices, 100.0f * maxPositionError / std::max(extent, FLT_MIN), extent);
+    PRINT("normal error:   max %.4f deg, mean %.4f deg\n", maxNormalError, sumNormalError / std::max(numNormals, static_cast<size_t>(1)));
+    PRINT("tangent error:  max %.4f deg, mean %.4f deg, %zu handedness flips\n", maxTangentError, 
+        sumTangentError / std::max(numTangents, static_cast<size_t>(1)), numFlippedTangents);
+    PRINT("uv error:       max %.3g (%.3g texels of a 4096 texture)\n", maxUvError, maxUvError * 4096.0f);
 }
 
-std::vector<uint32_t>* Model::getIndexBuffer(uint32_t primitiveNum) {
-    tinygltf::Accessor indexAccessor =  model.accessors[model.meshes[0].primitives[primitiveNum].indices];
+void Model::decodeMaterialTextures(ThreadPool* pool, 
+    const std::function<void(UI32, const Image&, const ImageSource&)>& onDecoded) {
+    auto start = std::chrono::high_resolution_clock::now();
+
+    ImageDecoder decoder(pool);
+    // the textures each decode fills, an image shared between materials is only decoded once
+    std::vector<std::vector<UI32>> decodeTextures;
+    std::vector<ImageSource> decodeSources; // the encoded bytes each decode reads from
+    std::unordered_map<std::string, UI32> uriDecodes; // images referenced by the cache
+    std::unordered_map<int, UI32> imageDecodes; // images of the parsed gltf
+    UI32 numStandIns = 0;
+
+    for (UI32 materialIdx = 0; materialIdx < getNumMaterials(); materialIdx++) {
+        // each slot is looked up by name, slots without a texture are left to the caller's default
+        for (UI32 slot = 0; slot < 2; slot++) {
+            UI32 textureIdx = 2 * materialIdx + slot;
 
-    // get the number of indices 
-    tinygltf::BufferView bView = model.bufferViews[indexAccessor.bufferView];
-    indices.resize(getNumIndices(primitiveNum));
+            // the slot's image, by uri when the gltf was not parsed
+            std::string uri;
+            int imageIdx = -1;
+            if (meshCache.isLoaded()) {
+                const MeshCache::Material& material = meshCache.materials[materialIdx];
+                uri = slot == 0 ? material.albedo : material.metallicRoughness;
+                if (uri.empty()) {
+                    continue;
+                }
+            }
+            else {
+                imageIdx = getMaterialImage(materialIdx, slot);
+                if (imageIdx < 0) {
+                    continue;
+                }
+                uri = model.images[imageIdx].uri;
+            }
 
-    tinygltf::Buffer buffer = model.buffers[bView.buffer];
-    // copy the data into the indices buffer
-    for (size_t i = 0; i < indices.size(); i++) {
-        indices[i] = *((uint16_t*)(buffer.data.data() + bView.byteOffset + i * sizeof(uint16_t))); // cast UC to uint16, which is converted to uint32
+            // block compressed stand ins are mapped rather than decoded, they go to the upload straight away and the
+            // mapping is their source
+            auto standIn = std::make_shared<Ktx2File>();
+            if (loadKtx2Texture(uri, standIn.get())) {
+                ImageSource source{};
+                source.ktx2 = standIn;
+                onDecoded(textureIdx, standIn->getImage(), source);
+                numStandIns++;
+                continue;
+            }
+
+            auto uriIt = uriDecodes.find(uri);
+            auto imageIt = imageDecodes.find(imageIdx);
+            if (meshCache.isLoaded() ? uriIt != uriDecodes.end() : imageIt != imageDecodes.end()) {
+                decodeTextures[meshCache.isLoaded() ? uriIt->second : imageIt->second].push_back(textureIdx);
+                continue;
+            }
+
+            // the encoded bytes are decoded where they lie and become the source of the textures, a mapped file or 
+            // the bytes the loader callback kept in the gltf image
+            ImageSource source{};
+            if (meshCache.isLoaded()) {
+                auto file = std::make_shared<MappedFile>();
+                file->map(baseDir + uri);
+                source.encoded = { file->data, file->size };
+                source.owner   = file;
+            }
+            else {
+                auto encoded = std::make_shared<std::vector<unsigned char>>(std::move(model.images[imageIdx].image));
+                source.encoded = { encoded->data(), encoded->size() };
+                source.owner   = encoded;
+            }
+
+            // forced to four channels, as tinygltf does when it decodes images
+            UI32 decodeIdx = decoder.decodeMemory(source.encoded.data, source.encoded.size, STBI_rgb_alpha);
+            (meshCache.isLoaded() ? uriDecodes[uri] : imageDecodes[imageIdx]) = decodeIdx;
+            decodeTextures.push_back({ textureIdx });
+            decodeSources.push_back(source);
+        }
     }
 
-    return &indices;
+    // uploads are recorded on this thread as each image completes, while the workers decode the others. The upload
+    // copies the pixels to staging memory, so they are freed straight after, and the encoded bytes go unless the
+    // callback kept their source
+    ImageDecoder::Result result;
+    while (decoder.next(&result)) {
+        for (UI32 textureIdx : decodeTextures[result.id]) {
+            onDecoded(textureIdx, result.image, decodeSources[result.id]);
+        }
+        result.pixels.reset();
+        decodeSources[result.id] = ImageSource{};
+    }
+
+    auto end = std::chrono::high_resolution_clock::now();
+    PRINT("material textures: %zu images decoded on %u threads, %u ktx2 stand ins, in %.2f ms\n", decodeTextures.size(),
+        pool->getNumThreads(), numStandIns, std::chrono::duration<double, std::milli>(end - start).count());
 }
 
-const std::vector<Image>* Model::getMaterialTextureData(uint32_t primitiveNum) {
-    tinygltf::Material material = model.materials[model.meshes[0].primitives[primitiveNum].material];
+int Model::getMaterialImage(UI32 materialIdx, UI32 slot) const {
+    // values also hold factors, the slots are found by the name of their texture
+    static const char* const SLOT_NAMES[2] = { "baseColorTexture", "metallicRoughnessTexture" };
+    const tinygltf::ParameterMap& values = model.materials[materialIdx].values;
+    auto it = values.find(SLOT_NAMES[slot]);
+    if (it == values.end()) {
+        return -1;
+    }
+    int texIdx = it->second.TextureIndex();
+    return texIdx < 0 ? -1 : model.textures[texIdx].source;
+}
 
-    m_assert((material.values.size() > 0) && (material.values.size() < 3), "Invalid number of textures in material (only support two)... ");
-    textures.resize(material.values.size());
+bool Model::loadKtx2Texture(const std::string& uri, Ktx2File* file) {
+    // embedded images have no file to stand in for them
+    if (uri.empty() || uri.compare(0, 5, "data:") == 0) {
+        return false;
+    }
 
-    // TODO: refactor away from dynamic vector with a material class
-    auto texIter = textures.begin();
-    for (auto& value : material.values) {
-        int texIdx = value.second.TextureIndex();
-        tinygltf::Image* im = &model.images[texIdx];
-        // image info
-        *texIter = { static_cast<uint32_t>(im->width), static_cast<uint32_t>(im->height), getImageFormat(texIdx), { im->image.data(), im->image.size() } };
-        texIter++; // move on to next texture
+    std::string path = baseDir + uri.substr(0, uri.find_last_of('.')) + ".ktx2";
+    if (!std::ifstream(path).good()) {
+        return false;
     }
 
-    return &textures;
-}
\ No newline at end of file
+    file->load(path);
+    return true;
+}
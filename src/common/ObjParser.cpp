@@ -0,0 +1,362 @@
+//
+// Definition of the ObjParser class
+//
+
+#include <common/ObjParser.h>
+
+#include <utils/MappedFile.h>
+#include <utils/Print.h>
+
+#include <tiny_obj_loader.h> // benchmark baseline, implemented in Model.cpp
+
+#include <algorithm> // min, max
+#include <charconv> // from_chars
+#include <chrono> // parse timings
+#include <cstring> // memchr, memcpy
+#include <stdexcept>
+
+// target size of a chunk, enough chunks to balance the load without making the merge expensive
+static const size_t CHUNK_SIZE = 4 * 1024 * 1024;
+
+// a negative (relative) index can only be resolved once the number of elements before the chunk is known
+struct RelativeIndex {
+    size_t slot;   // face corner in the chunk
+    UI8 attribute; // 0 vertex, 1 normal, 2 texcoord
+};
+
+struct ObjChunk {
+    const char* begin;
+    const char* end;
+
+    std::vector<F32> positions;
+    std::vector<F32> normals;
+    std::vector<F32> texcoords;
+    std::vector<ObjParser::Index> indices;
+    std::vector<size_t> shapeStarts; // corners parsed before each o or g statement
+    std::vector<RelativeIndex> relativeIndices;
+};
+
+static inline bool isSpace(char c) {
+    return c == ' ' || c == '\t';
+}
+
+static inline bool isLineEnd(char c) {
+    return c == '\n' || c == '\r';
+}
+
+static inline const char* skipSpace(const char* ptr, const char* end) {
+    while (ptr < end && isSpace(*ptr)) {
+        ptr++;
+    }
+    return ptr;
+}
+
+static inline const char* skipLine(const char* ptr, const char* end) {
+    const char* newLine = static_cast<const char*>(memchr(ptr, '\n', end - ptr));
+    return newLine ? newLine + 1 : end;
+}
+
+static const char* parseFloat(const char* ptr, const char* end, F32& value) {
+    ptr = skipSpace(ptr, end);
+    if (ptr < end && *ptr == '+') {
+        ptr++; // from_chars does not accept a leading plus
+    }
+    auto result = std::from_chars(ptr, end, value);
+    if (result.ec != std::errc()) {
+        throw std::runtime_error("failed to parse a number in obj file!");
+    }
+    return result.ptr;
+}
+
+// parses the float components of a v, vn or vt statement, optional components default to 0
+static const char* parseFloats(const char* ptr, const char* end, std::vector<F32>& dst, UI32 numComponents, UI32 numRequired) {
+    for (UI32 i = 0; i < numComponents; i++) {
+        const char* next = skipSpace(ptr, end);
+        if (i >= numRequired && (next == end || isLineEnd(*next))) {
+            dst.push_back(0.0f);
+            continue;
+        }
+        F32 value;
+        ptr = parseFloat(next, end, value);
+        dst.push_back(value);
+    }
+    return ptr;
+}
+
+// resolves an obj index (1 based, or negative relative to the end of the list) to a 0 based index
+static const char* parseIndex(const char* ptr, const char* end, I32 count, I32& index, bool& relative) {
+    I32 value = 0;
+    auto result = std::from_chars(ptr, end, value);
+    if (result.ec != std::errc() || value == 0) {
+        throw std::runtime_error("invalid face index in obj file!");
+    }
+    relative = value < 0;
+    index = relative ? count + value : value - 1; // relative indices are local to the chunk for now
+    return result.ptr;
+}
+
+static const char* parseFace(const char* ptr, const char* end, ObjChunk& chunk, std::vector<ObjParser::Index>& polygon, 
+    std::vector<RelativeIndex>& polygonRelative) {
+    polygon.clear();
+    polygonRelative.clear();
+
+    const I32 counts[] = { 
+        static_cast<I32>(chunk.positions.size() / 3), 
+        static_cast<I32>(chunk.normals.size() / 3), 
+        static_cast<I32>(chunk.texcoords.size() / 2) 
+    };
+
+    for (;;) {
+        ptr = skipSpace(ptr, end);
+        if (ptr == end || isLineEnd(*ptr)) {
+            break;
+        }
+
+        // v, v/vt, v//vn or v/vt/vn
+        ObjParser::Index index{ -1, -1, -1 };
+        bool relative;
+        ptr = parseIndex(ptr, end, counts[0], index.vertex, relative);
+        if (relative) {
+            polygonRelative.push_back({ polygon.size(), 0 });
+        }
+        if (ptr < end && *ptr == '/') {
+            ptr++;
+            if (ptr < end && *ptr != '/') {
+                ptr = parseIndex(ptr, end, counts[2], index.texcoord, relative);
+                if (relative) {
+                    polygonRelative.push_back({ polygon.size(), 2 });
+                }
+            }
+            if (ptr < end && *ptr == '/') {
+                ptr++;
+                ptr = parseIndex(ptr, end, counts[1], index.normal, relative);
+                if (relative) {
+                    polygonRelative.push_back({ polygon.size(), 1 });
+                }
+            }
+        }
+        polygon.push_back(index);
+    }
+
+    if (polygon.size() < 3) {
+        return ptr; // points and degenerate faces are not drawn
+    }
+
+    // fan triangulation, relative slots are remapped to the corners they end up in
+    for (size_t i = 1; i + 1 < polygon.size(); i++) {
+        size_t triangle[] = { 0, i, i + 1 };
+        for (size_t corner : triangle) {
+            for (const auto& relativeIndex : polygonRelative) {
+                if (relativeIndex.slot == corner) {
+                    chunk.relativeIndices.push_back({ chunk.indices.size(), relativeIndex.attribute });
+                }
+            }
+            chunk.indices.push_back(polygon[corner]);
+        }
+    }
+
+    return ptr;
+}
+
+static void parseChunk(ObjChunk& chunk) {
+    const char* ptr = chunk.begin;
+    const char* end = chunk.end;
+
+    // reused by every face to avoid allocating per line
+    std::vector<ObjParser::Index> polygon;
+    std::vector<RelativeIndex> polygonRelative;
+
+    while (ptr < end) {
+        ptr = skipSpace(ptr, end);
+        if (ptr == end) {
+            break;
+        }
+
+        if (ptr[0] == 'v' && ptr + 1 < end) {
+            if (isSpace(ptr[1])) {
+                ptr = parseFloats(ptr + 2, end, chunk.positions, 3, 3); // w and vertex colours are ignored
+            }
+            else if (ptr[1] == 'n' && ptr + 2 < end && isSpace(ptr[2])) {
+                ptr = parseFloats(ptr + 3, end, chunk.normals, 3, 3);
+            }
+            else if (ptr[1] == 't' && ptr + 2 < end && isSpace(ptr[2])) {
+                ptr = parseFloats(ptr + 3, end, chunk.texcoords, 2, 1);
+            }
+        }
+        else if (ptr[0] == 'f' && ptr + 1 < end && isSpace(ptr[1])) {
+            ptr = parseFace(ptr + 2, end, chunk, polygon, polygonRelative);
+        }
+        else if ((ptr[0] == 'o' || ptr[0] == 'g') && (ptr + 1 == end || isSpace(ptr[1]) || isLineEnd(ptr[1]))) {
+            chunk.shapeStarts.push_back(chunk.indices.size());
+        }
+
+        // anything else (comments, materials, smoothing groups, lines) is skipped
+        ptr = skipLine(ptr, end);
+    }
+}
+
+void ObjParser::parse(const std::string& path, ThreadPool& pool) {
+    MappedFile file;
+    file.map(path);
+
+    positions.clear();
+    normals.clear();
+    texcoords.clear();
+    indices.clear();
+    shapes.clear();
+
+    const char* data = reinterpret_cast<const char*>(file.data);
+    const char* fileEnd = data + file.size;
+
+    // split into chunks that start at the beginning of a line, the split does not depend on the thread count
+    std::vector<ObjChunk> chunks;
+    const char* chunkBegin = data;
+    while (chunkBegin < fileEnd) {
+        const char* chunkEnd = chunkBegin + std::min(CHUNK_SIZE, static_cast<size_t>(fileEnd - chunkBegin));
+        chunkEnd = chunkEnd < fileEnd ? skipLine(chunkEnd, fileEnd) : fileEnd;
+        chunks.emplace_back();
+        chunks.back().begin = chunkBegin;
+        chunks.back().end   = chunkEnd;
+        chunkBegin = chunkEnd;
+    }
+
+    pool.parallelFor(chunks.size(), [&chunks](size_t i) { parseChunk(chunks[i]); });
+
+    // offsets of each chunk in the merged arrays
+    struct ChunkOffsets {
+        size_t positions, normals, texcoords, indices;
+    };
+    std::vector<ChunkOffsets> offsets(chunks.size());
+    ChunkOffsets total{};
+    for (size_t i = 0; i < chunks.size(); i++) {
+        offsets[i] = total;
+        total.positions += chunks[i].positions.size();
+        total.normals   += chunks[i].normals.size();
+        total.texcoords += chunks[i].texcoords.size();
+        total.indices   += chunks[i].indices.size();
+    }
+
+    positions.resize(total.positions);
+    normals.resize(total.normals);
+    texcoords.resize(total.texcoords);
+    indices.resize(total.indices);
+
+    const I32 numElements[] = { 
+        static_cast<I32>(total.positions / 3), 
+        static_cast<I32>(total.normals / 3), 
+        static_cast<I32>(total.texcoords / 2) 
+    };
+
+    // copy each chunk into place, resolve its relative indices and validate every index
+    pool.parallelFor(chunks.size(), [&](size_t i) {
+        ObjChunk& chunk = chunks[i];
+        std::copy(chunk.positions.begin(), chunk.positions.end(), positions.begin() + offsets[i].positions);
+        std::copy(chunk.normals.begin(), chunk.normals.end(), normals.begin() + offsets[i].normals);
+        std::copy(chunk.texcoords.begin(), chunk.texcoords.end(), texcoords.begin() + offsets[i].texcoords);
+
+        const I32 bases[] = { 
+            static_cast<I32>(offsets[i].positions / 3), 
+            static_cast<I32>(offsets[i].normals / 3), 
+            static_cast<I32>(offsets[i].texcoords / 2) 
+        };
+        for (const auto& relativeIndex : chunk.relativeIndices) {
+            Index& index = chunk.indices[relativeIndex.slot];
+            I32* attribute = relativeIndex.attribute == 0 ? &index.vertex : relativeIndex.attribute == 1 ? &index.normal : &index.texcoord;
+            *attribute += bases[relativeIndex.attribute];
+            if (*attribute < 0) {
+                throw std::runtime_error("relative face index out of range in obj file!");
+            }
+        }
+
+        for (const auto& index : chunk.indices) {
+            if (index.vertex < 0 || index.vertex >= numElements[0] || index.normal >= numElements[1] || index.texcoord >= numElements[2]) {
+                throw std::runtime_error("face index out of range in obj file!");
+            }
+        }
+
+        std::copy(chunk.indices.begin(), chunk.indices.end(), indices.begin() + offsets[i].indices);
+
+        // the chunk data is no longer needed
+        std::vector<F32>().swap(chunk.positions);
+        std::vector<F32>().swap(chunk.normals);
+        std::vector<F32>().swap(chunk.texcoords);
+        std::vector<Index>().swap(chunk.indices);
+    });
+
+    // shapes run from one o or g statement to the next, empty ones are dropped
+    std::vector<size_t> shapeStarts = { 0 };
+    for (size_t i = 0; i < chunks.size(); i++) {
+        for (size_t start : chunks[i].shapeStarts) {
+            shapeStarts.push_back(offsets[i].indices + start);
+        }
+    }
+    shapeStarts.push_back(indices.size());
+
+    for (size_t i = 0; i + 1 < shapeStarts.size(); i++) {
+        if (shapeStarts[i + 1] > shapeStarts[i]) {
+            shapes.push_back({ shapeStarts[i], shapeStarts[i + 1] - shapeStarts[i] });
+        }
+    }
+}
+
+void ObjParser::benchmark(const std::string& path) {
+    using milliseconds = std::chrono::duration<float, std::chrono::milliseconds::period>;
+
+    MappedFile file;
+    file.map(path);
+    float sizeMB = static_cast<float>(file.size) / (1024.0f * 1024.0f);
+    file.unmap();
+
+    PRINT("obj parse benchmark: %s (%.1f MB)\n", path.c_str(), sizeMB);
+
+    // single threaded baseline
+    {
+        tinyobj::attrib_t attrib;
+        std::vector<tinyobj::shape_t> shapes;
+        std::vector<tinyobj::material_t> materials;
+        std::string warn, err;
+
+        auto start = std::chrono::high_resolution_clock::now();
+        if (!tinyobj::LoadObj(&attrib, &shapes, &materials, &warn, &err, path.c_str())) {
+            throw std::runtime_error(warn + err);
+        }
+        float ms = milliseconds(std::chrono::high_resolution_clock::now() - start).count();
+        PRINT("tinyobjloader: %9.2f ms, %8.1f MB/s\n", ms, sizeMB / (ms / 1000.0f));
+    }
+
+    // 1, 2, 4 ... threads, up to the number of hardware threads
+    UI32 maxThreads = std::max(std::thread::hardware_concurrency(), 1u);
+    std::vector<UI32> threadCounts;
+    for (UI32 numThreads = 1; numThreads < maxThreads; numThreads *= 2) {
+        threadCounts.push_back(numThreads);
+    }
+    threadCounts.push_back(maxThreads);
+
+    ObjParser reference;
+    float singleThreadMs = 0.0f;
+
+    for (UI32 numThreads : threadCounts) {
+        ThreadPool pool(numThreads);
+        ObjParser parser;
+
+        auto start = std::chrono::high_resolution_clock::now();
+        parser.parse(path, pool);
+        float ms = milliseconds(std::chrono::high_resolution_clock::now() - start).count();
+
+        if (numThreads == 1) {
+            singleThreadMs = ms;
+            reference = std::move(parser);
+            PRINT("%2u threads:    %9.2f ms, %8.1f MB/s, speedup %5.2fx\n", numThreads, ms, sizeMB / (ms / 1000.0f), 1.0f);
+            continue;
+        }
+
+        // the merge is ordered, so every thread count must give exactly the same output
+        bool identical = parser.positions == reference.positions && parser.normals == reference.normals &&
+            parser.texcoords == reference.texcoords && parser.indices.size() == reference.indices.size() &&
+            memcmp(parser.indices.data(), reference.indices.data(), parser.indices.size() * sizeof(Index)) == 0 &&
+            parser.shapes.size() == reference.shapes.size();
+
+        PRINT("%2u threads:    %9.2f ms, %8.1f MB/s, speedup %5.2fx%s\n", numThreads, ms, sizeMB / (ms / 1000.0f), 
+            singleThreadMs / ms, identical ? "" : " (OUTPUT DIFFERS)");
+    }
+}
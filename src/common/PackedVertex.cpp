@@ -0,0 +1,113 @@
+//
+// Definition of the PackedVertex struct
+//
+
+#include <common/PackedVertex.h>
+
+#include <algorithm> // min, max
+#include <cmath> // abs, round
+
+#include <glm/gtc/matrix_transform.hpp> // translate, scale
+
+static inline UI16 quantiseUnorm16(F32 v) {
+    return static_cast<UI16>(std::round(std::min(std::max(v, 0.0f), 1.0f) * 65535.0f));
+}
+
+static inline I16 quantiseSnorm16(F32 v) {
+    return static_cast<I16>(std::round(std::min(std::max(v, -1.0f), 1.0f) * 32767.0f));
+}
+
+// vulkan's snorm conversion, -32768 also maps to -1
+static inline F32 dequantiseSnorm16(I16 v) {
+    return std::max(static_cast<F32>(v) / 32767.0f, -1.0f);
+}
+
+static inline F32 signNotZero(F32 v) {
+    return v >= 0.0f ? 1.0f : -1.0f;
+}
+
+glm::mat4 PackedVertex::Quantisation::getPositionTransform() const {
+    return glm::scale(glm::translate(glm::mat4(1.0f), positionMin), positionExtent);
+}
+
+glm::vec4 PackedVertex::Quantisation::getUvTransform() const {
+    return glm::vec4(uvMin, uvExtent);
+}
+
+PackedVertex PackedVertex::pack(const glm::vec3& pos, const glm::vec3& nor, const glm::vec4& tan, const glm::vec2& tex,
+    const Quantisation& quantisation) {
+    PackedVertex packed;
+
+    // a zero extent (flat model or constant uvs) is stored as 1, everything then quantises to 0
+    for (int i = 0; i < 3; i++) {
+        F32 extent = quantisation.positionExtent[i] > 0.0f ? quantisation.positionExtent[i] : 1.0f;
+        packed.pos[i] = quantiseUnorm16((pos[i] - quantisation.positionMin[i]) / extent);
+    }
+    packed.pos[3] = tan.w < 0.0f ? 0 : 65535;
+
+    octEncode(nor, packed.nor);
+    octEncode(glm::vec3(tan), packed.tan);
+
+    for (int i = 0; i < 2; i++) {
+        F32 extent = quantisation.uvExtent[i] > 0.0f ? quantisation.uvExtent[i] : 1.0f;
+        packed.tex[i] = quantiseUnorm16((tex[i] - quantisation.uvMin[i]) / extent);
+    }
+
+    return packed;
+}
+
+void PackedVertex::unpack(const Quantisation& quantisation, glm::vec3& outPos, glm::vec3& outNor, glm::vec4& outTan,
+    glm::vec2& outTex) const {
+    glm::vec3 unorm(pos[0] / 65535.0f, pos[1] / 65535.0f, pos[2] / 65535.0f);
+    outPos = glm::vec3(quantisation.getPositionTransform() * glm::vec4(unorm, 1.0f));
+    outNor = octDecode(nor);
+    outTan = glm::vec4(octDecode(tan), pos[3] / 65535.0f * 2.0f - 1.0f);
+    glm::vec4 uvTransform = quantisation.getUvTransform();
+    outTex = glm::vec2(uvTransform.x + tex[0] / 65535.0f * uvTransform.z, uvTransform.y + tex[1] / 65535.0f * uvTransform.w);
+}
+
+// octahedral mapping of a unit vector: project onto the octahedron |x| + |y| + |z| = 1 and fold the lower
+// half over the diagonals, "A Survey of Efficient Representations for Independent Unit Vectors" (Cigolle et al.)
+void PackedVertex::octEncode(const glm::vec3& v, I16 encoded[2]) {
+    F32 l1 = std::abs(v.x) + std::abs(v.y) + std::abs(v.z);
+    if (l1 == 0.0f) {
+        encoded[0] = encoded[1] = 0; // missing normals and tangents decode to +z
+        return;
+    }
+
+    F32 x = v.x / l1;
+    F32 y = v.y / l1;
+    if (v.z < 0.0f) {
+        F32 foldedX = (1.0f - std::abs(y)) * signNotZero(x);
+        F32 foldedY = (1.0f - std::abs(x)) * signNotZero(y);
+        x = foldedX;
+        y = foldedY;
+    }
+
+    // rounding each component independently is not always the closest encoding, try the four neighbours
+    F32 floorX = std::floor(std::min(std::max(x, -1.0f), 1.0f) * 32767.0f);
+    F32 floorY = std::floor(std::min(std::max(y, -1.0f), 1.0f) * 32767.0f);
+    glm::vec3 n = glm::normalize(v);
+    F32 bestDot = -2.0f;
+    for (int i = 0; i < 4; i++) {
+        I16 candidate[2] = {
+            quantiseSnorm16((floorX + (i & 1)) / 32767.0f),
+            quantiseSnorm16((floorY + (i >> 1)) / 32767.0f)
+        };
+        F32 d = glm::dot(octDecode(candidate), n);
+        if (d > bestDot) {
+            bestDot = d;
+            encoded[0] = candidate[0];
+            encoded[1] = candidate[1];
+        }
+    }
+}
+
+glm::vec3 PackedVertex::octDecode(const I16 encoded[2]) {
+    glm::vec3 v(dequantiseSnorm16(encoded[0]), dequantiseSnorm16(encoded[1]), 0.0f);
+    v.z = 1.0f - std::abs(v.x) - std::abs(v.y);
+    F32 t = std::max(-v.z, 0.0f);
+    v.x += v.x >= 0.0f ? -t : t;
+    v.y += v.y >= 0.0f ? -t : t;
+    return glm::normalize(v);
+}
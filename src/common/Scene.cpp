@@ -11,7 +11,9 @@ Scene::Scene(const std::string& path) {
 
 void Scene::LoadScene(const std::string& path) {
 	std::string error;
-	bool r = loader.LoadASCIIFromFile(&scene, &error, path);
+	// binary gltf files hold the json and buffers in a single file
+	bool isBinary = path.size() > 4 && path.compare(path.size() - 4, 4, ".glb") == 0;
+	bool r = isBinary ? loader.LoadBinaryFromFile(&scene, &error, path) : loader.LoadASCIIFromFile(&scene, &error, path);
 	if (!error.empty()) {
 		std::cout << error << std::endl;
 	}
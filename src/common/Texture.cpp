@@ -5,28 +5,47 @@
 #include <common/Texture.h>
 
 #include <utils/Utils.h> // utils namespace
+#include <utils/BlockCompression.h> // decoding when the device lacks bc formats
 
 // image loading
 #include <stb_image.h>
 
 
-void Texture::createTexture(VulkanSetup* pVkSetup, const VkCommandPool& commandPool, const Image& image) {
+UploadManager::Token Texture::createTexture(VulkanSetup* pVkSetup, UploadManager* uploadManager, const Image& sourceImage) {
     vkSetup = pVkSetup;
 
-    VulkanBuffer stagingBuffer; // staging buffer containing image in host memory
+    UploadManager::Token token = createTextureImage(uploadManager, sourceImage);
 
-    VulkanBuffer::CreateInfo createInfo{};
-    createInfo.size = image.imageData.size;
-    createInfo.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
-    createInfo.properties = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
-    createInfo.pVulkanBuffer = &stagingBuffer;
+    // create the sampler
+    createTextureSampler();
+
+    return token;
+}
 
-    VulkanBuffer::createBuffer(vkSetup, &createInfo);
+UploadManager::Token Texture::recreateImage(UploadManager* uploadManager, const Image& sourceImage, DeletionQueue* deletionQueue) {
+    // frames in flight may still sample the old image through its view
+    VulkanSetup* pVkSetup = vkSetup;
+    VulkanImage oldImage = textureImage;
+    VkImageView oldImageView = textureImageView;
+    deletionQueue->push([=]() mutable {
+        vkDestroyImageView(pVkSetup->device, oldImageView, nullptr);
+        oldImage.cleanupImage(pVkSetup);
+    });
+
+    return createTextureImage(uploadManager, sourceImage);
+}
+
+UploadManager::Token Texture::createTextureImage(UploadManager* uploadManager, const Image& sourceImage) {
+    // block compressed images are decoded on the host when the device cannot sample their format
+    Image image = sourceImage;
+    std::vector<unsigned char> decodedData;
+    if (VulkanImage::formatIsBlockCompressed(image.format) && !VulkanImage::queryFormatSupport(vkSetup->physicalDevice, 
+        image.format, VK_IMAGE_TYPE_2D, VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, 0).supported) {
+        image = utils::decodeImage(sourceImage, &decodedData);
+    }
 
-    void* data;
-    vkMapMemory(vkSetup->device, stagingBuffer.memory, 0, image.imageData.size, 0, &data);
-    memcpy(data, image.imageData.data, image.imageData.size);
-    vkUnmapMemory(vkSetup->device, stagingBuffer.memory);
+    // pre-built levels are uploaded as they are, otherwise the chain is generated from level 0
+    bool generateMips = image.levelOffsets.empty();
 
     // create the image and its memory
     VulkanImage::ImageCreateInfo imgCreateInfo{};
@@ -34,48 +53,35 @@ void Texture::createTexture(VulkanSetup* pVkSetup, const VkCommandPool& commandP
     imgCreateInfo.height = image.height;
     imgCreateInfo.format = image.format;
     imgCreateInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
-    imgCreateInfo.usage = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+    // a generated mip chain is blitted from level 0, so the image is a transfer source too
+    imgCreateInfo.usage = VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT | 
+        (generateMips ? VK_IMAGE_USAGE_TRANSFER_SRC_BIT : 0);
+    imgCreateInfo.mipLevels = generateMips ? VulkanImage::getMipLevels(image.width, image.height) : 
+        static_cast<UI32>(image.levelOffsets.size());
     imgCreateInfo.properties = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
+    imgCreateInfo.category = MemoryAllocator::Category::TEXTURE;
     imgCreateInfo.pVulkanImage = &textureImage;
 
-    VulkanImage::createImage(vkSetup, commandPool, imgCreateInfo);
+    VulkanImage::createImage(vkSetup, VK_NULL_HANDLE, imgCreateInfo);
 
-    // copy host data to device
-    VulkanImage::LayoutTransitionInfo transitionData{};
-    transitionData.pVulkanImage = &textureImage;
-    transitionData.renderCommandPool = commandPool;
-    transitionData.format = image.format;
-    transitionData.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-    transitionData.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+    // the pixels are copied into the upload manager's staging arena, the layout transitions and the copy are batched
+    // with every other upload rather than submitted and waited on here
+    UploadManager::ImageUploadInfo uploadInfo{};
+    uploadInfo.pVulkanImage = &textureImage;
+    uploadInfo.data = image.imageData.data;
+    uploadInfo.size = image.imageData.size;
+    uploadInfo.regions = VulkanImage::getUploadRegions(image);
+    uploadInfo.mipLevels = textureImage.mipLevels;
+    uploadInfo.generateMips = generateMips;
 
-    VulkanImage::transitionImageLayout(vkSetup, transitionData); // specify the initial layout VK_IMAGE_LAYOUT_UNDEFINED
-
-    // need to specify which parts of the buffer we are going to copy to which part of the image
-    std::vector<VkBufferImageCopy> regions = {
-        { 0, 0, 0, { VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1 }, { 0, 0, 0 }, { image.width, image.height, 1 } }
-    };
-
-    VulkanBuffer::copyBufferToImage(vkSetup, commandPool, stagingBuffer.buffer, textureImage.image, regions);
-
-    // need another transfer to give the shader access to the texture
-    transitionData.pVulkanImage = &textureImage;
-    transitionData.renderCommandPool = commandPool;
-    transitionData.format = image.format;
-    transitionData.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
-    transitionData.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-
-    VulkanImage::transitionImageLayout(vkSetup, transitionData);
-
-    // cleanup the staging buffer and its memory
-    stagingBuffer.cleanupBufferData(vkSetup->device);
+    UploadManager::Token token = uploadManager->uploadImage(uploadInfo);
 
     // then create the image view
     VkImageViewCreateInfo imageViewCreateInfo = utils::initImageViewCreateInfo(textureImage.image,
-        VK_IMAGE_VIEW_TYPE_2D, image.format, {}, { VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1 });
+        VK_IMAGE_VIEW_TYPE_2D, image.format, {}, { VK_IMAGE_ASPECT_COLOR_BIT, 0, textureImage.mipLevels, 0, 1 });
     textureImageView = VulkanImage::createImageView(vkSetup, imageViewCreateInfo);
 
-    // create the sampler
-    createTextureSampler();
+    return token;
 }
 
 void Texture::cleanupTexture() {
@@ -121,7 +127,8 @@ void Texture::createTextureSampler() {
     samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_LINEAR;
     samplerInfo.mipLodBias = 0.0f;
     samplerInfo.minLod = 0.0f;
-    samplerInfo.maxLod = 0.0f;
+    // the view bounds the levels sampled, so an image recreated with more levels keeps the sampler
+    samplerInfo.maxLod = VK_LOD_CLAMP_NONE;
 
     // now create the configured sampler
     if (vkCreateSampler(vkSetup->device, &samplerInfo, nullptr, &textureSampler) != VK_SUCCESS) {
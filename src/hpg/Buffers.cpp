@@ -8,7 +8,9 @@
 
 void VulkanBuffer::cleanupBufferData(const VkDevice& device) {
     vkDestroyBuffer(device, buffer, nullptr);
-    vkFreeMemory(device, memory, nullptr);
+    if (allocation.allocator) {
+        allocation.allocator->free(allocation);
+    }
 }
 
 void VulkanBuffer::copyBufferToImage(const VulkanSetup* vkSetup, const VkCommandPool& renderCommandPool, VkBuffer buffer,
@@ -39,22 +41,14 @@ void VulkanBuffer::createBuffer(const VulkanSetup* vkSetup, VulkanBuffer::Create
     VkMemoryRequirements memRequirements;
     vkGetBufferMemoryRequirements(vkSetup->device, bufferCreateInfo->pVulkanBuffer->buffer, &memRequirements);
 
-    // allocate the memory for the buffer
-    VkMemoryAllocateInfo allocInfo{};
-    allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-    allocInfo.allocationSize = memRequirements.size;
-    allocInfo.memoryTypeIndex = utils::findMemoryType(&vkSetup->physicalDevice, memRequirements.memoryTypeBits, bufferCreateInfo->properties);
-
-    // allocate memory for the buffer. In a real world application, not supposed to actually call vkAllocateMemory for every individual buffer. 
-    // The maximum number of simultaneous memory allocations is limited by the maxMemoryAllocationCount physical device limit. The right way to 
-    // allocate memory for large number of objects at the same time is to create a custom allocator that splits up a single allocation among many 
-    // different objects by using the offset parameters seen in other functions
-    if (vkAllocateMemory(vkSetup->device, &allocInfo, nullptr, &bufferCreateInfo->pVulkanBuffer->memory) != VK_SUCCESS) {
-        throw std::runtime_error("failed to allocate vertex buffer memory!");
-    }
+    // sub-allocate the memory from one of the allocator's blocks, calling vkAllocateMemory for every buffer would soon
+    // hit the maxMemoryAllocationCount limit
+    MemoryAllocator::Allocation& allocation = bufferCreateInfo->pVulkanBuffer->allocation;
+    allocation = vkSetup->allocator.allocate(memRequirements, bufferCreateInfo->properties, MemoryAllocator::ResourceType::LINEAR,
+        bufferCreateInfo->category);
 
     // associate memory with buffer
-    vkBindBufferMemory(vkSetup->device, bufferCreateInfo->pVulkanBuffer->buffer, bufferCreateInfo->pVulkanBuffer->memory, 0);
+    vkBindBufferMemory(vkSetup->device, bufferCreateInfo->pVulkanBuffer->buffer, allocation.memory, allocation.offset);
 }
 
 void VulkanBuffer::copyBuffer(const VulkanSetup* vkSetup, const VkCommandPool& commandPool, VulkanBuffer::CopyInfo* bufferCopyInfo) {
@@ -64,41 +58,3 @@ void VulkanBuffer::copyBuffer(const VulkanSetup* vkSetup, const VkCommandPool& c
     vkCmdCopyBuffer(commandBuffer, *bufferCopyInfo->pSrc, *bufferCopyInfo->pDst, 1, &bufferCopyInfo->copyRegion);
     utils::endSingleTimeCommands(&vkSetup->device, &vkSetup->graphicsQueue, &commandBuffer, &commandPool);
 }
-
-void VulkanBuffer::createDeviceLocalBuffer(const VulkanSetup* vkSetup, const VkCommandPool& commandPool, const Buffer& buffer, VulkanBuffer* vkBuffer, VkBufferUsageFlagBits usage) {
-    VulkanBuffer stagingBuffer;
-
-    VulkanBuffer::CreateInfo createInfo{};
-    createInfo.size = buffer.size;
-    createInfo.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
-    createInfo.properties = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
-    createInfo.pVulkanBuffer = &stagingBuffer;
-
-    VulkanBuffer::createBuffer(vkSetup, &createInfo);
-
-    void* data;
-    vkMapMemory(vkSetup->device, stagingBuffer.memory, 0, buffer.size, 0, &data);
-    memcpy(data, buffer.data, buffer.size);
-    vkUnmapMemory(vkSetup->device, stagingBuffer.memory);
-
-    // different usage bit flag VK_BUFFER_USAGE_INDEX_BUFFER_BIT instead of VK_BUFFER_USAGE_VERTEX_BUFFER_BIT
-    createInfo.usage = VK_BUFFER_USAGE_TRANSFER_DST_BIT | usage;
-    createInfo.properties = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
-    createInfo.pVulkanBuffer = vkBuffer;
-
-    VulkanBuffer::createBuffer(vkSetup, &createInfo);
-
-    VkBufferCopy copyRegion{};
-    copyRegion.size = buffer.size;
-    copyRegion.srcOffset = 0;
-    copyRegion.dstOffset = 0;
-
-    VulkanBuffer::CopyInfo copyInfo{};
-    copyInfo.pSrc = &stagingBuffer.buffer;
-    copyInfo.pDst = &vkBuffer->buffer;
-    copyInfo.copyRegion = copyRegion;
-
-    VulkanBuffer::copyBuffer(vkSetup, commandPool, &copyInfo);
-
-    stagingBuffer.cleanupBufferData(vkSetup->device);
-}
\ No newline at end of file
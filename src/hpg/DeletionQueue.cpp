@@ -0,0 +1,28 @@
+//
+// Definition of the DeletionQueue class
+//
+
+#include <hpg/DeletionQueue.h>
+
+#include <utility> // move
+
+void DeletionQueue::push(std::function<void()>&& deleter) {
+    entries.push_back({ frame, std::move(deleter) });
+}
+
+void DeletionQueue::collect(UI64 completedFrame) {
+    while (!entries.empty() && entries.front().frame <= completedFrame) {
+        // pop before running so a throwing deleter is not run twice
+        std::function<void()> deleter = std::move(entries.front().deleter);
+        entries.pop_front();
+        deleter();
+    }
+}
+
+void DeletionQueue::flush() {
+    while (!entries.empty()) {
+        std::function<void()> deleter = std::move(entries.front().deleter);
+        entries.pop_front();
+        deleter();
+    }
+}
@@ -14,41 +14,36 @@
 //
 //////////////////////
 
-void DepthResource::createDepthResource(VulkanSetup* pVkSetup, const VkExtent2D& extent, VkCommandPool commandPool) {
+void DepthResource::createDepthResource(VulkanSetup* pVkSetup, RenderTargetPool* pRenderTargetPool, const VkExtent2D& extent) {
     vkSetup = pVkSetup;
-    // depth image should have the same resolution as the colour attachment, defined by swap chain extent
-    VkFormat depthFormat = findDepthFormat(vkSetup); // find a depth format
+    renderTargetPool = pRenderTargetPool;
 
-    // we have the information needed to create an image (the format, usage etc) and an image view
-    VulkanImage::ImageCreateInfo info{};
+    // depth image should have the same resolution as the colour attachment, defined by swap chain extent. Only the
+    // composition pass uses it and never stores it, so it is transient and shares memory with other passes' targets
+    RenderTargetPool::TargetInfo info{};
     info.width        = extent.width;
     info.height       = extent.height;
-    info.format       = depthFormat;
-    info.tiling       = VK_IMAGE_TILING_OPTIMAL;
+    info.format       = findDepthFormat(vkSetup);
     info.usage        = VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT;
-    info.properties   = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
+    info.aspect       = VK_IMAGE_ASPECT_DEPTH_BIT;
+    info.firstPass    = RenderTargetPool::Pass::COMPOSITION;
+    info.lastPass     = RenderTargetPool::Pass::COMPOSITION;
+    info.transient    = true;
     info.pVulkanImage = &depthImage;
+    info.pImageView   = &depthImageView;
 
-    VulkanImage::createImage(vkSetup, commandPool, info);
+    renderTargetPool->createTarget(info);
 
-    VkImageViewCreateInfo imageViewCreateInfo = utils::initImageViewCreateInfo(depthImage.image,
-        VK_IMAGE_VIEW_TYPE_2D, depthFormat, {}, { VK_IMAGE_ASPECT_DEPTH_BIT, 0, 1, 0, 1 });
-    depthImageView = VulkanImage::createImageView(vkSetup, imageViewCreateInfo);
-
-    VulkanImage::LayoutTransitionInfo transitionData{};
-    transitionData.pVulkanImage      = &depthImage;
-    transitionData.renderCommandPool = commandPool;
-    transitionData.format            = depthFormat;
-    transitionData.oldLayout         = VK_IMAGE_LAYOUT_UNDEFINED;
-    transitionData.newLayout         = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
-
-    // undefined layout is used as the initial layout as there are no existing depth image contents that matter
-    VulkanImage::transitionImageLayout(vkSetup, transitionData);
+    // no layout transition is submitted, the render pass clears the image from an undefined layout. This keeps the
+    // graphics queue from being drained when the resource is recreated on a resize
 }
 
 void DepthResource::cleanupDepthResource() {
-    vkDestroyImageView(vkSetup->device, depthImageView, nullptr);
-    depthImage.cleanupImage(vkSetup);
+    renderTargetPool->destroyTarget(depthImage.image, depthImageView);
+}
+
+void DepthResource::releaseDepthResource(DeletionQueue* deletionQueue) {
+    renderTargetPool->releaseTarget(depthImage.image, depthImageView, deletionQueue);
 }
 
 //
@@ -15,11 +15,12 @@
 //
 //////////////////////
 
-void FrameBuffer::initFrameBuffer(VulkanSetup* pVkSetup, const SwapChain* swapChainData, const VkCommandPool& commandPool) {
+void FrameBuffer::initFrameBuffer(VulkanSetup* pVkSetup, const SwapChain* swapChainData, RenderTargetPool* pRenderTargetPool) {
     // update the pointer to the setup data rather than passing as argument to functions
     vkSetup = pVkSetup;
+    renderTargetPool = pRenderTargetPool;
     // first create the depth resource
-    depthResource.createDepthResource(vkSetup, swapChainData->extent, commandPool);
+    depthResource.createDepthResource(vkSetup, renderTargetPool, swapChainData->extent);
     // then create the framebuffers
     createFrameBuffers(swapChainData);
     createImGuiFramebuffers(swapChainData);
@@ -36,6 +37,25 @@ void FrameBuffer::cleanupFrameBuffers() {
     }
 }
 
+void FrameBuffer::recreateFrameBuffers(const SwapChain* swapChainData, DeletionQueue* deletionQueue) {
+    // frames in flight may still render into the old framebuffers, they are destroyed once those complete
+    VkDevice device = vkSetup->device;
+    std::vector<VkFramebuffer> oldFramebuffers = framebuffers;
+    std::vector<VkFramebuffer> oldImGuiFramebuffers = imGuiFramebuffers;
+
+    deletionQueue->push([=]() {
+        for (size_t i = 0; i < oldFramebuffers.size(); i++) {
+            vkDestroyFramebuffer(device, oldFramebuffers[i], nullptr);
+            vkDestroyFramebuffer(device, oldImGuiFramebuffers[i], nullptr);
+        }
+    });
+    depthResource.releaseDepthResource(deletionQueue);
+
+    depthResource.createDepthResource(vkSetup, renderTargetPool, swapChainData->extent);
+    createFrameBuffers(swapChainData);
+    createImGuiFramebuffers(swapChainData);
+}
+
 //////////////////////
 //
 // The framebuffers
@@ -6,14 +6,12 @@
 #include <app/AppConstants.h>
 
 void GBuffer::createGBuffer(VulkanSetup* pVkSetup, SwapChain* swapChain, VkDescriptorSetLayout* descriptorSetLayout, 
-	Model* model, const VkCommandPool& cmdPool) {
+	Model* model, RenderTargetPool* pRenderTargetPool) {
 	vkSetup = pVkSetup;
+	renderTargetPool = pRenderTargetPool;
 	extent = swapChain->extent; // get extent from swap chain
 
-	createAttachment("position", VK_FORMAT_R16G16B16A16_SFLOAT, VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT, cmdPool);
-	createAttachment("normal", VK_FORMAT_R16G16B16A16_SFLOAT, VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT, cmdPool);
-	createAttachment("albedo", VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT, cmdPool);
-	createAttachment("depth", DepthResource::findDepthFormat(vkSetup), VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT, cmdPool);
+	createAttachments();
 
 	createRenderPass();
 
@@ -21,20 +19,10 @@ void GBuffer::createGBuffer(VulkanSetup* pVkSetup, SwapChain* swapChain, VkDescr
 
 	createColourSampler();
 
-	// uniform buffers
-	VulkanBuffer::createUniformBuffer<GBuffer::OffScreenUbo>(vkSetup, 1, 
-		&offScreenUniform, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
-
-	VulkanBuffer::createUniformBuffer<GBuffer::CompositionUBO>(vkSetup, swapChain->images.size(), 
-		&compositionUniforms, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
-
 	createPipelines(descriptorSetLayout, swapChain, model);
 }
 
 void GBuffer::cleanupGBuffer() {
-	offScreenUniform.cleanupBufferData(vkSetup->device);
-	compositionUniforms.cleanupBufferData(vkSetup->device);
-
 	vkDestroySampler(vkSetup->device, colourSampler, nullptr);
 	
 	vkDestroyFramebuffer(vkSetup->device, deferredFrameBuffer, nullptr);
@@ -47,29 +35,60 @@ void GBuffer::cleanupGBuffer() {
 	vkDestroyRenderPass(vkSetup->device, deferredRenderPass, nullptr);
 
 	for (auto& attachment : attachments) {
-		vkDestroyImageView(vkSetup->device, attachment.second.imageView, nullptr);
-		attachment.second.vulkanImage.cleanupImage(vkSetup);
+		renderTargetPool->destroyTarget(attachment.second.vulkanImage.image, attachment.second.imageView);
 	}
 }
 
-void GBuffer::createAttachment(const std::string& name, VkFormat format, VkImageUsageFlagBits usage, const VkCommandPool& cmdPool) {
-	Attachment* attachment = &attachments[name]; // [] inserts an element if non exist in map
-	attachment->format = format;
+void GBuffer::recreateGBuffer(SwapChain* swapChain, DeletionQueue* deletionQueue) {
+	// frames in flight may still use the old objects, they are destroyed once those complete
+	VkDevice device = vkSetup->device;
+	VkFramebuffer oldFrameBuffer = deferredFrameBuffer;
 
-	// create the image 
-	VulkanImage::ImageCreateInfo info{};
-	info.width        = extent.width;
-	info.height       = extent.height;
-	info.format       = attachment->format;
-	info.tiling       = VK_IMAGE_TILING_OPTIMAL;
-	info.usage        = usage | VK_IMAGE_USAGE_SAMPLED_BIT;
-	info.pVulkanImage = &attachment->vulkanImage;
+	deletionQueue->push([=]() {
+		vkDestroyFramebuffer(device, oldFrameBuffer, nullptr);
+	});
 
-	VulkanImage::createImage(vkSetup, cmdPool, info);
+	for (auto& attachment : attachments) {
+		renderTargetPool->releaseTarget(attachment.second.vulkanImage.image, attachment.second.imageView, deletionQueue);
+	}
+
+	extent = swapChain->extent;
+
+	createAttachments();
+
+	createFrameBuffer();
+}
+
+void GBuffer::recreatePipelines(SwapChain* swapChain, VkDescriptorSetLayout* descriptorSetLayout, Model* model, 
+	DeletionQueue* deletionQueue) {
+	VkDevice device = vkSetup->device;
+	std::array<VkPipeline, 3> oldPipelines = { deferredPipeline, offScreenPipeline, skyboxPipeline };
+	VkPipelineLayout oldLayout = layout;
+
+	deletionQueue->push([=]() {
+		for (VkPipeline oldPipeline : oldPipelines) {
+			vkDestroyPipeline(device, oldPipeline, nullptr);
+		}
+		vkDestroyPipelineLayout(device, oldLayout, nullptr);
+	});
+
+	createPipelines(descriptorSetLayout, swapChain, model);
+}
+
+void GBuffer::createAttachments() {
+	createAttachment("position", VK_FORMAT_R16G16B16A16_SFLOAT, VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT, false);
+	createAttachment("normal", VK_FORMAT_R16G16B16A16_SFLOAT, VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT, false);
+	createAttachment("albedo", VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT, false);
+	// depth is only tested against while filling the gBuffer, nothing samples it
+	createAttachment("depth", DepthResource::findDepthFormat(vkSetup), VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT, true);
+}
+
+void GBuffer::createAttachment(const std::string& name, VkFormat format, VkImageUsageFlagBits usage, bool transient) {
+	Attachment* attachment = &attachments[name]; // [] inserts an element if non exist in map
+	attachment->format = format;
 
-	// create the image view
-	VkImageAspectFlags aspectMask = 0;
 	// usage determines aspect mask
+	VkImageAspectFlags aspectMask = 0;
 	if (usage & VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT) 
 		aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
 	if (usage & VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT)
@@ -77,9 +96,20 @@ void GBuffer::createAttachment(const std::string& name, VkFormat format, VkImage
 	if (aspectMask <= 0)
 		throw std::runtime_error("Invalid aspect mask!");
 
-	VkImageViewCreateInfo imageViewCreateInfo = utils::initImageViewCreateInfo(attachment->vulkanImage.image,
-		VK_IMAGE_VIEW_TYPE_2D, format, {}, { aspectMask, 0, 1, 0, 1 });
-	attachment->imageView = VulkanImage::createImageView(vkSetup, imageViewCreateInfo);
+	// create the image and its view
+	RenderTargetPool::TargetInfo info{};
+	info.width        = extent.width;
+	info.height       = extent.height;
+	info.format       = attachment->format;
+	info.usage        = transient ? usage : usage | VK_IMAGE_USAGE_SAMPLED_BIT;
+	info.aspect       = aspectMask;
+	info.firstPass    = RenderTargetPool::Pass::OFFSCREEN;
+	info.lastPass     = transient ? RenderTargetPool::Pass::OFFSCREEN : RenderTargetPool::Pass::COMPOSITION;
+	info.transient    = transient;
+	info.pVulkanImage = &attachment->vulkanImage;
+	info.pImageView   = &attachment->imageView;
+
+	renderTargetPool->createTarget(info);
 }
 
 void GBuffer::createRenderPass() {
@@ -92,10 +122,12 @@ void GBuffer::createRenderPass() {
 		attachmentDescriptions[i].stencilLoadOp  = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
 		attachmentDescriptions[i].stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
 		if (i == 3) {
+			attachmentDescriptions[i].storeOp       = VK_ATTACHMENT_STORE_OP_DONT_CARE; // transient, never read after the pass
 			attachmentDescriptions[i].initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
 			attachmentDescriptions[i].finalLayout   = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
 		}
 		else {
+			attachmentDescriptions[i].storeOp       = VK_ATTACHMENT_STORE_OP_STORE;
 			attachmentDescriptions[i].initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
 			attachmentDescriptions[i].finalLayout   = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
 		}
@@ -119,7 +151,7 @@ void GBuffer::createRenderPass() {
 	subpass.colorAttachmentCount    = static_cast<uint32_t>(colourReferences.size());
 	subpass.pDepthStencilAttachment = &depthReference;
 	
-	std::array<VkSubpassDependency, 2> dependencies{}; // dependencies for attachment layout transition
+	std::array<VkSubpassDependency, 3> dependencies{}; // dependencies for attachment layout transition
 
 	dependencies[0].srcSubpass      = VK_SUBPASS_EXTERNAL;
 	dependencies[0].dstSubpass      = 0;
@@ -137,13 +169,22 @@ void GBuffer::createRenderPass() {
 	dependencies[1].dstAccessMask   = VK_ACCESS_MEMORY_READ_BIT;
 	dependencies[1].dependencyFlags = VK_DEPENDENCY_BY_REGION_BIT;
 
+	// the depth attachment's memory is aliased by the composition pass' depth, whose writes must be done before the 
+	// clear. Earlier submissions to the queue are in the first scope, so this covers the previous frame
+	dependencies[2].srcSubpass      = VK_SUBPASS_EXTERNAL;
+	dependencies[2].dstSubpass      = 0;
+	dependencies[2].srcStageMask    = VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+	dependencies[2].dstStageMask    = VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+	dependencies[2].srcAccessMask   = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+	dependencies[2].dstAccessMask   = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+
 	VkRenderPassCreateInfo renderPassInfo = {};
 	renderPassInfo.sType           = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
 	renderPassInfo.pAttachments    = attachmentDescriptions.data();
 	renderPassInfo.attachmentCount = static_cast<uint32_t>(attachmentDescriptions.size());
 	renderPassInfo.subpassCount    = 1;
 	renderPassInfo.pSubpasses      = &subpass;
-	renderPassInfo.dependencyCount = 2;
+	renderPassInfo.dependencyCount = static_cast<uint32_t>(dependencies.size());
 	renderPassInfo.pDependencies   = dependencies.data();
 
 	if (vkCreateRenderPass(vkSetup->device, &renderPassInfo, nullptr, &deferredRenderPass) != VK_SUCCESS) {
@@ -206,9 +247,6 @@ void GBuffer::createPipelines(VkDescriptorSetLayout* descriptorSetLayout, SwapCh
 	VkPipelineColorBlendAttachmentState colorBlendAttachment = 
 		utils::initPipelineColorBlendAttachmentState(colBlendAttachFlag, VK_FALSE);
 
-	VkViewport viewport{ 0.0f, 0.0f, (float)extent.width, (float)extent.height, 0.0f, 1.0f };
-	VkRect2D scissor{ { 0, 0 }, extent };
-
 	VkShaderModule vertShaderModule, fragShaderModule;
 	std::array<VkPipelineShaderStageCreateInfo, 2> shaderStages;
 
@@ -224,8 +262,13 @@ void GBuffer::createPipelines(VkDescriptorSetLayout* descriptorSetLayout, SwapCh
 	VkPipelineDepthStencilStateCreateInfo  depthStencilStateInfo =
 		utils::initPipelineDepthStencilStateCreateInfo(VK_TRUE, VK_TRUE, VK_COMPARE_OP_LESS_OR_EQUAL);
 
+	// the viewport and scissor are set when recording so the pipelines are kept when the extent changes
 	VkPipelineViewportStateCreateInfo      viewportStateInfo =
-		utils::initPipelineViewportStateCreateInfo(1, &viewport, 1, &scissor);
+		utils::initPipelineViewportStateCreateInfo(1, nullptr, 1, nullptr);
+
+	std::array<VkDynamicState, 2> dynamicStates = { VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR };
+	VkPipelineDynamicStateCreateInfo       dynamicStateInfo =
+		utils::initPipelineDynamicStateCreateInfo(dynamicStates.data(), static_cast<uint32_t>(dynamicStates.size()));
 
 	VkPipelineMultisampleStateCreateInfo   multisamplingStateInfo =
 		utils::initPipelineMultisampleStateCreateInfo(VK_SAMPLE_COUNT_1_BIT);
@@ -245,6 +288,7 @@ void GBuffer::createPipelines(VkDescriptorSetLayout* descriptorSetLayout, SwapCh
 	pipelineCreateInfo.pMultisampleState   = &multisamplingStateInfo;
 	pipelineCreateInfo.pDepthStencilState  = &depthStencilStateInfo;
 	pipelineCreateInfo.pColorBlendState    = &colorBlendingStateInfo;
+	pipelineCreateInfo.pDynamicState       = &dynamicStateInfo;
 
 	// composition pipeline
 	vertShaderModule = Shader::createShaderModule(vkSetup, Shader::readFile(COMP_VERT_SHADER));
@@ -258,7 +302,7 @@ void GBuffer::createPipelines(VkDescriptorSetLayout* descriptorSetLayout, SwapCh
 		utils::initPipelineVertexInputStateCreateInfo(0, nullptr, 0, nullptr); // no vertex data input
 	pipelineCreateInfo.pVertexInputState = &emptyInputStateInfo;
 
-	if (vkCreateGraphicsPipelines(vkSetup->device, VK_NULL_HANDLE, 1, &pipelineCreateInfo, nullptr, &deferredPipeline) != VK_SUCCESS) {
+	if (vkCreateGraphicsPipelines(vkSetup->device, vkSetup->pipelineCache, 1, &pipelineCreateInfo, nullptr, &deferredPipeline) != VK_SUCCESS) {
 		throw std::runtime_error("Could not create deferred graphics pipeline!");
 	}
 
@@ -268,7 +312,8 @@ void GBuffer::createPipelines(VkDescriptorSetLayout* descriptorSetLayout, SwapCh
 	// offscreen pipeline
 	pipelineCreateInfo.renderPass = deferredRenderPass;
 
-	vertShaderModule = Shader::createShaderModule(vkSetup, Shader::readFile(OFF_VERT_SHADER));
+	vertShaderModule = Shader::createShaderModule(vkSetup, Shader::readFile(
+		model->getVertexFormat() == Model::VertexFormat::PACKED ? OFF_PACKED_VERT_SHADER : OFF_VERT_SHADER));
 	fragShaderModule = Shader::createShaderModule(vkSetup, Shader::readFile(OFF_FRAG_SHADER));
 	shaderStages[0]  = utils::initPipelineShaderStageCreateInfo(VK_SHADER_STAGE_VERTEX_BIT, vertShaderModule, "main");
 	shaderStages[1]  = utils::initPipelineShaderStageCreateInfo(VK_SHADER_STAGE_FRAGMENT_BIT, fragShaderModule, "main");
@@ -292,7 +337,7 @@ void GBuffer::createPipelines(VkDescriptorSetLayout* descriptorSetLayout, SwapCh
 	colorBlendingStateInfo.attachmentCount = static_cast<uint32_t>(colorBlendAttachmentStates.size());
 	colorBlendingStateInfo.pAttachments    = colorBlendAttachmentStates.data();
 	
-	if (vkCreateGraphicsPipelines(vkSetup->device, VK_NULL_HANDLE, 1, &pipelineCreateInfo, nullptr, &offScreenPipeline) != VK_SUCCESS) {
+	if (vkCreateGraphicsPipelines(vkSetup->device, vkSetup->pipelineCache, 1, &pipelineCreateInfo, nullptr, &offScreenPipeline) != VK_SUCCESS) {
 		throw std::runtime_error("Could not create deferred graphics pipeline!");
 	}
 
@@ -311,7 +356,7 @@ void GBuffer::createPipelines(VkDescriptorSetLayout* descriptorSetLayout, SwapCh
 	vertexInputStateInfo = utils::initPipelineVertexInputStateCreateInfo(1, &bindingDescription, 1, &attributeDescription);
 	pipelineCreateInfo.pVertexInputState = &vertexInputStateInfo; // vertex input bindings / attributes from gltf model
 
-	if (vkCreateGraphicsPipelines(vkSetup->device, VK_NULL_HANDLE, 1, &pipelineCreateInfo, nullptr, &skyboxPipeline) != VK_SUCCESS) {
+	if (vkCreateGraphicsPipelines(vkSetup->device, vkSetup->pipelineCache, 1, &pipelineCreateInfo, nullptr, &skyboxPipeline) != VK_SUCCESS) {
 		throw std::runtime_error("Could not create deferred graphics pipeline!");
 	}
 
@@ -319,17 +364,3 @@ void GBuffer::createPipelines(VkDescriptorSetLayout* descriptorSetLayout, SwapCh
 	vkDestroyShaderModule(vkSetup->device, fragShaderModule, nullptr);
 }
 
-void GBuffer::updateOffScreenUniformBuffer(const GBuffer::OffScreenUbo& ubo) {
-	void* data;
-	vkMapMemory(vkSetup->device, offScreenUniform.memory, 0, sizeof(ubo), 0, &data);
-	memcpy(data, &ubo, sizeof(ubo));
-	vkUnmapMemory(vkSetup->device, offScreenUniform.memory);
-}
-
-void GBuffer::updateCompositionUniformBuffer(uint32_t imageIndex, const GBuffer::CompositionUBO& ubo) {
-	void* data;
-	vkMapMemory(vkSetup->device, compositionUniforms.memory, sizeof(ubo) * imageIndex, sizeof(ubo), 0, &data);
-	memcpy(data, &ubo, sizeof(ubo));
-	vkUnmapMemory(vkSetup->device, compositionUniforms.memory);
-}
-
@@ -5,6 +5,7 @@
 #include <hpg/Image.h>
 
 #include <utils/Print.h>
+#include <utils/Downsample.h> // getMipDimension
 
 // image loading
 #include <stb_image.h>
@@ -17,7 +18,7 @@ void VulkanImage::createImage(const VulkanSetup* vkSetup, const VkCommandPool& c
     imageInfo.extent.width  = info.width; // the dimensions of the image
     imageInfo.extent.height = info.height;
     imageInfo.extent.depth  = 1;
-    imageInfo.mipLevels     = 1; // mip mapping 
+    imageInfo.mipLevels     = info.mipLevels; // mip mapping 
     imageInfo.arrayLayers   = info.arrayLayers;
     imageInfo.format        = info.format; // same format as the pixels is best
     imageInfo.tiling        = info.tiling; // tiling of the pixels, let vulkan lay them out
@@ -36,25 +37,24 @@ void VulkanImage::createImage(const VulkanSetup* vkSetup, const VkCommandPool& c
     VkMemoryRequirements memRequirements;
     vkGetImageMemoryRequirements(vkSetup->device, info.pVulkanImage->image, &memRequirements);
 
-    VkMemoryAllocateInfo allocInfo{};
-    allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-    allocInfo.allocationSize = memRequirements.size;
-    allocInfo.memoryTypeIndex = utils::findMemoryType(&vkSetup->physicalDevice, memRequirements.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+    // optimal and linear resources are kept in separate blocks, so they never share a bufferImageGranularity page
+    MemoryAllocator::ResourceType resourceType = info.tiling == VK_IMAGE_TILING_OPTIMAL ? 
+        MemoryAllocator::ResourceType::OPTIMAL : MemoryAllocator::ResourceType::LINEAR;
+    info.pVulkanImage->allocation = vkSetup->allocator.allocate(memRequirements, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, resourceType,
+        info.category);
 
-    if (vkAllocateMemory(vkSetup->device, &allocInfo, nullptr, &info.pVulkanImage->imageMemory) != VK_SUCCESS) {
-        throw std::runtime_error("failed to allocate image memory!");
-    }
-
-    vkBindImageMemory(vkSetup->device, info.pVulkanImage->image, info.pVulkanImage->imageMemory, 0);
+    vkBindImageMemory(vkSetup->device, info.pVulkanImage->image, info.pVulkanImage->allocation.memory, info.pVulkanImage->allocation.offset);
 
-    // update the image's format
-    info.pVulkanImage->format = info.format;
+    // update the image's format and dimensions
+    info.pVulkanImage->extent    = { info.width, info.height };
+    info.pVulkanImage->format    = info.format;
+    info.pVulkanImage->mipLevels = info.mipLevels;
 }
 
 void VulkanImage::cleanupImage(const VulkanSetup* vkSetup) {
     // destroy the texture image and its memory
     vkDestroyImage(vkSetup->device, image, nullptr);
-    vkFreeMemory(vkSetup->device, imageMemory, nullptr);
+    vkSetup->allocator.free(allocation);
 }
 
 VkImageView VulkanImage::createImageView(const VulkanSetup* vkSetup, const VkImageViewCreateInfo& imageViewCreateInfo) {
@@ -97,7 +97,7 @@ void VulkanImage::transitionImageLayout(const VulkanSetup* vkSetup, const Vulkan
 
     // mip mapping
     barrier.subresourceRange.baseMipLevel = 0;
-    barrier.subresourceRange.levelCount = 1;
+    barrier.subresourceRange.levelCount = transitionData.mipLevels;
     // image array
     barrier.subresourceRange.baseArrayLayer = 0;
     barrier.subresourceRange.layerCount = transitionData.arrayLayers;
@@ -167,17 +167,14 @@ Image VulkanImage::loadImageFromFile(const std::string& path) {
         throw std::runtime_error("could not load image!");
     }
 
-    // allocate memory, make a copy, then delete original
-    image.imageData.data = (unsigned char*)malloc(width * height * channels * sizeof(unsigned char));
-    memcpy(image.imageData.data, data, width * height * channels);
-    stbi_image_free(data);
-
+    // the image keeps stb_image's buffer rather than a copy of it
+    image.imageData.data = data;
     image.width = width;
     image.height = height;
-    image.imageData.size = image.width * image.height * channels * sizeof(unsigned char);
+    image.imageData.size = static_cast<size_t>(image.width) * image.height * channels;
     image.format = getImageFormat(channels);
         
-    // !!PIXELS NEED TO BE FREED!! do so when no longer in use at the end of application lifecycle
+    // !!PIXELS NEED TO BE FREED!! with stbi_image_free, as soon as the upload is queued
     return image;
 }
 
@@ -196,11 +193,53 @@ VkFormat VulkanImage::getImageFormat(int numChannels) {
     }
 }
 
+UI32 VulkanImage::getFormatTexelSize(VkFormat format) {
+    switch (format) {
+    case VK_FORMAT_R8_SRGB:
+    case VK_FORMAT_R8_UNORM:
+        return 1;
+    case VK_FORMAT_R8G8_SRGB:
+    case VK_FORMAT_R8G8_UNORM:
+        return 2;
+    case VK_FORMAT_R8G8B8_SRGB:
+    case VK_FORMAT_R8G8B8_UNORM:
+        return 3;
+    case VK_FORMAT_R8G8B8A8_SRGB:
+    case VK_FORMAT_R8G8B8A8_UNORM:
+        return 4;
+    case VK_FORMAT_R16G16B16A16_SFLOAT:
+        return 8;
+    case VK_FORMAT_R32G32B32A32_SFLOAT:
+        return 16;
+    case VK_FORMAT_BC1_RGB_UNORM_BLOCK:
+    case VK_FORMAT_BC1_RGB_SRGB_BLOCK:
+    case VK_FORMAT_BC1_RGBA_UNORM_BLOCK:
+    case VK_FORMAT_BC1_RGBA_SRGB_BLOCK:
+    case VK_FORMAT_BC4_UNORM_BLOCK:
+        return 8;
+    case VK_FORMAT_BC3_UNORM_BLOCK:
+    case VK_FORMAT_BC3_SRGB_BLOCK:
+    case VK_FORMAT_BC5_UNORM_BLOCK:
+    case VK_FORMAT_BC7_UNORM_BLOCK:
+    case VK_FORMAT_BC7_SRGB_BLOCK:
+        return 16;
+    default:
+        return 4;
+    }
+}
+
+bool VulkanImage::formatIsBlockCompressed(VkFormat format) {
+    // the BC formats are contiguous in the enumeration
+    return format >= VK_FORMAT_BC1_RGB_UNORM_BLOCK && format <= VK_FORMAT_BC7_SRGB_BLOCK;
+}
+
 VulkanImage::ImageFormatSupportDetails VulkanImage::queryFormatSupport(VkPhysicalDevice device, VkFormat format, VkImageType type,
     VkImageTiling tiling, VkImageUsageFlags usage, VkImageCreateFlags flags) {
     // given a set of desired image parameters, determine if a format is supported or not
     VulkanImage::ImageFormatSupportDetails details = { format, {} };
-    if (vkGetPhysicalDeviceImageFormatProperties(device, format, type, tiling, usage, flags, &details.properties) != VK_SUCCESS) {
+    details.supported = vkGetPhysicalDeviceImageFormatProperties(device, format, type, tiling, usage, flags, 
+        &details.properties) == VK_SUCCESS;
+    if (!details.supported) {
         PRINT("!!! format %i not supported !!!\n", format);
     }
     return details;
@@ -217,4 +256,63 @@ VkBool32 VulkanImage::formatIsFilterable(VkPhysicalDevice physicalDevice, VkForm
         return formatProps.linearTilingFeatures & VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT;
 
     return false;
-}
\ No newline at end of file
+}
+
+VkBool32 VulkanImage::formatIsBlittable(VkPhysicalDevice physicalDevice, VkFormat format) {
+    VkFormatProperties formatProps;
+    vkGetPhysicalDeviceFormatProperties(physicalDevice, format, &formatProps);
+
+    VkFormatFeatureFlags blitFeatures = VK_FORMAT_FEATURE_BLIT_SRC_BIT | VK_FORMAT_FEATURE_BLIT_DST_BIT;
+    return (formatProps.optimalTilingFeatures & blitFeatures) == blitFeatures;
+}
+
+bool VulkanImage::formatHasByteChannels(VkFormat format) {
+    switch (format) {
+    case VK_FORMAT_R8_SRGB:
+    case VK_FORMAT_R8_UNORM:
+    case VK_FORMAT_R8G8_SRGB:
+    case VK_FORMAT_R8G8_UNORM:
+    case VK_FORMAT_R8G8B8_SRGB:
+    case VK_FORMAT_R8G8B8_UNORM:
+    case VK_FORMAT_R8G8B8A8_SRGB:
+    case VK_FORMAT_R8G8B8A8_UNORM:
+    case VK_FORMAT_B8G8R8A8_SRGB:
+    case VK_FORMAT_B8G8R8A8_UNORM:
+        return true;
+    default:
+        return false;
+    }
+}
+
+UI32 VulkanImage::getMipLevels(UI32 width, UI32 height) {
+    UI32 levels = 1;
+    for (UI32 size = width > height ? width : height; size > 1; size >>= 1) {
+        levels++;
+    }
+    return levels;
+}
+
+VkDeviceSize VulkanImage::getLevelSize(VkFormat format, UI32 width, UI32 height) {
+    VkDeviceSize texelSize = getFormatTexelSize(format);
+    if (formatIsBlockCompressed(format)) {
+        // partial blocks at the right and bottom edges are stored whole
+        return texelSize * ((width + 3) / 4) * ((height + 3) / 4);
+    }
+    return texelSize * width * height;
+}
+
+std::vector<VkBufferImageCopy> VulkanImage::getUploadRegions(const Image& image) {
+    std::vector<VkBufferImageCopy> regions;
+    UI32 numLevels = image.levelOffsets.empty() ? 1 : static_cast<UI32>(image.levelOffsets.size());
+    for (UI32 level = 0; level < numLevels; level++) {
+        UI32 width  = utils::getMipDimension(image.width, level);
+        UI32 height = utils::getMipDimension(image.height, level);
+        VkDeviceSize offset = image.levelOffsets.empty() ? 0 : image.levelOffsets[level];
+        VkDeviceSize layerSize = getLevelSize(image.format, width, height);
+        for (UI32 layer = 0; layer < image.arrayLayers; layer++) {
+            regions.push_back({ offset + layer * layerSize, 0, 0, { VK_IMAGE_ASPECT_COLOR_BIT, level, layer, 1 }, 
+                { 0, 0, 0 }, { width, height, 1 } });
+        }
+    }
+    return regions;
+}
@@ -0,0 +1,425 @@
+//
+// Definition of the MemoryAllocator class
+//
+
+#include <hpg/MemoryAllocator.h>
+
+#include <utils/Print.h>
+
+#include <algorithm> // max, copy
+#include <fstream>
+#include <stdexcept>
+
+static inline VkDeviceSize alignUp(VkDeviceSize value, VkDeviceSize alignment) {
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+void MemoryAllocator::init(VkPhysicalDevice thePhysicalDevice, VkDevice theDevice, VkDeviceSize theBlockSize) {
+    physicalDevice = thePhysicalDevice;
+    device = theDevice;
+    blockSize = theBlockSize;
+    vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memoryProperties);
+
+    VkPhysicalDeviceProperties properties;
+    vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+    nonCoherentAtomSize = std::max(properties.limits.nonCoherentAtomSize, static_cast<VkDeviceSize>(1));
+}
+
+void MemoryAllocator::enableMemoryBudget(VkInstance instance) {
+    // an instance extension on vulkan 1.0, the function has to be loaded
+    vkGetPhysicalDeviceMemoryProperties2KHR = reinterpret_cast<PFN_vkGetPhysicalDeviceMemoryProperties2KHR>(
+        vkGetInstanceProcAddr(instance, "vkGetPhysicalDeviceMemoryProperties2KHR"));
+}
+
+void MemoryAllocator::cleanup() {
+    std::lock_guard<std::mutex> lock(mutex);
+    for (auto& block : blocks) {
+        if (block->numAllocations > 0) {
+            PRINT("memory allocator: %u allocations leaked in a block of memory type %u\n", block->numAllocations, block->memoryType);
+        }
+        if (block->mapped) {
+            vkUnmapMemory(device, block->memory);
+        }
+        vkFreeMemory(device, block->memory, nullptr);
+    }
+    blocks.clear();
+    numDeviceAllocations = 0;
+}
+
+MemoryAllocator::Allocation MemoryAllocator::allocate(const VkMemoryRequirements& requirements, VkMemoryPropertyFlags properties,
+    ResourceType resourceType, Category category) {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    UI32 memoryType = findMemoryType(requirements.memoryTypeBits, properties);
+    VkMemoryPropertyFlags flags = memoryProperties.memoryTypes[memoryType].propertyFlags;
+
+    // host writes to non coherent memory are flushed in multiples of the atom size, which must not overlap another allocation
+    VkDeviceSize alignment = std::max(requirements.alignment, static_cast<VkDeviceSize>(1));
+    VkDeviceSize size = requirements.size;
+    if ((flags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) && !(flags & VK_MEMORY_PROPERTY_HOST_COHERENT_BIT)) {
+        alignment = std::max(alignment, nonCoherentAtomSize);
+        size = alignUp(size, nonCoherentAtomSize);
+    }
+
+    Allocation allocation{};
+    allocation.category = category;
+
+    // large resources get a block of their own rather than wasting most of a shared one
+    if (size > blockSize / 2) {
+        Block* block = createBlock(memoryType, size, resourceType, true);
+        allocateFromBlock(block, size, alignment, allocation);
+        allocation.allocator = this;
+        return allocation;
+    }
+
+    for (auto& block : blocks) {
+        if (block->memoryType == memoryType && block->resourceType == resourceType && !block->dedicated &&
+            allocateFromBlock(block.get(), size, alignment, allocation)) {
+            allocation.allocator = this;
+            return allocation;
+        }
+    }
+
+    Block* block = createBlock(memoryType, blockSize, resourceType, false);
+    if (!allocateFromBlock(block, size, alignment, allocation)) {
+        throw std::runtime_error("failed to sub-allocate from a new memory block!");
+    }
+    allocation.allocator = this;
+    return allocation;
+}
+
+void MemoryAllocator::free(Allocation& allocation) {
+    if (!allocation.block) {
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+    Block* block = allocation.block;
+
+    CategoryStats& stats = categoryStats[static_cast<size_t>(allocation.category)];
+    stats.numAllocations--;
+    stats.bytes -= allocation.size;
+
+    // insert the range in offset order and merge it with the free ranges either side
+    auto next = std::lower_bound(block->freeRanges.begin(), block->freeRanges.end(), allocation.offset,
+        [](const Range& range, VkDeviceSize offset) { return range.offset < offset; });
+    Range range = { allocation.offset, allocation.size };
+
+    if (next != block->freeRanges.end() && range.offset + range.size == next->offset) {
+        range.size += next->size;
+        next = block->freeRanges.erase(next);
+    }
+    if (next != block->freeRanges.begin()) {
+        auto previous = next - 1;
+        if (previous->offset + previous->size == range.offset) {
+            previous->size += range.size;
+            range.size = 0;
+        }
+    }
+    if (range.size > 0) {
+        block->freeRanges.insert(next, range);
+    }
+
+    block->numAllocations--;
+    allocation = Allocation{};
+
+    if (block->numAllocations > 0) {
+        return;
+    }
+
+    // keep one empty block of each kind around so alternately creating and freeing a resource does not hit the driver
+    bool spare = !block->dedicated;
+    for (auto& other : blocks) {
+        if (other.get() != block && other->memoryType == block->memoryType && other->resourceType == block->resourceType &&
+            !other->dedicated) {
+            spare = false;
+            break;
+        }
+    }
+    if (!spare) {
+        destroyBlock(block);
+    }
+}
+
+std::vector<MemoryAllocator::Stats> MemoryAllocator::getStats() {
+    std::vector<Stats> stats(VK_MAX_MEMORY_TYPES);
+    stats.resize(getStats(stats.data()));
+    return stats;
+}
+
+UI32 MemoryAllocator::getStats(Stats* stats) {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    UI32 numStats = 0;
+    for (UI32 type = 0; type < memoryProperties.memoryTypeCount; type++) {
+        Stats typeStats{};
+        typeStats.memoryType = type;
+        VkDeviceSize freeBytes = 0;
+        VkDeviceSize largestFreeBytes = 0; // sum of the largest free range of each block, free space split across blocks is expected
+
+        for (auto& block : blocks) {
+            if (block->memoryType != type) {
+                continue;
+            }
+            typeStats.numBlocks++;
+            typeStats.numAllocations += block->numAllocations;
+            typeStats.numFreeRanges += static_cast<UI32>(block->freeRanges.size());
+            typeStats.blockBytes += block->size;
+            VkDeviceSize blockLargest = 0;
+            for (const Range& range : block->freeRanges) {
+                freeBytes += range.size;
+                blockLargest = std::max(blockLargest, range.size);
+            }
+            largestFreeBytes += blockLargest;
+            typeStats.largestFreeRange = std::max(typeStats.largestFreeRange, blockLargest);
+        }
+
+        if (typeStats.numBlocks == 0) {
+            continue;
+        }
+        typeStats.usedBytes = typeStats.blockBytes - freeBytes;
+        typeStats.fragmentation = freeBytes > 0 ? 1.0f - static_cast<F32>(largestFreeBytes) / freeBytes : 0.0f;
+        stats[numStats++] = typeStats;
+    }
+    return numStats;
+}
+
+std::vector<MemoryAllocator::CategoryStats> MemoryAllocator::getCategoryStats() {
+    std::vector<CategoryStats> stats(static_cast<size_t>(Category::COUNT));
+    getCategoryStats(stats.data());
+    return stats;
+}
+
+UI32 MemoryAllocator::getCategoryStats(CategoryStats* stats) {
+    std::lock_guard<std::mutex> lock(mutex);
+    std::copy(categoryStats, categoryStats + static_cast<size_t>(Category::COUNT), stats);
+    return static_cast<UI32>(Category::COUNT);
+}
+
+std::vector<MemoryAllocator::HeapBudget> MemoryAllocator::getHeapBudgets() {
+    std::vector<HeapBudget> budgets(VK_MAX_MEMORY_HEAPS);
+    budgets.resize(getHeapBudgets(budgets.data()));
+    return budgets;
+}
+
+UI32 MemoryAllocator::getHeapBudgets(HeapBudget* budgets) {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    for (UI32 heap = 0; heap < memoryProperties.memoryHeapCount; heap++) {
+        budgets[heap] = HeapBudget{};
+        budgets[heap].size = memoryProperties.memoryHeaps[heap].size;
+        budgets[heap].deviceLocal = (memoryProperties.memoryHeaps[heap].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT) != 0;
+    }
+    for (auto& block : blocks) {
+        budgets[memoryProperties.memoryTypes[block->memoryType].heapIndex].allocatorBytes += block->size;
+    }
+
+    if (vkGetPhysicalDeviceMemoryProperties2KHR) {
+        VkPhysicalDeviceMemoryBudgetPropertiesEXT budgetProperties{};
+        budgetProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_BUDGET_PROPERTIES_EXT;
+
+        VkPhysicalDeviceMemoryProperties2 properties{};
+        properties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_PROPERTIES_2;
+        properties.pNext = &budgetProperties;
+
+        vkGetPhysicalDeviceMemoryProperties2KHR(physicalDevice, &properties);
+
+        for (UI32 heap = 0; heap < memoryProperties.memoryHeapCount; heap++) {
+            budgets[heap].budget = budgetProperties.heapBudget[heap];
+            budgets[heap].usage = budgetProperties.heapUsage[heap];
+        }
+    }
+    else {
+        for (UI32 heap = 0; heap < memoryProperties.memoryHeapCount; heap++) {
+            budgets[heap].budget = budgets[heap].size / 10 * 8;
+            budgets[heap].usage = budgets[heap].allocatorBytes;
+        }
+    }
+    return memoryProperties.memoryHeapCount;
+}
+
+void MemoryAllocator::printStats() {
+    std::vector<Stats> stats = getStats();
+    PRINT("memory allocator: %u device allocations\n", numDeviceAllocations);
+    for (const Stats& s : stats) {
+        PRINT("  type %2u: %3u blocks, %5u allocations, %8.2f / %8.2f MB used, %4u free ranges, fragmentation %.2f\n",
+            s.memoryType, s.numBlocks, s.numAllocations, s.usedBytes / (1024.0f * 1024.0f), s.blockBytes / (1024.0f * 1024.0f),
+            s.numFreeRanges, s.fragmentation);
+    }
+
+    std::vector<CategoryStats> categories = getCategoryStats();
+    for (size_t i = 0; i < categories.size(); i++) {
+        PRINT("  %-10s: %5u allocations, %8.2f MB (peak %.2f MB)\n", getCategoryName(static_cast<Category>(i)),
+            categories[i].numAllocations, categories[i].bytes / (1024.0f * 1024.0f), categories[i].peakBytes / (1024.0f * 1024.0f));
+    }
+
+    std::vector<HeapBudget> budgets = getHeapBudgets();
+    for (size_t i = 0; i < budgets.size(); i++) {
+        PRINT("  heap %zu%s: %8.2f / %8.2f MB budget (%s), %8.2f MB in blocks\n", i, budgets[i].deviceLocal ? " (device local)" : "",
+            budgets[i].usage / (1024.0f * 1024.0f), budgets[i].budget / (1024.0f * 1024.0f), hasMemoryBudget() ? "reported" : "estimated",
+            budgets[i].allocatorBytes / (1024.0f * 1024.0f));
+    }
+}
+
+void MemoryAllocator::dumpJson(const std::string& path) {
+    std::ofstream out(path, std::ios::trunc);
+    if (!out) {
+        throw std::runtime_error("failed to open " + path + " for writing!");
+    }
+
+    out << "{\n";
+    out << "    \"deviceAllocations\": " << numDeviceAllocations << ",\n";
+    out << "    \"budgetReported\": " << (hasMemoryBudget() ? "true" : "false") << ",\n";
+
+    std::vector<HeapBudget> budgets = getHeapBudgets();
+    out << "    \"heaps\": [\n";
+    for (size_t i = 0; i < budgets.size(); i++) {
+        out << "        { \"index\": " << i << ", \"deviceLocal\": " << (budgets[i].deviceLocal ? "true" : "false") 
+            << ", \"size\": " << budgets[i].size << ", \"budget\": " << budgets[i].budget << ", \"usage\": " << budgets[i].usage 
+            << ", \"allocatorBytes\": " << budgets[i].allocatorBytes << " }" << (i + 1 < budgets.size() ? "," : "") << "\n";
+    }
+    out << "    ],\n";
+
+    std::vector<CategoryStats> categories = getCategoryStats();
+    out << "    \"categories\": [\n";
+    for (size_t i = 0; i < categories.size(); i++) {
+        out << "        { \"name\": \"" << getCategoryName(static_cast<Category>(i)) << "\", \"allocations\": " 
+            << categories[i].numAllocations << ", \"bytes\": " << categories[i].bytes << ", \"peakBytes\": " 
+            << categories[i].peakBytes << " }" << (i + 1 < categories.size() ? "," : "") << "\n";
+    }
+    out << "    ],\n";
+
+    std::vector<Stats> stats = getStats();
+    out << "    \"memoryTypes\": [\n";
+    for (size_t i = 0; i < stats.size(); i++) {
+        out << "        { \"index\": " << stats[i].memoryType << ", \"heap\": " << memoryProperties.memoryTypes[stats[i].memoryType].heapIndex
+            << ", \"blocks\": " << stats[i].numBlocks << ", \"allocations\": " << stats[i].numAllocations << ", \"blockBytes\": " 
+            << stats[i].blockBytes << ", \"usedBytes\": " << stats[i].usedBytes << ", \"fragmentation\": " << stats[i].fragmentation 
+            << " }" << (i + 1 < stats.size() ? "," : "") << "\n";
+    }
+    out << "    ]\n";
+    out << "}\n";
+}
+
+const char* MemoryAllocator::getCategoryName(Category category) {
+    switch (category) {
+    case Category::TEXTURE:
+        return "texture";
+    case Category::GEOMETRY:
+        return "geometry";
+    case Category::ATTACHMENT:
+        return "attachment";
+    case Category::SHADOW_MAP:
+        return "shadow map";
+    case Category::UNIFORM:
+        return "uniform";
+    case Category::STAGING:
+        return "staging";
+    default:
+        return "other";
+    }
+}
+
+UI32 MemoryAllocator::findMemoryType(UI32 typeFilter, VkMemoryPropertyFlags properties) const {
+    for (UI32 i = 0; i < memoryProperties.memoryTypeCount; i++) {
+        if ((typeFilter & (1 << i)) && (memoryProperties.memoryTypes[i].propertyFlags & properties) == properties) {
+            return i;
+        }
+    }
+    throw std::runtime_error("failed to find suitable memory type!");
+}
+
+MemoryAllocator::Block* MemoryAllocator::createBlock(UI32 memoryType, VkDeviceSize size, ResourceType resourceType, bool dedicated) {
+    VkMemoryAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+    allocInfo.allocationSize = size;
+    allocInfo.memoryTypeIndex = memoryType;
+
+    std::unique_ptr<Block> block = std::make_unique<Block>();
+    if (vkAllocateMemory(device, &allocInfo, nullptr, &block->memory) != VK_SUCCESS) {
+        throw std::runtime_error("failed to allocate a memory block!");
+    }
+    numDeviceAllocations++;
+
+    block->size = size;
+    block->memoryType = memoryType;
+    block->resourceType = resourceType;
+    block->dedicated = dedicated;
+    block->mapped = nullptr;
+    block->numAllocations = 0;
+    block->freeRanges.push_back({ 0, size });
+
+    // persistently mapped, a memory object can only be mapped once so the allocations share this mapping
+    if (memoryProperties.memoryTypes[memoryType].propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) {
+        void* data;
+        if (vkMapMemory(device, block->memory, 0, VK_WHOLE_SIZE, 0, &data) != VK_SUCCESS) {
+            // the block is not tracked yet, its memory would leak
+            vkFreeMemory(device, block->memory, nullptr);
+            numDeviceAllocations--;
+            throw std::runtime_error("failed to map a memory block!");
+        }
+        block->mapped = static_cast<unsigned char*>(data);
+    }
+
+    blocks.push_back(std::move(block));
+    return blocks.back().get();
+}
+
+void MemoryAllocator::destroyBlock(Block* block) {
+    if (block->mapped) {
+        vkUnmapMemory(device, block->memory);
+    }
+    vkFreeMemory(device, block->memory, nullptr);
+    numDeviceAllocations--;
+
+    blocks.erase(std::find_if(blocks.begin(), blocks.end(), [block](const std::unique_ptr<Block>& b) { return b.get() == block; }));
+}
+
+bool MemoryAllocator::allocateFromBlock(Block* block, VkDeviceSize size, VkDeviceSize alignment, Allocation& allocation) {
+    // best fit, the free range left with the least space after the aligned allocation. The alignment padding is
+    // counted as used, a range whose start needs padding fits less than its size suggests. Linear and optimal
+    // resources never share a block, so there is no bufferImageGranularity padding to add
+    auto best = block->freeRanges.end();
+    VkDeviceSize bestWaste = ~static_cast<VkDeviceSize>(0);
+    for (auto range = block->freeRanges.begin(); range != block->freeRanges.end(); range++) {
+        VkDeviceSize offset = alignUp(range->offset, alignment);
+        if (offset + size > range->offset + range->size) {
+            continue;
+        }
+        VkDeviceSize waste = range->offset + range->size - (offset + size);
+        if (waste < bestWaste) {
+            best = range;
+            bestWaste = waste;
+        }
+    }
+
+    if (best == block->freeRanges.end()) {
+        return false;
+    }
+
+    // the alignment padding stays free, before the allocation, as does whatever is left after it
+    Range range = *best;
+    VkDeviceSize offset = alignUp(range.offset, alignment);
+    VkDeviceSize end = offset + size;
+    best = block->freeRanges.erase(best);
+    if (end < range.offset + range.size) {
+        best = block->freeRanges.insert(best, { end, range.offset + range.size - end });
+    }
+    if (offset > range.offset) {
+        block->freeRanges.insert(best, { range.offset, offset - range.offset });
+    }
+
+    block->numAllocations++;
+
+    CategoryStats& stats = categoryStats[static_cast<size_t>(allocation.category)];
+    stats.numAllocations++;
+    stats.bytes += size;
+    stats.peakBytes = std::max(stats.peakBytes, stats.bytes);
+
+    allocation.memory = block->memory;
+    allocation.offset = offset;
+    allocation.size = size;
+    allocation.mapped = block->mapped ? block->mapped + offset : nullptr;
+    allocation.block = block;
+    return true;
+}
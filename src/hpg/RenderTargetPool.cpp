@@ -0,0 +1,167 @@
+//
+// Definition of the RenderTargetPool class
+//
+
+#include <hpg/RenderTargetPool.h>
+
+#include <utils/Utils.h>
+
+#include <algorithm> // find
+#include <stdexcept>
+
+void RenderTargetPool::createRenderTargetPool(const VulkanSetup* pVkSetup) {
+    vkSetup = pVkSetup;
+
+    VkPhysicalDeviceMemoryProperties memoryProperties;
+    vkGetPhysicalDeviceMemoryProperties(vkSetup->physicalDevice, &memoryProperties);
+
+    lazyMemoryTypeBits = 0;
+    for (UI32 i = 0; i < memoryProperties.memoryTypeCount; i++) {
+        if (memoryProperties.memoryTypes[i].propertyFlags & VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT) {
+            lazyMemoryTypeBits |= 1 << i;
+        }
+    }
+}
+
+void RenderTargetPool::cleanupRenderTargetPool() {
+    if (!targets.empty()) {
+        throw std::runtime_error("render targets are still alive!");
+    }
+}
+
+void RenderTargetPool::createTarget(const RenderTargetPool::TargetInfo& info) {
+    VkImageUsageFlags usage = info.usage;
+    if (info.transient) {
+        const VkImageUsageFlags attachmentUsage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | 
+            VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_INPUT_ATTACHMENT_BIT;
+        if (usage & ~attachmentUsage) {
+            throw std::runtime_error("transient render targets can only be used as attachments!");
+        }
+        usage |= VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT;
+    }
+
+    VkImageCreateInfo imageInfo{};
+    imageInfo.sType         = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+    imageInfo.imageType     = VK_IMAGE_TYPE_2D;
+    imageInfo.extent.width  = info.width;
+    imageInfo.extent.height = info.height;
+    imageInfo.extent.depth  = 1;
+    imageInfo.mipLevels     = 1;
+    imageInfo.arrayLayers   = 1;
+    imageInfo.format        = info.format;
+    imageInfo.tiling        = VK_IMAGE_TILING_OPTIMAL;
+    imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    imageInfo.usage         = usage;
+    imageInfo.samples       = VK_SAMPLE_COUNT_1_BIT;
+    imageInfo.sharingMode   = VK_SHARING_MODE_EXCLUSIVE;
+
+    VkImage image;
+    if (vkCreateImage(vkSetup->device, &imageInfo, nullptr, &image) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create render target image!");
+    }
+
+    VkMemoryRequirements memRequirements;
+    vkGetImageMemoryRequirements(vkSetup->device, image, &memRequirements);
+
+    // lazily allocated types are only reported for transient images
+    VkMemoryPropertyFlags properties = (memRequirements.memoryTypeBits & lazyMemoryTypeBits) ? 
+        VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT : VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
+
+    Slot* slot = findSlot(memRequirements, properties, info.firstPass, info.lastPass);
+    if (!slot) {
+        slots.push_back(std::make_unique<Slot>());
+        slot = slots.back().get();
+        slot->allocation     = vkSetup->allocator.allocate(memRequirements, properties, 
+            MemoryAllocator::ResourceType::OPTIMAL, MemoryAllocator::Category::ATTACHMENT);
+        slot->memoryTypeBits = memRequirements.memoryTypeBits;
+        slot->properties     = properties;
+    }
+
+    vkBindImageMemory(vkSetup->device, image, slot->allocation.memory, slot->allocation.offset);
+    slot->users.push_back(image);
+    targets[image] = { slot, memRequirements.size, info.firstPass, info.lastPass };
+
+    // the pool owns the memory, the image's allocation stays empty
+    info.pVulkanImage->image  = image;
+    info.pVulkanImage->format = info.format;
+
+    VkImageViewCreateInfo imageViewCreateInfo = utils::initImageViewCreateInfo(image,
+        VK_IMAGE_VIEW_TYPE_2D, info.format, {}, { info.aspect, 0, 1, 0, 1 });
+    *info.pImageView = VulkanImage::createImageView(vkSetup, imageViewCreateInfo);
+}
+
+void RenderTargetPool::destroyTarget(VkImage image, VkImageView imageView) {
+    auto target = targets.find(image);
+    if (target == targets.end()) {
+        throw std::runtime_error("image is not a render target of the pool!");
+    }
+
+    vkDestroyImageView(vkSetup->device, imageView, nullptr);
+    vkDestroyImage(vkSetup->device, image, nullptr);
+
+    Slot* slot = target->second.slot;
+    slot->users.erase(std::find(slot->users.begin(), slot->users.end(), image));
+    targets.erase(target);
+
+    // the memory goes back to the allocator once no target is bound to it
+    if (slot->users.empty()) {
+        vkSetup->allocator.free(slot->allocation);
+        slots.erase(std::find_if(slots.begin(), slots.end(), 
+            [slot](const std::unique_ptr<Slot>& other) { return other.get() == slot; }));
+    }
+}
+
+void RenderTargetPool::releaseTarget(VkImage image, VkImageView imageView, DeletionQueue* deletionQueue) {
+    // the target stays a user of its slot until then, so targets created meanwhile cannot alias it
+    deletionQueue->push([this, image, imageView]() {
+        destroyTarget(image, imageView);
+    });
+}
+
+RenderTargetPool::Stats RenderTargetPool::getStats() const {
+    Stats stats{};
+    stats.numTargets = static_cast<UI32>(targets.size());
+    stats.numSlots   = static_cast<UI32>(slots.size());
+
+    for (const auto& target : targets) {
+        stats.requestedBytes += target.second.size;
+    }
+
+    for (const auto& slot : slots) {
+        stats.allocatedBytes += slot->allocation.size;
+        if (slot->properties & VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT) {
+            stats.lazyBytes += slot->allocation.size;
+        }
+    }
+
+    // a slot keeps the size of the target it was allocated for, which can be larger than the targets left in it
+    VkDeviceSize committedBytes = stats.allocatedBytes - stats.lazyBytes;
+    stats.savedBytes = stats.requestedBytes > committedBytes ? stats.requestedBytes - committedBytes : 0;
+
+    return stats;
+}
+
+RenderTargetPool::Slot* RenderTargetPool::findSlot(const VkMemoryRequirements& requirements, VkMemoryPropertyFlags properties,
+    Pass firstPass, Pass lastPass) {
+    for (auto& slot : slots) {
+        // identical type bits and properties guarantee the allocator picked a type the image can use
+        if (slot->memoryTypeBits != requirements.memoryTypeBits || slot->properties != properties ||
+            slot->allocation.size < requirements.size || slot->allocation.offset % requirements.alignment != 0) {
+            continue;
+        }
+
+        bool disjoint = true;
+        for (VkImage user : slot->users) {
+            const Target& target = targets.at(user);
+            if (firstPass <= target.lastPass && target.firstPass <= lastPass) {
+                disjoint = false;
+                break;
+            }
+        }
+
+        if (disjoint) {
+            return slot.get();
+        }
+    }
+    return nullptr;
+}
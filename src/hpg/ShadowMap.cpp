@@ -17,15 +17,9 @@ void ShadowMap::createShadowMap(VulkanSetup* pVkSetup, VkDescriptorSetLayout* de
 	createShadowMapFrameBuffer();
 
 	createShadowMapPipeline(descriptorSetLayout, model);
-
-	// uniform buffer
-	VulkanBuffer::createUniformBuffer<ShadowMap::UBO>(vkSetup, 1, &shadowMapUniformBuffer,
-		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
 }
 
 void ShadowMap::cleanupShadowMap() {
-	shadowMapUniformBuffer.cleanupBufferData(vkSetup->device);
-
 	vkDestroySampler(vkSetup->device, depthSampler, nullptr);
 
 	vkDestroyFramebuffer(vkSetup->device, shadowMapFrameBuffer, nullptr);
@@ -47,6 +41,7 @@ void ShadowMap::createAttachment(const VkCommandPool& cmdPool) {
 	info.format = format;
 	info.tiling = VK_IMAGE_TILING_OPTIMAL;
 	info.usage = VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+	info.category = MemoryAllocator::Category::SHADOW_MAP;
 	info.pVulkanImage = &vulkanImage;
 
 	VulkanImage::createImage(vkSetup, cmdPool, info);
@@ -195,7 +190,8 @@ void ShadowMap::createShadowMapPipeline(VkDescriptorSetLayout* descriptorSetLayo
 
 	VkShaderModule vertShaderModule; // , fragShaderModule;
 	std::array<VkPipelineShaderStageCreateInfo, 1> shaderStages;
-	vertShaderModule = Shader::createShaderModule(vkSetup, Shader::readFile(SHADOWMAP_VERT_SHADER));
+	vertShaderModule = Shader::createShaderModule(vkSetup, Shader::readFile(
+		model->getVertexFormat() == Model::VertexFormat::PACKED ? SHADOWMAP_PACKED_VERT_SHADER : SHADOWMAP_VERT_SHADER));
 	//fragShaderModule = Shader::createShaderModule(vkSetup, Shader::readFile(SHADOWMAP_FRAG_SHADER));
 	shaderStages[0] = utils::initPipelineShaderStageCreateInfo(VK_SHADER_STAGE_VERTEX_BIT, vertShaderModule, "main");
 	//shaderStages[1] = utils::initPipelineShaderStageCreateInfo(VK_SHADER_STAGE_FRAGMENT_BIT, fragShaderModule, "main");
@@ -213,17 +209,10 @@ void ShadowMap::createShadowMapPipeline(VkDescriptorSetLayout* descriptorSetLayo
 	graphicsPipelineCreateInfo.pVertexInputState   = &vertexInputStateCreateInfo; // vertex input bindings / attributes from gltf model
 	graphicsPipelineCreateInfo.renderPass = shadowMapRenderPass;
 
-	if (vkCreateGraphicsPipelines(vkSetup->device, VK_NULL_HANDLE, 1, &graphicsPipelineCreateInfo, nullptr, &shadowMapPipeline) != VK_SUCCESS) {
+	if (vkCreateGraphicsPipelines(vkSetup->device, vkSetup->pipelineCache, 1, &graphicsPipelineCreateInfo, nullptr, &shadowMapPipeline) != VK_SUCCESS) {
 		throw std::runtime_error("Could not create deferred graphics pipeline!");
 	}
 
 	vkDestroyShaderModule(vkSetup->device, vertShaderModule, nullptr);
 	//vkDestroyShaderModule(vkSetup->device, fragShaderModule, nullptr);
-}
-
-void ShadowMap::updateShadowMapUniformBuffer(const ShadowMap::UBO& ubo) {
-	void* data;
-	vkMapMemory(vkSetup->device, shadowMapUniformBuffer.memory, 0, sizeof(ubo), 0, &data);
-	memcpy(data, &ubo, sizeof(ubo));
-	vkUnmapMemory(vkSetup->device, shadowMapUniformBuffer.memory);
 }
\ No newline at end of file
@@ -7,31 +7,33 @@
 #include <app/AppConstants.h>
 
 #include <utils/Print.h>
+#include <utils/Ktx2File.h> // compressed cube maps
+#include <utils/BlockCompression.h> // decoding when the device lacks bc formats
+#include <utils/ImageDecoder.h> // png faces
 
 #include <hpg/Skybox.h>
 #include <hpg/Buffers.h>
 
 #include <stb_image.h>
 
-void Skybox::createSkybox(VulkanSetup* pVkSetup, const VkCommandPool& commandPool) {
+#include <cstring> // memcpy
+#include <fstream> // ktx2 file check
+
+void Skybox::createSkybox(VulkanSetup* pVkSetup, UploadManager* uploadManager, ThreadPool* pool) {
     vkSetup = pVkSetup;
 
-    createSkyboxImage(commandPool);
+    createSkyboxImage(uploadManager, pool);
 
     createSkyboxImageView();
 
     createSkyboxSampler();
 
-    VulkanBuffer::createDeviceLocalBuffer(vkSetup, commandPool,
-        Buffer{ (unsigned char*)Skybox::cubeVerts, 36 * sizeof(glm::vec3) }, // vertex data as buffer of bytes
+    uploadManager->createDeviceLocalBuffer(
+        { Buffer{ (unsigned char*)Skybox::cubeVerts, 36 * sizeof(glm::vec3) } }, // vertex data as buffer of bytes
         &vertexBuffer, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT);
-
-    VulkanBuffer::createUniformBuffer<Skybox::UBO>(vkSetup, 1, &uniformBuffer,
-        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
 }
 
 void Skybox::cleanupSkybox() {
-    uniformBuffer.cleanupBufferData(vkSetup->device);
     vertexBuffer.cleanupBufferData(vkSetup->device);
 
     vkDestroySampler(vkSetup->device, skyboxSampler, nullptr);
@@ -41,59 +43,50 @@ void Skybox::cleanupSkybox() {
     skyboxImage.cleanupImage(vkSetup);
 }
 
-void Skybox::createSkyboxImage(const VkCommandPool& commandPool) {
-    // load the skybox data from the 6 images
+void Skybox::createSkyboxImage(UploadManager* uploadManager, ThreadPool* pool) {
     Image image{};
-    const char* faces[6] = { "Right.png", "Left.png", "Bottom.png", "Top.png", "Front.png", "Back.png" };
-
-    // query the dimensions of the file
-    int width, height, channels;
-    if (!stbi_info((SKYBOX_PATH + faces[0]).c_str(), &width, &height, &channels)) {
-        throw std::runtime_error("Could not load desired image file!");
+    Ktx2File ktx2;
+    ImageDecoder decoder(pool);
+
+    if (std::ifstream(SKYBOX_PATH + SKYBOX_KTX2).good()) {
+        // a compressed cube map with its mip chain, the faces are already in the order below
+        ktx2.load(SKYBOX_PATH + SKYBOX_KTX2);
+        image = ktx2.getImage();
+        if (image.arrayLayers != 6) {
+            throw std::runtime_error("skybox ktx2 file is not a cube map!");
+        }
     }
-
-    // use these to assign the width and height of the whole image, and allocate an array of bytes accordingly
-    image.height = height;
-    image.width = width;
-    image.format = VulkanImage::getImageFormat(channels);
-    image.imageData.size = height * width * channels * 6; // 6 images of dimensions w x h with pixels of n channels
-    image.imageData.data = (unsigned char*)malloc(image.imageData.size);
-
-    PRINT("size of array: %zi\n size of uc: %zi\n", image.imageData.size * sizeof(unsigned char), sizeof(unsigned char));
-
-    if (!image.imageData.data) {
-        throw std::runtime_error("Error, could not allocate memory!");
-    }
-
-    stbi_set_flip_vertically_on_load(true);
-
-    // for each face, load the pixels and copy them into the image data
-    uint32_t offset = 0;
-    for (int i = 0; i < 6; i++) {
-
-        unsigned char* data = stbi_load((SKYBOX_PATH + faces[i]).c_str(), &width, &height, &channels, 0);
-        if (!data) {
+    else {
+        // load the skybox data from the 6 images, the faces are decoded in parallel while the image is created
+        const char* faces[6] = { "Right.png", "Left.png", "Bottom.png", "Top.png", "Front.png", "Back.png" };
+        for (int i = 0; i < 6; i++) {
+            decoder.decodeFile(SKYBOX_PATH + faces[i], 0, true); // ids match the face indices
+        }
+
+        // query the dimensions of the file, every face must share them
+        int width, height, channels;
+        if (!stbi_info((SKYBOX_PATH + faces[0]).c_str(), &width, &height, &channels)) {
             throw std::runtime_error("Could not load desired image file!");
-        }        
-        memcpy(image.imageData.data + offset, data, height * width * channels);
-        stbi_image_free(data);
-        offset += height * width * channels;
+        }
+
+        // the faces are written to staging memory as they are decoded, there is no host copy of the whole cube map
+        image.height = height;
+        image.width = width;
+        image.format = VulkanImage::getImageFormat(channels);
+        image.arrayLayers = 6;
+        image.imageData = { nullptr, static_cast<size_t>(height) * width * channels * 6 }; // 6 images of w x h with n channels
     }
 
-    VulkanBuffer stagingBuffer{};
-
-    VulkanBuffer::CreateInfo createInfo{};
-    createInfo.size = image.imageData.size;
-    createInfo.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
-    createInfo.properties = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
-    createInfo.pVulkanBuffer = &stagingBuffer;
-
-    VulkanBuffer::createBuffer(vkSetup, &createInfo);
+    // block compressed faces are decoded on the host when the device cannot sample their format
+    std::vector<unsigned char> decodedData;
+    if (VulkanImage::formatIsBlockCompressed(image.format) && !VulkanImage::queryFormatSupport(vkSetup->physicalDevice, 
+        image.format, VK_IMAGE_TYPE_2D, VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, 
+        VK_IMAGE_CREATE_CUBE_COMPATIBLE_BIT).supported) {
+        image = utils::decodeImage(image, &decodedData);
+    }
 
-    void* data;
-    vkMapMemory(vkSetup->device, stagingBuffer.memory, 0, image.imageData.size, 0, &data);
-    memcpy(data, image.imageData.data, image.imageData.size);
-    vkUnmapMemory(vkSetup->device, stagingBuffer.memory);
+    // pre-built levels are uploaded as they are, otherwise the chain is generated from level 0
+    bool generateMips = image.levelOffsets.empty();
 
     // create the image and its memory
     VulkanImage::ImageCreateInfo imgCreateInfo{};
@@ -101,10 +94,15 @@ void Skybox::createSkyboxImage(const VkCommandPool& commandPool) {
     imgCreateInfo.height = image.height;
     imgCreateInfo.format = image.format;
     imgCreateInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
-    imgCreateInfo.usage = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+    // a generated mip chain is blitted from level 0, so the image is a transfer source too
+    imgCreateInfo.usage = VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT | 
+        (generateMips ? VK_IMAGE_USAGE_TRANSFER_SRC_BIT : 0);
     imgCreateInfo.arrayLayers = 6;
+    imgCreateInfo.mipLevels = generateMips ? VulkanImage::getMipLevels(image.width, image.height) : 
+        static_cast<UI32>(image.levelOffsets.size());
     imgCreateInfo.properties = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
     imgCreateInfo.flags = VK_IMAGE_CREATE_CUBE_COMPATIBLE_BIT;
+    imgCreateInfo.category = MemoryAllocator::Category::TEXTURE;
 
     imgCreateInfo.pVulkanImage = &skyboxImage;
 
@@ -117,48 +115,36 @@ void Skybox::createSkyboxImage(const VkCommandPool& commandPool) {
         PRINT("format %i details:\nmax array layers = %i\n", format, details.properties.maxArrayLayers);
     }
 
-    VulkanImage::createImage(vkSetup, commandPool, imgCreateInfo);
-
-    // copy host data to device
-    VulkanImage::LayoutTransitionInfo transitionData{};
-    transitionData.pVulkanImage = &skyboxImage;
-    transitionData.renderCommandPool = commandPool;
-    transitionData.format = image.format;
-    transitionData.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-    transitionData.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
-    transitionData.arrayLayers = 6;
-
-    VulkanImage::transitionImageLayout(vkSetup, transitionData); // specify the initial layout VK_IMAGE_LAYOUT_UNDEFINED
-
-    std::vector<VkBufferImageCopy> regions;
-
-    offset = 0;
-    // loop over the 6 faces and create the buffer copy regions
-    for (int i = 0; i < 6; i++) {
-        VkBufferImageCopy region = {};
-        region.bufferOffset = offset;
-        region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-        region.imageSubresource.baseArrayLayer = i;
-        region.imageSubresource.layerCount = 1;
-        region.imageSubresource.mipLevel = 0;
-        region.imageExtent = { image.width, image.height, 1 };
-        regions.push_back(region);
-        // increment offset into staging buffer
-        offset += image.width * image.height * channels;
-    }
-
-    VulkanBuffer::copyBufferToImage(vkSetup, commandPool, stagingBuffer.buffer, skyboxImage.image, regions);
+    VulkanImage::createImage(vkSetup, VK_NULL_HANDLE, imgCreateInfo);
 
-    // need another transfer to give the shader access to the texture
-    transitionData.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
-    transitionData.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+    // the faces are queued with the other uploads, the manager transitions all six layers around the copy
+    UploadManager::ImageUploadInfo uploadInfo{};
+    uploadInfo.pVulkanImage = &skyboxImage;
+    uploadInfo.data = image.imageData.data;
+    uploadInfo.size = image.imageData.size;
+    uploadInfo.arrayLayers = 6;
+    uploadInfo.mipLevels = skyboxImage.mipLevels;
+    uploadInfo.generateMips = generateMips;
+    // a region per face of each level present
+    uploadInfo.regions = VulkanImage::getUploadRegions(image);
 
-    VulkanImage::transitionImageLayout(vkSetup, transitionData);
+    if (!image.imageData.data) {
+        // each decoded face is copied to its layer and freed before the next one is collected
+        uploadInfo.writeData = [&decoder, &image](unsigned char* staging) {
+            size_t faceSize = image.imageData.size / 6;
+            ImageDecoder::Result face;
+            while (decoder.next(&face)) {
+                if (face.image.width != image.width || face.image.height != image.height || face.image.format != image.format) {
+                    throw std::runtime_error("skybox faces do not share the same dimensions and format!");
+                }
+                memcpy(staging + face.id * faceSize, face.image.imageData.data, faceSize);
+                face.pixels.reset();
+            }
+        };
+    }
 
-    // cleanup the staging buffer and its memory
-    stagingBuffer.cleanupBufferData(vkSetup->device);
-    // cleanup image pixels still in host memory
-    free(image.imageData.data);
+    // the pixels are copied to staging memory when queued, the host copies are released on return
+    uploadManager->uploadImage(uploadInfo);
 }
 
 void Skybox::createSkyboxImageView() {
@@ -166,7 +152,7 @@ void Skybox::createSkyboxImageView() {
     VkImageViewCreateInfo imageViewCreateInfo = utils::initImageViewCreateInfo(skyboxImage.image,
         VK_IMAGE_VIEW_TYPE_CUBE, skyboxImage.format,
         VkComponentMapping{ VK_COMPONENT_SWIZZLE_R, VK_COMPONENT_SWIZZLE_G, VK_COMPONENT_SWIZZLE_B, VK_COMPONENT_SWIZZLE_A },
-        VkImageSubresourceRange{ VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 6 });
+        VkImageSubresourceRange{ VK_IMAGE_ASPECT_COLOR_BIT, 0, skyboxImage.mipLevels, 0, 6 });
     skyboxImageView = VulkanImage::createImageView(vkSetup, imageViewCreateInfo);
 }
 
@@ -177,6 +163,7 @@ void Skybox::createSkyboxSampler() {
     samplerCreateInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_REPEAT;
     samplerCreateInfo.addressModeV = samplerCreateInfo.addressModeU;
     samplerCreateInfo.addressModeW = samplerCreateInfo.addressModeV;
+    samplerCreateInfo.maxLod = static_cast<float>(skyboxImage.mipLevels);
     if (vkCreateSampler(vkSetup->device, &samplerCreateInfo, nullptr, &skyboxSampler) != VK_SUCCESS) {
         throw std::runtime_error("failed to create texture sampler!");
     }
@@ -20,12 +20,7 @@ void SwapChain::initSwapChain(VulkanSetup* pVkSetup, Model* model, VkDescriptorS
     createSwapChain();
 
     // then create the image views for the images created
-    imageViews.resize(images.size());
-    for (size_t i = 0; i < images.size(); i++) {
-        VkImageViewCreateInfo imageViewCreateInfo = utils::initImageViewCreateInfo(images[i],
-            VK_IMAGE_VIEW_TYPE_2D, imageFormat, {}, { VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1 });
-        imageViews[i] = VulkanImage::createImageView(vkSetup, imageViewCreateInfo);
-    }
+    createImageViews();
 
     // then the geometry render pass 
     createRenderPass();
@@ -56,7 +51,53 @@ void SwapChain::cleanupSwapChain() {
     vkDestroySwapchainKHR(vkSetup->device, swapChain, nullptr);
 }
 
-void SwapChain::createSwapChain() {
+void SwapChain::recreateSwapChain(Model* model, VkDescriptorSetLayout* descriptorSetLayout, DeletionQueue* deletionQueue) {
+    VkDevice device = vkSetup->device;
+
+    // the old swap chain's images may still be rendered to or presented by frames in flight
+    VkSwapchainKHR oldSwapChain = swapChain;
+    std::vector<VkImageView> oldImageViews = imageViews;
+    VkFormat oldImageFormat = imageFormat;
+
+    // passing the old swap chain lets the presentation engine hand its resources over to the new one
+    createSwapChain(oldSwapChain);
+    createImageViews();
+
+    // the viewport and scissor are dynamic, the pipeline only has to be rebuilt for a render pass of another format
+    if (imageFormat != oldImageFormat) {
+        VkRenderPass oldRenderPass = renderPass;
+        VkRenderPass oldImGuiRenderPass = imGuiRenderPass;
+        VkPipeline oldPipeline = pipeline;
+        VkPipelineLayout oldPipelineLayout = pipelineLayout;
+        createRenderPass();
+        createImGuiRenderPass();
+        createForwardPipeline(descriptorSetLayout, model);
+        deletionQueue->push([=]() {
+            vkDestroyPipeline(device, oldPipeline, nullptr);
+            vkDestroyPipelineLayout(device, oldPipelineLayout, nullptr);
+            vkDestroyRenderPass(device, oldRenderPass, nullptr);
+            vkDestroyRenderPass(device, oldImGuiRenderPass, nullptr);
+        });
+    }
+
+    deletionQueue->push([=]() {
+        for (VkImageView imageView : oldImageViews) {
+            vkDestroyImageView(device, imageView, nullptr);
+        }
+        vkDestroySwapchainKHR(device, oldSwapChain, nullptr);
+    });
+}
+
+void SwapChain::createImageViews() {
+    imageViews.resize(images.size());
+    for (size_t i = 0; i < images.size(); i++) {
+        VkImageViewCreateInfo imageViewCreateInfo = utils::initImageViewCreateInfo(images[i],
+            VK_IMAGE_VIEW_TYPE_2D, imageFormat, {}, { VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1 });
+        imageViews[i] = VulkanImage::createImageView(vkSetup, imageViewCreateInfo);
+    }
+}
+
+void SwapChain::createSwapChain(VkSwapchainKHR oldSwapChain) {
     supportDetails = querySwapChainSupport(); // is sc supported
 
     VkSurfaceFormatKHR surfaceFormat = chooseSwapSurfaceFormat(supportDetails.formats);
@@ -96,7 +137,7 @@ void SwapChain::createSwapChain() {
     createInfo.compositeAlpha = VK_COMPOSITE_ALPHA_OPAQUE_BIT_KHR;
     createInfo.presentMode    = presentMode; // determined earlier
     createInfo.clipped        = VK_TRUE; // ignore obscured pixels
-    createInfo.oldSwapchain   = VK_NULL_HANDLE;
+    createInfo.oldSwapchain   = oldSwapChain; // retired by the creation, but must still be destroyed
 
     if (vkCreateSwapchainKHR(vkSetup->device, &createInfo, nullptr, &swapChain) != VK_SUCCESS) {
         throw std::runtime_error("failed to create swap chain!");
@@ -263,13 +304,15 @@ void SwapChain::createRenderPass() {
     // - make the render pass wait for the VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT stage.
     **************************************************************************************************************/
 
+    // the depth attachment's memory is aliased by the gBuffer depth, the offscreen pass' depth writes earlier in the
+    // queue must be done before it is cleared
     VkSubpassDependency dependency = {};
     dependency.srcSubpass    = VK_SUBPASS_EXTERNAL;
     dependency.dstSubpass    = 0;
-    dependency.srcStageMask  = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-    dependency.dstStageMask  = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-    dependency.srcAccessMask = 0;
-    dependency.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+    dependency.srcStageMask  = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+    dependency.dstStageMask  = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT;
+    dependency.srcAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+    dependency.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
 
     /*
     std::array<VkSubpassDependency, 2> dependencies; // see struct definition for more details
@@ -359,9 +402,6 @@ void SwapChain::createForwardPipeline(VkDescriptorSetLayout* descriptorSetLayout
     auto bindingDescription    = model->getBindingDescriptions(0);
     auto attributeDescriptions = model->getAttributeDescriptions(0);
 
-    VkViewport viewport{ 0.0f, 0.0f, (float)extent.width, (float)extent.height, 0.0f, 1.0f };
-    VkRect2D scissor{ { 0, 0 }, extent };
-
     VkPipelineColorBlendAttachmentState colorBlendAttachment{};
     colorBlendAttachment.colorWriteMask = 
         VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
@@ -377,7 +417,7 @@ void SwapChain::createForwardPipeline(VkDescriptorSetLayout* descriptorSetLayout
     VkPipelineInputAssemblyStateCreateInfo inputAssembly = 
         utils::initPipelineInputAssemblyStateCreateInfo(VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST, VK_FALSE);
     VkPipelineViewportStateCreateInfo viewportState = 
-        utils::initPipelineViewportStateCreateInfo(1, &viewport, 1, &scissor);
+        utils::initPipelineViewportStateCreateInfo(1, nullptr, 1, nullptr); // set when recording, the pipeline outlives extents
     VkPipelineRasterizationStateCreateInfo rasterizer = 
         utils::initPipelineRasterStateCreateInfo(VK_POLYGON_MODE_FILL, VK_CULL_MODE_BACK_BIT, VK_FRONT_FACE_COUNTER_CLOCKWISE);    
     VkPipelineMultisampleStateCreateInfo multisampling = 
@@ -386,6 +426,9 @@ void SwapChain::createForwardPipeline(VkDescriptorSetLayout* descriptorSetLayout
         utils::initPipelineColorBlendStateCreateInfo(1, &colorBlendAttachment);
     VkPipelineDepthStencilStateCreateInfo depthStencil = 
         utils::initPipelineDepthStencilStateCreateInfo(VK_TRUE, VK_TRUE, VK_COMPARE_OP_LESS);
+    std::array<VkDynamicState, 2> dynamicStates = { VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR };
+    VkPipelineDynamicStateCreateInfo dynamicState = 
+        utils::initPipelineDynamicStateCreateInfo(dynamicStates.data(), static_cast<uint32_t>(dynamicStates.size()));
     VkPipelineLayoutCreateInfo pipelineLayoutInfo = 
         utils::initPipelineLayoutCreateInfo(1, descriptorSetLayout);
 
@@ -403,10 +446,11 @@ void SwapChain::createForwardPipeline(VkDescriptorSetLayout* descriptorSetLayout
     pipelineInfo.pMultisampleState   = &multisampling;
     pipelineInfo.pColorBlendState    = &colorBlending;
     pipelineInfo.pDepthStencilState  = &depthStencil;
+    pipelineInfo.pDynamicState       = &dynamicState;
     pipelineInfo.stageCount          = static_cast<uint32_t>(shaderStages.size());
     pipelineInfo.pStages             = shaderStages.data();
 
-    if (vkCreateGraphicsPipelines(vkSetup->device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &pipeline) != VK_SUCCESS) {
+    if (vkCreateGraphicsPipelines(vkSetup->device, vkSetup->pipelineCache, 1, &pipelineInfo, nullptr, &pipeline) != VK_SUCCESS) {
         throw std::runtime_error("failed to create graphics pipeline!");
     }
 
@@ -0,0 +1,461 @@
+//
+// Definition of the TextureStreamer class
+//
+
+#include <hpg/TextureStreamer.h>
+
+#include <utils/Downsample.h> // mip chains of single level images
+#include <utils/BlockCompression.h> // decoding when the device lacks bc formats
+#include <utils/Ktx2File.h> // mapped sources
+
+#include <algorithm> // max, min, sort, heaps
+#include <chrono> // polling rebuilds
+#include <cmath> // log2, floor
+#include <cstring> // memcpy
+#include <stdexcept>
+
+// image loading
+#include <stb_image.h>
+
+static inline VkDeviceSize alignUp(VkDeviceSize value, VkDeviceSize alignment) {
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+// levels are uploaded with offsets relative to the first one, which must be multiples of the texel size and 4
+static VkDeviceSize getCopyAlignment(VkFormat format) {
+    VkDeviceSize texelSize = VulkanImage::getFormatTexelSize(format);
+    VkDeviceSize alignment = texelSize;
+    while (alignment % 4 != 0) {
+        alignment += texelSize;
+    }
+    return alignment;
+}
+
+// offsets of numLevels levels of a width x height image, aligned for copies, returns their total size
+static VkDeviceSize layoutLevels(VkFormat format, UI32 width, UI32 height, UI32 numLevels, std::vector<VkDeviceSize>* offsets) {
+    VkDeviceSize alignment = getCopyAlignment(format);
+    VkDeviceSize size = 0;
+    offsets->clear();
+    for (UI32 level = 0; level < numLevels; level++) {
+        size = alignUp(size, alignment);
+        offsets->push_back(size);
+        size += VulkanImage::getLevelSize(format, utils::getMipDimension(width, level), utils::getMipDimension(height, level));
+    }
+    return size;
+}
+
+void TextureStreamer::createTextureStreamer(VulkanSetup* pVkSetup, UploadManager* pUploadManager, DeletionQueue* pDeletionQueue,
+    VkDeviceSize budgetBytes, VkDeviceSize uploadBytes, UI32 numThreads) {
+    vkSetup              = pVkSetup;
+    uploadManager        = pUploadManager;
+    deletionQueue        = pDeletionQueue;
+    budget               = budgetBytes;
+    uploadBytesPerUpdate = uploadBytes;
+    pool                 = std::make_unique<ThreadPool>(numThreads);
+}
+
+void TextureStreamer::cleanupTextureStreamer() {
+    // the pool finishes the rebuilds it was given before its workers stop
+    pool.reset();
+    std::vector<StreamedTexture>().swap(textures);
+    changedTextures.clear();
+    sourceBytes = 0;
+}
+
+void TextureStreamer::addTexture(UI32 textureIdx, Texture* texture, const Image& image, const ImageSource& source) {
+    if (textureIdx >= textures.size()) {
+        textures.resize(static_cast<size_t>(textureIdx) + 1);
+    }
+    StreamedTexture& streamed = textures[textureIdx];
+    streamed = StreamedTexture{};
+    streamed.texture = texture;
+    streamed.source  = source;
+
+    // block compressed levels are decoded whenever they are read when the device cannot sample their format
+    bool hasSource = source.ktx2 || source.encoded.data;
+    streamed.decodeBlocks = VulkanImage::formatIsBlockCompressed(image.format) && !VulkanImage::queryFormatSupport(
+        vkSetup->physicalDevice, image.format, VK_IMAGE_TYPE_2D, VK_IMAGE_TILING_OPTIMAL,
+        VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, 0).supported;
+
+    // without a source every level is copied to the host, a single level gets its chain built there when its texels
+    // are bytes
+    Image levels = image;
+    if (!hasSource) {
+        bool buildChain = image.levelOffsets.empty() && VulkanImage::formatHasByteChannels(image.format);
+        if (streamed.decodeBlocks) {
+            levels = decodeLevels(selectLevels(image, 0), &streamed.hostData);
+        }
+        else if (buildChain) {
+            levels = downsampleLevels(image, 0, VulkanImage::getMipLevels(image.width, image.height), &streamed.hostData);
+        }
+        else {
+            Image selected = selectLevels(image, 0);
+            streamed.hostData.assign(selected.imageData.data, selected.imageData.data + selected.imageData.size);
+            levels = selected;
+            levels.imageData = { streamed.hostData.data(), streamed.hostData.size() };
+        }
+        streamed.hostLevels   = levels;
+        streamed.decodeBlocks = false;
+    }
+
+    streamed.width     = image.width;
+    streamed.height    = image.height;
+    streamed.format    = streamed.decodeBlocks ? utils::getDecodedFormat(image.format) : levels.format;
+    streamed.numLevels = !levels.levelOffsets.empty() ? static_cast<UI32>(levels.levelOffsets.size()) :
+        (VulkanImage::formatHasByteChannels(levels.format) ? VulkanImage::getMipLevels(image.width, image.height) : 1);
+
+    streamed.chainBytes.resize(static_cast<size_t>(streamed.numLevels) + 1, 0);
+    for (UI32 n = 1; n <= streamed.numLevels; n++) {
+        UI32 level = streamed.numLevels - n;
+        streamed.chainBytes[n] = streamed.chainBytes[n - 1] + VulkanImage::getLevelSize(streamed.format,
+            utils::getMipDimension(image.width, level), utils::getMipDimension(image.height, level));
+    }
+
+    // the smallest levels are always resident, so the texture can be sampled straight away. The image in hand is
+    // used for them rather than reading the source again
+    streamed.minLevels = 1;
+    while (streamed.minLevels < streamed.numLevels &&
+        getLevelDimension(streamed, streamed.numLevels - streamed.minLevels - 1) <= MIN_RESIDENT_SIZE) {
+        streamed.minLevels++;
+    }
+    streamed.residentLevels = streamed.minLevels;
+    streamed.targetLevels   = streamed.minLevels;
+
+    UI32 first = streamed.numLevels - streamed.minLevels;
+    std::vector<unsigned char> storage;
+    Image minLevels{};
+    if (!hasSource || !levels.levelOffsets.empty()) {
+        minLevels = selectLevels(levels, first);
+        if (streamed.decodeBlocks) {
+            minLevels = decodeLevels(minLevels, &storage);
+        }
+    }
+    else {
+        minLevels = downsampleLevels(levels, first, streamed.numLevels, &storage);
+    }
+    texture->createTexture(vkSetup, uploadManager, minLevels);
+
+    // textures sharing an image share its source
+    if (hasSource) {
+        const void* owner = source.ktx2 ? static_cast<const void*>(source.ktx2.get()) : source.owner.get();
+        bool shared = false;
+        for (UI32 i = 0; i < static_cast<UI32>(textures.size()) && !shared; i++) {
+            const ImageSource& other = textures[i].source;
+            shared = i != textureIdx && (other.ktx2 ? static_cast<const void*>(other.ktx2.get()) : other.owner.get()) == owner;
+        }
+        if (!shared) {
+            sourceBytes += source.ktx2 ? source.ktx2->getImage().imageData.size : source.encoded.size;
+        }
+    }
+}
+
+void TextureStreamer::request(UI32 textureIdx, F32 pixelsPerUv) {
+    if (textureIdx < textures.size()) {
+        textures[textureIdx].pixelsPerUv = std::max(textures[textureIdx].pixelsPerUv, pixelsPerUv);
+    }
+}
+
+void TextureStreamer::update() {
+    changedTextures.clear();
+
+    // rebuilds decoded since the last update are uploaded first, the ones still decoding count towards this update's
+    // uploads and keep their textures as they are
+    VkDeviceSize uploaded = 0;
+    bool evictionsPending = false;
+    for (UI32 i = 0; i < static_cast<UI32>(textures.size()); i++) {
+        StreamedTexture& streamed = textures[i];
+        if (!streamed.rebuild) {
+            continue;
+        }
+        if (streamed.rebuild->done.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+            uploaded += streamed.rebuild->bytes;
+            evictionsPending |= streamed.rebuild->numLevels < streamed.residentLevels;
+            continue;
+        }
+        streamed.rebuild->done.get(); // rethrows the error of a failed decode
+        setResidentLevels(i, streamed.rebuild->numLevels, streamed.rebuild->levels);
+        streamed.rebuild.reset();
+    }
+
+    // the finest level needed maps a texel to at most a pixel, as the sampler would pick it. Textures keep the levels
+    // they have while everything fits, on top of the requested ones and the ones always resident
+    VkDeviceSize totalBytes = 0;
+    for (auto& streamed : textures) {
+        if (!streamed.texture) {
+            continue;
+        }
+
+        streamed.requestedLevels = 0;
+        if (streamed.pixelsPerUv > 0.0f) {
+            F32 level = std::floor(std::log2(static_cast<F32>(getLevelDimension(streamed, 0)) / streamed.pixelsPerUv));
+            F32 coarsest = static_cast<F32>(streamed.numLevels - 1);
+            UI32 finest = level > 0.0f ? static_cast<UI32>(std::min(level, coarsest)) : 0;
+            streamed.requestedLevels = streamed.numLevels - finest;
+        }
+
+        streamed.targetLevels = streamed.rebuild ? streamed.rebuild->numLevels :
+            std::max(std::max(streamed.minLevels, streamed.requestedLevels), streamed.residentLevels);
+        totalBytes += streamed.chainBytes[streamed.targetLevels];
+    }
+
+    // over budget, the largest level of the least needed texture is dropped until everything fits or only the levels
+    // always resident are left. Textures being decoded wait for their rebuild
+    if (totalBytes > budget) {
+        candidates.clear();
+        for (UI32 i = 0; i < static_cast<UI32>(textures.size()); i++) {
+            if (textures[i].texture && !textures[i].rebuild && textures[i].targetLevels > textures[i].minLevels) {
+                candidates.push_back(getCandidate(i));
+            }
+        }
+        std::make_heap(candidates.begin(), candidates.end());
+
+        while (totalBytes > budget && !candidates.empty()) {
+            std::pop_heap(candidates.begin(), candidates.end());
+            UI32 textureIdx = candidates.back().textureIdx;
+            candidates.pop_back();
+
+            StreamedTexture& streamed = textures[textureIdx];
+            totalBytes -= streamed.chainBytes[streamed.targetLevels] - streamed.chainBytes[streamed.targetLevels - 1];
+            streamed.targetLevels--;
+            if (streamed.targetLevels > streamed.minLevels) {
+                candidates.push_back(getCandidate(textureIdx));
+                std::push_heap(candidates.begin(), candidates.end());
+            }
+        }
+    }
+
+    // every rebuild uploads the whole new chain, the first one of an update always goes ahead so that large chains
+    // are not held back forever
+    streamIns.clear();
+    for (UI32 i = 0; i < static_cast<UI32>(textures.size()); i++) {
+        StreamedTexture& streamed = textures[i];
+        if (!streamed.texture || streamed.rebuild || streamed.targetLevels == streamed.residentLevels) {
+            continue;
+        }
+        if (streamed.targetLevels > streamed.residentLevels) {
+            streamIns.push_back(i);
+        }
+        else if (uploaded < uploadBytesPerUpdate) {
+            uploaded += streamed.chainBytes[streamed.targetLevels];
+            rebuildTexture(i, streamed.targetLevels);
+            numEvicted++;
+        }
+        else {
+            evictionsPending = true;
+        }
+    }
+
+    // textures only grow once every eviction has been applied, so the resident levels stay within the budget. The
+    // ones whose largest resident texels cover the most pixels go first
+    if (!evictionsPending) {
+        std::sort(streamIns.begin(), streamIns.end(), [this](UI32 a, UI32 b) {
+            const StreamedTexture& streamedA = textures[a];
+            const StreamedTexture& streamedB = textures[b];
+            return streamedA.pixelsPerUv / getLevelDimension(streamedA, streamedA.numLevels - streamedA.residentLevels) >
+                streamedB.pixelsPerUv / getLevelDimension(streamedB, streamedB.numLevels - streamedB.residentLevels);
+        });
+
+        for (UI32 textureIdx : streamIns) {
+            if (uploaded > 0 && uploaded >= uploadBytesPerUpdate) {
+                break;
+            }
+            StreamedTexture& streamed = textures[textureIdx];
+            uploaded += streamed.chainBytes[streamed.targetLevels];
+            rebuildTexture(textureIdx, streamed.targetLevels);
+            numStreamedIn++;
+        }
+    }
+
+    // the new images must be uploaded before the frame sampling them is submitted
+    if (!changedTextures.empty()) {
+        std::sort(changedTextures.begin(), changedTextures.end());
+        uploadManager->flush();
+    }
+
+    // requests only count towards the next update
+    for (auto& streamed : textures) {
+        streamed.pixelsPerUv = 0.0f;
+    }
+}
+
+TextureStreamer::Stats TextureStreamer::getStats() const {
+    Stats stats{};
+    stats.budget        = budget;
+    stats.sourceBytes   = sourceBytes;
+    stats.numStreamedIn = numStreamedIn;
+    stats.numEvicted    = numEvicted;
+    stats.uploadedBytes = uploadedBytes;
+    for (const auto& streamed : textures) {
+        if (!streamed.texture) {
+            continue;
+        }
+        UI32 requestedLevels = std::max(streamed.minLevels, streamed.requestedLevels);
+        stats.numTextures++;
+        stats.numStreaming   += streamed.residentLevels != requestedLevels ? 1 : 0;
+        stats.numDecoding    += streamed.rebuild ? 1 : 0;
+        stats.residentBytes  += streamed.chainBytes[streamed.residentLevels];
+        stats.requestedBytes += streamed.chainBytes[requestedLevels];
+        stats.fullBytes      += streamed.chainBytes[streamed.numLevels];
+        stats.hostBytes      += streamed.hostData.size() + (streamed.rebuild ? streamed.rebuild->bytes : 0);
+    }
+    return stats;
+}
+
+UI32 TextureStreamer::getLevelDimension(const StreamedTexture& streamed, UI32 level) {
+    return std::max(utils::getMipDimension(streamed.width, level), utils::getMipDimension(streamed.height, level));
+}
+
+TextureStreamer::Candidate TextureStreamer::getCandidate(UI32 textureIdx) const {
+    const StreamedTexture& streamed = textures[textureIdx];
+    UI32 level = streamed.numLevels - streamed.targetLevels;
+
+    Candidate candidate{};
+    candidate.requested  = streamed.targetLevels <= streamed.requestedLevels;
+    candidate.priority   = candidate.requested ? streamed.pixelsPerUv / getLevelDimension(streamed, level) :
+        static_cast<F32>(streamed.chainBytes[streamed.targetLevels] - streamed.chainBytes[streamed.targetLevels - 1]);
+    candidate.textureIdx = textureIdx;
+    return candidate;
+}
+
+Image TextureStreamer::selectLevels(const Image& image, UI32 first) {
+    // a single level lies at the start of the data
+    std::vector<VkDeviceSize> offsets = image.levelOffsets.empty() ? std::vector<VkDeviceSize>{ 0 } : image.levelOffsets;
+
+    // the selected levels are contiguous, whichever order the container stores them in
+    VkDeviceSize begin = image.imageData.size;
+    VkDeviceSize end = 0;
+    for (UI32 level = first; level < static_cast<UI32>(offsets.size()); level++) {
+        begin = std::min(begin, offsets[level]);
+        end = std::max(end, offsets[level] + image.arrayLayers * VulkanImage::getLevelSize(image.format,
+            utils::getMipDimension(image.width, level), utils::getMipDimension(image.height, level)));
+    }
+
+    Image levels{};
+    levels.width       = utils::getMipDimension(image.width, first);
+    levels.height      = utils::getMipDimension(image.height, first);
+    levels.format      = image.format;
+    levels.arrayLayers = image.arrayLayers;
+    levels.imageData   = { image.imageData.data + begin, static_cast<size_t>(end - begin) };
+    for (UI32 level = first; level < static_cast<UI32>(offsets.size()); level++) {
+        levels.levelOffsets.push_back(offsets[level] - begin);
+    }
+    return levels;
+}
+
+Image TextureStreamer::downsampleLevels(const Image& image, UI32 first, UI32 numLevels, std::vector<unsigned char>* storage) {
+    UI32 texelSize = VulkanImage::getFormatTexelSize(image.format);
+
+    Image levels{};
+    levels.width  = utils::getMipDimension(image.width, first);
+    levels.height = utils::getMipDimension(image.height, first);
+    levels.format = image.format;
+    storage->resize(static_cast<size_t>(layoutLevels(image.format, levels.width, levels.height, numLevels - first,
+        &levels.levelOffsets)));
+    levels.imageData = { storage->data(), storage->size() };
+
+    if (first == 0) {
+        memcpy(storage->data(), image.imageData.data, static_cast<size_t>(VulkanImage::getLevelSize(image.format,
+            image.width, image.height)));
+    }
+
+    // each level is filtered from the one above, the levels above the first are only kept until the next is built
+    std::vector<unsigned char> scratch[2];
+    const unsigned char* src = image.imageData.data;
+    for (UI32 level = 1; level < numLevels; level++) {
+        UI32 width  = utils::getMipDimension(image.width, level);
+        UI32 height = utils::getMipDimension(image.height, level);
+        unsigned char* dst;
+        if (level >= first) {
+            dst = storage->data() + levels.levelOffsets[level - first];
+        }
+        else {
+            scratch[level % 2].resize(static_cast<size_t>(texelSize) * width * height);
+            dst = scratch[level % 2].data();
+        }
+        utils::downsampleImage(src, utils::getMipDimension(image.width, level - 1), utils::getMipDimension(image.height, level - 1),
+            texelSize, dst);
+        src = dst;
+    }
+    return levels;
+}
+
+Image TextureStreamer::decodeLevels(const Image& levels, std::vector<unsigned char>* storage) {
+    Image decoded{};
+    decoded.width  = levels.width;
+    decoded.height = levels.height;
+    decoded.format = utils::getDecodedFormat(levels.format);
+    if (decoded.format == VK_FORMAT_UNDEFINED) {
+        throw std::runtime_error("cannot decode block compressed format!");
+    }
+
+    UI32 numLevels = static_cast<UI32>(levels.levelOffsets.size());
+    storage->resize(static_cast<size_t>(layoutLevels(decoded.format, levels.width, levels.height, numLevels,
+        &decoded.levelOffsets)));
+    decoded.imageData = { storage->data(), storage->size() };
+
+    for (UI32 level = 0; level < numLevels; level++) {
+        utils::decodeBlocks(levels.format, levels.imageData.data + levels.levelOffsets[level], utils::getMipDimension(levels.width, level),
+            utils::getMipDimension(levels.height, level), storage->data() + decoded.levelOffsets[level]);
+    }
+    return decoded;
+}
+
+Image TextureStreamer::readSourceLevels(const ImageSource& source, bool decodeBlocks, UI32 first, UI32 numLevels,
+    std::vector<unsigned char>* storage) {
+    if (source.ktx2) {
+        Image levels = selectLevels(source.ktx2->getImage(), first);
+        return decodeBlocks ? decodeLevels(levels, storage) : levels;
+    }
+
+    // forced to four channels, as the image the texture was added with
+    int width, height, channels;
+    std::unique_ptr<unsigned char, void(*)(void*)> pixels(stbi_load_from_memory(source.encoded.data,
+        static_cast<int>(source.encoded.size), &width, &height, &channels, STBI_rgb_alpha), stbi_image_free);
+    if (!pixels) {
+        throw std::runtime_error("failed to decode streamed texture image!");
+    }
+
+    Image image{};
+    image.width     = static_cast<UI32>(width);
+    image.height    = static_cast<UI32>(height);
+    image.format    = VulkanImage::getImageFormat(STBI_rgb_alpha);
+    image.imageData = { pixels.get(), static_cast<size_t>(width) * height * STBI_rgb_alpha };
+    return downsampleLevels(image, first, numLevels, storage);
+}
+
+void TextureStreamer::rebuildTexture(UI32 textureIdx, UI32 numLevels) {
+    StreamedTexture& streamed = textures[textureIdx];
+    UI32 first = streamed.numLevels - numLevels;
+
+    // host copies and containers the device samples are read in place
+    if (!streamed.hostData.empty()) {
+        Image hostLevels = streamed.hostLevels;
+        hostLevels.imageData = { streamed.hostData.data(), streamed.hostData.size() };
+        setResidentLevels(textureIdx, numLevels, selectLevels(hostLevels, first));
+        return;
+    }
+    if (streamed.source.ktx2 && !streamed.decodeBlocks) {
+        setResidentLevels(textureIdx, numLevels, selectLevels(streamed.source.ktx2->getImage(), first));
+        return;
+    }
+
+    // the worker shares the rebuild and the source, so either may be dropped here while it runs
+    auto rebuild = std::make_shared<Rebuild>();
+    rebuild->numLevels = numLevels;
+    rebuild->bytes     = streamed.chainBytes[numLevels];
+    ImageSource source = streamed.source;
+    bool decodeBlocks  = streamed.decodeBlocks;
+    UI32 totalLevels   = streamed.numLevels;
+    rebuild->done = pool->submit([rebuild, source, decodeBlocks, first, totalLevels]() {
+        rebuild->levels = readSourceLevels(source, decodeBlocks, first, totalLevels, &rebuild->storage);
+    });
+    streamed.rebuild = rebuild;
+}
+
+void TextureStreamer::setResidentLevels(UI32 textureIdx, UI32 numLevels, const Image& levels) {
+    StreamedTexture& streamed = textures[textureIdx];
+    streamed.texture->recreateImage(uploadManager, levels, deletionQueue);
+    streamed.residentLevels = numLevels;
+    uploadedBytes += streamed.chainBytes[numLevels];
+    changedTextures.push_back(textureIdx);
+}
@@ -0,0 +1,55 @@
+//
+// Definition of the UniformRing class
+//
+
+#include <hpg/UniformRing.h>
+
+#include <algorithm> // max
+#include <stdexcept>
+
+void UniformRing::createUniformRing(const VulkanSetup* pVkSetup, VkDeviceSize theFrameSize, UI32 numFrames) {
+    vkSetup = pVkSetup;
+
+    // partitions start on an aligned offset so every push in them is aligned too
+    alignment = std::max(vkSetup->deviceProperties.limits.minUniformBufferOffsetAlignment, static_cast<VkDeviceSize>(1));
+    frameSize = (theFrameSize + alignment - 1) / alignment * alignment;
+
+    VulkanBuffer::CreateInfo createInfo{};
+    createInfo.size          = frameSize * numFrames;
+    createInfo.usage         = VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT;
+    createInfo.properties    = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+    createInfo.category      = MemoryAllocator::Category::UNIFORM;
+    createInfo.pVulkanBuffer = &buffer;
+
+    VulkanBuffer::createBuffer(vkSetup, &createInfo);
+
+    frameBegin = head = 0;
+}
+
+void UniformRing::cleanupUniformRing() {
+    buffer.cleanupBufferData(vkSetup->device);
+}
+
+void UniformRing::beginFrame(UI32 frameIdx) {
+    frameBegin = head = frameSize * frameIdx;
+}
+
+UI32 UniformRing::allocate(VkDeviceSize size, void** data) {
+    VkDeviceSize offset = head;
+    VkDeviceSize end = offset + size;
+    if (end > frameBegin + frameSize) {
+        throw std::runtime_error("uniform ring frame partition is full!");
+    }
+
+    head = (end + alignment - 1) / alignment * alignment;
+    *data = static_cast<unsigned char*>(buffer.allocation.mapped) + offset;
+    return static_cast<UI32>(offset);
+}
+
+VkDescriptorBufferInfo UniformRing::getDescriptorInfo(VkDeviceSize range) const {
+    VkDescriptorBufferInfo info{};
+    info.buffer = buffer.buffer;
+    info.offset = 0;
+    info.range  = range;
+    return info;
+}
@@ -0,0 +1,633 @@
+//
+// Definition of the UploadManager class
+//
+
+#include <hpg/UploadManager.h>
+
+#include <utils/Downsample.h>
+
+#include <algorithm> // max
+#include <cstring> // memcpy
+#include <stdexcept>
+
+static inline VkDeviceSize alignUp(VkDeviceSize value, VkDeviceSize alignment) {
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+// stages of the graphics queue that read uploaded data, acquired resources are made available to them
+static const VkPipelineStageFlags READ_STAGES = 
+    VK_PIPELINE_STAGE_VERTEX_INPUT_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+
+static inline VkCommandPool createPool(VkDevice device, uint32_t queueFamily) {
+    // command buffers are short lived and reset individually when their batch is reused
+    VkCommandPoolCreateInfo poolInfo{};
+    poolInfo.sType            = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+    poolInfo.queueFamilyIndex = queueFamily;
+    poolInfo.flags            = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT | VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+
+    VkCommandPool pool;
+    if (vkCreateCommandPool(device, &poolInfo, nullptr, &pool) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create upload command pool!");
+    }
+    return pool;
+}
+
+static inline VkCommandBuffer allocateCommandBuffer(VkDevice device, VkCommandPool pool) {
+    VkCommandBufferAllocateInfo allocInfo{};
+    allocInfo.sType              = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+    allocInfo.level              = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+    allocInfo.commandPool        = pool;
+    allocInfo.commandBufferCount = 1;
+
+    VkCommandBuffer commandBuffer;
+    if (vkAllocateCommandBuffers(device, &allocInfo, &commandBuffer) != VK_SUCCESS) {
+        throw std::runtime_error("failed to allocate upload command buffer!");
+    }
+    return commandBuffer;
+}
+
+void UploadManager::createUploadManager(const VulkanSetup* pVkSetup, VkDeviceSize stagingSize) {
+    vkSetup = pVkSetup;
+
+    // resources are exclusive to a queue family, with a dedicated transfer family they change hands after the copies
+    ownershipTransfer = vkSetup->transferFamily != vkSetup->graphicsFamily;
+
+    commandPool = createPool(vkSetup->device, vkSetup->transferFamily);
+    if (ownershipTransfer) {
+        acquirePool = createPool(vkSetup->device, vkSetup->graphicsFamily);
+    }
+
+    VulkanBuffer::CreateInfo createInfo{};
+    createInfo.size          = stagingSize;
+    createInfo.usage         = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
+    createInfo.properties    = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+    createInfo.category      = MemoryAllocator::Category::STAGING;
+    createInfo.pVulkanBuffer = &staging;
+
+    VulkanBuffer::createBuffer(vkSetup, &createInfo);
+
+    capacity = stagingSize;
+    head = used = 0;
+
+    beginBatch();
+}
+
+void UploadManager::cleanupUploadManager() {
+    wait(flush());
+
+    freeBatches.push_back(std::move(recording));
+    for (auto& batch : freeBatches) {
+        vkDestroyFence(vkSetup->device, batch.fence, nullptr);
+        if (batch.copiesDone) {
+            vkDestroySemaphore(vkSetup->device, batch.copiesDone, nullptr);
+        }
+    }
+    freeBatches.clear();
+    recording = Batch{};
+
+    // frees every command buffer allocated from them
+    vkDestroyCommandPool(vkSetup->device, commandPool, nullptr);
+    if (acquirePool) {
+        vkDestroyCommandPool(vkSetup->device, acquirePool, nullptr);
+    }
+
+    staging.cleanupBufferData(vkSetup->device);
+}
+
+UploadManager::Token UploadManager::createDeviceLocalBuffer(const std::vector<Buffer>& buffers, VulkanBuffer* vkBuffer,
+    VkBufferUsageFlags usage, MemoryAllocator::Category category) {
+    VkDeviceSize totalSize = 0;
+    for (const auto& buffer : buffers) {
+        totalSize += buffer.size;
+    }
+
+    VulkanBuffer::CreateInfo createInfo{};
+    createInfo.size          = totalSize;
+    createInfo.usage         = VK_BUFFER_USAGE_TRANSFER_DST_BIT | usage;
+    createInfo.properties    = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
+    createInfo.category      = category;
+    createInfo.pVulkanBuffer = vkBuffer;
+
+    VulkanBuffer::createBuffer(vkSetup, &createInfo);
+
+    return uploadBuffer(vkBuffer->buffer, 0, buffers);
+}
+
+UploadManager::Token UploadManager::uploadBuffer(VkBuffer dst, VkDeviceSize dstOffset, const std::vector<Buffer>& buffers) {
+    VkDeviceSize totalSize = 0;
+    for (const auto& buffer : buffers) {
+        totalSize += buffer.size;
+    }
+    if (totalSize == 0) {
+        return recordingToken;
+    }
+
+    VkBuffer stagingBuffer;
+    VkDeviceSize stagingOffset;
+    unsigned char* data = reserveStaging(totalSize, 4, &stagingBuffer, &stagingOffset);
+    for (const auto& buffer : buffers) {
+        memcpy(data, buffer.data, buffer.size);
+        data += buffer.size;
+    }
+
+    VkBufferCopy copyRegion{};
+    copyRegion.srcOffset = stagingOffset;
+    copyRegion.dstOffset = dstOffset;
+    copyRegion.size      = totalSize;
+    vkCmdCopyBuffer(recording.commandBuffer, stagingBuffer, dst, 1, &copyRegion);
+
+    if (ownershipTransfer) {
+        // release the range to the graphics family, the matching acquire is recorded when the batch is flushed
+        VkBufferMemoryBarrier barrier{};
+        barrier.sType               = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+        barrier.srcAccessMask       = VK_ACCESS_TRANSFER_WRITE_BIT;
+        barrier.dstAccessMask       = 0;
+        barrier.srcQueueFamilyIndex = vkSetup->transferFamily;
+        barrier.dstQueueFamilyIndex = vkSetup->graphicsFamily;
+        barrier.buffer              = dst;
+        barrier.offset              = dstOffset;
+        barrier.size                = totalSize;
+        vkCmdPipelineBarrier(recording.commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0,
+            0, nullptr, 1, &barrier, 0, nullptr);
+
+        barrier.srcAccessMask = 0;
+        barrier.dstAccessMask = VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_INDEX_READ_BIT | VK_ACCESS_UNIFORM_READ_BIT |
+            VK_ACCESS_SHADER_READ_BIT;
+        recording.bufferAcquires.push_back(barrier);
+    }
+    else {
+        recording.hasBufferCopies = true;
+    }
+    recording.numUploads++;
+    numUploads++;
+    return recording.token;
+}
+
+UploadManager::Token UploadManager::uploadImage(const ImageUploadInfo& info) {
+    // buffer offsets of image copies must be a multiple of both the texel (or block) size and 4
+    VkDeviceSize texelSize = VulkanImage::getFormatTexelSize(info.pVulkanImage->format);
+    VkDeviceSize alignment = texelSize;
+    while (alignment % 4 != 0) {
+        alignment += texelSize;
+    }
+
+    // blits filter linearly and need a graphics queue, formats without linear filtering are downsampled while staging
+    VkFormat format = info.pVulkanImage->format;
+    bool blitMips = info.generateMips && info.mipLevels > 1 && 
+        VulkanImage::formatIsFilterable(vkSetup->physicalDevice, format, VK_IMAGE_TILING_OPTIMAL) && 
+        VulkanImage::formatIsBlittable(vkSetup->physicalDevice, format);
+    bool downsampleMips = info.generateMips && info.mipLevels > 1 && !blitMips;
+    if (downsampleMips && !VulkanImage::formatHasByteChannels(format)) {
+        throw std::runtime_error("cannot generate mips for an image format without linear blits or 8 bit channels!");
+    }
+
+    // the host built levels of every layer follow level 0 in staging memory
+    VkDeviceSize stagingSize = info.size;
+    if (downsampleMips) {
+        for (const auto& region : info.regions) {
+            for (UI32 level = 1; level < info.mipLevels; level++) {
+                stagingSize = alignUp(stagingSize, alignment) + static_cast<VkDeviceSize>(texelSize) * 
+                    utils::getMipDimension(region.imageExtent.width, level) * utils::getMipDimension(region.imageExtent.height, level);
+            }
+        }
+    }
+
+    VkBuffer stagingBuffer;
+    VkDeviceSize stagingOffset;
+    unsigned char* data = reserveStaging(stagingSize, alignment, &stagingBuffer, &stagingOffset);
+    if (info.writeData) {
+        info.writeData(data);
+    }
+    else {
+        memcpy(data, info.data, info.size);
+    }
+
+    std::vector<VkBufferImageCopy> regions = info.regions;
+    if (downsampleMips) {
+        // each level is filtered from the one above in host memory, staging memory may be write combined and is 
+        // only ever written. Level 0 is read back from it when the caller wrote it there, which is slow but only 
+        // happens for formats the device cannot blit
+        const unsigned char* levelZero = info.writeData ? data : static_cast<const unsigned char*>(info.data);
+        std::vector<unsigned char> levels[2];
+        VkDeviceSize offset = info.size;
+        for (const auto& region : info.regions) {
+            const unsigned char* src = levelZero + region.bufferOffset;
+            UI32 width  = region.imageExtent.width;
+            UI32 height = region.imageExtent.height;
+            for (UI32 level = 1; level < info.mipLevels; level++) {
+                std::vector<unsigned char>& dst = levels[level % 2];
+                UI32 levelWidth  = utils::getMipDimension(region.imageExtent.width, level);
+                UI32 levelHeight = utils::getMipDimension(region.imageExtent.height, level);
+                dst.resize(static_cast<size_t>(texelSize) * levelWidth * levelHeight);
+                utils::downsampleImage(src, width, height, static_cast<UI32>(texelSize), dst.data());
+
+                offset = alignUp(offset, alignment);
+                memcpy(data + offset, dst.data(), dst.size());
+
+                VkBufferImageCopy levelRegion = region;
+                levelRegion.bufferOffset              = offset;
+                levelRegion.bufferRowLength           = 0;
+                levelRegion.bufferImageHeight         = 0;
+                levelRegion.imageSubresource.mipLevel = level;
+                levelRegion.imageExtent               = { levelWidth, levelHeight, 1 };
+                regions.push_back(levelRegion);
+
+                offset += dst.size();
+                src = dst.data();
+                width = levelWidth;
+                height = levelHeight;
+            }
+        }
+        numDownsampledMipChains++;
+    }
+
+    VkImageMemoryBarrier barrier{};
+    barrier.sType                           = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+    barrier.srcQueueFamilyIndex             = VK_QUEUE_FAMILY_IGNORED;
+    barrier.dstQueueFamilyIndex             = VK_QUEUE_FAMILY_IGNORED;
+    barrier.image                           = info.pVulkanImage->image;
+    barrier.subresourceRange.aspectMask     = VK_IMAGE_ASPECT_COLOR_BIT;
+    barrier.subresourceRange.baseMipLevel   = 0;
+    barrier.subresourceRange.levelCount     = info.mipLevels;
+    barrier.subresourceRange.baseArrayLayer = 0;
+    barrier.subresourceRange.layerCount     = info.arrayLayers;
+
+    // previous contents are discarded, nothing to wait on
+    barrier.oldLayout     = VK_IMAGE_LAYOUT_UNDEFINED;
+    barrier.newLayout     = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+    barrier.srcAccessMask = 0;
+    barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    vkCmdPipelineBarrier(recording.commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0,
+        0, nullptr, 0, nullptr, 1, &barrier);
+
+    // whole image copies are valid whatever the transfer queue's minImageTransferGranularity
+    for (auto& region : regions) {
+        region.bufferOffset += stagingOffset;
+    }
+    vkCmdCopyBufferToImage(recording.commandBuffer, stagingBuffer, info.pVulkanImage->image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+        static_cast<uint32_t>(regions.size()), regions.data());
+
+    if (blitMips) {
+        MipGeneration generation{};
+        generation.image       = info.pVulkanImage->image;
+        generation.width       = info.pVulkanImage->extent.width;
+        generation.height      = info.pVulkanImage->extent.height;
+        generation.mipLevels   = info.mipLevels;
+        generation.arrayLayers = info.arrayLayers;
+        generation.finalLayout = info.finalLayout;
+
+        if (ownershipTransfer) {
+            // the transfer queue may not blit, the image is handed over in TRANSFER_DST_OPTIMAL and the chain is 
+            // blitted on the graphics queue once acquired
+            barrier.oldLayout           = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+            barrier.newLayout           = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+            barrier.srcAccessMask       = VK_ACCESS_TRANSFER_WRITE_BIT;
+            barrier.dstAccessMask       = 0;
+            barrier.srcQueueFamilyIndex = vkSetup->transferFamily;
+            barrier.dstQueueFamilyIndex = vkSetup->graphicsFamily;
+            vkCmdPipelineBarrier(recording.commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0,
+                0, nullptr, 0, nullptr, 1, &barrier);
+
+            barrier.srcAccessMask = 0;
+            barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT | VK_ACCESS_TRANSFER_WRITE_BIT;
+            recording.mipAcquires.push_back(barrier);
+            recording.mipGenerations.push_back(generation);
+        }
+        else {
+            recordMipGeneration(recording.commandBuffer, generation);
+        }
+
+        numBlittedMipChains++;
+        recording.numUploads++;
+        numUploads++;
+        return recording.token;
+    }
+
+    barrier.oldLayout     = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+    barrier.newLayout     = info.finalLayout;
+    barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+
+    if (ownershipTransfer) {
+        // the release and the acquire both describe the layout transition, it happens once between the two
+        barrier.dstAccessMask       = 0;
+        barrier.srcQueueFamilyIndex = vkSetup->transferFamily;
+        barrier.dstQueueFamilyIndex = vkSetup->graphicsFamily;
+        vkCmdPipelineBarrier(recording.commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0,
+            0, nullptr, 0, nullptr, 1, &barrier);
+
+        barrier.srcAccessMask = 0;
+        barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+        recording.imageAcquires.push_back(barrier);
+    }
+    else {
+        barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+        vkCmdPipelineBarrier(recording.commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0,
+            0, nullptr, 0, nullptr, 1, &barrier);
+    }
+
+    recording.numUploads++;
+    numUploads++;
+    return recording.token;
+}
+
+UploadManager::Token UploadManager::flush() {
+    if (recording.numUploads == 0) {
+        return recordingToken - 1;
+    }
+
+    // one barrier for every buffer copy of the batch, vertex, index and uniform reads of later submissions wait on it
+    if (recording.hasBufferCopies) {
+        VkMemoryBarrier barrier{};
+        barrier.sType         = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+        barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        barrier.dstAccessMask = VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_INDEX_READ_BIT | VK_ACCESS_UNIFORM_READ_BIT |
+            VK_ACCESS_SHADER_READ_BIT;
+        vkCmdPipelineBarrier(recording.commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, READ_STAGES, 0,
+            1, &barrier, 0, nullptr, 0, nullptr);
+    }
+
+    if (vkEndCommandBuffer(recording.commandBuffer) != VK_SUCCESS) {
+        throw std::runtime_error("failed to record upload command buffer!");
+    }
+
+    VkSubmitInfo submitInfo{};
+    submitInfo.sType              = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    submitInfo.commandBufferCount = 1;
+    submitInfo.pCommandBuffers    = &recording.commandBuffer;
+
+    if (!ownershipTransfer) {
+        // the transfer queue is the graphics queue
+        if (vkQueueSubmit(vkSetup->transferQueue, 1, &submitInfo, recording.fence) != VK_SUCCESS) {
+            throw std::runtime_error("failed to submit upload command buffer!");
+        }
+    }
+    else {
+        submitInfo.signalSemaphoreCount = 1;
+        submitInfo.pSignalSemaphores    = &recording.copiesDone;
+
+        if (vkQueueSubmit(vkSetup->transferQueue, 1, &submitInfo, VK_NULL_HANDLE) != VK_SUCCESS) {
+            throw std::runtime_error("failed to submit upload command buffer!");
+        }
+
+        // acquire everything released by the copies, frames submitted to the graphics queue afterwards see the data
+        VkCommandBufferBeginInfo beginInfo{};
+        beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+        beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+        if (vkBeginCommandBuffer(recording.acquireCommandBuffer, &beginInfo) != VK_SUCCESS) {
+            throw std::runtime_error("failed to begin recording upload acquire command buffer!");
+        }
+        vkCmdPipelineBarrier(recording.acquireCommandBuffer, READ_STAGES, READ_STAGES, 0, 0, nullptr,
+            static_cast<uint32_t>(recording.bufferAcquires.size()), recording.bufferAcquires.data(),
+            static_cast<uint32_t>(recording.imageAcquires.size()), recording.imageAcquires.data());
+
+        VkPipelineStageFlags waitStages = READ_STAGES;
+        if (!recording.mipGenerations.empty()) {
+            vkCmdPipelineBarrier(recording.acquireCommandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 
+                0, nullptr, 0, nullptr, static_cast<uint32_t>(recording.mipAcquires.size()), recording.mipAcquires.data());
+            for (const auto& generation : recording.mipGenerations) {
+                recordMipGeneration(recording.acquireCommandBuffer, generation);
+            }
+            waitStages |= VK_PIPELINE_STAGE_TRANSFER_BIT;
+        }
+
+        if (vkEndCommandBuffer(recording.acquireCommandBuffer) != VK_SUCCESS) {
+            throw std::runtime_error("failed to record upload acquire command buffer!");
+        }
+
+        VkSubmitInfo acquireInfo{};
+        acquireInfo.sType              = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+        acquireInfo.waitSemaphoreCount = 1;
+        acquireInfo.pWaitSemaphores    = &recording.copiesDone;
+        acquireInfo.pWaitDstStageMask  = &waitStages;
+        acquireInfo.commandBufferCount = 1;
+        acquireInfo.pCommandBuffers    = &recording.acquireCommandBuffer;
+
+        if (vkQueueSubmit(vkSetup->graphicsQueue, 1, &acquireInfo, recording.fence) != VK_SUCCESS) {
+            throw std::runtime_error("failed to submit upload acquire command buffer!");
+        }
+    }
+    numSubmissions++;
+
+    Token submitted = recording.token;
+    pending.push_back(std::move(recording));
+    recordingToken++;
+    beginBatch();
+
+    return submitted;
+}
+
+void UploadManager::update() {
+    while (!pending.empty() && vkGetFenceStatus(vkSetup->device, pending.front().fence) == VK_SUCCESS) {
+        retireBatch(pending.front());
+        pending.pop_front();
+    }
+}
+
+bool UploadManager::isComplete(Token token) {
+    update();
+    return token <= completedToken;
+}
+
+void UploadManager::wait(Token token) {
+    if (token >= recordingToken) {
+        flush();
+    }
+
+    // batches complete in submission order, wait on the oldest until the token's batch is retired
+    while (completedToken < token && !pending.empty()) {
+        vkWaitForFences(vkSetup->device, 1, &pending.front().fence, VK_TRUE, UINT64_MAX);
+        retireBatch(pending.front());
+        pending.pop_front();
+    }
+}
+
+void UploadManager::recordMipGeneration(VkCommandBuffer commandBuffer, const MipGeneration& generation) {
+    VkImageMemoryBarrier barrier{};
+    barrier.sType                           = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+    barrier.srcQueueFamilyIndex             = VK_QUEUE_FAMILY_IGNORED;
+    barrier.dstQueueFamilyIndex             = VK_QUEUE_FAMILY_IGNORED;
+    barrier.image                           = generation.image;
+    barrier.subresourceRange.aspectMask     = VK_IMAGE_ASPECT_COLOR_BIT;
+    barrier.subresourceRange.levelCount     = 1;
+    barrier.subresourceRange.baseArrayLayer = 0;
+    barrier.subresourceRange.layerCount     = generation.arrayLayers;
+
+    I32 width  = static_cast<I32>(generation.width);
+    I32 height = static_cast<I32>(generation.height);
+    for (UI32 level = 1; level < generation.mipLevels; level++) {
+        I32 levelWidth  = std::max(width / 2, 1);
+        I32 levelHeight = std::max(height / 2, 1);
+
+        // the level above was written by the copy or the previous blit
+        barrier.subresourceRange.baseMipLevel = level - 1;
+        barrier.oldLayout     = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+        barrier.newLayout     = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+        barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+        vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0,
+            0, nullptr, 0, nullptr, 1, &barrier);
+
+        VkImageBlit blit{};
+        blit.srcSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, level - 1, 0, generation.arrayLayers };
+        blit.srcOffsets[1]  = { width, height, 1 };
+        blit.dstSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, level, 0, generation.arrayLayers };
+        blit.dstOffsets[1]  = { levelWidth, levelHeight, 1 };
+        vkCmdBlitImage(commandBuffer, generation.image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, generation.image, 
+            VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &blit, VK_FILTER_LINEAR);
+
+        // done with the level above once the blit has read it
+        barrier.oldLayout     = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+        barrier.newLayout     = generation.finalLayout;
+        barrier.srcAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+        barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+        vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0,
+            0, nullptr, 0, nullptr, 1, &barrier);
+
+        width  = levelWidth;
+        height = levelHeight;
+    }
+
+    // the last level is only ever written
+    barrier.subresourceRange.baseMipLevel = generation.mipLevels - 1;
+    barrier.oldLayout     = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+    barrier.newLayout     = generation.finalLayout;
+    barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0,
+        0, nullptr, 0, nullptr, 1, &barrier);
+}
+
+void UploadManager::beginBatch() {
+    if (!freeBatches.empty()) {
+        recording = std::move(freeBatches.back());
+        freeBatches.pop_back();
+    }
+    else {
+        recording = Batch{};
+        recording.commandBuffer = allocateCommandBuffer(vkSetup->device, commandPool);
+
+        if (ownershipTransfer) {
+            recording.acquireCommandBuffer = allocateCommandBuffer(vkSetup->device, acquirePool);
+
+            VkSemaphoreCreateInfo semaphoreInfo{};
+            semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+            if (vkCreateSemaphore(vkSetup->device, &semaphoreInfo, nullptr, &recording.copiesDone) != VK_SUCCESS) {
+                throw std::runtime_error("failed to create upload semaphore!");
+            }
+        }
+
+        VkFenceCreateInfo fenceInfo{};
+        fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+        if (vkCreateFence(vkSetup->device, &fenceInfo, nullptr, &recording.fence) != VK_SUCCESS) {
+            throw std::runtime_error("failed to create upload fence!");
+        }
+    }
+
+    recording.token = recordingToken;
+
+    VkCommandBufferBeginInfo beginInfo{};
+    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+    // implicitly resets the command buffer
+    if (vkBeginCommandBuffer(recording.commandBuffer, &beginInfo) != VK_SUCCESS) {
+        throw std::runtime_error("failed to begin recording upload command buffer!");
+    }
+}
+
+void UploadManager::retireBatch(Batch& batch) {
+    completedToken = batch.token;
+
+    // batches retire in the order they reserved staging space, so the oldest bytes of the ring are released
+    used -= batch.stagingBytes;
+    for (auto& buffer : batch.dedicatedStaging) {
+        buffer.cleanupBufferData(vkSetup->device);
+    }
+
+    vkResetFences(vkSetup->device, 1, &batch.fence);
+
+    Batch reuse{};
+    reuse.commandBuffer = batch.commandBuffer;
+    reuse.acquireCommandBuffer = batch.acquireCommandBuffer;
+    reuse.copiesDone = batch.copiesDone;
+    reuse.fence = batch.fence;
+    freeBatches.push_back(reuse);
+}
+
+unsigned char* UploadManager::reserveStaging(VkDeviceSize size, VkDeviceSize alignment, VkBuffer* stagingBuffer,
+    VkDeviceSize* stagingOffset) {
+    // too large for the arena, the upload gets a staging buffer of its own that is freed with its batch
+    if (size > capacity) {
+        VulkanBuffer dedicated;
+
+        VulkanBuffer::CreateInfo createInfo{};
+        createInfo.size          = size;
+        createInfo.usage         = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
+        createInfo.properties    = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+        createInfo.category      = MemoryAllocator::Category::STAGING;
+        createInfo.pVulkanBuffer = &dedicated;
+
+        VulkanBuffer::createBuffer(vkSetup, &createInfo);
+        recording.dedicatedStaging.push_back(dedicated);
+
+        *stagingBuffer = dedicated.buffer;
+        *stagingOffset = 0;
+        return static_cast<unsigned char*>(dedicated.allocation.mapped);
+    }
+
+    VkDeviceSize offset;
+    while (!tryReserve(size, alignment, &offset)) {
+        // space is only released by completed batches, submit what has been recorded so far and wait on the oldest
+        if (recording.numUploads > 0) {
+            flush();
+        }
+        if (pending.empty()) {
+            throw std::runtime_error("failed to reserve upload staging memory!");
+        }
+        vkWaitForFences(vkSetup->device, 1, &pending.front().fence, VK_TRUE, UINT64_MAX);
+        retireBatch(pending.front());
+        pending.pop_front();
+    }
+
+    *stagingBuffer = staging.buffer;
+    *stagingOffset = offset;
+    return static_cast<unsigned char*>(staging.allocation.mapped) + offset;
+}
+
+bool UploadManager::tryReserve(VkDeviceSize size, VkDeviceSize alignment, VkDeviceSize* offset) {
+    if (used == 0) {
+        head = 0; // nothing in flight, start from the beginning to keep the whole arena contiguous
+    }
+
+    // the oldest byte still in use, equal to the head when the arena is full
+    VkDeviceSize tail = (head + capacity - used) % capacity;
+    VkDeviceSize start = alignUp(head, alignment);
+    VkDeviceSize reserved;
+
+    if (used == 0 || tail < head) {
+        // free space runs from the head to the end of the arena, then from the start to the tail
+        if (start + size <= capacity) {
+            reserved = start + size - head;
+        }
+        else if (size <= tail) {
+            start = 0; // wrap around, the end of the arena is padding
+            reserved = capacity - head + size;
+        }
+        else {
+            return false;
+        }
+    }
+    else if (tail > head && start + size <= tail) {
+        reserved = start + size - head;
+    }
+    else {
+        return false;
+    }
+
+    used += reserved;
+    recording.stagingBytes += reserved;
+    head = (start + size) % capacity;
+    *offset = start;
+    return true;
+}
@@ -14,12 +14,18 @@
 #define GLFW_INCLUDE_VULKAN
 #include <GLFW/glfw3.h>
 
+#include <utils/Print.h>
+
 // reporting and propagating exceptions
 #include <iostream> 
 #include <stdexcept>
 
+#include <cstdio> // remove, rename
+#include <cstring> // strcmp, memcmp, memcpy
+#include <fstream>
 #include <set>
 #include <string>
+#include <vector>
 
 //
 // INITIALISATION AND DESTRUCTION
@@ -43,11 +49,25 @@ void VulkanSetup::initSetup(GLFWwindow* theWindow) {
     // create the logical device for interfacing with the physical device
     createLogicalDevice();
 
+    // device memory for buffers and images is sub-allocated from large blocks
+    allocator.init(physicalDevice, device);
+    if (memoryBudget) {
+        allocator.enableMemoryBudget(instance);
+    }
+
+    // pipelines compiled by previous runs are reused rather than built again
+    createPipelineCache();
+
     // we got this far so signal that the setup was complete
     setupComplete = true;
 }
 
 void VulkanSetup::cleanupSetup() {
+    // every pipeline has been created by now, keep them for the next run
+    writePipelineCache();
+    vkDestroyPipelineCache(device, pipelineCache, nullptr);
+    // every buffer and image has been destroyed by now, release the memory blocks
+    allocator.cleanup();
     // remove the logical device, no direct interaction with instance so not passed as argument
     vkDestroyDevice(device, nullptr);
     // destroy the window surface
@@ -131,6 +151,18 @@ std::vector<const char*> VulkanSetup::getRequiredExtensions() {
         extensions.push_back(VK_EXT_DEBUG_UTILS_EXTENSION_NAME);
     }
 
+    // optional, needed on vulkan 1.0 to query the memory budget of the device
+    uint32_t availableCount = 0;
+    vkEnumerateInstanceExtensionProperties(nullptr, &availableCount, nullptr);
+    std::vector<VkExtensionProperties> availableExtensions(availableCount);
+    vkEnumerateInstanceExtensionProperties(nullptr, &availableCount, availableExtensions.data());
+    for (const auto& extension : availableExtensions) {
+        if (strcmp(extension.extensionName, VK_KHR_GET_PHYSICAL_DEVICE_PROPERTIES_2_EXTENSION_NAME) == 0) {
+            extensions.push_back(VK_KHR_GET_PHYSICAL_DEVICE_PROPERTIES_2_EXTENSION_NAME);
+            physicalDeviceProperties2 = true;
+        }
+    }
+
     // return the vector
     return extensions;
 }
@@ -353,6 +385,20 @@ bool VulkanSetup::checkDeviceExtensionSupport(VkPhysicalDevice device) {
     return requiredExtensions.empty();
 }
 
+bool VulkanSetup::isDeviceExtensionSupported(VkPhysicalDevice device, const char* extensionName) {
+    uint32_t extensionCount;
+    vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionCount, nullptr);
+    std::vector<VkExtensionProperties> availableExtensions(extensionCount);
+    vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionCount, availableExtensions.data());
+
+    for (const auto& extension : availableExtensions) {
+        if (strcmp(extension.extensionName, extensionName) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
 VulkanSetup::SwapChainSupportDetails VulkanSetup::querySwapChainSupport(VkPhysicalDevice device) {
     VulkanSetup::SwapChainSupportDetails details;
     // query the surface capabilities and store in a VkSurfaceCapabilities struct
@@ -390,7 +436,8 @@ void VulkanSetup::createLogicalDevice() {
     // create a vector containing VkDeviceQueueCreqteInfo structs
     std::vector<VkDeviceQueueCreateInfo> queueCreateInfos;
     // using a set makes sure that there are no dulpicate references to a same queue!
-    std::set<uint32_t> uniqueQueueFamilies = { indices.graphicsFamily.value(), indices.presentFamily.value() };
+    std::set<uint32_t> uniqueQueueFamilies = { indices.graphicsFamily.value(), indices.presentFamily.value(), 
+        indices.getTransferFamily() };
 
     // queue priority, for now give queues the same priority
     float queuePriority = 1.0f;
@@ -410,6 +457,18 @@ void VulkanSetup::createLogicalDevice() {
     VkPhysicalDeviceFeatures deviceFeatures{};
     deviceFeatures.samplerAnisotropy = VK_TRUE; // we want the device to use anisotropic filtering if available
 
+    // block compressed textures are sampled as they are when the device has them, otherwise they are decoded on the host
+    VkPhysicalDeviceFeatures supportedFeatures;
+    vkGetPhysicalDeviceFeatures(physicalDevice, &supportedFeatures);
+    deviceFeatures.textureCompressionBC = supportedFeatures.textureCompressionBC;
+
+    // optional extensions are enabled on top of the required ones when the device has them
+    std::vector<const char*> extensions = deviceExtensions;
+    if (physicalDeviceProperties2 && isDeviceExtensionSupported(physicalDevice, VK_EXT_MEMORY_BUDGET_EXTENSION_NAME)) {
+        extensions.push_back(VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);
+        memoryBudget = true;
+    }
+
     // the struct containing the device info
     VkDeviceCreateInfo createInfo{};
     createInfo.sType                   = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO; // inform on type of struct
@@ -418,8 +477,8 @@ void VulkanSetup::createLogicalDevice() {
 
     createInfo.pEnabledFeatures        = &deviceFeatures; // desired device features
     // setting validation layers and extensions is per device
-    createInfo.enabledExtensionCount   = static_cast<uint32_t>(deviceExtensions.size()); // the number of desired extensions
-    createInfo.ppEnabledExtensionNames = deviceExtensions.data(); // pointer to the vector containing the desired extensions 
+    createInfo.enabledExtensionCount   = static_cast<uint32_t>(extensions.size()); // the number of desired extensions
+    createInfo.ppEnabledExtensionNames = extensions.data(); // pointer to the vector containing the desired extensions 
 
     // older implementation compatibility, no disitinction instance and device specific validations
     if (enableValidationLayers) {
@@ -440,4 +499,124 @@ void VulkanSetup::createLogicalDevice() {
     vkGetDeviceQueue(device, indices.graphicsFamily.value(), 0, &graphicsQueue);
     // set the presentation queue handle like above
     vkGetDeviceQueue(device, indices.presentFamily.value(), 0, &presentQueue);
+    // and the transfer queue, which is the graphics queue itself without a dedicated family
+    vkGetDeviceQueue(device, indices.getTransferFamily(), 0, &transferQueue);
+
+    graphicsFamily = indices.graphicsFamily.value();
+    transferFamily = indices.getTransferFamily();
+}
+
+//
+// PIPELINE CACHE
+//
+
+// prefixed to the driver's data, vulkan validates its own header too but a driver update keeping the same cache 
+// uuid or a truncated file should never reach the driver
+struct PipelineCacheHeader {
+    char magic[4];
+    UI32 version;
+    UI32 vendorID;
+    UI32 deviceID;
+    UI32 driverVersion;
+    UI8  pipelineCacheUUID[VK_UUID_SIZE];
+    UI64 dataSize;
+    UI64 dataHash;
+};
+
+static const char PIPELINE_CACHE_MAGIC[4] = { 'H', 'P', 'G', 'P' };
+static const UI32 PIPELINE_CACHE_VERSION  = 1;
+
+static UI64 hashPipelineCacheData(const unsigned char* data, size_t size) {
+    // fnv-1a, the data is small and only hashed when loading and writing
+    UI64 hash = 0xcbf29ce484222325ULL;
+    for (size_t i = 0; i < size; i++) {
+        hash = (hash ^ data[i]) * 0x100000001b3ULL;
+    }
+    return hash;
+}
+
+static PipelineCacheHeader getPipelineCacheHeader(const VkPhysicalDeviceProperties& properties) {
+    PipelineCacheHeader header{};
+    memcpy(header.magic, PIPELINE_CACHE_MAGIC, sizeof(PIPELINE_CACHE_MAGIC));
+    header.version       = PIPELINE_CACHE_VERSION;
+    header.vendorID      = properties.vendorID;
+    header.deviceID      = properties.deviceID;
+    header.driverVersion = properties.driverVersion;
+    memcpy(header.pipelineCacheUUID, properties.pipelineCacheUUID, VK_UUID_SIZE);
+    return header;
+}
+
+void VulkanSetup::createPipelineCache() {
+    std::vector<unsigned char> data;
+
+    std::ifstream in(PIPELINE_CACHE_PATH, std::ios::binary | std::ios::ate);
+    if (in) {
+        size_t fileSize = static_cast<size_t>(in.tellg());
+        in.seekg(0);
+
+        PipelineCacheHeader expected = getPipelineCacheHeader(deviceProperties);
+        PipelineCacheHeader header{};
+        if (fileSize >= sizeof(PipelineCacheHeader) && in.read(reinterpret_cast<char*>(&header), sizeof(PipelineCacheHeader)) &&
+            memcmp(header.magic, expected.magic, sizeof(header.magic)) == 0 && header.version == expected.version &&
+            header.vendorID == expected.vendorID && header.deviceID == expected.deviceID && 
+            header.driverVersion == expected.driverVersion && 
+            memcmp(header.pipelineCacheUUID, expected.pipelineCacheUUID, VK_UUID_SIZE) == 0 &&
+            header.dataSize == fileSize - sizeof(PipelineCacheHeader)) {
+            data.resize(static_cast<size_t>(header.dataSize));
+            if (!in.read(reinterpret_cast<char*>(data.data()), data.size()) || 
+                hashPipelineCacheData(data.data(), data.size()) != header.dataHash) {
+                data.clear();
+            }
+        }
+
+        if (data.empty()) {
+            PRINT("pipeline cache %s is stale or corrupt, starting empty\n", PIPELINE_CACHE_PATH.c_str());
+        }
+    }
+
+    VkPipelineCacheCreateInfo createInfo{};
+    createInfo.sType           = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+    createInfo.initialDataSize = data.size();
+    createInfo.pInitialData    = data.empty() ? nullptr : data.data();
+
+    if (vkCreatePipelineCache(device, &createInfo, nullptr, &pipelineCache) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create pipeline cache!");
+    }
+}
+
+void VulkanSetup::writePipelineCache() {
+    size_t dataSize = 0;
+    if (vkGetPipelineCacheData(device, pipelineCache, &dataSize, nullptr) != VK_SUCCESS || dataSize == 0) {
+        return;
+    }
+
+    std::vector<unsigned char> data(dataSize);
+    if (vkGetPipelineCacheData(device, pipelineCache, &dataSize, data.data()) != VK_SUCCESS) {
+        return;
+    }
+
+    PipelineCacheHeader header = getPipelineCacheHeader(deviceProperties);
+    header.dataSize = dataSize;
+    header.dataHash = hashPipelineCacheData(data.data(), dataSize);
+
+    // a failed write only costs the next run its warm start, shutdown carries on
+    std::string tmpPath = PIPELINE_CACHE_PATH + ".tmp";
+    std::ofstream out(tmpPath, std::ios::binary | std::ios::trunc);
+    out.write(reinterpret_cast<const char*>(&header), sizeof(PipelineCacheHeader));
+    out.write(reinterpret_cast<const char*>(data.data()), static_cast<std::streamsize>(dataSize));
+    out.close();
+    if (!out) {
+        std::remove(tmpPath.c_str());
+        PRINT("failed to write pipeline cache %s\n", tmpPath.c_str());
+        return;
+    }
+
+    std::remove(PIPELINE_CACHE_PATH.c_str()); // rename does not replace existing files on windows
+    if (std::rename(tmpPath.c_str(), PIPELINE_CACHE_PATH.c_str()) != 0) {
+        std::remove(tmpPath.c_str());
+        PRINT("failed to move %s to %s\n", tmpPath.c_str(), PIPELINE_CACHE_PATH.c_str());
+        return;
+    }
+
+    PRINT("wrote pipeline cache %s (%zu bytes)\n", PIPELINE_CACHE_PATH.c_str(), dataSize);
 }
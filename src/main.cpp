@@ -6,11 +6,68 @@
 #include <iostream> 
 #include <stdexcept>
 #include <cstdlib> // EXIT_SUCCES and EXIT_FAILURE
+#include <string>
 
 // include the application
 #include <app/Application.h>
 
-int main() {
+#include <common/ObjParser.h>
+
+#include <utils/Ktx2File.h>
+
+#include <vector>
+
+// block compressed formats the texture converter writes, colour textures are sRGB as the renderer samples them
+static VkFormat getConversionFormat(const std::string& name) {
+    if (name == "bc1") return VK_FORMAT_BC1_RGB_SRGB_BLOCK;
+    if (name == "bc1-unorm") return VK_FORMAT_BC1_RGB_UNORM_BLOCK;
+    if (name == "bc3") return VK_FORMAT_BC3_SRGB_BLOCK;
+    if (name == "bc3-unorm") return VK_FORMAT_BC3_UNORM_BLOCK;
+    if (name == "bc4") return VK_FORMAT_BC4_UNORM_BLOCK;
+    if (name == "bc5") return VK_FORMAT_BC5_UNORM_BLOCK;
+    if (name == "bc7") return VK_FORMAT_BC7_SRGB_BLOCK;
+    if (name == "bc7-unorm") return VK_FORMAT_BC7_UNORM_BLOCK;
+    throw std::runtime_error("unknown texture format " + name + "!");
+}
+
+int main(int argc, char* argv[]) {
+    // DeferredRendering.exe --benchmark-obj <path> times the obj parser instead of running the application
+    if (argc > 2 && std::string(argv[1]) == "--benchmark-obj") {
+        try {
+            ObjParser::benchmark(argv[2]);
+        }
+        catch (const std::exception& e) {
+            std::cerr << e.what() << std::endl;
+            return EXIT_FAILURE;
+        }
+        return EXIT_SUCCESS;
+    }
+
+    // DeferredRendering.exe --benchmark-vertex-format <path> compares the packed and float vertex formats of a model
+    if (argc > 2 && std::string(argv[1]) == "--benchmark-vertex-format") {
+        try {
+            Model::benchmarkVertexFormats(argv[2]);
+        }
+        catch (const std::exception& e) {
+            std::cerr << e.what() << std::endl;
+            return EXIT_FAILURE;
+        }
+        return EXIT_SUCCESS;
+    }
+
+    // DeferredRendering.exe --convert-texture <format> <output.ktx2> <image> | <6 cube map faces> compresses a texture 
+    // and its mip chain offline, faces are given in the skybox's order: right, left, bottom, top, front, back
+    if (argc > 4 && std::string(argv[1]) == "--convert-texture") {
+        try {
+            Ktx2File::convert(std::vector<std::string>(argv + 4, argv + argc), argv[3], getConversionFormat(argv[2]));
+        }
+        catch (const std::exception& e) {
+            std::cerr << e.what() << std::endl;
+            return EXIT_FAILURE;
+        }
+        return EXIT_SUCCESS;
+    }
+
     Application app;
     try {
         app.run();
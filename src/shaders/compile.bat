@@ -2,6 +2,8 @@ C:/VulkanSDK/1.2.162.1/Bin/glslc.exe offscreen.vert -o offscreen.vert.spv
 
 C:/VulkanSDK/1.2.162.1/Bin/glslc.exe offscreen.frag -o offscreen.frag.spv
 
+C:/VulkanSDK/1.2.162.1/Bin/glslc.exe offscreen_packed.vert -o offscreen_packed.vert.spv
+
 C:/VulkanSDK/1.2.162.1/Bin/glslc.exe composition.vert -o composition.vert.spv
 
 C:/VulkanSDK/1.2.162.1/Bin/glslc.exe composition.frag -o composition.frag.spv
@@ -18,4 +20,6 @@ C:/VulkanSDK/1.2.162.1/Bin/glslc.exe shadowmap.vert -o shadowmap.vert.spv
 
 C:/VulkanSDK/1.2.162.1/Bin/glslc.exe shadowmap.frag -o shadowmap.frag.spv
 
+C:/VulkanSDK/1.2.162.1/Bin/glslc.exe shadowmap_packed.vert -o shadowmap_packed.vert.spv
+
 pause
\ No newline at end of file
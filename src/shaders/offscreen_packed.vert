@@ -0,0 +1,51 @@
+#version 450
+#extension GL_ARB_separate_shader_objects : enable
+
+//
+// Vertex shader for deferred rendering offscreen stage, packed vertex format
+// 
+
+// uniform
+layout(binding = 0, std140) uniform UniformBufferObject {
+    mat4 modl; // includes the position dequantisation
+    mat4 view;
+	mat4 proj;
+	mat4 norm;
+	vec4 uvTransform; // offset in xy, scale in zw
+} ubo;
+
+// inputs specified in the vertex buffer attributes, unorm and snorm values arrive as floats
+layout(location = 0) in vec4 inPosition; // w holds the tangent handedness
+layout(location = 1) in vec2 inNormal;   // octahedral encoded
+layout(location = 2) in vec2 inTangent;  // octahedral encoded
+layout(location = 3) in vec2 inTexCoord;
+
+// outputs
+layout(location = 0) out vec3 fragPos;
+layout(location = 1) out vec3 fragNormal;
+layout(location = 2) out vec4 fragTangent;
+layout(location = 3) out vec2 fragTexCoord;
+
+vec3 octDecode(vec2 e) {
+	vec3 v = vec3(e, 1.0f - abs(e.x) - abs(e.y));
+	float t = max(-v.z, 0.0f);
+	v.x += v.x >= 0.0f ? -t : t;
+	v.y += v.y >= 0.0f ? -t : t;
+	return normalize(v);
+}
+
+void main() {
+	// position
+	vec4 tmpPos = ubo.modl * vec4(inPosition.xyz, 1.0f);
+	fragPos      = tmpPos.xyz;
+
+	vec4 pos = ubo.proj * ubo.view * tmpPos;
+	gl_Position = pos;
+	// normal
+	mat3 normal  = mat3(ubo.norm);
+    fragNormal   = normal * octDecode(inNormal);
+	// tangent
+	fragTangent  = vec4(octDecode(inTangent), inPosition.w * 2.0f - 1.0f);
+	// texture uv
+    fragTexCoord = ubo.uvTransform.xy + inTexCoord * ubo.uvTransform.zw;
+}
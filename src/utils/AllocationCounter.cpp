@@ -0,0 +1,47 @@
+//
+// Definition of the heap allocation counter and the replaced global operator new
+//
+
+#include <utils/AllocationCounter.h>
+
+#include <atomic>
+#include <cstdlib> // malloc, free
+#include <new> // bad_alloc
+
+namespace {
+    std::atomic<UI64> numHeapAllocations{ 0 };
+}
+
+UI64 utils::getNumHeapAllocations() {
+    return numHeapAllocations.load(std::memory_order_relaxed);
+}
+
+void* utils::countedMalloc(size_t size) {
+    numHeapAllocations.fetch_add(1, std::memory_order_relaxed);
+    return malloc(size);
+}
+
+void utils::countedFree(void* ptr) {
+    free(ptr);
+}
+
+//
+// Global operator new and delete, the array and nothrow forms call these by default. Over aligned
+// allocations go through the library's aligned forms and are not counted
+//
+
+void* operator new(size_t size) {
+    void* ptr = utils::countedMalloc(size > 0 ? size : 1);
+    if (!ptr) {
+        throw std::bad_alloc();
+    }
+    return ptr;
+}
+
+void operator delete(void* ptr) noexcept {
+    utils::countedFree(ptr);
+}
+
+void operator delete(void* ptr, size_t) noexcept {
+    utils::countedFree(ptr);
+}
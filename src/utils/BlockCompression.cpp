@@ -0,0 +1,715 @@
+//
+// Definition of the block compression codec
+//
+
+#include <utils/BlockCompression.h>
+#include <utils/Downsample.h> // getMipDimension
+
+#include <algorithm> // min, max, swap
+#include <cfloat> // FLT_MAX
+#include <cmath> // abs
+#include <cstdint> // UINT32_MAX
+#include <cstring> // memset, memcpy
+#include <stdexcept>
+
+namespace utils {
+    //-BC7 tables--------------------------------------------------------------------------------------------------//
+    // subset of each texel in the 2 subset partitions, one bit per texel from the block's first texel up
+    static const UI16 BC7_PARTITIONS_2[64] = {
+        0xcccc, 0x8888, 0xeeee, 0xecc8, 0xc880, 0xfeec, 0xfec8, 0xec80, 0xc800, 0xffec, 0xfe80, 0xe800, 0xffe8, 0xff00, 0xfff0, 0xf000,
+        0xf710, 0x008e, 0x7100, 0x08ce, 0x008c, 0x7310, 0x3100, 0x8cce, 0x088c, 0x3110, 0x6666, 0x366c, 0x17e8, 0x0ff0, 0x718e, 0x399c,
+        0xaaaa, 0xf0f0, 0x5a5a, 0x33cc, 0x3c3c, 0x55aa, 0x9696, 0xa55a, 0x73ce, 0x13c8, 0x324c, 0x3bdc, 0x6996, 0xc33c, 0x9966, 0x0660,
+        0x0272, 0x04e4, 0x4e40, 0x2720, 0xc936, 0x936c, 0x39c6, 0x639c, 0x9336, 0x9cc6, 0x817e, 0xe718, 0xccf0, 0x0fcc, 0x7744, 0xee22
+    };
+
+    static const unsigned char BC7_PARTITIONS_3[64][16] = {
+        { 0, 0, 1, 1, 0, 0, 1, 1, 0, 2, 2, 1, 2, 2, 2, 2 }, { 0, 0, 0, 1, 0, 0, 1, 1, 2, 2, 1, 1, 2, 2, 2, 1 },
+        { 0, 0, 0, 0, 2, 0, 0, 1, 2, 2, 1, 1, 2, 2, 1, 1 }, { 0, 2, 2, 2, 0, 0, 2, 2, 0, 0, 1, 1, 0, 1, 1, 1 },
+        { 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 2, 2, 1, 1, 2, 2 }, { 0, 0, 1, 1, 0, 0, 1, 1, 0, 0, 2, 2, 0, 0, 2, 2 },
+        { 0, 0, 2, 2, 0, 0, 2, 2, 1, 1, 1, 1, 1, 1, 1, 1 }, { 0, 0, 1, 1, 0, 0, 1, 1, 2, 2, 1, 1, 2, 2, 1, 1 },
+        { 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2 }, { 0, 0, 0, 0, 1, 1, 1, 1, 1, 1, 1, 1, 2, 2, 2, 2 },
+        { 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 2, 2, 2, 2 }, { 0, 0, 1, 2, 0, 0, 1, 2, 0, 0, 1, 2, 0, 0, 1, 2 },
+        { 0, 1, 1, 2, 0, 1, 1, 2, 0, 1, 1, 2, 0, 1, 1, 2 }, { 0, 1, 2, 2, 0, 1, 2, 2, 0, 1, 2, 2, 0, 1, 2, 2 },
+        { 0, 0, 1, 1, 0, 1, 1, 2, 1, 1, 2, 2, 1, 2, 2, 2 }, { 0, 0, 1, 1, 2, 0, 0, 1, 2, 2, 0, 0, 2, 2, 2, 0 },
+        { 0, 0, 0, 1, 0, 0, 1, 1, 0, 1, 1, 2, 1, 1, 2, 2 }, { 0, 1, 1, 1, 0, 0, 1, 1, 2, 0, 0, 1, 2, 2, 0, 0 },
+        { 0, 0, 0, 0, 1, 1, 2, 2, 1, 1, 2, 2, 1, 1, 2, 2 }, { 0, 0, 2, 2, 0, 0, 2, 2, 0, 0, 2, 2, 1, 1, 1, 1 },
+        { 0, 1, 1, 1, 0, 1, 1, 1, 0, 2, 2, 2, 0, 2, 2, 2 }, { 0, 0, 0, 1, 0, 0, 0, 1, 2, 2, 2, 1, 2, 2, 2, 1 },
+        { 0, 0, 0, 0, 0, 0, 1, 1, 0, 1, 2, 2, 0, 1, 2, 2 }, { 0, 0, 0, 0, 1, 1, 0, 0, 2, 2, 1, 0, 2, 2, 1, 0 },
+        { 0, 1, 2, 2, 0, 1, 2, 2, 0, 0, 1, 1, 0, 0, 0, 0 }, { 0, 0, 1, 2, 0, 0, 1, 2, 1, 1, 2, 2, 2, 2, 2, 2 },
+        { 0, 1, 1, 0, 1, 2, 2, 1, 1, 2, 2, 1, 0, 1, 1, 0 }, { 0, 0, 0, 0, 0, 1, 1, 0, 1, 2, 2, 1, 1, 2, 2, 1 },
+        { 0, 0, 2, 2, 1, 1, 0, 2, 1, 1, 0, 2, 0, 0, 2, 2 }, { 0, 1, 1, 0, 0, 1, 1, 0, 2, 0, 0, 2, 2, 2, 2, 2 },
+        { 0, 0, 1, 1, 0, 1, 2, 2, 0, 1, 2, 2, 0, 0, 1, 1 }, { 0, 0, 0, 0, 2, 0, 0, 0, 2, 2, 1, 1, 2, 2, 2, 1 },
+        { 0, 0, 0, 0, 0, 0, 0, 2, 1, 1, 2, 2, 1, 2, 2, 2 }, { 0, 2, 2, 2, 0, 0, 2, 2, 0, 0, 1, 2, 0, 0, 1, 1 },
+        { 0, 0, 1, 1, 0, 0, 1, 2, 0, 0, 2, 2, 0, 2, 2, 2 }, { 0, 1, 2, 0, 0, 1, 2, 0, 0, 1, 2, 0, 0, 1, 2, 0 },
+        { 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 0, 0, 0, 0 }, { 0, 1, 2, 0, 1, 2, 0, 1, 2, 0, 1, 2, 0, 1, 2, 0 },
+        { 0, 1, 2, 0, 2, 0, 1, 2, 1, 2, 0, 1, 0, 1, 2, 0 }, { 0, 0, 1, 1, 2, 2, 0, 0, 1, 1, 2, 2, 0, 0, 1, 1 },
+        { 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 0, 0, 0, 0, 1, 1 }, { 0, 1, 0, 1, 0, 1, 0, 1, 2, 2, 2, 2, 2, 2, 2, 2 },
+        { 0, 0, 0, 0, 0, 0, 0, 0, 2, 1, 2, 1, 2, 1, 2, 1 }, { 0, 0, 2, 2, 1, 1, 2, 2, 0, 0, 2, 2, 1, 1, 2, 2 },
+        { 0, 0, 2, 2, 0, 0, 1, 1, 0, 0, 2, 2, 0, 0, 1, 1 }, { 0, 2, 2, 0, 1, 2, 2, 1, 0, 2, 2, 0, 1, 2, 2, 1 },
+        { 0, 1, 0, 1, 2, 2, 2, 2, 2, 2, 2, 2, 0, 1, 0, 1 }, { 0, 0, 0, 0, 2, 1, 2, 1, 2, 1, 2, 1, 2, 1, 2, 1 },
+        { 0, 1, 0, 1, 0, 1, 0, 1, 0, 1, 0, 1, 2, 2, 2, 2 }, { 0, 2, 2, 2, 0, 1, 1, 1, 0, 2, 2, 2, 0, 1, 1, 1 },
+        { 0, 0, 0, 2, 1, 1, 1, 2, 0, 0, 0, 2, 1, 1, 1, 2 }, { 0, 0, 0, 0, 2, 1, 1, 2, 2, 1, 1, 2, 2, 1, 1, 2 },
+        { 0, 2, 2, 2, 0, 1, 1, 1, 0, 1, 1, 1, 0, 2, 2, 2 }, { 0, 0, 0, 2, 1, 1, 1, 2, 1, 1, 1, 2, 0, 0, 0, 2 },
+        { 0, 1, 1, 0, 0, 1, 1, 0, 0, 1, 1, 0, 2, 2, 2, 2 }, { 0, 0, 0, 0, 0, 0, 0, 0, 2, 1, 1, 2, 2, 1, 1, 2 },
+        { 0, 1, 1, 0, 0, 1, 1, 0, 2, 2, 2, 2, 2, 2, 2, 2 }, { 0, 0, 2, 2, 0, 0, 1, 1, 0, 0, 1, 1, 0, 0, 2, 2 },
+        { 0, 0, 2, 2, 1, 1, 2, 2, 1, 1, 2, 2, 0, 0, 2, 2 }, { 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 2, 1, 1, 2 },
+        { 0, 0, 0, 2, 0, 0, 0, 1, 0, 0, 0, 2, 0, 0, 0, 1 }, { 0, 2, 2, 2, 1, 2, 2, 2, 0, 2, 2, 2, 1, 2, 2, 2 },
+        { 0, 1, 0, 1, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2 }, { 0, 1, 1, 1, 2, 0, 1, 1, 2, 2, 0, 1, 2, 2, 2, 0 }
+    };
+
+    // texels whose index drops its top bit, the first texel is always the anchor of the first subset
+    static const unsigned char BC7_ANCHORS_2[64] = {
+        15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15,
+        15,  2,  8,  2,  2,  8,  8, 15,  2,  8,  2,  2,  8,  8,  2,  2,
+        15, 15,  6,  8,  2,  8, 15, 15,  2,  8,  2,  2,  2, 15, 15,  6,
+         6,  2,  6,  8, 15, 15,  2,  2, 15, 15, 15, 15, 15,  2,  2, 15
+    };
+
+    static const unsigned char BC7_ANCHORS_3_SECOND[64] = {
+         3,  3, 15, 15,  8,  3, 15, 15,  8,  8,  6,  6,  6,  5,  3,  3,
+         3,  3,  8, 15,  3,  3,  6, 10,  5,  8,  8,  6,  8,  5, 15, 15,
+         8, 15,  3,  5,  6, 10,  8, 15, 15,  3, 15,  5, 15, 15, 15, 15,
+         3, 15,  5,  5,  5,  8,  5, 10,  5, 10,  8, 13, 15, 12,  3,  3
+    };
+
+    static const unsigned char BC7_ANCHORS_3_THIRD[64] = {
+        15,  8,  8,  3, 15, 15,  3,  8, 15, 15, 15, 15, 15, 15, 15,  8,
+        15,  8, 15,  3, 15,  8, 15,  8,  3, 15,  6, 10, 15, 15, 10,  8,
+        15,  3, 15, 10, 10,  8,  9, 10,  6, 15,  8, 15,  3,  6,  6,  8,
+        15,  3, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15,  3, 15, 15,  8
+    };
+
+    // interpolation weights out of 64 for 2, 3 and 4 bit indices
+    static const unsigned char BC7_WEIGHTS_2[4]  = { 0, 21, 43, 64 };
+    static const unsigned char BC7_WEIGHTS_3[8]  = { 0, 9, 18, 27, 37, 46, 55, 64 };
+    static const unsigned char BC7_WEIGHTS_4[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+    struct Bc7Mode {
+        UI32 numSubsets;
+        UI32 partitionBits;
+        UI32 rotationBits;
+        UI32 indexSelectionBits;
+        UI32 colourBits;
+        UI32 alphaBits;
+        UI32 endpointPBits; // one per endpoint
+        UI32 sharedPBits;   // one per subset
+        UI32 indexBits;
+        UI32 secondaryIndexBits; // alpha indices of the modes with separate colour and alpha
+    };
+
+    static const Bc7Mode BC7_MODES[8] = {
+        { 3, 4, 0, 0, 4, 0, 1, 0, 3, 0 },
+        { 2, 6, 0, 0, 6, 0, 0, 1, 3, 0 },
+        { 3, 6, 0, 0, 5, 0, 0, 0, 2, 0 },
+        { 2, 6, 0, 0, 7, 0, 1, 0, 2, 0 },
+        { 1, 0, 2, 1, 5, 6, 0, 0, 2, 3 },
+        { 1, 0, 2, 0, 7, 8, 0, 0, 2, 2 },
+        { 1, 0, 0, 0, 7, 7, 1, 0, 4, 0 },
+        { 2, 6, 0, 0, 5, 5, 1, 0, 2, 0 }
+    };
+
+    //-Bit streams, least significant bit first------------------------------------------------------------------//
+    struct BitReader {
+        const unsigned char* data;
+        UI32 position = 0;
+
+        inline UI32 read(UI32 numBits) {
+            UI32 value = 0;
+            for (UI32 i = 0; i < numBits; i++, position++) {
+                value |= ((data[position >> 3] >> (position & 7)) & 1) << i;
+            }
+            return value;
+        }
+    };
+
+    struct BitWriter {
+        unsigned char* data; // zeroed
+        UI32 position = 0;
+
+        inline void write(UI32 value, UI32 numBits) {
+            for (UI32 i = 0; i < numBits; i++, position++) {
+                data[position >> 3] |= static_cast<unsigned char>(((value >> i) & 1) << (position & 7));
+            }
+        }
+    };
+
+    //-Decoding--------------------------------------------------------------------------------------------------//
+    static inline UI32 readUI16(const unsigned char* data) {
+        return data[0] | (data[1] << 8);
+    }
+
+    static inline void unpack565(UI32 colour, unsigned char* rgb) {
+        UI32 r = (colour >> 11) & 0x1f;
+        UI32 g = (colour >> 5) & 0x3f;
+        UI32 b = colour & 0x1f;
+        rgb[0] = static_cast<unsigned char>((r << 3) | (r >> 2));
+        rgb[1] = static_cast<unsigned char>((g << 2) | (g >> 4));
+        rgb[2] = static_cast<unsigned char>((b << 3) | (b >> 2));
+    }
+
+    // the four colours a BC1 block's indices select, three and transparent black when the endpoints are in order
+    static void getColourPalette(const unsigned char* block, bool threeColourMode, unsigned char palette[4][4]) {
+        UI32 c0 = readUI16(block);
+        UI32 c1 = readUI16(block + 2);
+        unpack565(c0, palette[0]);
+        unpack565(c1, palette[1]);
+        palette[0][3] = palette[1][3] = palette[2][3] = palette[3][3] = 255;
+
+        for (UI32 c = 0; c < 3; c++) {
+            if (c0 > c1 || !threeColourMode) {
+                palette[2][c] = static_cast<unsigned char>((2 * palette[0][c] + palette[1][c] + 1) / 3);
+                palette[3][c] = static_cast<unsigned char>((palette[0][c] + 2 * palette[1][c] + 1) / 3);
+            }
+            else {
+                palette[2][c] = static_cast<unsigned char>((palette[0][c] + palette[1][c] + 1) / 2);
+                palette[3][c] = 0;
+            }
+        }
+        if (c0 <= c1 && threeColourMode) {
+            palette[3][3] = 0;
+        }
+    }
+
+    static void getChannelPalette(const unsigned char* block, unsigned char palette[8]) {
+        UI32 r0 = block[0];
+        UI32 r1 = block[1];
+        palette[0] = static_cast<unsigned char>(r0);
+        palette[1] = static_cast<unsigned char>(r1);
+        if (r0 > r1) {
+            for (UI32 i = 2; i < 8; i++) {
+                palette[i] = static_cast<unsigned char>(((8 - i) * r0 + (i - 1) * r1 + 3) / 7);
+            }
+        }
+        else {
+            for (UI32 i = 2; i < 6; i++) {
+                palette[i] = static_cast<unsigned char>(((6 - i) * r0 + (i - 1) * r1 + 2) / 5);
+            }
+            palette[6] = 0;
+            palette[7] = 255;
+        }
+    }
+
+    static void decodeColourBlock(const unsigned char* block, bool threeColourMode, unsigned char texels[16][4]) {
+        unsigned char palette[4][4];
+        getColourPalette(block, threeColourMode, palette);
+        UI32 indices = block[4] | (block[5] << 8) | (block[6] << 16) | (static_cast<UI32>(block[7]) << 24);
+        for (UI32 i = 0; i < 16; i++) {
+            memcpy(texels[i], palette[(indices >> (2 * i)) & 3], 4);
+        }
+    }
+
+    static void decodeChannelBlock(const unsigned char* block, UI32 channel, unsigned char texels[16][4]) {
+        unsigned char palette[8];
+        getChannelPalette(block, palette);
+        BitReader reader{ block + 2 };
+        for (UI32 i = 0; i < 16; i++) {
+            texels[i][channel] = palette[reader.read(3)];
+        }
+    }
+
+    static inline UI32 expandBits(UI32 value, UI32 numBits) {
+        value <<= 8 - numBits;
+        return value | (value >> numBits);
+    }
+
+    static inline UI32 interpolate(UI32 e0, UI32 e1, UI32 weight) {
+        return ((64 - weight) * e0 + weight * e1 + 32) >> 6;
+    }
+
+    static void decodeBc7Block(const unsigned char* block, unsigned char texels[16][4]) {
+        UI32 modeIdx = 0;
+        while (modeIdx < 8 && !(block[0] & (1 << modeIdx))) {
+            modeIdx++;
+        }
+        // reserved mode, decodes to transparent black
+        if (modeIdx == 8) {
+            memset(texels, 0, 16 * 4);
+            return;
+        }
+
+        const Bc7Mode& mode = BC7_MODES[modeIdx];
+        BitReader reader{ block };
+        reader.read(modeIdx + 1);
+        UI32 partition = reader.read(mode.partitionBits);
+        UI32 rotation = reader.read(mode.rotationBits);
+        UI32 indexSelection = reader.read(mode.indexSelectionBits);
+
+        // channels are stored together, both endpoints of each subset in turn
+        UI32 endpoints[3][2][4];
+        for (UI32 c = 0; c < 3; c++) {
+            for (UI32 s = 0; s < mode.numSubsets; s++) {
+                endpoints[s][0][c] = reader.read(mode.colourBits);
+                endpoints[s][1][c] = reader.read(mode.colourBits);
+            }
+        }
+        for (UI32 s = 0; s < mode.numSubsets; s++) {
+            endpoints[s][0][3] = reader.read(mode.alphaBits);
+            endpoints[s][1][3] = reader.read(mode.alphaBits);
+        }
+
+        UI32 colourBits = mode.colourBits;
+        UI32 alphaBits = mode.alphaBits;
+        if (mode.endpointPBits || mode.sharedPBits) {
+            for (UI32 s = 0; s < mode.numSubsets; s++) {
+                UI32 pBits[2];
+                pBits[0] = reader.read(1);
+                pBits[1] = mode.endpointPBits ? reader.read(1) : pBits[0];
+                for (UI32 e = 0; e < 2; e++) {
+                    for (UI32 c = 0; c < 4; c++) {
+                        endpoints[s][e][c] = (endpoints[s][e][c] << 1) | pBits[e];
+                    }
+                }
+            }
+            colourBits++;
+            alphaBits += alphaBits ? 1 : 0;
+        }
+
+        for (UI32 s = 0; s < mode.numSubsets; s++) {
+            for (UI32 e = 0; e < 2; e++) {
+                for (UI32 c = 0; c < 3; c++) {
+                    endpoints[s][e][c] = expandBits(endpoints[s][e][c], colourBits);
+                }
+                endpoints[s][e][3] = alphaBits ? expandBits(endpoints[s][e][3], alphaBits) : 255;
+            }
+        }
+
+        UI32 subsets[16];
+        for (UI32 i = 0; i < 16; i++) {
+            if (mode.numSubsets == 2) {
+                subsets[i] = (BC7_PARTITIONS_2[partition] >> i) & 1;
+            }
+            else if (mode.numSubsets == 3) {
+                subsets[i] = BC7_PARTITIONS_3[partition][i];
+            }
+            else {
+                subsets[i] = 0;
+            }
+        }
+
+        auto isAnchor = [&](UI32 texel) {
+            if (texel == 0) {
+                return true;
+            }
+            if (mode.numSubsets == 2) {
+                return texel == BC7_ANCHORS_2[partition];
+            }
+            if (mode.numSubsets == 3) {
+                return texel == BC7_ANCHORS_3_SECOND[partition] || texel == BC7_ANCHORS_3_THIRD[partition];
+            }
+            return false;
+        };
+
+        UI32 indices[16];
+        UI32 secondaryIndices[16];
+        for (UI32 i = 0; i < 16; i++) {
+            indices[i] = reader.read(isAnchor(i) ? mode.indexBits - 1 : mode.indexBits);
+        }
+        for (UI32 i = 0; i < 16 && mode.secondaryIndexBits; i++) {
+            secondaryIndices[i] = reader.read(i == 0 ? mode.secondaryIndexBits - 1 : mode.secondaryIndexBits);
+        }
+
+        auto getWeight = [](UI32 index, UI32 numBits) -> UI32 {
+            return numBits == 2 ? BC7_WEIGHTS_2[index] : numBits == 3 ? BC7_WEIGHTS_3[index] : BC7_WEIGHTS_4[index];
+        };
+
+        for (UI32 i = 0; i < 16; i++) {
+            const UI32 (&e)[2][4] = endpoints[subsets[i]];
+            UI32 colourWeight = getWeight(indices[i], mode.indexBits);
+            UI32 alphaWeight = colourWeight;
+            if (mode.secondaryIndexBits) {
+                // the index selection bit swaps which stream the colour and alpha read from
+                UI32 secondaryWeight = getWeight(secondaryIndices[i], mode.secondaryIndexBits);
+                colourWeight = indexSelection ? secondaryWeight : colourWeight;
+                alphaWeight = indexSelection ? getWeight(indices[i], mode.indexBits) : secondaryWeight;
+            }
+            for (UI32 c = 0; c < 3; c++) {
+                texels[i][c] = static_cast<unsigned char>(interpolate(e[0][c], e[1][c], colourWeight));
+            }
+            texels[i][3] = static_cast<unsigned char>(interpolate(e[0][3], e[1][3], alphaWeight));
+
+            // rotation swaps alpha with one of the colour channels
+            if (rotation) {
+                std::swap(texels[i][3], texels[i][rotation - 1]);
+            }
+        }
+    }
+
+    VkFormat getDecodedFormat(VkFormat format) {
+        switch (format) {
+        case VK_FORMAT_BC1_RGB_UNORM_BLOCK:
+        case VK_FORMAT_BC1_RGBA_UNORM_BLOCK:
+        case VK_FORMAT_BC3_UNORM_BLOCK:
+        case VK_FORMAT_BC7_UNORM_BLOCK:
+            return VK_FORMAT_R8G8B8A8_UNORM;
+        case VK_FORMAT_BC1_RGB_SRGB_BLOCK:
+        case VK_FORMAT_BC1_RGBA_SRGB_BLOCK:
+        case VK_FORMAT_BC3_SRGB_BLOCK:
+        case VK_FORMAT_BC7_SRGB_BLOCK:
+            return VK_FORMAT_R8G8B8A8_SRGB;
+        case VK_FORMAT_BC4_UNORM_BLOCK:
+            return VK_FORMAT_R8_UNORM;
+        case VK_FORMAT_BC5_UNORM_BLOCK:
+            return VK_FORMAT_R8G8_UNORM;
+        default:
+            return VK_FORMAT_UNDEFINED;
+        }
+    }
+
+    void decodeBlocks(VkFormat format, const unsigned char* blocks, UI32 width, UI32 height, unsigned char* dst) {
+        VkFormat decodedFormat = getDecodedFormat(format);
+        if (decodedFormat == VK_FORMAT_UNDEFINED) {
+            throw std::runtime_error("cannot decode block compressed format!");
+        }
+        UI32 blockSize = VulkanImage::getFormatTexelSize(format);
+        UI32 texelSize = VulkanImage::getFormatTexelSize(decodedFormat);
+
+        for (UI32 by = 0; by < height; by += 4) {
+            for (UI32 bx = 0; bx < width; bx += 4, blocks += blockSize) {
+                unsigned char texels[16][4] = {};
+                switch (format) {
+                case VK_FORMAT_BC1_RGB_UNORM_BLOCK:
+                case VK_FORMAT_BC1_RGB_SRGB_BLOCK:
+                    decodeColourBlock(blocks, true, texels);
+                    // black rather than transparent, the format has no alpha
+                    for (auto& texel : texels) {
+                        texel[3] = 255;
+                    }
+                    break;
+                case VK_FORMAT_BC1_RGBA_UNORM_BLOCK:
+                case VK_FORMAT_BC1_RGBA_SRGB_BLOCK:
+                    decodeColourBlock(blocks, true, texels);
+                    break;
+                case VK_FORMAT_BC3_UNORM_BLOCK:
+                case VK_FORMAT_BC3_SRGB_BLOCK:
+                    decodeColourBlock(blocks + 8, false, texels);
+                    decodeChannelBlock(blocks, 3, texels);
+                    break;
+                case VK_FORMAT_BC4_UNORM_BLOCK:
+                    decodeChannelBlock(blocks, 0, texels);
+                    break;
+                case VK_FORMAT_BC5_UNORM_BLOCK:
+                    decodeChannelBlock(blocks, 0, texels);
+                    decodeChannelBlock(blocks + 8, 1, texels);
+                    break;
+                default:
+                    decodeBc7Block(blocks, texels);
+                    break;
+                }
+
+                // texels of partial blocks beyond the edges are dropped
+                for (UI32 y = 0; y < 4 && by + y < height; y++) {
+                    for (UI32 x = 0; x < 4 && bx + x < width; x++) {
+                        memcpy(dst + (static_cast<size_t>(by + y) * width + bx + x) * texelSize, texels[4 * y + x], texelSize);
+                    }
+                }
+            }
+        }
+    }
+
+    //-Encoding--------------------------------------------------------------------------------------------------//
+    // endpoints along the principal axis of the block's texels, found by power iteration on their covariance
+    static void fitEndpoints(const unsigned char texels[16][4], UI32 numChannels, F32 e0[4], F32 e1[4]) {
+        F32 mean[4] = {};
+        for (UI32 i = 0; i < 16; i++) {
+            for (UI32 c = 0; c < numChannels; c++) {
+                mean[c] += texels[i][c] / 16.0f;
+            }
+        }
+
+        F32 covariance[4][4] = {};
+        for (UI32 i = 0; i < 16; i++) {
+            for (UI32 a = 0; a < numChannels; a++) {
+                for (UI32 b = 0; b < numChannels; b++) {
+                    covariance[a][b] += (texels[i][a] - mean[a]) * (texels[i][b] - mean[b]);
+                }
+            }
+        }
+
+        // start from the bounding box diagonal, which is close for most blocks
+        F32 axis[4] = {};
+        for (UI32 i = 0; i < 16; i++) {
+            for (UI32 c = 0; c < numChannels; c++) {
+                axis[c] = std::max(axis[c], texels[i][c] - mean[c]);
+            }
+        }
+        for (UI32 iteration = 0; iteration < 8; iteration++) {
+            F32 next[4] = {};
+            F32 length = 0.0f;
+            for (UI32 a = 0; a < numChannels; a++) {
+                for (UI32 b = 0; b < numChannels; b++) {
+                    next[a] += covariance[a][b] * axis[b];
+                }
+                length = std::max(length, std::abs(next[a]));
+            }
+            if (length == 0.0f) {
+                break;
+            }
+            for (UI32 c = 0; c < numChannels; c++) {
+                axis[c] = next[c] / length;
+            }
+        }
+
+        F32 lengthSquared = 0.0f;
+        for (UI32 c = 0; c < numChannels; c++) {
+            lengthSquared += axis[c] * axis[c];
+        }
+
+        F32 minT = 0.0f;
+        F32 maxT = 0.0f;
+        if (lengthSquared > 0.0f) {
+            minT = FLT_MAX;
+            maxT = -FLT_MAX;
+            for (UI32 i = 0; i < 16; i++) {
+                F32 t = 0.0f;
+                for (UI32 c = 0; c < numChannels; c++) {
+                    t += (texels[i][c] - mean[c]) * axis[c];
+                }
+                t /= lengthSquared;
+                minT = std::min(minT, t);
+                maxT = std::max(maxT, t);
+            }
+        }
+
+        for (UI32 c = 0; c < numChannels; c++) {
+            e0[c] = std::min(std::max(mean[c] + axis[c] * minT, 0.0f), 255.0f);
+            e1[c] = std::min(std::max(mean[c] + axis[c] * maxT, 0.0f), 255.0f);
+        }
+    }
+
+    static inline UI32 pack565(const F32 rgb[3]) {
+        UI32 r = static_cast<UI32>(rgb[0] * 31.0f / 255.0f + 0.5f);
+        UI32 g = static_cast<UI32>(rgb[1] * 63.0f / 255.0f + 0.5f);
+        UI32 b = static_cast<UI32>(rgb[2] * 31.0f / 255.0f + 0.5f);
+        return (r << 11) | (g << 5) | b;
+    }
+
+    static inline UI32 squaredError(const unsigned char* a, const unsigned char* b, UI32 numChannels) {
+        UI32 error = 0;
+        for (UI32 c = 0; c < numChannels; c++) {
+            I32 d = static_cast<I32>(a[c]) - static_cast<I32>(b[c]);
+            error += d * d;
+        }
+        return error;
+    }
+
+    // four colour mode only, so the block decodes the same in BC1 and BC3
+    static void encodeColourBlock(const unsigned char texels[16][4], unsigned char* block) {
+        F32 e0[4], e1[4];
+        fitEndpoints(texels, 3, e0, e1);
+        UI32 c0 = pack565(e1);
+        UI32 c1 = pack565(e0);
+        if (c0 < c1) {
+            std::swap(c0, c1);
+        }
+
+        block[0] = static_cast<unsigned char>(c0);
+        block[1] = static_cast<unsigned char>(c0 >> 8);
+        block[2] = static_cast<unsigned char>(c1);
+        block[3] = static_cast<unsigned char>(c1 >> 8);
+
+        unsigned char palette[4][4];
+        getColourPalette(block, false, palette);
+
+        UI32 indices = 0;
+        for (UI32 i = 0; i < 16; i++) {
+            UI32 best = 0;
+            UI32 bestError = UINT32_MAX;
+            for (UI32 p = 0; p < 4; p++) {
+                UI32 error = squaredError(texels[i], palette[p], 3);
+                if (error < bestError) {
+                    best = p;
+                    bestError = error;
+                }
+            }
+            indices |= best << (2 * i);
+        }
+        block[4] = static_cast<unsigned char>(indices);
+        block[5] = static_cast<unsigned char>(indices >> 8);
+        block[6] = static_cast<unsigned char>(indices >> 16);
+        block[7] = static_cast<unsigned char>(indices >> 24);
+    }
+
+    static void encodeChannelBlock(const unsigned char texels[16][4], UI32 channel, unsigned char* block) {
+        // the eight value mode, with the endpoints in decreasing order
+        unsigned char minValue = 255;
+        unsigned char maxValue = 0;
+        for (UI32 i = 0; i < 16; i++) {
+            minValue = std::min(minValue, texels[i][channel]);
+            maxValue = std::max(maxValue, texels[i][channel]);
+        }
+        memset(block, 0, 8);
+        block[0] = maxValue;
+        block[1] = minValue;
+
+        unsigned char palette[8];
+        getChannelPalette(block, palette);
+
+        BitWriter writer{ block + 2 };
+        for (UI32 i = 0; i < 16; i++) {
+            UI32 best = 0;
+            UI32 bestError = UINT32_MAX;
+            for (UI32 p = 0; p < 8; p++) {
+                UI32 error = squaredError(&texels[i][channel], &palette[p], 1);
+                if (error < bestError) {
+                    best = p;
+                    bestError = error;
+                }
+            }
+            writer.write(best, 3);
+        }
+    }
+
+    // mode 6, a single subset of 7 bit RGBA endpoints with a p bit each and 4 bit indices
+    static void encodeBc7Block(const unsigned char texels[16][4], unsigned char* block) {
+        F32 fitted[2][4];
+        fitEndpoints(texels, 4, fitted[0], fitted[1]);
+
+        // the p bit is shared by every channel of an endpoint, keep the one closest to the fitted values
+        UI32 endpoints[2][4];
+        UI32 pBits[2];
+        for (UI32 e = 0; e < 2; e++) {
+            F32 bestError = FLT_MAX;
+            for (UI32 p = 0; p < 2; p++) {
+                UI32 quantised[4];
+                F32 error = 0.0f;
+                for (UI32 c = 0; c < 4; c++) {
+                    I32 q = static_cast<I32>((fitted[e][c] - p) / 2.0f + 0.5f);
+                    quantised[c] = static_cast<UI32>(std::min(std::max(q, 0), 127));
+                    F32 d = static_cast<F32>((quantised[c] << 1) | p) - fitted[e][c];
+                    error += d * d;
+                }
+                if (error < bestError) {
+                    bestError = error;
+                    memcpy(endpoints[e], quantised, sizeof(quantised));
+                    pBits[e] = p;
+                }
+            }
+        }
+
+        unsigned char palette[16][4];
+        for (UI32 i = 0; i < 16; i++) {
+            for (UI32 c = 0; c < 4; c++) {
+                palette[i][c] = static_cast<unsigned char>(interpolate((endpoints[0][c] << 1) | pBits[0],
+                    (endpoints[1][c] << 1) | pBits[1], BC7_WEIGHTS_4[i]));
+            }
+        }
+
+        UI32 indices[16];
+        for (UI32 i = 0; i < 16; i++) {
+            UI32 bestError = UINT32_MAX;
+            for (UI32 p = 0; p < 16; p++) {
+                UI32 error = squaredError(texels[i], palette[p], 4);
+                if (error < bestError) {
+                    indices[i] = p;
+                    bestError = error;
+                }
+            }
+        }
+
+        // the anchor texel's index has no top bit, swap the endpoints so it is clear
+        if (indices[0] & 8) {
+            std::swap(endpoints[0], endpoints[1]);
+            std::swap(pBits[0], pBits[1]);
+            for (auto& index : indices) {
+                index = 15 - index;
+            }
+        }
+
+        memset(block, 0, 16);
+        BitWriter writer{ block };
+        writer.write(1 << 6, 7);
+        for (UI32 c = 0; c < 4; c++) {
+            writer.write(endpoints[0][c], 7);
+            writer.write(endpoints[1][c], 7);
+        }
+        writer.write(pBits[0], 1);
+        writer.write(pBits[1], 1);
+        for (UI32 i = 0; i < 16; i++) {
+            writer.write(indices[i], i == 0 ? 3 : 4);
+        }
+    }
+
+    void encodeBlocks(VkFormat format, const unsigned char* rgba, UI32 width, UI32 height, unsigned char* blocks) {
+        if (getDecodedFormat(format) == VK_FORMAT_UNDEFINED) {
+            throw std::runtime_error("cannot encode block compressed format!");
+        }
+        UI32 blockSize = VulkanImage::getFormatTexelSize(format);
+
+        for (UI32 by = 0; by < height; by += 4) {
+            for (UI32 bx = 0; bx < width; bx += 4, blocks += blockSize) {
+                unsigned char texels[16][4];
+                for (UI32 y = 0; y < 4; y++) {
+                    for (UI32 x = 0; x < 4; x++) {
+                        UI32 sx = std::min(bx + x, width - 1);
+                        UI32 sy = std::min(by + y, height - 1);
+                        memcpy(texels[4 * y + x], rgba + (static_cast<size_t>(sy) * width + sx) * 4, 4);
+                    }
+                }
+
+                switch (format) {
+                case VK_FORMAT_BC1_RGB_UNORM_BLOCK:
+                case VK_FORMAT_BC1_RGB_SRGB_BLOCK:
+                case VK_FORMAT_BC1_RGBA_UNORM_BLOCK:
+                case VK_FORMAT_BC1_RGBA_SRGB_BLOCK:
+                    encodeColourBlock(texels, blocks);
+                    break;
+                case VK_FORMAT_BC3_UNORM_BLOCK:
+                case VK_FORMAT_BC3_SRGB_BLOCK:
+                    encodeChannelBlock(texels, 3, blocks);
+                    encodeColourBlock(texels, blocks + 8);
+                    break;
+                case VK_FORMAT_BC4_UNORM_BLOCK:
+                    encodeChannelBlock(texels, 0, blocks);
+                    break;
+                case VK_FORMAT_BC5_UNORM_BLOCK:
+                    encodeChannelBlock(texels, 0, blocks);
+                    encodeChannelBlock(texels, 1, blocks + 8);
+                    break;
+                default:
+                    encodeBc7Block(texels, blocks);
+                    break;
+                }
+            }
+        }
+    }
+
+    //-Whole images----------------------------------------------------------------------------------------------//
+    Image decodeImage(const Image& image, std::vector<unsigned char>* storage) {
+        Image decoded{};
+        decoded.width       = image.width;
+        decoded.height      = image.height;
+        decoded.format      = getDecodedFormat(image.format);
+        decoded.arrayLayers = image.arrayLayers;
+        if (decoded.format == VK_FORMAT_UNDEFINED) {
+            throw std::runtime_error("cannot decode block compressed format!");
+        }
+
+        UI32 numLevels = image.levelOffsets.empty() ? 1 : static_cast<UI32>(image.levelOffsets.size());
+        VkDeviceSize size = 0;
+        for (UI32 level = 0; level < numLevels; level++) {
+            decoded.levelOffsets.push_back(size);
+            size += image.arrayLayers * VulkanImage::getLevelSize(decoded.format, getMipDimension(image.width, level),
+                getMipDimension(image.height, level));
+        }
+        storage->resize(static_cast<size_t>(size));
+
+        for (UI32 level = 0; level < numLevels; level++) {
+            UI32 width  = getMipDimension(image.width, level);
+            UI32 height = getMipDimension(image.height, level);
+            VkDeviceSize srcLayerSize = VulkanImage::getLevelSize(image.format, width, height);
+            VkDeviceSize dstLayerSize = VulkanImage::getLevelSize(decoded.format, width, height);
+            const unsigned char* src = image.imageData.data + (image.levelOffsets.empty() ? 0 : image.levelOffsets[level]);
+            unsigned char* dst = storage->data() + decoded.levelOffsets[level];
+            for (UI32 layer = 0; layer < image.arrayLayers; layer++) {
+                decodeBlocks(image.format, src + layer * srcLayerSize, width, height, dst + layer * dstLayerSize);
+            }
+        }
+
+        // a single level keeps the chain generated on upload
+        if (image.levelOffsets.empty()) {
+            decoded.levelOffsets.clear();
+        }
+        decoded.imageData = { storage->data(), storage->size() };
+        return decoded;
+    }
+}
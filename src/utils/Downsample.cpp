@@ -0,0 +1,62 @@
+//
+// Definition of the CPU image downsampler
+//
+
+#include <utils/Downsample.h>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+#define DOWNSAMPLE_SSE2
+#include <emmintrin.h>
+#endif
+
+namespace utils {
+    // averages the 2x2 block of texels at (x0, x1) in rows r0 and r1, rounding to nearest
+    static inline void averageTexel(const unsigned char* r0, const unsigned char* r1, UI32 x0, UI32 x1, UI32 texelSize, 
+        unsigned char* dst) {
+        for (UI32 c = 0; c < texelSize; c++) {
+            UI32 sum = r0[x0 * texelSize + c] + r0[x1 * texelSize + c] + r1[x0 * texelSize + c] + r1[x1 * texelSize + c];
+            dst[c] = static_cast<unsigned char>((sum + 2) >> 2);
+        }
+    }
+
+    void downsampleImage(const unsigned char* src, UI32 width, UI32 height, UI32 texelSize, unsigned char* dst) {
+        UI32 dstWidth  = getMipDimension(width, 1);
+        UI32 dstHeight = getMipDimension(height, 1);
+        size_t srcPitch = static_cast<size_t>(width) * texelSize;
+        size_t dstPitch = static_cast<size_t>(dstWidth) * texelSize;
+
+        for (UI32 y = 0; y < dstHeight; y++) {
+            // a single row or column is averaged with itself
+            const unsigned char* r0 = src + srcPitch * (2 * y < height ? 2 * y : height - 1);
+            const unsigned char* r1 = src + srcPitch * (2 * y + 1 < height ? 2 * y + 1 : height - 1);
+            unsigned char* out = dst + dstPitch * y;
+
+            UI32 x = 0;
+#ifdef DOWNSAMPLE_SSE2
+            if (texelSize == 4 && width > 1) {
+                const __m128i zero = _mm_setzero_si128();
+                const __m128i two = _mm_set1_epi16(2);
+                // four source texels, two output texels, at a time
+                for (; 2 * x + 3 < width && x + 1 < dstWidth; x += 2) {
+                    __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(r0 + 8 * x));
+                    __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(r1 + 8 * x));
+                    // vertical sums of texels 0 and 1, then 2 and 3, as 16 bit channels
+                    __m128i lo = _mm_add_epi16(_mm_unpacklo_epi8(a, zero), _mm_unpacklo_epi8(b, zero));
+                    __m128i hi = _mm_add_epi16(_mm_unpackhi_epi8(a, zero), _mm_unpackhi_epi8(b, zero));
+                    // horizontal sums of each pair land in the low four channels
+                    lo = _mm_add_epi16(lo, _mm_srli_si128(lo, 8));
+                    hi = _mm_add_epi16(hi, _mm_srli_si128(hi, 8));
+                    __m128i sum = _mm_unpacklo_epi64(lo, hi);
+                    sum = _mm_srli_epi16(_mm_add_epi16(sum, two), 2);
+                    _mm_storel_epi64(reinterpret_cast<__m128i*>(out + 4 * x), _mm_packus_epi16(sum, zero));
+                }
+            }
+#endif
+            for (; x < dstWidth; x++) {
+                UI32 x0 = 2 * x < width ? 2 * x : width - 1;
+                UI32 x1 = 2 * x + 1 < width ? 2 * x + 1 : width - 1;
+                averageTexel(r0, r1, x0, x1, texelSize, out + x * texelSize);
+            }
+        }
+    }
+}
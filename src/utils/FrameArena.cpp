@@ -0,0 +1,45 @@
+//
+// Definition of the FrameArena class
+//
+
+#include <utils/FrameArena.h>
+
+#include <algorithm> // max
+#include <cstdint> // uintptr_t
+#include <stdexcept>
+
+void FrameArena::createFrameArena(size_t theFrameSize, UI32 theNumFrames) {
+    // partitions start on a max_align_t boundary like the block itself
+    const size_t blockAlignment = alignof(std::max_align_t);
+    frameSize = (theFrameSize + blockAlignment - 1) / blockAlignment * blockAlignment;
+    numFrames = theNumFrames;
+
+    memory.reset(new unsigned char[frameSize * numFrames]);
+
+    frameBegin = head = 0;
+    peakUsage = 0;
+}
+
+void FrameArena::cleanupFrameArena() {
+    memory.reset();
+    frameSize = 0;
+    numFrames = 0;
+    frameBegin = head = 0;
+}
+
+void FrameArena::beginFrame(UI32 frameIdx) {
+    frameBegin = head = frameSize * (frameIdx % numFrames);
+}
+
+void* FrameArena::allocate(size_t size, size_t alignment) {
+    // align the address rather than the offset so alignments beyond the block's own are honoured
+    uintptr_t base = reinterpret_cast<uintptr_t>(memory.get());
+    size_t offset = static_cast<size_t>((base + head + alignment - 1) / alignment * alignment - base);
+    if (offset + size > frameBegin + frameSize) {
+        throw std::runtime_error("frame arena partition is full!");
+    }
+
+    head = offset + size;
+    peakUsage = std::max(peakUsage, head - frameBegin);
+    return memory.get() + offset;
+}
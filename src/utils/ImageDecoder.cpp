@@ -0,0 +1,96 @@
+//
+// Definition of the ImageDecoder class
+//
+
+#include <utils/ImageDecoder.h>
+
+#include <algorithm> // swap_ranges
+#include <stdexcept>
+#include <utility> // move
+
+// image loading
+#include <stb_image.h>
+
+ImageDecoder::ImageDecoder(ThreadPool* pPool) : pool(pPool) {}
+
+ImageDecoder::~ImageDecoder() {
+    // workers reference the decoder until their task returns
+    for (auto& future : futures) {
+        future.wait();
+    }
+}
+
+UI32 ImageDecoder::decodeFile(const std::string& path, int numChannels, bool flipVertically) {
+    return submit([path, numChannels](int* width, int* height, int* channels) {
+        return stbi_load(path.c_str(), width, height, channels, numChannels);
+    }, numChannels, flipVertically, path);
+}
+
+UI32 ImageDecoder::decodeMemory(const unsigned char* data, size_t size, int numChannels, bool flipVertically) {
+    return submit([data, size, numChannels](int* width, int* height, int* channels) {
+        return stbi_load_from_memory(data, static_cast<int>(size), width, height, channels, numChannels);
+    }, numChannels, flipVertically, "from memory");
+}
+
+bool ImageDecoder::next(Result* result) {
+    if (numCollected == numSubmitted) {
+        return false;
+    }
+
+    Completed done;
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        condition.wait(lock, [this]() { return !completed.empty(); });
+        done = std::move(completed.front());
+        completed.pop_front();
+    }
+    numCollected++;
+
+    if (done.error) {
+        std::rethrow_exception(done.error);
+    }
+    *result = std::move(done.result);
+    return true;
+}
+
+UI32 ImageDecoder::submit(DecodeFunction&& decode, int numChannels, bool flipVertically, const std::string& name) {
+    UI32 id = numSubmitted++;
+
+    futures.push_back(pool->submit([this, id, decode = std::move(decode), numChannels, flipVertically, name]() {
+        Completed done;
+        done.result.id = id;
+        try {
+            int width, height, fileChannels;
+            unsigned char* pixels = decode(&width, &height, &fileChannels);
+            if (!pixels) {
+                throw std::runtime_error("failed to load texture image " + name + "!");
+            }
+            done.result.pixels = std::unique_ptr<unsigned char, void(*)(void*)>(pixels, stbi_image_free);
+
+            // stb_image reports the file's channels even when others were asked for
+            int channels = numChannels ? numChannels : fileChannels;
+            size_t rowSize = static_cast<size_t>(width) * channels;
+            if (flipVertically) {
+                for (int y = 0; y < height / 2; y++) {
+                    std::swap_ranges(pixels + y * rowSize, pixels + (y + 1) * rowSize, pixels + (height - 1 - y) * rowSize);
+                }
+            }
+
+            done.result.image.width     = static_cast<UI32>(width);
+            done.result.image.height    = static_cast<UI32>(height);
+            done.result.image.format    = VulkanImage::getImageFormat(channels);
+            done.result.image.imageData = { pixels, rowSize * height };
+        }
+        catch (...) {
+            done.error = std::current_exception();
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            completed.push_back(std::move(done));
+        }
+        condition.notify_one();
+    }));
+
+    return id;
+}
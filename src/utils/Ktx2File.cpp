@@ -0,0 +1,317 @@
+//
+// Definition of the Ktx2File class
+//
+
+#include <utils/Ktx2File.h>
+#include <utils/BlockCompression.h>
+#include <utils/Downsample.h>
+#include <utils/Print.h>
+
+#include <algorithm> // min, max
+#include <chrono> // conversion timing
+#include <cstring> // memcmp, memcpy
+#include <fstream>
+#include <stdexcept>
+
+// image loading
+#include <stb_image.h>
+
+namespace {
+    //-File layout, every field is little endian-----------------------------------------------------------------//
+    const unsigned char KTX2_IDENTIFIER[12] = { 0xab, 'K', 'T', 'X', ' ', '2', '0', 0xbb, '\r', '\n', 0x1a, '\n' };
+
+    struct Header {
+        unsigned char identifier[12];
+        UI32 vkFormat;
+        UI32 typeSize;
+        UI32 pixelWidth;
+        UI32 pixelHeight;
+        UI32 pixelDepth;
+        UI32 layerCount; // 0 when the texture is not an array
+        UI32 faceCount;
+        UI32 levelCount;
+        UI32 supercompressionScheme;
+        UI32 dfdByteOffset;
+        UI32 dfdByteLength;
+        UI32 kvdByteOffset;
+        UI32 kvdByteLength;
+        UI64 sgdByteOffset;
+        UI64 sgdByteLength;
+    };
+    static_assert(sizeof(Header) == 80, "the ktx2 header is 80 bytes");
+
+    struct LevelIndex {
+        UI64 byteOffset;
+        UI64 byteLength;
+        UI64 uncompressedByteLength;
+    };
+
+    // khronos data format descriptor colour models and channels of the block compressed formats
+    const UI32 DF_MODEL_BC1A = 128;
+    const UI32 DF_MODEL_BC3  = 130;
+    const UI32 DF_MODEL_BC4  = 131;
+    const UI32 DF_MODEL_BC5  = 132;
+    const UI32 DF_MODEL_BC7  = 134;
+
+    const UI32 DF_CHANNEL_COLOUR        = 0;
+    const UI32 DF_CHANNEL_ALPHA_PRESENT = 1; // bc1 with punch through alpha
+    const UI32 DF_CHANNEL_GREEN         = 1; // second channel of bc5
+    const UI32 DF_CHANNEL_ALPHA         = 15;
+
+    bool isSrgb(VkFormat format) {
+        return format == VK_FORMAT_BC1_RGB_SRGB_BLOCK || format == VK_FORMAT_BC1_RGBA_SRGB_BLOCK ||
+            format == VK_FORMAT_BC3_SRGB_BLOCK || format == VK_FORMAT_BC7_SRGB_BLOCK;
+    }
+
+    // a basic descriptor block with a sample per 64 bit half of the block
+    std::vector<UI32> getDataFormatDescriptor(VkFormat format) {
+        UI32 model;
+        std::vector<UI32> channels;
+        switch (format) {
+        case VK_FORMAT_BC1_RGB_UNORM_BLOCK:
+        case VK_FORMAT_BC1_RGB_SRGB_BLOCK:
+            model = DF_MODEL_BC1A;
+            channels = { DF_CHANNEL_COLOUR };
+            break;
+        case VK_FORMAT_BC1_RGBA_UNORM_BLOCK:
+        case VK_FORMAT_BC1_RGBA_SRGB_BLOCK:
+            model = DF_MODEL_BC1A;
+            channels = { DF_CHANNEL_ALPHA_PRESENT };
+            break;
+        case VK_FORMAT_BC3_UNORM_BLOCK:
+        case VK_FORMAT_BC3_SRGB_BLOCK:
+            model = DF_MODEL_BC3;
+            channels = { DF_CHANNEL_ALPHA, DF_CHANNEL_COLOUR };
+            break;
+        case VK_FORMAT_BC4_UNORM_BLOCK:
+            model = DF_MODEL_BC4;
+            channels = { DF_CHANNEL_COLOUR };
+            break;
+        case VK_FORMAT_BC5_UNORM_BLOCK:
+            model = DF_MODEL_BC5;
+            channels = { DF_CHANNEL_COLOUR, DF_CHANNEL_GREEN };
+            break;
+        case VK_FORMAT_BC7_UNORM_BLOCK:
+        case VK_FORMAT_BC7_SRGB_BLOCK:
+            model = DF_MODEL_BC7;
+            channels = { DF_CHANNEL_COLOUR };
+            break;
+        default:
+            throw std::runtime_error("no data format descriptor for the texture's format!");
+        }
+
+        UI32 blockSize = VulkanImage::getFormatTexelSize(format);
+        UI32 sampleBits = 8 * blockSize / static_cast<UI32>(channels.size());
+        UI32 descriptorBlockSize = 24 + 16 * static_cast<UI32>(channels.size());
+
+        std::vector<UI32> words = {
+            4 + descriptorBlockSize, // total size
+            0, // khronos vendor, basic descriptor type
+            2 | (descriptorBlockSize << 16), // version
+            model | (1 << 8) | ((isSrgb(format) ? 2u : 1u) << 16), // bt709 primaries, srgb or linear transfer, straight alpha
+            3 | (3 << 8), // 4x4 texel blocks
+            blockSize, // bytes in the first plane
+            0
+        };
+        for (UI32 i = 0; i < channels.size(); i++) {
+            words.push_back(i * sampleBits | ((sampleBits - 1) << 16) | (channels[i] << 24));
+            words.push_back(0); // sample position
+            words.push_back(0); // lower
+            words.push_back(0xffffffff); // upper
+        }
+        return words;
+    }
+
+    inline UI64 alignUp(UI64 value, UI64 alignment) {
+        return (value + alignment - 1) / alignment * alignment;
+    }
+}
+
+void Ktx2File::load(const std::string& path) {
+    file.map(path);
+
+    Header header;
+    if (file.size < sizeof(Header) || memcmp(file.data, KTX2_IDENTIFIER, sizeof(KTX2_IDENTIFIER)) != 0) {
+        throw std::runtime_error(path + " is not a ktx2 file!");
+    }
+    memcpy(&header, file.data, sizeof(Header));
+
+    VkFormat format = static_cast<VkFormat>(header.vkFormat);
+    if (header.supercompressionScheme != 0) {
+        throw std::runtime_error("supercompressed ktx2 files are not supported, " + path + "!");
+    }
+    if (utils::getDecodedFormat(format) == VK_FORMAT_UNDEFINED) {
+        throw std::runtime_error("ktx2 file " + path + " is not in a supported block compressed format!");
+    }
+    if (header.pixelWidth == 0 || header.pixelHeight == 0 || header.pixelDepth != 0 || header.layerCount > 1 ||
+        (header.faceCount != 1 && header.faceCount != 6)) {
+        throw std::runtime_error("ktx2 file " + path + " is not a 2d texture or cube map!");
+    }
+    // a level count of 0 asks for the chain to be generated, which cannot be done for compressed data
+    if (header.levelCount == 0 || header.levelCount > VulkanImage::getMipLevels(header.pixelWidth, header.pixelHeight)) {
+        throw std::runtime_error("ktx2 file " + path + " has an invalid number of mip levels!");
+    }
+    if (file.size < sizeof(Header) + header.levelCount * sizeof(LevelIndex)) {
+        throw std::runtime_error("ktx2 file " + path + " is truncated!");
+    }
+
+    image = Image{};
+    image.width       = header.pixelWidth;
+    image.height      = header.pixelHeight;
+    image.format      = format;
+    image.arrayLayers = header.faceCount;
+
+    // levels are stored smallest first, the image's data starts at the smallest and ends with level 0
+    UI64 blockSize = VulkanImage::getFormatTexelSize(format);
+    UI64 begin = file.size;
+    UI64 end   = 0;
+    std::vector<UI64> offsets(header.levelCount);
+    for (UI32 level = 0; level < header.levelCount; level++) {
+        LevelIndex index;
+        memcpy(&index, file.data + sizeof(Header) + level * sizeof(LevelIndex), sizeof(LevelIndex));
+
+        UI64 levelSize = header.faceCount * VulkanImage::getLevelSize(format, utils::getMipDimension(header.pixelWidth, level),
+            utils::getMipDimension(header.pixelHeight, level));
+        if (index.byteLength != levelSize || index.byteOffset % blockSize != 0 || index.byteOffset > file.size ||
+            index.byteLength > file.size - index.byteOffset) {
+            throw std::runtime_error("ktx2 file " + path + " has an invalid level index!");
+        }
+        offsets[level] = index.byteOffset;
+        begin = std::min(begin, index.byteOffset);
+        end   = std::max(end, index.byteOffset + index.byteLength);
+    }
+
+    for (UI64 offset : offsets) {
+        image.levelOffsets.push_back(offset - begin);
+    }
+    image.imageData = { file.data + begin, static_cast<size_t>(end - begin) };
+}
+
+void Ktx2File::write(const std::string& path, const Image& image) {
+    if (!VulkanImage::formatIsBlockCompressed(image.format)) {
+        throw std::runtime_error("only block compressed images are written to ktx2 files!");
+    }
+
+    UI32 numLevels = image.levelOffsets.empty() ? 1 : static_cast<UI32>(image.levelOffsets.size());
+    std::vector<UI32> dfd = getDataFormatDescriptor(image.format);
+
+    Header header{};
+    memcpy(header.identifier, KTX2_IDENTIFIER, sizeof(KTX2_IDENTIFIER));
+    header.vkFormat      = static_cast<UI32>(image.format);
+    header.typeSize      = 1;
+    header.pixelWidth    = image.width;
+    header.pixelHeight   = image.height;
+    header.faceCount     = image.arrayLayers;
+    header.levelCount    = numLevels;
+    header.dfdByteOffset = static_cast<UI32>(sizeof(Header) + numLevels * sizeof(LevelIndex));
+    header.dfdByteLength = static_cast<UI32>(dfd.size() * sizeof(UI32));
+
+    // level data is aligned to the block size, from the smallest level up to level 0
+    UI64 blockSize = VulkanImage::getFormatTexelSize(image.format);
+    std::vector<LevelIndex> levels(numLevels);
+    UI64 offset = header.dfdByteOffset + header.dfdByteLength;
+    for (UI32 level = numLevels; level-- > 0;) {
+        offset = alignUp(offset, blockSize);
+        levels[level].byteOffset = offset;
+        levels[level].byteLength = image.arrayLayers * VulkanImage::getLevelSize(image.format,
+            utils::getMipDimension(image.width, level), utils::getMipDimension(image.height, level));
+        levels[level].uncompressedByteLength = levels[level].byteLength;
+        offset += levels[level].byteLength;
+    }
+
+    std::vector<unsigned char> contents(static_cast<size_t>(offset), 0);
+    memcpy(contents.data(), &header, sizeof(Header));
+    memcpy(contents.data() + sizeof(Header), levels.data(), levels.size() * sizeof(LevelIndex));
+    memcpy(contents.data() + header.dfdByteOffset, dfd.data(), header.dfdByteLength);
+    for (UI32 level = 0; level < numLevels; level++) {
+        const unsigned char* src = image.imageData.data + (image.levelOffsets.empty() ? 0 : image.levelOffsets[level]);
+        memcpy(contents.data() + levels[level].byteOffset, src, static_cast<size_t>(levels[level].byteLength));
+    }
+
+    std::ofstream out(path, std::ios::binary);
+    if (!out.write(reinterpret_cast<const char*>(contents.data()), contents.size())) {
+        throw std::runtime_error("failed to write ktx2 file " + path + "!");
+    }
+}
+
+void Ktx2File::convert(const std::vector<std::string>& inputs, const std::string& output, VkFormat format) {
+    if (inputs.size() != 1 && inputs.size() != 6) {
+        throw std::runtime_error("a ktx2 texture is converted from one image or six cube map faces!");
+    }
+    if (utils::getDecodedFormat(format) == VK_FORMAT_UNDEFINED) {
+        throw std::runtime_error("cannot convert to the requested format!");
+    }
+
+    auto start = std::chrono::high_resolution_clock::now();
+
+    // cube map faces are flipped like the skybox's own faces, so the layers match whichever source it loads
+    stbi_set_flip_vertically_on_load(inputs.size() == 6);
+
+    // every face's level 0, forced to four channels as the encoder expects
+    int width = 0;
+    int height = 0;
+    std::vector<std::vector<unsigned char>> faces;
+    for (const auto& input : inputs) {
+        int faceWidth, faceHeight, channels;
+        unsigned char* pixels = stbi_load(input.c_str(), &faceWidth, &faceHeight, &channels, STBI_rgb_alpha);
+        if (!pixels) {
+            throw std::runtime_error("failed to load texture image " + input + "!");
+        }
+        if (!faces.empty() && (faceWidth != width || faceHeight != height)) {
+            stbi_image_free(pixels);
+            throw std::runtime_error("cube map faces must have the same dimensions!");
+        }
+        width = faceWidth;
+        height = faceHeight;
+        faces.emplace_back(pixels, pixels + static_cast<size_t>(width) * height * 4);
+        stbi_image_free(pixels);
+    }
+    stbi_set_flip_vertically_on_load(false);
+
+    Image image{};
+    image.width       = static_cast<UI32>(width);
+    image.height      = static_cast<UI32>(height);
+    image.format      = format;
+    image.arrayLayers = static_cast<UI32>(faces.size());
+
+    // levels back to back from level 0, each holding its faces in turn
+    UI32 numLevels = VulkanImage::getMipLevels(image.width, image.height);
+    VkDeviceSize size = 0;
+    for (UI32 level = 0; level < numLevels; level++) {
+        image.levelOffsets.push_back(size);
+        size += image.arrayLayers * VulkanImage::getLevelSize(format, utils::getMipDimension(image.width, level),
+            utils::getMipDimension(image.height, level));
+    }
+    std::vector<unsigned char> blocks(static_cast<size_t>(size));
+    image.imageData = { blocks.data(), blocks.size() };
+
+    std::vector<unsigned char> nextLevel;
+    for (UI32 level = 0; level < numLevels; level++) {
+        UI32 levelWidth  = utils::getMipDimension(image.width, level);
+        UI32 levelHeight = utils::getMipDimension(image.height, level);
+        VkDeviceSize layerSize = VulkanImage::getLevelSize(format, levelWidth, levelHeight);
+        for (UI32 face = 0; face < image.arrayLayers; face++) {
+            utils::encodeBlocks(format, faces[face].data(), levelWidth, levelHeight,
+                blocks.data() + image.levelOffsets[level] + face * layerSize);
+
+            // the level below is filtered from the uncompressed level, not the decoded blocks
+            if (level + 1 < numLevels) {
+                nextLevel.resize(static_cast<size_t>(4) * utils::getMipDimension(levelWidth, 1) * utils::getMipDimension(levelHeight, 1));
+                utils::downsampleImage(faces[face].data(), levelWidth, levelHeight, 4, nextLevel.data());
+                faces[face].swap(nextLevel);
+            }
+        }
+    }
+
+    write(output, image);
+
+    auto end = std::chrono::high_resolution_clock::now();
+    VkDeviceSize uncompressedSize = 0;
+    for (UI32 level = 0; level < numLevels; level++) {
+        uncompressedSize += image.arrayLayers * VulkanImage::getLevelSize(utils::getDecodedFormat(format),
+            utils::getMipDimension(image.width, level), utils::getMipDimension(image.height, level));
+    }
+    PRINT("converted %zu image(s) to %s: %ux%u, %u levels, %llu bytes (%llu decoded) in %.2f ms\n", inputs.size(), output.c_str(),
+        image.width, image.height, numLevels, static_cast<unsigned long long>(size), static_cast<unsigned long long>(uncompressedSize),
+        std::chrono::duration<double, std::milli>(end - start).count());
+}
@@ -18,7 +18,11 @@ void Loader::loadGltfScene(const std::string& path) {
 	std::string err;
 	std::string warn;
 
-	bool ret = loader.LoadASCIIFromFile(&model, &err, &warn, path);
+	// binary gltf files hold the json and buffers in a single file
+	bool isBinary = path.size() > 4 && path.compare(path.size() - 4, 4, ".glb") == 0;
+
+	bool ret = isBinary ? loader.LoadBinaryFromFile(&model, &err, &warn, path) 
+		: loader.LoadASCIIFromFile(&model, &err, &warn, path);
 
 	if (!warn.empty()) {
 		std::cout << warn;
@@ -0,0 +1,60 @@
+//
+// Definition of the ThreadPool class
+//
+
+#include <utils/ThreadPool.h>
+
+#include <algorithm> // max
+
+ThreadPool::ThreadPool(UI32 numThreads) {
+    // hardware_concurrency may return 0 when it cannot tell
+    numThreads = std::max(numThreads, 1u);
+    workers.reserve(numThreads);
+    for (UI32 i = 0; i < numThreads; i++) {
+        workers.emplace_back(&ThreadPool::workerLoop, this);
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    condition.notify_all();
+    for (auto& worker : workers) {
+        worker.join();
+    }
+}
+
+void ThreadPool::parallelFor(size_t count, const std::function<void(size_t)>& body) {
+    std::vector<std::future<void>> futures;
+    futures.reserve(count);
+    for (size_t i = 0; i < count; i++) {
+        futures.push_back(submit([&body, i]() { body(i); }));
+    }
+
+    // wait for every task before rethrowing, the body is referenced by tasks that may still be queued
+    for (auto& future : futures) {
+        future.wait();
+    }
+    for (auto& future : futures) {
+        future.get();
+    }
+}
+
+void ThreadPool::workerLoop() {
+    for (;;) {
+        std::function<void()> task;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            condition.wait(lock, [this]() { return stopping || !tasks.empty(); });
+            // drain the queue before stopping so that no future is left without a result
+            if (tasks.empty()) {
+                return;
+            }
+            task = std::move(tasks.front());
+            tasks.pop();
+        }
+        task();
+    }
+}
@@ -20,6 +20,19 @@ namespace utils {
 
         int i = 0;
         for (const auto& queueFamily : queueFamilies) {
+            // transfer only families are usually backed by the copy engines, prefer them over families that can also
+            // compute. Every family is visited for these, so the graphics and present search keeps the first valid ones
+            if ((queueFamily.queueFlags & VK_QUEUE_TRANSFER_BIT) && !(queueFamily.queueFlags & VK_QUEUE_GRAPHICS_BIT)) {
+                if (!indices.transferFamily.has_value() || !(queueFamily.queueFlags & VK_QUEUE_COMPUTE_BIT)) {
+                    indices.transferFamily = i;
+                }
+            }
+
+            if (indices.isComplete()) {
+                i++;
+                continue;
+            }
+
             // if the queue supports the desired queue operation, then the bitwise & operator returns true
             if (queueFamily.queueFlags & VK_QUEUE_GRAPHICS_BIT) {
                 // gaphics family was assigned a value! optional wrapper has_value now returns true.
@@ -33,11 +46,6 @@ namespace utils {
             if (presentSupport) {
                 indices.presentFamily = i;
             }
-
-            // return the first valid queue family
-            if (indices.isComplete()) {
-                break;
-            }
             i++;
         }
         return indices;